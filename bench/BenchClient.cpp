@@ -0,0 +1,432 @@
+// RSP client for benchmarking the server: definition
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "BenchClient.h"
+
+using std::cerr;
+using std::endl;
+using std::fixed;
+using std::left;
+using std::right;
+using std::setprecision;
+using std::setw;
+using std::string;
+using std::chrono::duration;
+using std::chrono::steady_clock;
+
+
+//! Constructor
+
+//! @param[in] _fd  The connection to the server
+
+BenchClient::BenchClient (int  _fd) :
+  mFd (_fd),
+  mLoop (nullptr),
+  mNoAckMode (false),
+  mRxHead (0),
+  mRxCount (0)
+{
+}	// BenchClient ()
+
+
+//! Constructor for a loopback connection
+
+//! @param[in] _loop  The connection to the server
+
+BenchClient::BenchClient (LoopbackConnection *_loop) :
+  mFd (-1),
+  mLoop (_loop),
+  mNoAckMode (false),
+  mRxHead (0),
+  mRxCount (0)
+{
+}	// BenchClient ()
+
+
+//! Destructor
+
+//! The connection belongs to the caller, so we leave it open.
+
+BenchClient::~BenchClient ()
+{
+}	// ~BenchClient ()
+
+
+//! Make a request and wait for the reply
+
+//! A monitor command may send console output before its reply, which we
+//! count as part of the reply.  Once the server agrees to no-ack mode, we
+//! stop acknowledging.
+
+//! @param[in]  payload  The packet to send, as on the wire
+//! @param[out] reply    The reply, as on the wire
+//! @return  TRUE if we got a reply, FALSE if the connection failed.
+
+bool
+BenchClient::request (const string & payload,
+		      string & reply)
+{
+  steady_clock::time_point  start = steady_clock::now ();
+  uint64_t  bytesIn = 0;
+  bool      isCmd = 0 == payload.compare (0, strlen ("qRcmd,"), "qRcmd,");
+
+  if (!putFrame (payload))
+    return  false;
+
+  do
+    {
+      if (!getReply (reply, bytesIn))
+	return  false;
+    }
+  while (isCmd && ('O' == reply[0]) && ("OK" != reply));
+
+  double  elapsed = duration <double> (steady_clock::now () - start).count ();
+  Stats & st = mStats[pktType (payload)];
+
+  if (0 == st.count)
+    {
+      st.min = elapsed;
+      st.max = elapsed;
+    }
+  else
+    {
+      st.min = (elapsed < st.min) ? elapsed : st.min;
+      st.max = (elapsed > st.max) ? elapsed : st.max;
+    }
+
+  st.count++;
+  st.bytesOut += payload.size () + 4;
+  st.bytesIn  += bytesIn;
+  st.total    += elapsed;
+
+  if (("QStartNoAckMode" == payload) && ("OK" == reply))
+    mNoAckMode = true;
+
+  return  true;
+
+}	// request ()
+
+
+//! Send a packet which gets no reply (such as 'k')
+
+//! @param[in] payload  The packet to send, as on the wire
+//! @return  TRUE if the packet was sent, FALSE if the connection failed.
+
+bool
+BenchClient::send (const string & payload)
+{
+  return  putFrame (payload);
+
+}	// send ()
+
+
+//! Close our side of the connection
+
+//! The server will see the connection close.  This is for giving up, when
+//! we can't send a kill.
+
+void
+BenchClient::close ()
+{
+  if (nullptr != mLoop)
+    mLoop->clientClose ();
+  else
+    shutdown (mFd, SHUT_RDWR);
+
+}	// close ()
+
+
+//! Report the statistics for each type of packet
+
+//! Latencies are in microseconds, and the throughput counts the bytes both
+//! ways over the total latency.
+
+//! @param[in] s  The stream for the report
+
+void
+BenchClient::report (std::ostream & s) const
+{
+  s << left << setw (16) << "Packet" << right
+    << setw (10) << "Count"
+    << setw (12) << "Mean(us)"
+    << setw (12) << "Min(us)"
+    << setw (12) << "Max(us)"
+    << setw (14) << "Out(bytes)"
+    << setw (14) << "In(bytes)"
+    << setw (10) << "MB/s" << endl;
+
+  for (auto  it = mStats.begin (); it != mStats.end (); it++)
+    {
+      const Stats & st = it->second;
+      double  mbps = (st.total > 0.0)
+	? static_cast<double> (st.bytesOut + st.bytesIn) / st.total / 1.0e6
+	: 0.0;
+
+      s << left << setw (16) << it->first << right
+	<< setw (10) << st.count
+	<< fixed << setprecision (1)
+	<< setw (12) << (st.total / st.count * 1.0e6)
+	<< setw (12) << (st.min * 1.0e6)
+	<< setw (12) << (st.max * 1.0e6)
+	<< setw (14) << st.bytesOut
+	<< setw (14) << st.bytesIn
+	<< setprecision (2)
+	<< setw (10) << mbps << endl;
+    }
+}	// report ()
+
+
+//! Forget all the statistics so far
+
+void
+BenchClient::clearStats ()
+{
+  mStats.clear ();
+
+}	// clearStats ()
+
+
+//! Send a packet, with its framing and checksum
+
+//! Unless in no-ack mode, we wait for the server to acknowledge it, and
+//! send it again if asked to.
+
+//! @param[in] payload  The packet to send, as on the wire
+//! @return  TRUE if the packet was sent, FALSE if the connection failed.
+
+bool
+BenchClient::putFrame (const string & payload)
+{
+  unsigned char  checksum = 0;
+
+  for (auto  it = payload.begin (); it != payload.end (); it++)
+    checksum += static_cast<unsigned char> (*it);
+
+  char  tail[4];
+
+  sprintf (tail, "#%02x", checksum);
+  string  frame = "$" + payload + tail;
+
+  for (;;)
+    {
+      if (!putRaw (frame.data (), frame.size ()))
+	return  false;
+
+      if (mNoAckMode)
+	return  true;
+
+      int  ch = getChar ();
+
+      if ('+' == ch)
+	return  true;
+      else if ('-' != ch)
+	{
+	  cerr << "ERROR: Bad acknowledgement from server" << endl;
+	  return  false;
+	}
+    }
+}	// putFrame ()
+
+
+//! Get a reply packet from the server
+
+//! We check the checksum and acknowledge the packet, unless in no-ack
+//! mode.  Anything before the '$' (such as a notification) is skipped.  Any
+//! run length encoding is expanded, but the bytes counted are those on the
+//! wire.
+
+//! @param[out]    reply    The reply, as on the wire
+//! @param[in,out] bytesIn  Added to with the bytes received
+//! @return  TRUE if we got a reply, FALSE if the connection failed.
+
+bool
+BenchClient::getReply (string & reply,
+		       uint64_t & bytesIn)
+{
+  int  ch;
+
+  do
+    {
+      if (-1 == (ch = getChar ()))
+	return  false;
+
+      bytesIn++;
+    }
+  while ('$' != ch);
+
+  unsigned char  checksum = 0;
+  uint64_t       wireLen  = 0;
+
+  reply.clear ();
+
+  while ('#' != (ch = getChar ()))
+    {
+      if (-1 == ch)
+	return  false;
+
+      checksum += static_cast<unsigned char> (ch);
+      wireLen++;
+
+      // Expand a run, which repeats the char before count - 29 times
+      if (('*' == ch) && !reply.empty ())
+	{
+	  if (-1 == (ch = getChar ()))
+	    return  false;
+
+	  checksum += static_cast<unsigned char> (ch);
+	  wireLen++;
+	  reply.append (ch - 29, reply.back ());
+	}
+      else
+	reply.push_back (static_cast<char> (ch));
+    }
+
+  char  cs[3];
+
+  for (int  i = 0; i < 2; i++)
+    if (-1 == (ch = getChar ()))
+      return  false;
+    else
+      cs[i] = static_cast<char> (ch);
+
+  cs[2] = '\0';
+  bytesIn += wireLen + 3;
+
+  if (strtoul (cs, nullptr, 16) != checksum)
+    {
+      cerr << "ERROR: Bad checksum in reply from server" << endl;
+      return  false;
+    }
+
+  return  mNoAckMode || putRaw ("+", 1);
+
+}	// getReply ()
+
+
+//! Write to the server
+
+//! @param[in] buf  What to write
+//! @param[in] len  How much to write
+//! @return  TRUE if it was all written, FALSE otherwise.
+
+bool
+BenchClient::putRaw (const char *buf,
+		     std::size_t  len)
+{
+  if (nullptr != mLoop)
+    {
+      if (mLoop->clientWrite (buf, len))
+	return  true;
+
+      cerr << "ERROR: Failed to write to server: Connection closed" << endl;
+      return  false;
+    }
+
+  while (len > 0)
+    {
+      ssize_t  res = write (mFd, buf, len);
+
+      if (res < 0)
+	{
+	  if (EINTR == errno)
+	    continue;
+
+	  cerr << "ERROR: Failed to write to server: " << strerror (errno)
+	       << endl;
+	  return  false;
+	}
+
+      buf += res;
+      len -= res;
+    }
+
+  return  true;
+
+}	// putRaw ()
+
+
+//! Read a character from the server
+
+//! @return  The character, or -1 if the connection failed.
+
+int
+BenchClient::getChar ()
+{
+  while (0 == mRxCount)
+    {
+      ssize_t  res = (nullptr != mLoop)
+	? mLoop->clientRead (mRxBuf, RX_BUF_SIZE, true)
+	: read (mFd, mRxBuf, RX_BUF_SIZE);
+
+      if (res > 0)
+	{
+	  mRxHead  = 0;
+	  mRxCount = res;
+	}
+      else if ((0 == res) || (nullptr != mLoop) || (EINTR != errno))
+	return  -1;
+    }
+
+  mRxCount--;
+  return  static_cast<unsigned char> (mRxBuf[mRxHead++]);
+
+}	// getChar ()
+
+
+//! The type of a packet, for the statistics
+
+//! @param[in] payload  The packet
+//! @return  The type of the packet
+
+string
+BenchClient::pktType (const string & payload)
+{
+  if (payload.empty ())
+    return  "(empty)";
+
+  switch (payload[0])
+    {
+    case 'q':
+    case 'Q':
+    case 'v':
+      return  payload.substr (0, payload.find_first_of (":;,?"));
+
+    default:
+      return  payload.substr (0, 1);
+    }
+}	// pktType ()
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
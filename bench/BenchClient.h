@@ -0,0 +1,126 @@
+// RSP client for benchmarking the server: declaration
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef BENCH_CLIENT_H
+#define BENCH_CLIENT_H
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "LoopbackConnection.h"
+
+
+//! A minimal RSP client, which times every request it makes
+
+//! Packets are given as they go on the wire, between the '$' and the '#',
+//! so they must already be escaped.  Replies are returned the same way,
+//! except that any run length encoding is expanded.  We keep the latency
+//! and the bytes each way for each type of packet, which is the first
+//! character of the packet, or for 'q', 'Q' and 'v' packets, the name up to
+//! the first separator.
+
+//! We talk to the server either over a file descriptor, or over a loopback
+//! connection, as its client.
+
+class BenchClient
+{
+public:
+
+  // Constructor and destructor
+
+  BenchClient (int  _fd);
+  BenchClient (LoopbackConnection *_loop);
+  ~BenchClient ();
+
+  // Make requests
+
+  bool  request (const std::string & payload,
+		 std::string & reply);
+  bool  send (const std::string & payload);
+  void  close ();
+
+  // Statistics
+
+  void  report (std::ostream & s) const;
+  void  clearStats ();
+
+private:
+
+  //! Statistics for one type of packet
+
+  struct Stats
+  {
+    uint64_t  count;			//!< Requests made
+    uint64_t  bytesOut;			//!< Bytes sent, including framing
+    uint64_t  bytesIn;			//!< Bytes received, including framing
+    double    total;			//!< Total latency in seconds
+    double    min;			//!< Least latency in seconds
+    double    max;			//!< Greatest latency in seconds
+  };
+
+  //! Size of the receive buffer
+
+  static const int  RX_BUF_SIZE = 65536;
+
+  //! The connection to the server, or -1 if we are using a loopback
+
+  int  mFd;
+
+  //! The loopback connection to the server, if we are using one
+
+  LoopbackConnection *mLoop;
+
+  //! Whether we have negotiated no-ack mode
+
+  bool  mNoAckMode;
+
+  //! Statistics for each type of packet
+
+  std::map<std::string, Stats>  mStats;
+
+  //! Buffered input from the server
+
+  char  mRxBuf[RX_BUF_SIZE];
+  int   mRxHead;
+  int   mRxCount;
+
+  // Helper methods
+
+  bool  putFrame (const std::string & payload);
+  bool  getReply (std::string & reply,
+		  uint64_t & bytesIn);
+  bool  putRaw (const char *buf,
+		std::size_t  len);
+  int   getChar ();
+  static std::string  pktType (const std::string & payload);
+
+};	// class BenchClient
+
+#endif	// BENCH_CLIENT_H
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,482 @@
+// Null target for benchmarking the server: definition
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <cstring>
+
+#include "BenchTarget.h"
+
+
+//! Constructor
+
+//! @param[in] flags    The trace flags
+//! @param[in] memSize  The size of memory in bytes
+
+BenchTarget::BenchTarget (const TraceFlags * flags,
+			  std::size_t  memSize) :
+  ITarget (flags),
+  mMem (memSize, 0),
+  mInstrCount (0),
+  mWatchHit (nullptr),
+  mInsnTrace (nullptr),
+  mInsnTraceOn (false)
+{
+  for (int  r = 0; r < NUM_REGS; r++)
+    mRegs[r] = 0;
+
+}	// BenchTarget ()
+
+
+//! Destructor
+
+BenchTarget::~BenchTarget ()
+{
+  delete  mInsnTrace;
+
+}	// ~BenchTarget ()
+
+
+//! Resume execution
+
+//! A step just moves on the PC, recording the instruction it was at if we
+//! are recording instructions.  A continue stops at once, at the lowest
+//! byte watched if there is one, otherwise as though at a breakpoint.
+
+//! @param[in] step  The type of resume
+//! @return  The result of the resume
+
+ITarget::ResumeRes
+BenchTarget::resume (ResumeType step)
+{
+  mWatchHit = nullptr;
+
+  switch (step)
+    {
+    case ResumeType::STEP:
+      if (mInsnTraceOn)
+	{
+	  uint32_t  pc = mRegs[PC_REGNUM];
+	  uint8_t  buf[4];
+
+	  (void) read (pc, buf, sizeof (buf));
+	  mInsnTrace->record (pc,
+			      static_cast<uint32_t> (buf[0])
+			      | (static_cast<uint32_t> (buf[1]) << 8)
+			      | (static_cast<uint32_t> (buf[2]) << 16)
+			      | (static_cast<uint32_t> (buf[3]) << 24),
+			      mInstrCount);
+	}
+
+      mRegs[PC_REGNUM] += 4;
+      mInstrCount++;
+      return  ResumeRes::STEPPED;
+
+    case ResumeType::CONTINUE:
+      if (mWatches.empty ())
+	return  ResumeRes::INTERRUPTED;
+
+      mWatchHit = &(*mWatches.begin ());
+      return  ResumeRes::WATCHPOINT;
+
+    default:
+      return  ResumeRes::SUCCESS;
+    }
+}	// resume ()
+
+
+//! Resume execution with a timeout, which we never reach
+
+//! @param[in] step     The type of resume
+//! @param[in] timeout  Ignored
+//! @return  The result of the resume
+
+ITarget::ResumeRes
+BenchTarget::resume (ResumeType step,
+		     std::chrono::duration <double>  timeout
+		       __attribute__ ((unused)))
+{
+  return  resume (step);
+
+}	// resume ()
+
+
+//! Resume execution with a budget, which we never use up
+
+//! @param[in] step    The type of resume
+//! @param[in] budget  Ignored
+//! @return  The result of the resume
+
+ITarget::ResumeRes
+BenchTarget::resume (ResumeType step,
+		     uint64_t  budget __attribute__ ((unused)))
+{
+  return  resume (step);
+
+}	// resume ()
+
+
+//! Terminate execution
+
+//! @return  Always SUCCESS
+
+ITarget::ResumeRes
+BenchTarget::terminate ()
+{
+  return  ResumeRes::SUCCESS;
+
+}	// terminate ()
+
+
+//! Reset the target, which just clears the registers
+
+//! @param[in] type  Ignored, since both resets are the same
+//! @return  Always SUCCESS
+
+ITarget::ResumeRes
+BenchTarget::reset (ResetType  type __attribute__ ((unused)))
+{
+  for (int  r = 0; r < NUM_REGS; r++)
+    mRegs[r] = 0;
+
+  return  ResumeRes::SUCCESS;
+
+}	// reset ()
+
+
+//! Get the cycle count, which is just the instruction count
+
+//! @return  The number of cycles
+
+uint64_t
+BenchTarget::getCycleCount () const
+{
+  return  mInstrCount;
+
+}	// getCycleCount ()
+
+
+//! Get the instruction count, which is the number of steps
+
+//! @return  The number of instructions
+
+uint64_t
+BenchTarget::getInstrCount () const
+{
+  return  mInstrCount;
+
+}	// getInstrCount ()
+
+
+//! Read a register
+
+//! @param[in]  reg    The register to read
+//! @param[out] value  The value read
+//! @return  The size of the register in bytes, or zero if there is no such
+//!          register
+
+std::size_t
+BenchTarget::readRegister (const int  reg,
+			   uint_reg_t & value) const
+{
+  if ((reg < 0) || (reg >= NUM_REGS))
+    return  0;
+
+  value = mRegs[reg];
+  return  sizeof (value);
+
+}	// readRegister ()
+
+
+//! Write a register
+
+//! Register zero is always zero.
+
+//! @param[in] reg    The register to write
+//! @param[in] value  The value to write
+//! @return  The size of the register in bytes, or zero if there is no such
+//!          register
+
+std::size_t
+BenchTarget::writeRegister (const int  reg,
+			    const uint_reg_t  value)
+{
+  if ((reg < 0) || (reg >= NUM_REGS))
+    return  0;
+
+  if (0 != reg)
+    mRegs[reg] = value;
+
+  return  sizeof (value);
+
+}	// writeRegister ()
+
+
+//! Read memory
+
+//! @param[in]  addr    Where to read from
+//! @param[out] buffer  Where to put what was read
+//! @param[in]  size    The number of bytes to read
+//! @return  The number of bytes read, which is less than asked for if the
+//!          read runs off the end of memory
+
+std::size_t
+BenchTarget::read (const uint32_t  addr,
+		   uint8_t * buffer,
+		   const std::size_t  size) const
+{
+  if (addr >= mMem.size ())
+    return  0;
+
+  std::size_t  n = (size < mMem.size () - addr) ? size : mMem.size () - addr;
+
+  memcpy (buffer, &(mMem[addr]), n);
+  return  n;
+
+}	// read ()
+
+
+//! Write memory
+
+//! @param[in] addr    Where to write to
+//! @param[in] buffer  What to write
+//! @param[in] size    The number of bytes to write
+//! @return  The number of bytes written, which is less than asked for if the
+//!          write runs off the end of memory
+
+std::size_t
+BenchTarget::write (const uint32_t  addr,
+		    const uint8_t * buffer,
+		    const std::size_t  size)
+{
+  if (addr >= mMem.size ())
+    return  0;
+
+  std::size_t  n = (size < mMem.size () - addr) ? size : mMem.size () - addr;
+
+  mSnapshot.noteWrite (this, addr, n);
+  memcpy (&(mMem[addr]), buffer, n);
+  return  n;
+
+}	// write ()
+
+
+//! Insert a matchpoint
+
+//! Breakpoints are accepted but never hit.  Watchpoints are for a byte, and
+//! the server should never ask us to watch a byte twice.
+
+//! @param[in] addr       Address for the matchpoint
+//! @param[in] matchType  Type of breakpoint or watchpoint
+//! @return  TRUE unless we were already watching the byte
+
+bool
+BenchTarget::insertMatchpoint (const uint32_t  addr,
+			       const MatchType  matchType)
+{
+  if ((MatchType::BREAK == matchType) || (MatchType::BREAK_HW == matchType))
+    return  true;
+
+  mWatchHit = nullptr;
+  return  mWatches.insert (std::make_pair (addr, matchType)).second;
+
+}	// insertMatchpoint ()
+
+
+//! Remove a matchpoint
+
+//! @param[in] addr       Address for the matchpoint
+//! @param[in] matchType  Type of breakpoint or watchpoint
+//! @return  TRUE unless it was a watchpoint we were not holding
+
+bool
+BenchTarget::removeMatchpoint (const uint32_t  addr,
+			       const MatchType  matchType)
+{
+  if ((MatchType::BREAK == matchType) || (MatchType::BREAK_HW == matchType))
+    return  true;
+
+  mWatchHit = nullptr;
+  return  1 == mWatches.erase (std::make_pair (addr, matchType));
+
+}	// removeMatchpoint ()
+
+
+//! Find the watchpoint at which the last continue stopped
+
+//! @param[out] addr       Address of the byte which was watched
+//! @param[out] matchType  Type of watchpoint
+//! @return  TRUE if the last resume stopped at a watchpoint, FALSE
+//!          otherwise.
+
+bool
+BenchTarget::lastWatchpoint (uint32_t & addr,
+			     MatchType & matchType) const
+{
+  if (nullptr == mWatchHit)
+    return  false;
+
+  addr      = mWatchHit->first;
+  matchType = mWatchHit->second;
+  return  true;
+
+}	// lastWatchpoint ()
+
+
+//! The size of the block of memory read together, which is a byte
+
+//! @return  Always 1
+
+std::size_t
+BenchTarget::readGranule () const
+{
+  return  1;
+
+}	// readGranule ()
+
+
+//! Save a snapshot
+
+//! @return  TRUE if the snapshot was saved, FALSE otherwise
+
+bool
+BenchTarget::saveSnapshot ()
+{
+  return  mSnapshot.save (this);
+
+}	// saveSnapshot ()
+
+
+//! Restore a snapshot
+
+//! @return  TRUE if the snapshot was restored, FALSE otherwise
+
+bool
+BenchTarget::restoreSnapshot ()
+{
+  return  mSnapshot.restore (this);
+
+}	// restoreSnapshot ()
+
+
+//! Handle a command, of which we have none
+
+//! @return  Always FALSE
+
+bool
+BenchTarget::command (const std::string  cmd __attribute__ ((unused)),
+		      std::ostream & stream __attribute__ ((unused)))
+{
+  return  false;
+
+}	// command ()
+
+
+//! Tell the target about the server, which we don't need
+
+void
+BenchTarget::gdbServer (GdbServer *server __attribute__ ((unused)))
+{
+}	// gdbServer ()
+
+
+//! Give the target a flag to watch, which we don't need, since we never
+//! run for long
+
+void
+BenchTarget::breakFlag (const std::atomic<bool> * flag
+			  __attribute__ ((unused)))
+{
+}	// breakFlag ()
+
+
+//! Start or stop recording instructions
+
+//! Each start begins a new trace, so each run of a workload sees only the
+//! instructions it stepped.
+
+//! @param[in] on  TRUE to start recording instructions, FALSE to stop
+//! @return  Always TRUE
+
+bool
+BenchTarget::traceInsns (bool  on)
+{
+  if (nullptr == mInsnTrace)
+    mInsnTrace = new InsnTrace;
+
+  if (on)
+    mInsnTrace->clear ();
+
+  mInsnTraceOn = on;
+  return  true;
+
+}	// traceInsns ()
+
+
+//! The instructions recorded
+
+//! @return  The instructions recorded, or NULL if we have never been asked
+//!          to record them.
+
+const InsnTrace *
+BenchTarget::insnTrace () const
+{
+  return  mInsnTrace;
+
+}	// insnTrace ()
+
+
+//! Can the instructions recorded be given to GDB as branch trace?
+
+//! @return  Always TRUE, since we record the address of the PC
+
+bool
+BenchTarget::branchTrace () const
+{
+  return  true;
+
+}	// branchTrace ()
+
+
+//! Give us a profile to sample into, which we don't need, since we never
+//! run for long
+
+void
+BenchTarget::profile (Profile * prof __attribute__ ((unused)))
+{
+}	// profile ()
+
+
+//! The time stamp, which is just the instruction count
+
+//! @return  The time stamp
+
+double
+BenchTarget::timeStamp ()
+{
+  return  static_cast<double> (mInstrCount);
+
+}	// timeStamp ()
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
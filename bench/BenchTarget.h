@@ -0,0 +1,157 @@
+// Null target for benchmarking the server: declaration
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef BENCH_TARGET_H
+#define BENCH_TARGET_H
+
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "InsnTrace.h"
+#include "ITarget.h"
+#include "Snapshot.h"
+
+
+//! A target which does as little as possible
+
+//! The target is just flat memory and a set of registers, so that timing the
+//! server against it measures the server and its connection, not a model.
+//! A step just advances the PC, and a continue stops at once, as though at
+//! a breakpoint.  Breakpoints are accepted, but never hit.  Watchpoints are
+//! held, and a continue stops at the lowest byte watched, if any, so that
+//! what the server asked us to watch can be checked.  Instructions stepped
+//! can be recorded, at the address of the PC, so branch trace can be
+//! checked too.  Snapshots are of what the debugger wrote and the registers,
+//! as on the real targets.  Nothing here stores to memory, so a snapshot may
+//! be saved at any time.
+
+class BenchTarget : public ITarget
+{
+public:
+
+  // Constructor and destructor
+
+  BenchTarget (const TraceFlags * flags,
+	       std::size_t  memSize);
+  ~BenchTarget ();
+
+  // ITarget interface
+
+  virtual ResumeRes  resume (ResumeType step);
+  virtual ResumeRes  resume (ResumeType step,
+			     std::chrono::duration <double>  timeout);
+  virtual ResumeRes  resume (ResumeType step,
+			     uint64_t  budget);
+  virtual ResumeRes  terminate ();
+  virtual ResumeRes  reset (ResetType  type);
+
+  virtual uint64_t  getCycleCount () const;
+  virtual uint64_t  getInstrCount () const;
+
+  virtual std::size_t  readRegister (const int  reg,
+				     uint_reg_t & value) const;
+  virtual std::size_t  writeRegister (const int  reg,
+				      const uint_reg_t  value);
+  virtual std::size_t  read (const uint32_t  addr,
+			     uint8_t * buffer,
+			     const std::size_t  size) const;
+  virtual std::size_t  write (const uint32_t  addr,
+			      const uint8_t * buffer,
+			      const std::size_t  size);
+
+  virtual bool  insertMatchpoint (const uint32_t  addr,
+				  const MatchType  matchType);
+  virtual bool  removeMatchpoint (const uint32_t  addr,
+				  const MatchType  matchType);
+  virtual bool  lastWatchpoint (uint32_t & addr,
+				MatchType & matchType) const;
+  virtual std::size_t  readGranule () const;
+
+  virtual bool  saveSnapshot ();
+  virtual bool  restoreSnapshot ();
+
+  virtual bool command (const std::string  cmd,
+			std::ostream & stream);
+
+  virtual void gdbServer (GdbServer *server);
+  virtual void breakFlag (const std::atomic<bool> * flag);
+  virtual bool  traceInsns (bool  on);
+  virtual const InsnTrace * insnTrace () const;
+  virtual bool  branchTrace () const;
+  virtual void  profile (Profile * prof);
+
+  virtual double timeStamp ();
+
+private:
+
+  //! Number of registers: 32 general registers and the PC
+
+  static const int NUM_REGS = 33;
+
+  //! Register number of the PC
+
+  static const int PC_REGNUM = 32;
+
+  //! The memory
+
+  std::vector<uint8_t>  mMem;
+
+  //! The registers
+
+  uint_reg_t  mRegs[NUM_REGS];
+
+  //! Instructions "executed"
+
+  uint64_t  mInstrCount;
+
+  //! The bytes watched, by address and type of watchpoint
+
+  std::set<std::pair<uint32_t, MatchType> >  mWatches;
+
+  //! The watchpoint at which the last continue stopped, if any
+
+  const std::pair<uint32_t, MatchType> *  mWatchHit;
+
+  //! The instructions recorded, or NULL if we have never been asked to
+  //! record them
+
+  InsnTrace *  mInsnTrace;
+
+  //! Are we recording instructions?
+
+  bool  mInsnTraceOn;
+
+  //! The snapshot
+
+  Snapshot  mSnapshot;
+
+};	// class BenchTarget
+
+#endif	// BENCH_TARGET_H
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
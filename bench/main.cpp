@@ -0,0 +1,853 @@
+// Benchmark for the GDB RSP server: main program
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include "config.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <getopt.h>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Class headers
+
+#include "BenchClient.h"
+#include "BenchTarget.h"
+#include "GdbServer.h"
+#include "LoopbackConnection.h"
+#include "StreamConnection.h"
+#include "TraceFlags.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ifstream;
+using std::ostream;
+using std::string;
+
+
+//! Default number of requests for each synthetic workload
+
+static const long int  DEFAULT_COUNT = 10000;
+
+//! Default number of bytes for the load workload, which is also the size of
+//! the target's memory
+
+static const long int  DEFAULT_SIZE = 1024 * 1024;
+
+
+//! Convenience function to output the usage to a specified stream.
+
+//! @param[in] s  Output stream to use.
+
+static void
+usage (ostream & s)
+{
+  s << "Usage: gdbserver-bench [ --replay | -r <trace-file> ]" << endl
+    << "                       [ --workload | -w <workload> ]" << endl
+    << "                       [ --count | -n <n> ]" << endl
+    << "                       [ --size | -s <bytes> ]" << endl
+    << "                       [ --packet-size | -p <bytes> ]" << endl
+    << "                       [ --ack | -a ]" << endl
+    << "                       [ --loopback | -l ]" << endl
+    << "                       [ --trace | -t <traceflag> ]" << endl
+    << "                       [ --help | -h ]" << endl
+    << endl
+    << "The server is run against a target which does next to nothing, over"
+    << endl
+    << "a socket pair, and the latency and throughput of each type of packet"
+    << endl
+    << "are reported." << endl
+    << endl
+    << "The workload option may appear multiple times.  Workloads are:"
+    << endl
+    << "  load  Write the target's memory with X packets, as GDB's load"
+    << endl
+    << "  step  Single step n times with vCont;s" << endl
+    << "  cont  Continue n times, each stopping at once" << endl
+    << "  regs  Read all the registers n times with g" << endl
+    << "  mem   Read memory n times with m, as much as a packet holds"
+    << endl
+    << "  bmem  Read memory n times with x, as much as a packet holds"
+    << endl
+    << "  watch Insert and remove overlapping watchpoints n times, checking"
+    << endl
+    << "        the target watches just the bytes still covered" << endl
+    << "  btrace Record branch trace of a few steps n times, checking the"
+    << endl
+    << "         blocks read back" << endl
+    << "  snapshot Save a snapshot, write memory and a register, and restore"
+    << endl
+    << "           it n times, checking all was rolled back" << endl
+    << "  all   All of the above (the default, unless replaying)" << endl
+    << endl
+    << "A trace to replay may be a GDB remote log (set remotelogfile), of"
+    << endl
+    << "which we replay the packets GDB wrote, or just one packet per line,"
+    << endl
+    << "as on the wire between the '$' and the '#'.  Lines starting with '#'"
+    << endl
+    << "are comments.  Kill and detach packets are not replayed." << endl
+    << endl
+    << "The size is the number of bytes to load (default " << DEFAULT_SIZE
+    << "), and the" << endl
+    << "packet size the maximum RSP packet size of the server (default "
+    << GdbServer::DEFAULT_PKT_SIZE << ")." << endl
+    << endl
+    << "With --ack, we do not switch to no-ack mode." << endl
+    << endl
+    << "With --loopback, the server is run over an in-memory loopback"
+    << endl
+    << "connection, rather than a socket pair, so that no time is spent in"
+    << endl
+    << "the kernel." << endl;
+
+}	// usage ()
+
+
+//! Convenience function to parse a positive number
+
+//! @param[in]  arg  The argument
+//! @param[out] val  The number
+//! @return  TRUE if the argument was a positive number, FALSE otherwise.
+
+static bool
+parseNum (const char *arg,
+	  long int & val)
+{
+  char *endptr;
+
+  val = strtol (arg, &endptr, 0);
+  return  ('\0' != *arg) && ('\0' == *endptr) && (val > 0);
+
+}	// parseNum ()
+
+
+//! Run the server on its end of the connection
+
+//! The server exits when we send it a kill.
+
+//! @param[in] conn        The server's end of the connection
+//! @param[in] cpu         The target
+//! @param[in] traceFlags  The trace flags
+//! @param[in] pktSize     The maximum packet size
+
+static void
+serve (AbstractConnection *conn,
+       ITarget *cpu,
+       TraceFlags *traceFlags,
+       int  pktSize)
+{
+  GdbServer  server (conn, cpu, traceFlags, GdbServer::EXIT_ON_KILL,
+		     pktSize);
+
+  (void) server.rspServer ();
+
+}	// serve ()
+
+
+//! Make a request, and check the reply starts as it should
+
+//! @param[in] client    The client
+//! @param[in] payload   The request
+//! @param[in] expected  What the reply should start with
+//! @return  TRUE if the reply was as expected, FALSE otherwise.
+
+static bool
+checkedRequest (BenchClient & client,
+		const string & payload,
+		const char *expected)
+{
+  string  reply;
+
+  if (!client.request (payload, reply))
+    return  false;
+
+  if (0 != reply.compare (0, strlen (expected), expected))
+    {
+      cerr << "ERROR: Unexpected reply to " << payload.substr (0, 16)
+	   << ": " << reply.substr (0, 16) << endl;
+      return  false;
+    }
+
+  return  true;
+
+}	// checkedRequest ()
+
+
+//! Start the session, as GDB would
+
+//! @param[in]  client   The client
+//! @param[in]  noAck    TRUE if we should ask for no-ack mode
+//! @param[out] pktSize  The packet size the server reported
+//! @return  TRUE if all went well, FALSE otherwise.
+
+static bool
+startSession (BenchClient & client,
+	      bool  noAck,
+	      long int & pktSize)
+{
+  string  reply;
+
+  if (!client.request ("qSupported:swbreak+;hwbreak+", reply))
+    return  false;
+
+  std::size_t  pos = reply.find ("PacketSize=");
+
+  if (string::npos == pos)
+    {
+      cerr << "ERROR: Server did not report its packet size" << endl;
+      return  false;
+    }
+
+  pktSize = strtol (reply.c_str () + pos + strlen ("PacketSize="),
+		    nullptr, 16);
+
+  return  !noAck || checkedRequest (client, "QStartNoAckMode", "OK");
+
+}	// startSession ()
+
+
+//! Load the target's memory, as GDB's load does
+
+//! Each X packet is as full as it can be, once escaped.  The data is
+//! pseudo-random, so some of it needs escaping, as real code does.
+
+//! @param[in] client   The client
+//! @param[in] pktSize  The server's packet size
+//! @param[in] size     How many bytes to load
+//! @return  TRUE if all went well, FALSE otherwise.
+
+static bool
+runLoad (BenchClient & client,
+	 long int  pktSize,
+	 long int  size)
+{
+  // Room for the largest header, "X<addr>,<len>:", with 32-bit addresses
+  static const long int  HDR_LEN = 19;
+  uint32_t  seed = 1;
+
+  for (long int  addr = 0; addr < size; )
+    {
+      string  data;
+      long int  len = 0;
+
+      while ((addr + len < size)
+	     && (static_cast<long int> (data.size ()) + HDR_LEN + 2 < pktSize))
+	{
+	  seed = seed * 1103515245 + 12345;
+	  char  c = static_cast<char> (seed >> 16);
+
+	  if (('$' == c) || ('#' == c) || ('*' == c) || ('}' == c))
+	    {
+	      data.push_back ('}');
+	      c ^= 0x20;
+	    }
+
+	  data.push_back (c);
+	  len++;
+	}
+
+      char  hdr[40];
+
+      sprintf (hdr, "X%lx,%lx:", addr, len);
+
+      if (!checkedRequest (client, hdr + data, "OK"))
+	return  false;
+
+      addr += len;
+    }
+
+  return  true;
+
+}	// runLoad ()
+
+
+//! Read memory, as much as fits in a packet each time
+
+//! We work our way through memory, so each read is of memory the server has
+//! not just read.  A binary read ('x') gets twice as much in each reply as
+//! a hex one ('m'), although some bytes will be escaped.
+
+//! @param[in] client   The client
+//! @param[in] count    How many reads to make
+//! @param[in] pktSize  The server's packet size
+//! @param[in] size     How much memory there is
+//! @param[in] binary   TRUE to read with 'x', FALSE to read with 'm'
+//! @return  TRUE if all went well, FALSE otherwise.
+
+static bool
+runMem (BenchClient & client,
+	long int  count,
+	long int  pktSize,
+	long int  size,
+	bool  binary)
+{
+  long int  len  = binary ? pktSize - 2 : (pktSize - 1) / 2;
+  long int  addr = 0;
+
+  if (len > size)
+    len = size;
+
+  for (long int  i = 0; i < count; i++)
+    {
+      char  buf[40];
+      string  reply;
+
+      if (addr + len > size)
+	addr = 0;
+
+      sprintf (buf, "%c%lx,%lx", binary ? 'x' : 'm', addr, len);
+
+      if (!client.request (buf, reply))
+	return  false;
+
+      if (static_cast<long int> (reply.size ()) < (binary ? len + 1 : len * 2))
+	{
+	  cerr << "ERROR: Short memory read: " << reply.substr (0, 16) << endl;
+	  return  false;
+	}
+
+      addr += len;
+    }
+
+  return  true;
+
+}	// runMem ()
+
+
+//! Make the same request many times
+
+//! @param[in] client    The client
+//! @param[in] count     How many requests to make
+//! @param[in] payload   The request
+//! @param[in] expected  What each reply should start with
+//! @return  TRUE if all went well, FALSE otherwise.
+
+static bool
+runRepeat (BenchClient & client,
+	   long int  count,
+	   const char *payload,
+	   const char *expected)
+{
+  for (long int  i = 0; i < count; i++)
+    if (!checkedRequest (client, payload, expected))
+      return  false;
+
+  return  true;
+
+}	// runRepeat ()
+
+
+//! Insert and remove overlapping watchpoints
+
+//! As GDB does for "watch x" and "watch *(char *) &x", we watch a word and
+//! its first byte, both at the same address, then take them out again in
+//! turn.  The target stops a continue at the lowest byte it is watching, so
+//! we can check it watches the bytes still covered, and no others.
+
+//! @param[in] client  The client
+//! @param[in] count   How many times to do it
+//! @return  TRUE if all went well, FALSE otherwise.
+
+static bool
+runWatch (BenchClient & client,
+	  long int  count)
+{
+  for (long int  i = 0; i < count; i++)
+    if (!checkedRequest (client, "Z2,100,4", "OK")
+	|| !checkedRequest (client, "Z2,100,1", "OK")
+	|| !checkedRequest (client, "Z2,102,2", "OK")
+	|| !checkedRequest (client, "z2,100,4", "OK")
+	|| !checkedRequest (client, "c", "T05watch:100;")
+	|| !checkedRequest (client, "z2,100,1", "OK")
+	|| !checkedRequest (client, "c", "T05watch:102;")
+	|| !checkedRequest (client, "z2,102,2", "OK")
+	|| !checkedRequest (client, "c", "T0520:"))
+      return  false;
+
+  return  true;
+
+}	// runWatch ()
+
+
+//! Record branch trace of a few steps, and read it back
+
+//! We step two instructions from one address, then one from another, as
+//! though a branch had been taken between them, so the trace is two blocks,
+//! the latest first.  The instructions are NOPs, so of four bytes each.
+
+//! @param[in] client  The client
+//! @param[in] count   How many times to do it
+//! @return  TRUE if all went well, FALSE otherwise.
+
+static bool
+runBtrace (BenchClient & client,
+	   long int  count)
+{
+  static const char  blocks[] =
+    "l<!DOCTYPE btrace SYSTEM \"btrace.dtd\">\n"
+    "<btrace version=\"1.0\">\n"
+    "<block begin=\"0x200\" end=\"0x200\"/>\n"
+    "<block begin=\"0x100\" end=\"0x104\"/>\n"
+    "</btrace>\n";
+
+  for (long int  i = 0; i < count; i++)
+    if (!checkedRequest (client, "M100,8:1300000013000000", "OK")
+	|| !checkedRequest (client, "M200,4:13000000", "OK")
+	|| !checkedRequest (client, "Qbtrace:bts", "OK")
+	|| !checkedRequest (client, "P20=00010000", "OK")
+	|| !checkedRequest (client, "vCont;s", "T05")
+	|| !checkedRequest (client, "vCont;s", "T05")
+	|| !checkedRequest (client, "P20=00020000", "OK")
+	|| !checkedRequest (client, "vCont;s", "T05")
+	|| !checkedRequest (client, "qXfer:btrace:read:all:0,fff", blocks)
+	|| !checkedRequest (client, "Qbtrace:off", "OK"))
+      return  false;
+
+  return  true;
+
+}	// runBtrace ()
+
+
+//! Save a snapshot, change memory and a register, and restore it
+
+//! One word was written by the debugger before the snapshot, so is in the
+//! image.  The other is written only after, so must be rolled back from
+//! what it held when the snapshot was saved.
+
+//! @param[in] client  The client
+//! @param[in] count   How many times to do it
+//! @return  TRUE if all went well, FALSE otherwise.
+
+static bool
+runSnapshot (BenchClient & client,
+	     long int  count)
+{
+  // "snapshot save" and "snapshot restore", in hex
+  static const char  save[] = "qRcmd,736e617073686f742073617665";
+  static const char  restore[] =
+    "qRcmd,736e617073686f7420726573746f7265";
+
+  for (long int  i = 0; i < count; i++)
+    {
+      string  oldMem;
+
+      if (!checkedRequest (client, "M100,4:11223344", "OK")
+	  || !checkedRequest (client, "P1=78563412", "OK")
+	  || !client.request ("m300,4", oldMem)
+	  || !checkedRequest (client, save, "OK")
+	  || !checkedRequest (client, "M100,4:55667788", "OK")
+	  || !checkedRequest (client, "M300,4:99aabbcc", "OK")
+	  || !checkedRequest (client, "P1=efbeadde", "OK")
+	  || !checkedRequest (client, restore, "OK")
+	  || !checkedRequest (client, "m100,4", "11223344")
+	  || !checkedRequest (client, "m300,4", oldMem.c_str ())
+	  || !checkedRequest (client, "p1", "78563412"))
+	return  false;
+    }
+
+  return  true;
+
+}	// runSnapshot ()
+
+
+//! Undo the escapes of a GDB remote log
+
+//! GDB logs non-printing characters as \\xNN, and a few as \\n and the
+//! like.
+
+//! @param[in] line  The logged line
+//! @return  The characters as they were sent
+
+static string
+unlog (const string & line)
+{
+  string  res;
+
+  for (std::size_t  i = 0; i < line.size (); i++)
+    {
+      if (('\\' != line[i]) || (i + 1 == line.size ()))
+	{
+	  res.push_back (line[i]);
+	  continue;
+	}
+
+      switch (line[++i])
+	{
+	case 'b': res.push_back ('\b'); break;
+	case 'f': res.push_back ('\f'); break;
+	case 'n': res.push_back ('\n'); break;
+	case 'r': res.push_back ('\r'); break;
+	case 't': res.push_back ('\t'); break;
+	case 'v': res.push_back ('\v'); break;
+
+	case 'x':
+	  res.push_back (static_cast<char>
+			 (strtol (line.substr (i + 1, 2).c_str (), nullptr,
+				  16)));
+	  i += 2;
+	  break;
+
+	default:  res.push_back (line[i]); break;
+	}
+    }
+
+  return  res;
+
+}	// unlog ()
+
+
+//! Replay a recorded trace of packets
+
+//! @see usage () for the format of the trace.
+
+//! @param[in] client    The client
+//! @param[in] fileName  The trace file
+//! @return  TRUE if all went well, FALSE otherwise.
+
+static bool
+runReplay (BenchClient & client,
+	   const char *fileName)
+{
+  ifstream  trace (fileName);
+
+  if (!trace)
+    {
+      cerr << "ERROR: Cannot open trace file " << fileName << endl;
+      return  false;
+    }
+
+  string  line;
+  long int  lineNum = 0;
+
+  while (std::getline (trace, line))
+    {
+      lineNum++;
+
+      if (line.empty () || ('#' == line[0])
+	  || (0 == line.compare (0, 2, "r "))
+	  || (0 == line.compare (0, 2, "c ")))
+	continue;
+
+      std::vector<string>  pkts;
+
+      if (0 == line.compare (0, 2, "w "))
+	{
+	  // A GDB log, which may have several packets and acks.
+	  string  raw = unlog (line.substr (2));
+	  std::size_t  start;
+
+	  while (string::npos != (start = raw.find ('$')))
+	    {
+	      std::size_t  end = raw.find ('#', start);
+
+	      if (string::npos == end)
+		break;
+
+	      pkts.push_back (raw.substr (start + 1, end - start - 1));
+	      raw.erase (0, end + 1);
+	    }
+	}
+      else
+	pkts.push_back (line);
+
+      for (auto  it = pkts.begin (); it != pkts.end (); it++)
+	{
+	  string  reply;
+
+	  // We end the session ourselves, and GDB's choice of no-ack mode
+	  // was made for us already.
+	  if (("k" == *it) || ('D' == (*it)[0]) || ("vKill" == *it)
+	      || ("QStartNoAckMode" == *it))
+	    continue;
+
+	  if (!client.request (*it, reply))
+	    {
+	      cerr << "ERROR: Replay failed at line " << lineNum << endl;
+	      return  false;
+	    }
+	}
+    }
+
+  return  true;
+
+}	// runReplay ()
+
+
+//! Main function
+
+//! @see usage () for information on the parameters.  The server runs on a
+//! thread of its own, with the benchmark client on this thread.
+
+//! @param[in] argc  Number of arguments.
+//! @param[in] argv  Vector or arguments.
+//! @return  The return code for the program.
+
+int
+main (int   argc,
+      char *argv[] )
+{
+  // Argument handling.
+
+  char         *replayFile = nullptr;
+  long int      count = DEFAULT_COUNT;
+  long int      size = DEFAULT_SIZE;
+  long int      pktSize = GdbServer::DEFAULT_PKT_SIZE;
+  bool          noAck = true;
+  bool          loopback = false;
+  bool          wantLoad = false;
+  bool          wantStep = false;
+  bool          wantCont = false;
+  bool          wantRegs = false;
+  bool          wantMem = false;
+  bool          wantBinMem = false;
+  bool          wantWatch = false;
+  bool          wantBtrace = false;
+  bool          wantSnapshot = false;
+  TraceFlags *  traceFlags = new TraceFlags ();
+
+  while (true) {
+    int c;
+    int longOptind = 0;
+    static struct option longOptions[] = {
+      {"replay",   required_argument, nullptr,  'r' },
+      {"workload", required_argument, nullptr,  'w' },
+      {"count",    required_argument, nullptr,  'n' },
+      {"size",     required_argument, nullptr,  's' },
+      {"packet-size", required_argument, nullptr, 'p' },
+      {"ack",      no_argument,       nullptr,  'a' },
+      {"loopback", no_argument,       nullptr,  'l' },
+      {"trace",    required_argument, nullptr,  't' },
+      {"help",     no_argument,       nullptr,  'h' },
+      {0,       0,                 0,  0 }
+    };
+
+    if ((c = getopt_long (argc, argv, "r:w:n:s:p:alt:h", longOptions, &longOptind)) == -1)
+      break;
+
+    switch (c) {
+    case 'r':
+      replayFile = strdup (optarg);
+      break;
+
+    case 'w':
+      if (0 == strcmp ("load", optarg))
+	wantLoad = true;
+      else if (0 == strcmp ("step", optarg))
+	wantStep = true;
+      else if (0 == strcmp ("cont", optarg))
+	wantCont = true;
+      else if (0 == strcmp ("regs", optarg))
+	wantRegs = true;
+      else if (0 == strcmp ("mem", optarg))
+	wantMem = true;
+      else if (0 == strcmp ("bmem", optarg))
+	wantBinMem = true;
+      else if (0 == strcmp ("watch", optarg))
+	wantWatch = true;
+      else if (0 == strcmp ("btrace", optarg))
+	wantBtrace = true;
+      else if (0 == strcmp ("snapshot", optarg))
+	wantSnapshot = true;
+      else if (0 == strcmp ("all", optarg))
+	{
+	  wantLoad = true;
+	  wantStep = true;
+	  wantCont = true;
+	  wantRegs = true;
+	  wantMem = true;
+	  wantBinMem = true;
+	  wantWatch = true;
+	  wantBtrace = true;
+	  wantSnapshot = true;
+	}
+      else
+	{
+	  cerr << "ERROR: Bad workload " << optarg << endl;
+	  usage (cerr);
+	  return EXIT_FAILURE;
+	}
+      break;
+
+    case 'n':
+      if (!parseNum (optarg, count))
+	{
+	  cerr << "ERROR: Bad count " << optarg << endl;
+	  usage (cerr);
+	  return EXIT_FAILURE;
+	}
+      break;
+
+    case 's':
+      if (!parseNum (optarg, size))
+	{
+	  cerr << "ERROR: Bad size " << optarg << endl;
+	  usage (cerr);
+	  return EXIT_FAILURE;
+	}
+      break;
+
+    case 'p':
+      if (!parseNum (optarg, pktSize))
+	{
+	  cerr << "ERROR: Bad packet size " << optarg << endl;
+	  usage (cerr);
+	  return EXIT_FAILURE;
+	}
+      break;
+
+    case 'a':
+      noAck = false;
+      break;
+
+    case 'l':
+      loopback = true;
+      break;
+
+    case 't':
+
+      if (!traceFlags->isFlag (optarg))
+	{
+	  cerr << "ERROR: Bad trace flag " << optarg << endl;
+	  usage (cerr);
+	  return EXIT_FAILURE;
+	}
+
+      traceFlags->flag (optarg, true);
+      break;
+
+    case 'h':
+      usage (cout);
+      return  EXIT_SUCCESS;
+
+    case '?':
+    case ':':
+      usage (cerr);
+      return  EXIT_FAILURE;
+
+    default:
+      cerr << "ERROR: getopt_long returned character code " << c << endl;
+      return  EXIT_FAILURE;
+    }
+  }
+
+  if (optind != argc)
+    {
+      usage (cerr);
+      return  EXIT_FAILURE;
+    }
+
+  // With nothing to replay and no workload, run them all.
+  if ((nullptr == replayFile)
+      && !(wantLoad || wantStep || wantCont || wantRegs || wantMem
+	   || wantBinMem || wantWatch || wantBtrace || wantSnapshot))
+    {
+      wantLoad = true;
+      wantStep = true;
+      wantCont = true;
+      wantRegs = true;
+      wantMem = true;
+      wantBinMem = true;
+      wantWatch = true;
+      wantBtrace = true;
+      wantSnapshot = true;
+    }
+
+  // The server's end of the connection and our client
+  int  fds[2] = { -1, -1 };
+  AbstractConnection *conn;
+  BenchClient *client;
+
+  if (loopback)
+    {
+      LoopbackConnection *loop = new LoopbackConnection (traceFlags);
+
+      conn = loop;
+      client = new BenchClient (loop);
+    }
+  else
+    {
+      if (0 != socketpair (AF_UNIX, SOCK_STREAM, 0, fds))
+	{
+	  cerr << "ERROR: Cannot create socket pair: " << strerror (errno)
+	       << endl;
+	  return  EXIT_FAILURE;
+	}
+
+      conn = new StreamConnection (traceFlags, fds[1], fds[1]);
+      client = new BenchClient (fds[0]);
+    }
+
+  ITarget *cpu = new BenchTarget (traceFlags, size);
+  std::thread  server (serve, conn, cpu, traceFlags,
+		       static_cast<int> (pktSize));
+  bool  ok = startSession (*client, noAck, pktSize);
+
+  ok = ok && ((nullptr == replayFile) || runReplay (*client, replayFile));
+  ok = ok && (!wantLoad || runLoad (*client, pktSize, size));
+  ok = ok && (!wantStep || runRepeat (*client, count, "vCont;s", "T"));
+  ok = ok && (!wantCont || runRepeat (*client, count, "c", "T"));
+  ok = ok && (!wantRegs || runRepeat (*client, count, "g", ""));
+  ok = ok && (!wantMem || runMem (*client, count, pktSize, size, false));
+  ok = ok && (!wantBinMem || runMem (*client, count, pktSize, size, true));
+  ok = ok && (!wantWatch || runWatch (*client, count));
+  ok = ok && (!wantBtrace || runBtrace (*client, count));
+  ok = ok && (!wantSnapshot || runSnapshot (*client, count));
+
+  // Kill the server, or if the connection failed, just close it.
+  if (ok)
+    (void) client->send ("k");
+  else
+    client->close ();
+
+  server.join ();
+  client->report (cout);
+
+  delete  client;
+  delete  conn;
+
+  if (!loopback)
+    {
+      close (fds[0]);
+      close (fds[1]);
+    }
+
+  delete  cpu;
+  delete  traceFlags;
+  return  ok ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}	// main ()
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
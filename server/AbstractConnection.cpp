@@ -25,8 +25,7 @@
 #include <csignal>
 #include <cstring>
 
-#include <sys/select.h>
-#include <unistd.h>
+#include <poll.h>
 
 #include "AbstractConnection.h"
 #include "Utils.h"
@@ -41,6 +40,20 @@ using std::setfill;
 using std::setw;
 
 
+//! Report if we can get another client once this one has gone.
+
+//! By default we can, but some connections serve a single client.
+
+//! @return  TRUE if we can reconnect, FALSE otherwise
+
+bool
+AbstractConnection::canReconnect ()
+{
+  return  true;
+
+}	// canReconnect ()
+
+
 //! Get the next packet from the RSP connection
 
 //! Modeled on the stub version supplied with GDB. This allows the user to
@@ -144,20 +157,39 @@ AbstractConnection::getPkt (RspPacket *pkt)
 
 	  // If the checksums don't match print a warning, and put the
 	  // negative ack back to the client. Otherwise put a positive ack.
-	  if (checksum != xmitcsum)
+	  // In no-ack mode, we don't ack, and just wait for the next packet
+	  // if the checksum is bad.
+	  if (mNoAckMode)
+	    {
+	      if (checksum != xmitcsum)
+		cerr << "Warning: Bad RSP checksum in no-ack mode: Computed 0x"
+		     << setw (2) << setfill ('0') << hex
+		     << (int) checksum << ", received 0x" << (int) xmitcsum
+		     << setfill (' ') << dec << ": Ignored" << endl;
+	      else
+		{
+		  if (traceFlags->traceRsp())
+		    {
+		      cout << "RSP trace: getPkt: " << *pkt << endl;
+		    }
+
+		  return  true;			// Success
+		}
+	    }
+	  else if (checksum != xmitcsum)
 	    {
 	      cerr << "Warning: Bad RSP checksum: Computed 0x"
 			<< setw (2) << setfill ('0') << hex
-			<< checksum << ", received 0x" << xmitcsum
+			<< (int) checksum << ", received 0x" << (int) xmitcsum
 			<< setfill (' ') << dec << endl;
-	      if (!putRspChar ('-'))		// Failed checksum
+	      if (!putRspChar ('-') || !flushRspChars ())  // Failed checksum
 		{
 		  return  false;		// Comms failure
 		}
 	    }
 	  else
 	    {
-	      if (!putRspChar ('+'))		// successful transfer
+	      if (!putRspChar ('+') || !flushRspChars ())  // successful transfer
 		{
 		  return  false;		// Comms failure
 		}
@@ -184,9 +216,7 @@ AbstractConnection::getPkt (RspPacket *pkt)
 //! Put the packet out on the RSP connection
 
 //! Modeled on the stub version supplied with GDB. Put out the data preceded
-//! by a '$', followed by a '#' and a one byte checksum. '$', '#', '*' and '}'
-//! are escaped by preceding them with '}' and then XORing the character with
-//! 0x20.
+//! by a '$', followed by a '#' and a one byte checksum (@see putRspFrame ()).
 
 //! @param[in] pkt  The Packet to transmit
 
@@ -195,167 +225,435 @@ AbstractConnection::getPkt (RspPacket *pkt)
 bool
 AbstractConnection::putPkt (RspPacket *pkt)
 {
-  int  len = pkt->getLen ();
   int  ch;				// Ack char
 
-  // Construct $<packet info>#<checksum>. Repeat until the GDB client
-  // acknowledges satisfactory receipt.
+  // Repeat until the GDB client acknowledges satisfactory receipt.
   do
     {
-      unsigned char checksum = 0;	// Computed checksum
-      int           count    = 0;	// Index into the buffer
-
-      if (!putRspChar ('$'))		// Start char
+      if (!putRspFrame ('$', pkt))
 	{
 	  return  false;		// Comms failure
 	}
 
+      // Check for ack of connection failure.  In no-ack mode there is no
+      // ack to wait for.
+      if (mNoAckMode)
+	break;
 
-      // Body of the packet
-      for (count = 0; count < len; count++)
+      ch = getRspChar ();
+      if (-1 == ch)
 	{
-	  unsigned char  ch = pkt->data[count];
+	  return  false;		// Comms failure
+	}
+    }
+  while ('+' != ch);
 
-	  // Check for escaped chars
-	  if (('$' == ch) || ('#' == ch) || ('*' == ch) || ('}' == ch))
-	    {
-	      ch       ^= 0x20;
-	      checksum += (unsigned char)'}';
-	      if (!putRspChar ('}'))
-		{
-		  return  false;	// Comms failure
-		}
+  if (traceFlags->traceRsp())
+    {
+      cout << "RSP trace: putPkt: " << *pkt << endl;
+    }
 
-	    }
+  return  true;
+
+}	// putPkt ()
+
+
+//! Put a notification out on the RSP connection
+
+//! Just like a packet, but preceded by a '%', and never acknowledged.  For
+//! use in non-stop mode.
+
+//! @param[in] pkt  The notification to transmit
+
+//! @return  TRUE to indicate success, FALSE otherwise (means a communications
+//!          failure).
+bool
+AbstractConnection::putNotification (RspPacket *pkt)
+{
+  if (!putRspFrame ('%', pkt))
+    return  false;			// Comms failure
+
+  if (traceFlags->traceRsp())
+    {
+      cout << "RSP trace: putNotification: " << *pkt << endl;
+    }
 
+  return  true;
+
+}	// putNotification ()
+
+
+//! Put out a packet or notification, framed and with its checksum
+
+//! $<packet info>#<checksum> or %<notification>#<checksum>.  '$', '#', '*'
+//! and '}' are escaped by preceding them with '}' and then XORing the
+//! character with 0x20.
+
+//! Runs of a character are run length encoded, as the char, then '*', then
+//! a char which is the number of repeats plus 29.  That must be printable
+//! and not '#' or '$', so we repeat at most 97 times, and never 6 or 7 times.
+//! Escaped chars are never run length encoded.  The checksum is computed as
+//! we go.
+
+//! @param[in] startChar  The char to start with
+//! @param[in] pkt        The data to put out
+
+//! @return  TRUE to indicate success, FALSE otherwise (means a communications
+//!          failure).
+bool
+AbstractConnection::putRspFrame (char  startChar,
+				 RspPacket *pkt)
+{
+  int            len      = pkt->getLen ();
+  unsigned char  checksum = 0;		// Computed checksum
+
+  if (!putRspChar (startChar))		// Start char
+    {
+      return  false;			// Comms failure
+    }
+
+  // Body of the packet
+  int  count = 0;
+
+  while (count < len)
+    {
+      unsigned char  ch = pkt->data[count];
+
+      // Check for escaped chars
+      if (('$' == ch) || ('#' == ch) || ('*' == ch) || ('}' == ch))
+	{
+	  ch       ^= 0x20;
+	  checksum += (unsigned char)'}';
 	  checksum += ch;
-	  if (!putRspChar (ch))
+	  if (!putRspChar ('}') || !putRspChar (ch))
 	    {
 	      return  false;		// Comms failure
 	    }
-	}
 
-      if (!putRspChar ('#'))		// End char
-	{
-	  return  false;		// Comms failure
+	  count++;
+	  continue;
 	}
 
-      // Computed checksum
-      if (!putRspChar (Utils::hex2Char (checksum >> 4)))
-	{
-	  return  false;		// Comms failure
-	}
-      if (!putRspChar (Utils::hex2Char (checksum % 16)))
+      checksum += ch;
+      if (!putRspChar (ch))
 	{
 	  return  false;		// Comms failure
 	}
 
-      // Check for ack of connection failure
-      ch = getRspChar ();
-      if (-1 == ch)
+      // How many times the char repeats after this one.  It is only worth
+      // encoding three or more repeats.
+      int  reps = 0;
+
+      while ((count + 1 + reps < len) && (reps < RLE_MAX_REPEAT)
+	     && (ch == static_cast<unsigned char> (pkt->data[count + 1 + reps])))
+	reps++;
+
+      if (reps >= 3)
 	{
-	  return  false;		// Comms failure
+	  // Avoid counts of '#' and '$'.  The ones left over are picked up
+	  // next time round.
+	  if ((6 == reps) || (7 == reps))
+	    reps = 5;
+
+	  unsigned char  n = reps + 29;
+
+	  checksum += (unsigned char)'*';
+	  checksum += n;
+	  if (!putRspChar ('*') || !putRspChar (n))
+	    {
+	      return  false;		// Comms failure
+	    }
+
+	  count += reps;
 	}
+
+      count++;
     }
-  while ('+' != ch);
 
-  if (traceFlags->traceRsp())
+  if (!putRspChar ('#'))		// End char
     {
-      cout << "RSP trace: putPkt: " << *pkt << endl;
+      return  false;			// Comms failure
     }
 
-  return  true;
+  // Computed checksum
+  if (!putRspChar (Utils::hex2Char (checksum >> 4)))
+    {
+      return  false;			// Comms failure
+    }
+  if (!putRspChar (Utils::hex2Char (checksum % 16)))
+    {
+      return  false;			// Comms failure
+    }
 
-}	// putPkt ()
+  // Send the whole packet in one go
+  return  flushRspChars ();
+
+}	// putRspFrame ()
 
 
 //! Put a single character out on the RSP connection
 
-//! Potentially we can have an OS specific implemenation of the underlying
-//! routine.
+//! The character is only added to the transmit buffer, which is written out
+//! by ::flushRspChars () once the packet is complete.  If the buffer fills
+//! up, it is flushed early.
 
 //! @param[in] c  The character to put out
-//! @return  TRUE if char sent OK, FALSE if not (communications failure)
+//! @return  TRUE if char buffered OK, FALSE if not (communications failure)
 
 bool
 AbstractConnection::putRspChar (char  c)
 {
-  return  putRspCharRaw (c);
+  if ((mTxCount == TX_BUF_SIZE) && !flushRspChars ())
+    return  false;
+
+  mTxBuf[mTxCount++] = c;
+  return  true;
 
 }	// putRspChar ()
 
 
+//! Write out any buffered characters on the RSP connection
 
-//! Get a single character from the RSP connection with buffering
+//! @return  TRUE if all chars were sent OK, FALSE if not (communications
+//!          failure)
 
-//! Utility routine for use by other functions.  This is built on the raw
-//! read function.
+bool
+AbstractConnection::flushRspChars ()
+{
+  if (0 == mTxCount)
+    return  true;
 
-//! This function will first return the possibly buffered character (buffering
-//! caused by calling 'haveBreak'.  If the character read is the break
-//! character then we record this fact, and fetch the next character.
+  bool  res = putRspBlockRaw (mTxBuf, mTxCount);
+  mBytesOut += mTxCount;
+  mTxCount = 0;
+  return  res;
+
+}	// flushRspChars ()
+
+
+//! Get a single character from the RSP connection with buffering
+
+//! Utility routine for use by other functions.  Characters are served from
+//! the receive ring buffer, which is refilled (blocking) from the raw read
+//! function only when it is empty.
 
 //! @return  The character received or -1 on failure
 
 int
 AbstractConnection::getRspChar ()
 {
-  int ch;
-
-  if (mNumGetBufChars > 1)
-    cerr << "Warning: Too many cached characters ("
-	 << dec << mNumGetBufChars << ")" << endl;
+  if ((0 == mRxCount) && !fillRxBuf (true))
+    return  -1;
 
-  if (mNumGetBufChars > 0)
-    {
-      ch = mGetCharBuf;
-      mNumGetBufChars = 0;
-    }
-  else
-    ch = getRspCharRaw (true);
+  int  ch = mRxBuf[mRxHead] & 0xff;	// No sign extend!
 
+  mRxHead = (mRxHead + 1) % RX_BUF_SIZE;
+  mRxCount--;
   return  ch;
 
 }	// getRspChar ()
 
 
+//! Read as many characters as are available into the receive buffer
+
+//! We read into the largest contiguous free space after the tail of the
+//! ring buffer, so a single raw read is all that is needed.
+
+//! @param[in] blocking  TRUE if we should wait for at least one char.
+//! @return  TRUE if at least one char was added to the buffer, FALSE
+//!          otherwise (communications failure, or nothing available for a
+//!          non-blocking read).
+
+bool
+AbstractConnection::fillRxBuf (bool  blocking)
+{
+  if (RX_BUF_SIZE == mRxCount)
+    return  true;			// Already full
+
+  std::size_t  tail  = (mRxHead + mRxCount) % RX_BUF_SIZE;
+  std::size_t  space = (tail >= mRxHead) ? RX_BUF_SIZE - tail
+					 : mRxHead - tail;
+  int  count = getRspBlockRaw (&(mRxBuf[tail]), space, blocking);
+
+  if (count <= 0)
+    return  false;
+
+  mRxCount += count;
+  mBytesIn += count;
+  return  true;
+
+}	// fillRxBuf ()
+
+
+//! Discard any buffered characters
+
+//! For use by derived classes when the underlying connection is closed, so
+//! nothing from the previous client leaks into the next.
+
+void
+AbstractConnection::clearBuffers ()
+{
+  mRxHead  = 0;
+  mRxCount = 0;
+  mTxCount = 0;
+
+}	// clearBuffers ()
+
+
 //! Have we received a break character.
 
 //! Since we only check fo this between packets, we don't have to worry about
 //! being in the middle of a packet.
 
-//! @Note  We only peek, so no character is actually consumed from the input.
+//! If the receive buffer is empty, we do a non-blocking read to fill it.  We
+//! then peek at the first buffered character, which is only consumed if it
+//! is the break character.
 
 //! @return  TRUE if we have received a break character, FALSE otherwise.
 
 bool
 AbstractConnection::haveBreak ()
 {
-  if (!mHavePendingBreak
-      && mNumGetBufChars == 0)
-    {
-      // Non-blocking read to possibly get a character.
-
-      int nextChar = getRspCharRaw (false);
+  if ((0 == mRxCount) && !fillRxBuf (false))
+    return  false;
 
-      if (nextChar != -1)
-	{
-	  if (nextChar == BREAK_CHAR)
-	    mHavePendingBreak = true;
-	  else
-	    {
-	      mGetCharBuf = nextChar;
-	      mNumGetBufChars = 1;
-	    }
-	}
-    }
-
-  if (mHavePendingBreak)
+  if (BREAK_CHAR == mRxBuf[mRxHead])
     {
-      mHavePendingBreak = false;
-      return true;
+      mRxHead = (mRxHead + 1) % RX_BUF_SIZE;
+      mRxCount--;
+      return  true;
     }
   else
-    return false;
+    return  false;
 
 }	// haveBreak ()
+
+
+//! The file descriptor to watch for input from the client
+
+//! This lets another thread wait for the client to send something, without
+//! touching the connection itself (@see BreakWatcher).  By default there is
+//! nothing to watch.
+
+//! @return  The file descriptor, or -1 if there is none to watch.
+
+int
+AbstractConnection::watchFd ()
+{
+  return  -1;
+
+}	// watchFd ()
+
+
+//! Wait a while for input from the client
+
+//! For use when we have other work to do, so can't block waiting for a
+//! packet.  Anything already buffered counts, otherwise it is up to the
+//! connection to wait (@see waitRspInput ()).
+
+//! @param[in] timeoutMs  How long to wait in milliseconds
+//! @return  TRUE if there is input (or we can't tell), FALSE otherwise.
+
+bool
+AbstractConnection::pollInput (int  timeoutMs)
+{
+  if (0 != mRxCount)
+    return  true;
+
+  return  waitRspInput (timeoutMs);
+
+}	// pollInput ()
+
+
+//! Wait a while for the connection to have input
+
+//! By default we wait for the file descriptor to watch to become readable.
+//! If we can't watch the connection, we can't tell, and say there is input,
+//! so the caller will just wait for it.
+
+//! @param[in] timeoutMs  How long to wait in milliseconds
+//! @return  TRUE if there is input (or we can't tell), FALSE otherwise.
+
+bool
+AbstractConnection::waitRspInput (int  timeoutMs)
+{
+  int  fd = watchFd ();
+
+  if (fd < 0)
+    return  true;
+
+  struct pollfd  pfd;
+
+  pfd.fd     = fd;
+  pfd.events = POLLIN;
+
+  return  poll (&pfd, 1, timeoutMs) > 0;
+
+}	// waitRspInput ()
+
+
+//! Set whether we are in no-acknowledgement mode.
+
+//! Once GDB has agreed to QStartNoAckMode, neither side sends '+' or '-'
+//! acknowledgements.  This is only safe on a reliable transport.
+
+//! @param[in] _noAckMode  TRUE to stop sending and waiting for acks, FALSE
+//!                        to resume normal acknowledgement.
+
+void
+AbstractConnection::setNoAckMode (bool  _noAckMode)
+{
+  mNoAckMode = _noAckMode;
+
+}	// setNoAckMode ()
+
+
+//! Are we in no-acknowledgement mode?
+
+//! @return  TRUE if packets are not being acknowledged, FALSE otherwise.
+
+bool
+AbstractConnection::getNoAckMode () const
+{
+  return  mNoAckMode;
+
+}	// getNoAckMode ()
+
+
+//! How many bytes have we received?
+
+//! Counted over all clients, since we were created or last reset.
+
+//! @return  The bytes received.
+
+uint64_t
+AbstractConnection::bytesIn () const
+{
+  return  mBytesIn;
+
+}	// bytesIn ()
+
+
+//! How many bytes have we sent?
+
+//! Counted over all clients, since we were created or last reset.
+
+//! @return  The bytes sent.
+
+uint64_t
+AbstractConnection::bytesOut () const
+{
+  return  mBytesOut;
+
+}	// bytesOut ()
+
+
+//! Start counting bytes each way again from zero
+
+void
+AbstractConnection::resetByteCounts ()
+{
+  mBytesIn  = 0;
+  mBytesOut = 0;
+
+}	// resetByteCounts ()
@@ -20,6 +20,9 @@
 #ifndef ABSTRACT_CONNECTION_H
 #define ABSTRACT_CONNECTION_H
 
+#include <cstddef>
+#include <cstdint>
+
 #include "RspPacket.h"
 #include "TraceFlags.h"
 
@@ -43,26 +46,58 @@ public:
   virtual bool  rspConnect () = 0;
   virtual void  rspClose () = 0;
   virtual bool  isConnected () = 0;
+  virtual bool  canReconnect ();
 
   // Public interface: get packets from the stream and put them out
 
   virtual bool  getPkt (RspPacket *pkt);
   virtual bool  putPkt (RspPacket *pkt);
+  bool  putNotification (RspPacket *pkt);
+
+  // Wait a while for input from the client
+
+  bool  pollInput (int  timeoutMs);
 
   // Check for a break (ctrl-C)
 
   virtual bool  haveBreak ();
 
+  // The file descriptor to watch for input from the client, if any
+
+  virtual int  watchFd ();
+
+  // Control acknowledgement of packets
+
+  void  setNoAckMode (bool  _noAckMode);
+  bool  getNoAckMode () const;
+
+  // Count the bytes each way
+
+  uint64_t  bytesIn () const;
+  uint64_t  bytesOut () const;
+  void  resetByteCounts ();
+
 protected:
 
   //! Trace flags
 
   TraceFlags *traceFlags;
 
-  // Internal OS specific routines to handle individual chars.
+  // Internal OS specific routines to handle blocks of chars.
+
+  virtual bool  putRspBlockRaw (const char  *buf,
+				std::size_t  len) = 0;
+  virtual int   getRspBlockRaw (char        *buf,
+				std::size_t  len,
+				bool         blocking) = 0;
+
+  // Wait for input on the connection itself
+
+  virtual bool  waitRspInput (int  timeoutMs);
 
-  virtual bool  putRspCharRaw (char  c) = 0;
-  virtual int   getRspCharRaw (bool blocking) = 0;
+  // Discard any buffered data (for use when a connection is closed)
+
+  void  clearBuffers ();
 
 private:
 
@@ -70,20 +105,60 @@ private:
 
   static const int BREAK_CHAR = 3;
 
-  //! Has a BREAK arrived?
+  //! The most repeats run length encoding can give, so the count char
+  //! (repeats + 29) is still printable.
+
+  static const int RLE_MAX_REPEAT = 97;
+
+  //! Are we in no-acknowledgement mode?  If so packets are neither
+  //! acknowledged, nor do we wait for an acknowledgement.
+
+  bool  mNoAckMode;
+
+  //! Size of the receive ring buffer
+
+  static const std::size_t RX_BUF_SIZE = 16384;
+
+  //! Size of the transmit buffer
+
+  static const std::size_t TX_BUF_SIZE = 16384;
+
+  //! The receive ring buffer
+
+  char  mRxBuf[RX_BUF_SIZE];
+
+  //! Index of the next char to be read from the receive buffer
+
+  std::size_t  mRxHead;
+
+  //! Count of how many chars are held in the receive buffer
+
+  std::size_t  mRxCount;
+
+  //! The transmit buffer, flushed once per packet (or when full)
+
+  char  mTxBuf[TX_BUF_SIZE];
+
+  //! Count of how many chars are held in the transmit buffer
+
+  std::size_t  mTxCount;
+
+  //! Bytes received, including framing and acknowledgements
 
-  bool mHavePendingBreak;
+  uint64_t  mBytesIn;
 
-  //! The buffered char for get RspChar
-  int  mGetCharBuf;
+  //! Bytes sent, including framing and acknowledgements
 
-  //! Count of how many buffered chars we have
-  int  mNumGetBufChars;
+  uint64_t  mBytesOut;
 
   // Internal routines to handle individual chars
 
+  bool  putRspFrame (char  startChar,
+		     RspPacket *pkt);
   bool  putRspChar (char  c);
+  bool  flushRspChars ();
   int   getRspChar ();
+  bool  fillRxBuf (bool  blocking);
 };	// AbstractConnection ()
 
 // Default implementation of the destructor.
@@ -97,8 +172,12 @@ AbstractConnection::~AbstractConnection ()
 inline
 AbstractConnection::AbstractConnection (TraceFlags *_traceFlags) :
   traceFlags (_traceFlags),
-  mHavePendingBreak (false),
-  mNumGetBufChars (0)
+  mNoAckMode (false),
+  mRxHead (0),
+  mRxCount (0),
+  mTxCount (0),
+  mBytesIn (0),
+  mBytesOut (0)
 {
   // Nothing.
 }
@@ -0,0 +1,495 @@
+// Headless batch runner: definition
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "BatchRunner.h"
+
+using std::cerr;
+using std::cout;
+using std::dec;
+using std::endl;
+using std::hex;
+using std::string;
+using std::vector;
+
+//! Budget to run the target with.  There is nothing to check for between
+//! runs, so we set no limit, and the target need never look at the clock.
+
+static const uint64_t  unlimitedBudget = 0;
+
+// GDB File-I/O open flags (see "Open Flags" in the GDB manual)
+
+static const uint_reg_t FILEIO_O_RDONLY = 0x0;
+static const uint_reg_t FILEIO_O_WRONLY = 0x1;
+static const uint_reg_t FILEIO_O_RDWR   = 0x2;
+static const uint_reg_t FILEIO_O_APPEND = 0x8;
+static const uint_reg_t FILEIO_O_CREAT  = 0x200;
+static const uint_reg_t FILEIO_O_TRUNC  = 0x400;
+static const uint_reg_t FILEIO_O_EXCL   = 0x800;
+
+// GDB File-I/O mode values (see "mode_t Values" in the GDB manual).  The
+// permission bits are the usual ones.
+
+static const uint32_t FILEIO_S_IFREG = 0100000;
+static const uint32_t FILEIO_S_IFDIR = 0040000;
+static const uint32_t FILEIO_S_IFCHR = 0020000;
+static const uint32_t FILEIO_S_PERMS = 0000777;
+
+// GDB File-I/O lseek flags
+
+static const uint_reg_t FILEIO_SEEK_SET = 0;
+static const uint_reg_t FILEIO_SEEK_CUR = 1;
+static const uint_reg_t FILEIO_SEEK_END = 2;
+
+
+//! Constructor
+
+//! @param[in] _cpu         The target to run, with its program loaded
+//! @param[in] _traceFlags  Our trace flags
+
+BatchRunner::BatchRunner (ITarget * _cpu,
+			  const TraceFlags * _traceFlags) :
+  cpu (_cpu),
+  traceFlags (_traceFlags)
+{
+}	// BatchRunner ()
+
+
+//! Run the program until it exits
+
+//! Anything other than a syscall stopping the target means the program
+//! won't finish, so we give up.  Either way, we report the counts.
+
+//! @return  The exit code of the program, or EXIT_FAILURE if it did not
+//!          exit.
+
+int
+BatchRunner::run ()
+{
+  int   exitCode = EXIT_FAILURE;
+  bool  running  = true;
+
+  while (running)
+    {
+      ITarget::ResumeRes  res =
+	cpu->resume (ITarget::ResumeType::CONTINUE, unlimitedBudget);
+
+      switch (res)
+	{
+	case ITarget::ResumeRes::TIMEOUT:
+
+	  break;
+
+	case ITarget::ResumeRes::SYSCALL:
+
+	  running = doSyscall (exitCode);
+	  break;
+
+	case ITarget::ResumeRes::STEPPED:
+	case ITarget::ResumeRes::INTERRUPTED:
+	case ITarget::ResumeRes::WATCHPOINT:
+	  {
+	    uint_reg_t  pc = 0;
+
+	    (void) cpu->readRegister (32, pc);
+	    cerr << "ERROR: Program stopped at 0x" << hex << pc << dec
+		 << " without exiting" << endl;
+	    running = false;
+	  }
+	  break;
+
+	default:
+
+	  cerr << "ERROR: Unexpected result from resume: " << res << endl;
+	  running = false;
+	  break;
+	}
+    }
+
+  cout << "Cycles:       " << cpu->getCycleCount () << endl;
+  cout << "Instructions: " << cpu->getInstrCount () << endl;
+  return  exitCode;
+
+}	// run ()
+
+
+//! Service a syscall
+
+//! The arguments are in a0 to a3, and the syscall number in a7, as for
+//! GdbServerImpl::rspSyscallRequest ().  The result goes back in a0.  As
+//! with GDB, closing the console is quietly ignored.
+
+//! @param[out] exitCode  The exit code, if the program exits
+//! @return  TRUE if the program should carry on, FALSE if it has exited or
+//!          made a syscall we don't know.
+
+bool
+BatchRunner::doSyscall (int & exitCode)
+{
+  uint_reg_t a0, a1, a2, a7;
+  cpu->readRegister (10, a0);
+  cpu->readRegister (11, a1);
+  cpu->readRegister (12, a2);
+  cpu->readRegister (17, a7);
+
+  int  fd = static_cast<int> (a0);
+  int64_t  ret;
+  string   path;
+  struct stat  st;
+
+  switch (a7) {
+    case 57   : ret = (fd <= STDERR_FILENO) ? 0 : close (fd);
+                break;
+    case 62   :
+      {
+	int  whence;
+
+	if (FILEIO_SEEK_SET == a2)
+	  whence = SEEK_SET;
+	else if (FILEIO_SEEK_CUR == a2)
+	  whence = SEEK_CUR;
+	else if (FILEIO_SEEK_END == a2)
+	  whence = SEEK_END;
+	else
+	  {
+	    ret = -1;
+	    break;
+	  }
+
+	ret = lseek (fd, static_cast<off_t> (a1), whence);
+      }
+      break;
+    case 63   : ret = sysRead (fd, a1, a2);
+                break;
+    case 64   : ret = sysWrite (fd, a1, a2);
+                break;
+    case 80   : ret = sysStat (fstat (fd, &st), st, a1);
+                break;
+    case 93   : exitCode = static_cast<int> (a0);
+                cout << "Program exited with code " << exitCode << endl;
+                return  false;
+    case 169  : ret = sysGettimeofday (a0);
+                break;
+    case 1024 : ret = readString (a0, path)
+                  ? open (path.c_str (), hostOpenFlags (a1),
+                          static_cast<mode_t> (a2 & FILEIO_S_PERMS))
+                  : -1;
+                break;
+    case 1026 : ret = readString (a0, path) ? unlink (path.c_str ()) : -1;
+                break;
+    case 1038 : ret = readString (a0, path)
+                  ? sysStat (stat (path.c_str (), &st), st, a1)
+                  : -1;
+                break;
+    default   : cerr << "ERROR: Unknown syscall " << a7 << endl;
+                return  false;
+  }
+
+  cpu->writeRegister (10, static_cast<uint_reg_t> (ret));
+  return  true;
+
+}	// doSyscall ()
+
+
+//! Read from a host file into target memory
+
+//! The count comes from the program, so we read in chunks of at most
+//! IO_CHUNK_SIZE, stopping at the first short read.  If we fail part way, we
+//! report what was transferred before the failure.
+
+//! @param[in] fd     The host file descriptor
+//! @param[in] addr   Target address of the buffer
+//! @param[in] count  Number of bytes to read
+//! @return  The number of bytes read, or -1 on error
+
+int64_t
+BatchRunner::sysRead (int  fd,
+		       uint_reg_t  addr,
+		       uint_reg_t  count)
+{
+  vector<uint8_t>  buf (IO_CHUNK_SIZE);
+  uint_reg_t  done = 0;
+
+  while (done < count)
+    {
+      std::size_t  chunk = IO_CHUNK_SIZE;
+
+      if (count - done < chunk)
+	chunk = static_cast<std::size_t> (count - done);
+
+      ssize_t  res = read (fd, buf.data (), chunk);
+
+      if (res < 0)
+	return  (0 == done) ? -1 : static_cast<int64_t> (done);
+
+      std::size_t  len = static_cast<std::size_t> (res);
+
+      if (cpu->write (static_cast<uint32_t> (addr + done), buf.data (), len)
+	  != len)
+	return  (0 == done) ? -1 : static_cast<int64_t> (done);
+
+      done += static_cast<uint_reg_t> (res);
+
+      if (len < chunk)
+	break;
+    }
+
+  return  static_cast<int64_t> (done);
+
+}	// sysRead ()
+
+
+//! Write from target memory to a host file
+
+//! As for sysRead (), we write in chunks of at most IO_CHUNK_SIZE,
+//! stopping at the first short write.
+
+//! @param[in] fd     The host file descriptor
+//! @param[in] addr   Target address of the buffer
+//! @param[in] count  Number of bytes to write
+//! @return  The number of bytes written, or -1 on error
+
+int64_t
+BatchRunner::sysWrite (int  fd,
+		       uint_reg_t  addr,
+		       uint_reg_t  count)
+{
+  vector<uint8_t>  buf (IO_CHUNK_SIZE);
+  uint_reg_t  done = 0;
+
+  while (done < count)
+    {
+      std::size_t  chunk = IO_CHUNK_SIZE;
+
+      if (count - done < chunk)
+	chunk = static_cast<std::size_t> (count - done);
+
+      if (cpu->read (static_cast<uint32_t> (addr + done), buf.data (), chunk)
+	  != chunk)
+	return  (0 == done) ? -1 : static_cast<int64_t> (done);
+
+      ssize_t  res = write (fd, buf.data (), chunk);
+
+      if (res < 0)
+	return  (0 == done) ? -1 : static_cast<int64_t> (done);
+
+      done += static_cast<uint_reg_t> (res);
+
+      if (static_cast<std::size_t> (res) < chunk)
+	break;
+    }
+
+  return  static_cast<int64_t> (done);
+
+}	// sysWrite ()
+
+
+//! Write back the result of stat or fstat
+
+//! The target gets the GDB File-I/O stat structure, with every field big
+//! endian, just as GDB would send it.
+
+//! @param[in] res   The result of the host stat or fstat
+//! @param[in] st    The host stat structure
+//! @param[in] addr  Target address of the stat structure
+//! @return  0 on success, -1 on error
+
+int64_t
+BatchRunner::sysStat (int  res,
+		      const struct stat & st,
+		      uint_reg_t  addr)
+{
+  if (res < 0)
+    return  -1;
+
+  uint8_t  fst[FIO_STAT_SIZE];
+
+  putBigEndian (&(fst[0]), st.st_dev, 4);
+  putBigEndian (&(fst[4]), st.st_ino, 4);
+  putBigEndian (&(fst[8]), fioMode (st.st_mode), 4);
+  putBigEndian (&(fst[12]), st.st_nlink, 4);
+  putBigEndian (&(fst[16]), st.st_uid, 4);
+  putBigEndian (&(fst[20]), st.st_gid, 4);
+  putBigEndian (&(fst[24]), st.st_rdev, 4);
+  putBigEndian (&(fst[28]), st.st_size, 8);
+  putBigEndian (&(fst[36]), st.st_blksize, 8);
+  putBigEndian (&(fst[44]), st.st_blocks, 8);
+  putBigEndian (&(fst[52]), st.st_atime, 4);
+  putBigEndian (&(fst[56]), st.st_mtime, 4);
+  putBigEndian (&(fst[60]), st.st_ctime, 4);
+
+  if (cpu->write (static_cast<uint32_t> (addr), fst, sizeof (fst))
+      != sizeof (fst))
+    return  -1;
+
+  return  0;
+
+}	// sysStat ()
+
+
+//! Get the time of day into target memory
+
+//! As with stat, the target gets the big endian GDB File-I/O structure.  GDB
+//! ignores the timezone, and so do we.
+
+//! @param[in] addr  Target address of the timeval structure
+//! @return  0 on success, -1 on error
+
+int64_t
+BatchRunner::sysGettimeofday (uint_reg_t  addr)
+{
+  struct timeval tv;
+
+  if (gettimeofday (&tv, nullptr) < 0)
+    return  -1;
+
+  uint8_t  ftv[FIO_TIMEVAL_SIZE];
+
+  putBigEndian (&(ftv[0]), tv.tv_sec, 4);
+  putBigEndian (&(ftv[4]), tv.tv_usec, 8);
+
+  if (cpu->write (static_cast<uint32_t> (addr), ftv, sizeof (ftv))
+      != sizeof (ftv))
+    return  -1;
+
+  return  0;
+
+}	// sysGettimeofday ()
+
+
+//! Read a NULL terminated string from target memory
+
+//! @param[in]  addr  Target address of the string
+//! @param[out] str   The string read
+//! @return  TRUE if we found the end of the string, FALSE otherwise.
+
+bool
+BatchRunner::readString (uint_reg_t  addr,
+			 string & str)
+{
+  str.clear ();
+
+  for (std::size_t  i = 0; i < MAX_PATH_LEN; i++)
+    {
+      uint8_t  ch;
+
+      if (cpu->read (static_cast<uint32_t> (addr + i), &ch, 1) != 1)
+	return  false;
+
+      if ('\0' == ch)
+	return  true;
+
+      str.push_back (static_cast<char> (ch));
+    }
+
+  return  false;
+
+}	// readString ()
+
+
+//! Convert GDB File-I/O open flags to host flags
+
+//! @param[in] flags  The GDB flags
+//! @return  The host flags
+
+int
+BatchRunner::hostOpenFlags (uint_reg_t  flags)
+{
+  int  hostFlags;
+
+  if (FILEIO_O_RDWR == (flags & (FILEIO_O_WRONLY | FILEIO_O_RDWR)))
+    hostFlags = O_RDWR;
+  else if (FILEIO_O_WRONLY == (flags & (FILEIO_O_WRONLY | FILEIO_O_RDWR)))
+    hostFlags = O_WRONLY;
+  else
+    hostFlags = O_RDONLY;
+
+  if (0 != (flags & FILEIO_O_APPEND))
+    hostFlags |= O_APPEND;
+  if (0 != (flags & FILEIO_O_CREAT))
+    hostFlags |= O_CREAT;
+  if (0 != (flags & FILEIO_O_TRUNC))
+    hostFlags |= O_TRUNC;
+  if (0 != (flags & FILEIO_O_EXCL))
+    hostFlags |= O_EXCL;
+
+  return  hostFlags;
+
+}	// hostOpenFlags ()
+
+
+//! Convert a host file mode to a GDB File-I/O mode
+
+//! GDB only knows about regular files, directories and character devices.
+
+//! @param[in] mode  The host mode
+//! @return  The GDB mode
+
+uint32_t
+BatchRunner::fioMode (mode_t  mode)
+{
+  uint32_t  fmode = mode & FILEIO_S_PERMS;
+
+  if (S_ISREG (mode))
+    fmode |= FILEIO_S_IFREG;
+  else if (S_ISDIR (mode))
+    fmode |= FILEIO_S_IFDIR;
+  else if (S_ISCHR (mode))
+    fmode |= FILEIO_S_IFCHR;
+
+  return  fmode;
+
+}	// fioMode ()
+
+
+//! Store a value big endian
+
+//! Values too big for the field are truncated, as GDB does.
+
+//! @param[out] buf  Where to store the value
+//! @param[in]  val  The value
+//! @param[in]  len  Size of the field in bytes
+
+void
+BatchRunner::putBigEndian (uint8_t * buf,
+			   uint64_t  val,
+			   std::size_t  len)
+{
+  for (std::size_t  i = len; i > 0; i--)
+    {
+      buf[i - 1] = static_cast<uint8_t> (val & 0xff);
+      val >>= 8;
+    }
+}	// putBigEndian ()
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,118 @@
+// Headless batch runner: declaration
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <sys/stat.h>
+
+#include "ITarget.h"
+#include "TraceFlags.h"
+
+
+//! Run a loaded program to completion without a GDB client
+
+//! The program's syscalls are the same ones the GDB server hands to GDB as
+//! File-I/O requests (@see GdbServerImpl::rspSyscallRequest ()), with the
+//! same numbering in a7.  Here we service them directly on the host,
+//! writing back results in the layout GDB would use, so a program behaves
+//! just as it does under GDB.  When the program exits we report its exit
+//! code and how many cycles and instructions it took.
+
+class BatchRunner
+{
+public:
+
+  // Constructor
+
+  BatchRunner (ITarget * _cpu,
+	       const TraceFlags * _traceFlags);
+
+  // Run until the program exits.  Returns the exit code of the program, or
+  // EXIT_FAILURE if it stopped without exiting.
+
+  int  run ();
+
+  // Service the syscall the target has stopped at.  Also used by the GDB
+  // server in non-stop mode, where it can't hand syscalls to GDB.
+
+  bool  doSyscall (int & exitCode);
+
+private:
+
+  //! Size of the GDB File-I/O stat structure
+
+  static const std::size_t FIO_STAT_SIZE = 64;
+
+  //! Size of the GDB File-I/O timeval structure
+
+  static const std::size_t FIO_TIMEVAL_SIZE = 12;
+
+  //! Longest file name we will read from the target
+
+  static const std::size_t MAX_PATH_LEN = 4096;
+
+  //! Most bytes we move between host file and target memory at a time
+
+  static const std::size_t IO_CHUNK_SIZE = 64 * 1024;
+
+  //! The target we are running
+
+  ITarget *cpu;
+
+  //! Our trace flags
+
+  const TraceFlags *traceFlags;
+
+  // Internal helper methods
+
+  int64_t  sysRead (int  fd,
+		    uint_reg_t  addr,
+		    uint_reg_t  count);
+  int64_t  sysWrite (int  fd,
+		     uint_reg_t  addr,
+		     uint_reg_t  count);
+  int64_t  sysStat (int  res,
+		    const struct stat & st,
+		    uint_reg_t  addr);
+  int64_t  sysGettimeofday (uint_reg_t  addr);
+  bool  readString (uint_reg_t  addr,
+		    std::string & str);
+  static int  hostOpenFlags (uint_reg_t  flags);
+  static uint32_t  fioMode (mode_t  mode);
+  static void  putBigEndian (uint8_t * buf,
+			     uint64_t  val,
+			     std::size_t  len);
+
+};	// class BatchRunner
+
+#endif	// BATCH_RUNNER_H
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,228 @@
+// Watcher for a break from the client: definition
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "BreakWatcher.h"
+
+using std::cerr;
+using std::endl;
+
+
+//! Constructor
+
+//! We start the watching thread straight away, but it does nothing until
+//! armed.  Without a pipe to wake it, we can't have a thread, in which case
+//! we can never be armed, and the server must look for breaks itself.
+
+BreakWatcher::BreakWatcher () :
+  mFlag (false),
+  mFd (-1),
+  mQuit (false)
+{
+  if (0 != pipe2 (mWakeFd, O_CLOEXEC | O_NONBLOCK))
+    {
+      cerr << "Warning: Cannot create break watcher pipe: "
+	   << strerror (errno) << endl;
+      mWakeFd[0] = -1;
+      mWakeFd[1] = -1;
+      return;
+    }
+
+  mThread = std::thread (&BreakWatcher::watch, this);
+
+}	// BreakWatcher ()
+
+
+//! Destructor
+
+//! Tell the thread to quit and wait for it.
+
+BreakWatcher::~BreakWatcher ()
+{
+  if (!mThread.joinable ())
+    return;
+
+  {
+    std::lock_guard<std::mutex>  lock (mMutex);
+
+    mQuit = true;
+    mFd   = -1;
+    (void) write (mWakeFd[1], "q", 1);
+  }
+
+  mCond.notify_one ();
+  mThread.join ();
+  close (mWakeFd[0]);
+  close (mWakeFd[1]);
+
+}	// ~BreakWatcher ()
+
+
+//! Start watching a connection
+
+//! The flag is cleared, and set again as soon as there is anything to read
+//! on the connection.
+
+//! @param[in] fd  The file descriptor of the connection, or -1 if the
+//!                connection has none we can watch.
+//! @return  TRUE if we are now watching, FALSE if we can't.
+
+bool
+BreakWatcher::arm (int  fd)
+{
+  if ((fd < 0) || !mThread.joinable ())
+    return  false;
+
+  {
+    std::lock_guard<std::mutex>  lock (mMutex);
+
+    mFlag.store (false);
+    mFd = fd;
+  }
+
+  mCond.notify_one ();
+  return  true;
+
+}	// arm ()
+
+
+//! Stop watching
+
+//! The flag is cleared, and the thread woken if it is waiting on the
+//! connection, so it lets go of it.
+
+void
+BreakWatcher::disarm ()
+{
+  if (!mThread.joinable ())
+    return;
+
+  std::lock_guard<std::mutex>  lock (mMutex);
+
+  mFlag.store (false);
+
+  if (-1 != mFd)
+    {
+      mFd = -1;
+      (void) write (mWakeFd[1], "d", 1);
+    }
+}	// disarm ()
+
+
+//! Are we watching a connection?
+
+//! @return  TRUE if we are armed and have not yet fired.
+
+bool
+BreakWatcher::armed ()
+{
+  std::lock_guard<std::mutex>  lock (mMutex);
+
+  return  -1 != mFd;
+
+}	// armed ()
+
+
+//! Have we fired?
+
+//! @return  TRUE if the connection became readable since we were armed.
+
+bool
+BreakWatcher::fired () const
+{
+  return  mFlag.load ();
+
+}	// fired ()
+
+
+//! The flag we set when we fire
+
+//! @return  A pointer to the flag, for the target to watch.
+
+const std::atomic<bool> *
+BreakWatcher::flag () const
+{
+  return  &mFlag;
+
+}	// flag ()
+
+
+//! The watching thread
+
+//! Wait until armed, then wait on both the connection and our pipe.  If the
+//! connection became readable and we are still armed on it, fire.
+
+void
+BreakWatcher::watch ()
+{
+  std::unique_lock<std::mutex>  lock (mMutex);
+
+  for (;;)
+    {
+      mCond.wait (lock, [this] { return  mQuit || (-1 != mFd); });
+
+      if (mQuit)
+	return;
+
+      int  fd = mFd;
+      struct pollfd  fds[2];
+
+      fds[0].fd     = fd;
+      fds[0].events = POLLIN;
+      fds[1].fd     = mWakeFd[0];
+      fds[1].events = POLLIN;
+
+      lock.unlock ();
+      int  res = poll (fds, 2, -1);
+      lock.lock ();
+
+      if (res <= 0)
+	continue;			// Interrupted, so just try again
+
+      if (0 != (fds[1].revents & POLLIN))
+	{
+	  char  buf[16];
+
+	  while (read (mWakeFd[0], buf, sizeof (buf)) > 0)
+	    ;
+	}
+
+      if ((0 != fds[0].revents) && (fd == mFd))
+	{
+	  mFlag.store (true);
+	  mFd = -1;
+	}
+    }
+}	// watch ()
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
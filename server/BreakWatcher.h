@@ -0,0 +1,107 @@
+// Watcher for a break from the client: declaration
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef BREAK_WATCHER_H
+#define BREAK_WATCHER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+
+//! Watch a client connection for input while the target runs
+
+//! While GDB is waiting for a continue to finish, the only thing it sends is
+//! a break (ctrl-C).  Rather than have the server stop the target regularly
+//! to look, a thread of our own waits for the connection to become readable
+//! and then sets a flag, which the target can check for next to nothing
+//! (@see ITarget::breakFlag ()).  The watcher only reports that something
+//! has arrived.  It is still up to the server to read it and see if it is a
+//! break.
+
+//! Having fired, the watcher disarms itself, and only watches again when
+//! armed.
+
+class BreakWatcher
+{
+public:
+
+  // Constructor and destructor
+
+  BreakWatcher ();
+  ~BreakWatcher ();
+
+  // Start and stop watching a connection
+
+  bool  arm (int  fd);
+  void  disarm ();
+
+  // Accessors
+
+  bool  armed ();
+  bool  fired () const;
+  const std::atomic<bool> * flag () const;
+
+private:
+
+  //! Set when the connection became readable while we were armed
+
+  std::atomic<bool>  mFlag;
+
+  //! Guards everything but the flag
+
+  std::mutex  mMutex;
+
+  //! Signalled when we are armed, or told to quit
+
+  std::condition_variable  mCond;
+
+  //! The connection we are watching, or -1 if we are not armed
+
+  int  mFd;
+
+  //! Set when the thread should exit
+
+  bool  mQuit;
+
+  //! A pipe, written to wake the thread from waiting on the connection
+
+  int  mWakeFd[2];
+
+  //! The watching thread, which only runs if we got our pipe
+
+  std::thread  mThread;
+
+  // The watching thread
+
+  void  watch ();
+
+};	// class BreakWatcher
+
+#endif	// BREAK_WATCHER_H
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,274 @@
+// ELF program loader: definition
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ElfLoader.h"
+
+#ifndef EM_RISCV
+#define EM_RISCV  243
+#endif
+
+using std::cerr;
+using std::cout;
+using std::dec;
+using std::endl;
+using std::hex;
+
+
+//! Constructor
+
+//! @param[in] _cpu         The target to load programs into
+//! @param[in] _traceFlags  Our trace flags
+
+ElfLoader::ElfLoader (ITarget * _cpu,
+		      const TraceFlags * _traceFlags) :
+  cpu (_cpu),
+  traceFlags (_traceFlags)
+{
+}	// ElfLoader ()
+
+
+//! Load a program
+
+//! The file is mapped rather than read, so the segments can be written to
+//! the target straight from the page cache.  We only accept little endian
+//! RISC-V executables, and take the ELF headers as they lie in the file, so
+//! assume a little endian host.
+
+//! @param[in] fileName  The ELF file to load
+//! @return  TRUE if the program was loaded, FALSE otherwise, in which case
+//!          an error has been reported.
+
+bool
+ElfLoader::load (const char * fileName)
+{
+  int  fd = open (fileName, O_RDONLY);
+
+  if (fd < 0)
+    {
+      cerr << "ERROR: Cannot open " << fileName << ": " << strerror (errno)
+	   << endl;
+      return  false;
+    }
+
+  struct stat  st;
+
+  if (fstat (fd, &st) < 0)
+    {
+      cerr << "ERROR: Cannot stat " << fileName << ": " << strerror (errno)
+	   << endl;
+      close (fd);
+      return  false;
+    }
+
+  std::size_t  imageSize = static_cast<std::size_t> (st.st_size);
+
+  if (imageSize < EI_NIDENT)
+    {
+      cerr << "ERROR: " << fileName << " is not an ELF file" << endl;
+      close (fd);
+      return  false;
+    }
+
+  void *map = mmap (nullptr, imageSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+
+  if (MAP_FAILED == map)
+    {
+      cerr << "ERROR: Cannot map " << fileName << ": " << strerror (errno)
+	   << endl;
+      return  false;
+    }
+
+  const uint8_t *image = static_cast<const uint8_t *> (map);
+  bool  res;
+
+  if (0 != memcmp (image, ELFMAG, SELFMAG))
+    {
+      cerr << "ERROR: " << fileName << " is not an ELF file" << endl;
+      res = false;
+    }
+  else if (ELFDATA2LSB != image[EI_DATA])
+    {
+      cerr << "ERROR: " << fileName << " is not little endian" << endl;
+      res = false;
+    }
+  else if (ELFCLASS32 == image[EI_CLASS])
+    res = loadImage<Elf32_Ehdr, Elf32_Phdr> (fileName, image, imageSize);
+  else if (ELFCLASS64 == image[EI_CLASS])
+    res = loadImage<Elf64_Ehdr, Elf64_Phdr> (fileName, image, imageSize);
+  else
+    {
+      cerr << "ERROR: " << fileName << " has unknown ELF class" << endl;
+      res = false;
+    }
+
+  munmap (map, imageSize);
+  return  res;
+
+}	// load ()
+
+
+//! Load the segments of a mapped ELF image
+
+//! Specialized on the ELF class, since the headers differ in layout.  Each
+//! loadable segment is written at its physical address, which is what GDB
+//! uses for "load".
+
+//! @param[in] fileName   The name of the file, for messages
+//! @param[in] image      The mapped file
+//! @param[in] imageSize  Size of the mapped file
+//! @return  TRUE if the program was loaded, FALSE otherwise.
+
+template <typename Ehdr, typename Phdr>
+bool
+ElfLoader::loadImage (const char * fileName,
+		      const uint8_t * image,
+		      std::size_t  imageSize)
+{
+  if (imageSize < sizeof (Ehdr))
+    {
+      cerr << "ERROR: " << fileName << " is truncated" << endl;
+      return  false;
+    }
+
+  const Ehdr *ehdr = reinterpret_cast<const Ehdr *> (image);
+
+  if ((ET_EXEC != ehdr->e_type) || (EM_RISCV != ehdr->e_machine))
+    {
+      cerr << "ERROR: " << fileName << " is not a RISC-V executable" << endl;
+      return  false;
+    }
+
+  if ((ehdr->e_phoff > imageSize)
+      || (sizeof (Phdr) != ehdr->e_phentsize)
+      || (static_cast<uint64_t> (ehdr->e_phnum) * sizeof (Phdr)
+	  > imageSize - ehdr->e_phoff))
+    {
+      cerr << "ERROR: " << fileName << " has bad program headers" << endl;
+      return  false;
+    }
+
+  const Phdr *phdr = reinterpret_cast<const Phdr *> (image + ehdr->e_phoff);
+  uint64_t  total = 0;
+  int  numSegs = 0;
+
+  for (int  i = 0; i < ehdr->e_phnum; i++, phdr++)
+    {
+      if ((PT_LOAD != phdr->p_type) || (0 == phdr->p_memsz))
+	continue;
+
+      if ((phdr->p_filesz > phdr->p_memsz)
+	  || (phdr->p_offset > imageSize)
+	  || (phdr->p_filesz > imageSize - phdr->p_offset)
+	  || (static_cast<uint64_t> (phdr->p_paddr) + phdr->p_memsz
+	      > (static_cast<uint64_t> (UINT32_MAX) + 1)))
+	{
+	  cerr << "ERROR: " << fileName << " has a bad segment" << endl;
+	  return  false;
+	}
+
+      uint32_t     addr   = static_cast<uint32_t> (phdr->p_paddr);
+      std::size_t  filesz = static_cast<std::size_t> (phdr->p_filesz);
+
+      if (cpu->write (addr, image + phdr->p_offset, filesz) != filesz)
+	{
+	  cerr << "ERROR: Cannot write segment at 0x" << hex << addr << dec
+	       << " of " << fileName << endl;
+	  return  false;
+	}
+
+      if (!zero (addr + phdr->p_filesz, phdr->p_memsz - phdr->p_filesz))
+	{
+	  cerr << "ERROR: Cannot clear segment at 0x" << hex << addr << dec
+	       << " of " << fileName << endl;
+	  return  false;
+	}
+
+      total += phdr->p_memsz;
+      numSegs++;
+    }
+
+  if (0 == cpu->writeRegister (RISCV_PC_REGNUM,
+			       static_cast<uint_reg_t> (ehdr->e_entry)))
+    {
+      cerr << "ERROR: Cannot set PC to entry point of " << fileName << endl;
+      return  false;
+    }
+
+  if (!traceFlags->traceSilent ())
+    cout << "Loaded " << fileName << ": " << total << " bytes in " << numSegs
+	 << " segments, entry point 0x" << hex << ehdr->e_entry << dec
+	 << endl;
+
+  return  true;
+
+}	// loadImage ()
+
+
+//! Zero a block of target memory
+
+//! Written a block at a time from a block of zeros, so the bss costs no more
+//! host memory however big it is.
+
+//! @param[in] addr  Start of the memory to clear
+//! @param[in] size  Number of bytes to clear
+//! @return  TRUE if the memory was cleared, FALSE otherwise.
+
+bool
+ElfLoader::zero (uint64_t  addr,
+		 uint64_t  size)
+{
+  static const uint8_t  zeros[ZERO_BLOCK_SIZE] = { 0 };
+
+  while (size > 0)
+    {
+      std::size_t  len = ZERO_BLOCK_SIZE;
+
+      if (size < len)
+	len = static_cast<std::size_t> (size);
+
+      if (cpu->write (static_cast<uint32_t> (addr), zeros, len) != len)
+	return  false;
+
+      addr += len;
+      size -= len;
+    }
+
+  return  true;
+
+}	// zero ()
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
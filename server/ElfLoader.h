@@ -0,0 +1,89 @@
+// ELF program loader: declaration
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef ELF_LOADER_H
+#define ELF_LOADER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ITarget.h"
+#include "TraceFlags.h"
+
+
+//! Load an ELF program straight into target memory
+
+//! Loading with GDB means a stream of X packets, each holding a packet's
+//! worth of the program.  Instead we map the file and write each loadable
+//! segment to the target in a single block, zero any part of the segment not
+//! in the file (the bss), and set the PC to the entry point.  This is what
+//! GDB's "load" does, less the round trips.
+
+class ElfLoader
+{
+public:
+
+  // Constructor
+
+  ElfLoader (ITarget * _cpu,
+	     const TraceFlags * _traceFlags);
+
+  // Load a program.  Return value indicates whether the load was successful
+
+  bool  load (const char * fileName);
+
+private:
+
+  //! Register number of the PC, as used by GDB
+
+  static const int RISCV_PC_REGNUM = 32;
+
+  //! Size of the block of zeros written at a time for the bss
+
+  static const std::size_t ZERO_BLOCK_SIZE = 4096;
+
+  //! The target we load into
+
+  ITarget *cpu;
+
+  //! Our trace flags
+
+  const TraceFlags *traceFlags;
+
+  // Internal helper methods
+
+  template <typename Ehdr, typename Phdr>
+  bool  loadImage (const char * fileName,
+		   const uint8_t * image,
+		   std::size_t  imageSize);
+  bool  zero (uint64_t  addr,
+	      uint64_t  size);
+
+};	// class ElfLoader
+
+#endif	// ELF_LOADER_H
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -24,22 +24,42 @@
 
 #include "GdbServer.h"
 #include "GdbServerImpl.h"
+#include "SingleTarget.h"
 
 
 //! Constructor for the GDB RSP server.
 
-//! A wrapper for the implementation class
+//! A wrapper for the implementation class.  If the server is specialized
+//! for a single target, and this is that target, we use the implementation
+//! for its class.  Otherwise (for example for a group of harts) we use the
+//! general implementation.
 
 //! @param[in] rspPort      RSP port to use.
 //! @param[in] _cpu         The simulated CPU
 //! @param[in] _traceFlags  Flags controlling tracing
+//! @param[in] _killBehaviour  How to behave on a kill (k) packet
+//! @param[in] _pktSize     Maximum RSP packet size
 
 GdbServer::GdbServer (AbstractConnection * _conn,
 			      ITarget * _cpu,
 			      TraceFlags * _traceFlags,
-			      GdbServer::KillBehaviour _killBehaviour)
+			      GdbServer::KillBehaviour _killBehaviour,
+			      int _pktSize)
 {
-  mServerImpl = new GdbServerImpl (_conn, _cpu, _traceFlags, _killBehaviour);
+#ifdef HAVE_SINGLE_TARGET
+  SingleTarget *single = dynamic_cast<SingleTarget *> (_cpu);
+
+  if (nullptr != single)
+    {
+      mServerImpl = new GdbServerImpl<SingleTarget> (_conn, single,
+						     _traceFlags,
+						     _killBehaviour, _pktSize);
+      return;
+    }
+#endif
+
+  mServerImpl = new GdbServerImpl<ITarget> (_conn, _cpu, _traceFlags,
+					    _killBehaviour, _pktSize);
 
 }	// GdbServer::GdbServer ()
 
@@ -80,6 +100,34 @@ GdbServer::command (const std::string  cmd,
 }	// GdbServer::rspServer ()
 
 
+//! Are we still holding any matchpoints?
+
+//! Wrap the implementation class
+
+//! @return  TRUE if any matchpoints are inserted, FALSE otherwise.
+
+bool
+GdbServer::holdingMatchpoints () const
+{
+  return  mServerImpl->holdingMatchpoints ();
+
+}	// GdbServer::holdingMatchpoints ()
+
+
+//! Dump the statistics as JSON
+
+//! Wrap the implementation class
+
+//! @param[out] stream  Where to dump the statistics
+
+void
+GdbServer::dumpStats (std::ostream & stream) const
+{
+  mServerImpl->dumpStats (stream);
+
+}	// GdbServer::dumpStats ()
+
+
 //! Output operator for KillBehavior enumeration
 
 //! @param[in] s  The stream to output to.
@@ -31,7 +31,7 @@
 // Classes needed for the declaration
 
 class AbstractConnection;
-class GdbServerImpl;
+class AbstractGdbServerImpl;
 class ITarget;
 class TraceFlags;
 
@@ -56,12 +56,18 @@ public:
       EXIT_ON_KILL
     };
 
+  //! Default maximum RSP packet size.  Large enough that bulk memory
+  //! transfers (e.g. load) need few round trips.
+
+  static const int DEFAULT_PKT_SIZE = 0x10000;
+
   // Constructor and destructor
 
   GdbServer (AbstractConnection * _conn,
 	     ITarget * _cpu,
 	     TraceFlags * _traceFlags,
-	     KillBehaviour _killBehaviour);
+	     KillBehaviour _killBehaviour,
+	     int _pktSize = DEFAULT_PKT_SIZE);
   ~GdbServer ();
 
   // Main loop to listen for and service RSP requests.
@@ -73,10 +79,18 @@ public:
   bool command (const std::string  cmd,
 		std::ostream & stream);
 
+  // Are we still holding any matchpoints?
+
+  bool holdingMatchpoints () const;
+
+  // Dump the statistics as JSON
+
+  void dumpStats (std::ostream & stream) const;
+
 
 private:
 
-  GdbServerImpl * mServerImpl;		// The actual implementation
+  AbstractGdbServerImpl * mServerImpl;	// The actual implementation
 
 };	// GdbServer ()
 
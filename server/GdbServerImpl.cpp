@@ -33,7 +33,10 @@
 #include <cassert>
 
 #include "GdbServerImpl.h"
+#include "ElfLoader.h"
+#include "InsnTrace.h"
 #include "Utils.h"
+#include "SingleTarget.h"
 #include "SyscallReplyPacket.h"
 
 using std::chrono::duration;
@@ -58,9 +61,16 @@ using std::vector;
 //! monitor command) and if this timeout is greater than the user timeout
 //! then things will stop working.  But you want this pretty short anyway
 //! in order that GDB appear responsive.
-const std::chrono::duration <double> GdbServerImpl::interruptTimeout
+template <class TARGET>
+const std::chrono::duration <double> GdbServerImpl<TARGET>::interruptTimeout
                                 = std::chrono::duration <double> (0.1);
 
+//! How often to report the speed of the model while it runs, when tracing
+//! it.
+template <class TARGET>
+const std::chrono::duration <double> GdbServerImpl<TARGET>::speedTraceInterval
+                                = std::chrono::duration <double> (1.0);
+
 //! Constructor for the GDB RSP server.
 
 //! Allocate a packet data structure and a new RSP connection. By default no
@@ -69,30 +79,68 @@ const std::chrono::duration <double> GdbServerImpl::interruptTimeout
 //! @param[in] rspPort      RSP port to use.
 //! @param[in] _cpu         The simulated CPU
 //! @param[in] _traceFlags  Flags controlling tracing
-
-GdbServerImpl::GdbServerImpl (AbstractConnection * _conn,
-			      ITarget * _cpu,
-			      TraceFlags * _traceFlags,
-			      GdbServer::KillBehaviour _killBehaviour) :
+//! @param[in] _killBehaviour  How to behave on a kill (k) packet
+//! @param[in] _pktSize     Maximum RSP packet size.  Silently increased to
+//!                         RSP_PKT_SIZE if smaller.
+
+template <class TARGET>
+GdbServerImpl<TARGET>::GdbServerImpl (AbstractConnection * _conn,
+				      TARGET * _cpu,
+				      TraceFlags * _traceFlags,
+				      GdbServer::KillBehaviour _killBehaviour,
+				      int _pktSize) :
   cpu (_cpu),
+  mHarts (dynamic_cast<HartGroup *> (static_cast<ITarget *> (_cpu))),
   traceFlags (_traceFlags),
   rsp (_conn),
   mTimeout (duration <double>::zero ()),
+  mSpeedTraceCycles (0),
+  mSpeedTraceInstrs (0),
+  mSliceBudget (INITIAL_SLICE_BUDGET),
   killBehaviour (_killBehaviour),
   mExitServer (false),
+  mClientSwbreak (false),
+  mClientHwbreak (false),
+  mNonStop (false),
+  mRunning (false),
+  mStopRequested (false),
+  mStopRes (ITarget::ResumeRes::NONE),
+  mStopSig (TargetSignal::TRAP),
+  mTargetWaiters (0),
   mSyscallContinuation (SYSCALL_NONE_PENDING)
 {
-  pkt           = new RspPacket (RSP_PKT_SIZE);
+  pkt           = new RspPacket ((_pktSize < RSP_PKT_SIZE)
+				 ? RSP_PKT_SIZE : _pktSize);
+  mMemBuf       = new uint8_t [pkt->getBufSize ()];
   mpHash        = new MpHash ();
+  mStats        = new ServerStats ();
+  mMemCache     = new MemCache<TARGET> (cpu, mStats);
+  mBreakWatcher = new BreakWatcher ();
+  mProfile      = new Profile ();
+  mSyscalls     = new BatchRunner (cpu, traceFlags);
+
+  cpu->breakFlag (mBreakWatcher->flag ());
+  cpu->profile (mProfile);
+  invalidateCaches ();
 
 }	// GdbServerImpl ()
 
 
 //! Destructor
 
-GdbServerImpl::~GdbServerImpl ()
+template <class TARGET>
+GdbServerImpl<TARGET>::~GdbServerImpl ()
 {
+  stopRunner ();
+  cpu->breakFlag (nullptr);
+  cpu->profile (nullptr);
+  delete  mSyscalls;
+  delete  mProfile;
+  delete  mBreakWatcher;
+  delete  mMemCache;
+  delete  mStats;
   delete  mpHash;
+  delete [] mMemBuf;
   delete  pkt;
 
 }	// ~GdbServerImpl
@@ -102,8 +150,9 @@ GdbServerImpl::~GdbServerImpl ()
 
 //! This only terminates if there was an error.
 
+template <class TARGET>
 int
-GdbServerImpl::rspServer ()
+GdbServerImpl<TARGET>::rspServer ()
 {
   // Loop processing commands forever
   while (!mExitServer)
@@ -111,6 +160,11 @@ GdbServerImpl::rspServer ()
       // Make sure we are still connected.
       while (!rsp->isConnected ())
 	{
+	  // A connection which serves just one client is finished when that
+	  // client goes.
+	  if (!rsp->canReconnect ())
+	    return  EXIT_SUCCESS;
+
 	  // Reconnect and stall the processor on a new connection
 	  if (!rsp->rspConnect ())
 	    {
@@ -120,12 +174,22 @@ GdbServerImpl::rspServer ()
 	    }
 
 	  // Reset this after making a new connection as the last exit
-	  // will have left it set.
+	  // will have left it set.  Likewise a new client has not yet
+	  // negotiated no-ack mode or non-stop mode.
 	  mSyscallContinuation = SYSCALL_NONE_PENDING;
+	  rsp->setNoAckMode (false);
+	  mClientSwbreak = false;
+	  mClientHwbreak = false;
+	  mNonStop = false;
+	  mStopQueue.clear ();
 	}
 
-      // Get a RSP client request
-      rspClientRequest ();
+      // Get a RSP client request, unless the target is running in non-stop
+      // mode, when we must also look out for it stopping.
+      if (mRunner.joinable ())
+	rspNonStopService ();
+      else
+	rspClientRequest ();
     }
 
   return EXIT_SUCCESS;
@@ -140,9 +204,11 @@ GdbServerImpl::rspServer ()
 //! @param[out] stream  Response as text on a stream
 //! @return  TRUE if the command was accepted, FALSE otherwise
 
+template <class TARGET>
 bool
-GdbServerImpl::command (const std::string  cmd __attribute__ ((unused)),
-			std::ostream & stream __attribute__ ((unused)))
+GdbServerImpl<TARGET>::command (const std::string  cmd
+				  __attribute__ ((unused)),
+				std::ostream & stream __attribute__ ((unused)))
 {
   // We don't handle any commands yet.
   return  false;
@@ -150,15 +216,49 @@ GdbServerImpl::command (const std::string  cmd __attribute__ ((unused)),
 }	// GdbServerImpl::rspServer ()
 
 
+//! Are we still holding any matchpoints?
+
+//! Once the client has gone, this says whether it left any breakpoints or
+//! watchpoints in the target.
+
+//! @return  TRUE if any matchpoints are inserted, FALSE otherwise.
+
+template <class TARGET>
+bool
+GdbServerImpl<TARGET>::holdingMatchpoints () const
+{
+  for (int  t = 0; t < NUM_MP_TYPES; t++)
+    if (mpHash->any (static_cast<MpType> (t)))
+      return  true;
+
+  return  !mWatchpoints.empty ();
+
+}	// holdingMatchpoints ()
+
+
+//! Dump the statistics as JSON
+
+//! @param[out] stream  Where to dump the statistics
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::dumpStats (std::ostream & stream) const
+{
+  mStats->dumpJson (stream, rsp->bytesIn (), rsp->bytesOut ());
+
+}	// dumpStats ()
+
+
 //! Some F request packets want to know the length of the string
 //! argument, so we have this simple function here to calculate that.
 
+template <class TARGET>
 int
-GdbServerImpl::stringLength (uint32_t addr)
+GdbServerImpl<TARGET>::stringLength (uint32_t addr)
 {
   uint8_t ch;
   int count = 0;
-  while (1 == cpu->read (addr + count, &ch, 1))
+  while (1 == mMemCache->read (addr + count, &ch, 1))
   {
     count++;
     if (ch == 0)
@@ -172,9 +272,16 @@ GdbServerImpl::stringLength (uint32_t addr)
 //! the GDB client. The arguments for the call will have already been
 //! put into registers via its newlib/libgloss implementation.
 
+template <class TARGET>
 void
-GdbServerImpl::rspSyscallRequest (SyscallContinuationType cType)
+GdbServerImpl<TARGET>::rspSyscallRequest (SyscallContinuationType cType)
 {
+  if (mNonStop)
+    {
+      rspNonStopSyscall (cType);
+      return;
+    }
+
   // Keep track of whether we were in the middle of a Continue or Step
   if (mSyscallContinuation != SYSCALL_NONE_PENDING)
     cerr << "Warning: There's already a syscall pending, first one lost?"
@@ -183,11 +290,11 @@ GdbServerImpl::rspSyscallRequest (SyscallContinuationType cType)
 
   // Get the args from the appropriate regs and send an F packet
   uint_reg_t a0, a1, a2, a3, a7;
-  cpu->readRegister (10, a0);
-  cpu->readRegister (11, a1);
-  cpu->readRegister (12, a2);
-  cpu->readRegister (13, a3);
-  cpu->readRegister (17, a7);
+  readRegister (10, a0);
+  readRegister (11, a1);
+  readRegister (12, a2);
+  readRegister (13, a3);
+  readRegister (17, a7);
 
   // Work out which syscall we've got
   switch (a7) {
@@ -232,13 +339,54 @@ GdbServerImpl::rspSyscallRequest (SyscallContinuationType cType)
 }
 
 
+//! Deal with a syscall in non-stop mode
+
+//! A stop notification can't be an F request, so we service the syscall
+//! ourselves (@see BatchRunner::doSyscall ()).  The runner does so without
+//! stopping for a continue, so we only see a syscall here after a step, or
+//! when the program exits or makes a syscall we don't know.  An exit is
+//! notified as such, otherwise, as for a step finished by GDB, we report a
+//! trap.
+
+//! @param[in] cType  What we were doing when the syscall happened
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::rspNonStopSyscall (SyscallContinuationType cType)
+{
+  uint_reg_t  a0, a7;
+  int  exitCode;
+
+  readRegister (17, a7);
+
+  if (93 == a7)
+    {
+      readRegister (10, a0);
+      sprintf (pkt->data, "W%" PRIxREG, a0);
+      pkt->setLen (strlen (pkt->data));
+      rspSendStop ();
+      return;
+    }
+
+  if (SYSCALL_THEN_FINISH_STEPPING == cType)
+    {
+      (void) mSyscalls->doSyscall (exitCode);
+      invalidateCaches ();
+    }
+
+  rspReportException (TargetSignal::TRAP);
+
+}	// rspNonStopSyscall ()
+
+
 //! The F reply is sent by the GDB client to us after a syscall has been
 //! handled.  Return true if the syscall reply has been handled and we
 //! should resume execution, return false if the target has been
 //! interrupted.
 
+template <class TARGET>
 void
-GdbServerImpl::rspSyscallReply ()
+GdbServerImpl<TARGET>::rspSyscallReply ()
 {
   SyscallReplyPacket p;
 
@@ -260,7 +408,7 @@ GdbServerImpl::rspSyscallReply ()
       //        within a single GDB session which causes GCC regression
       //        tests to fail, so we sidestep it here with a HACK.
       if (retcode != -1)
-        cpu->writeRegister (10, retcode);
+        writeRegister (10, retcode);
 
       if (p.hasCtrlC ())
         {
@@ -295,28 +443,81 @@ GdbServerImpl::rspSyscallReply ()
 
 // Implement a continue.
 
+//! While the target runs, the break watcher looks out for a break from the
+//! client, so the target will stop for one without our checking.
+
+//! In non-stop mode, we just say OK and leave the target running on a
+//! thread of its own (@see rspNonStopService ()).  Every hart runs, so if
+//! the target is already running, there is nothing more to do.
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::rspContinue ()
+{
+  if (mNonStop)
+    {
+      pkt->packStr ("OK");
+      rsp->putPkt (pkt);
+
+      if (!mRunner.joinable ())
+	startRunner ();
+
+      return;
+    }
+
+  (void) mBreakWatcher->arm (rsp->watchFd ());
+  runContinue ();
+  mBreakWatcher->disarm ();
+
+}	// rspContinue ()
+
+
+//! Run the target for a continue
+
+//! We have two timeouts to worry about.  The first is any timeout set by
+//! the user (through "monitor timeout"), the second is a timeout for
+//! checking for ctrl-C.  If the break watcher is armed, it will stop the
+//! target for a ctrl-C, so with no user timeout there is no need to stop,
+//! and we run with no budget at all.  Unless, that is, we are tracing the
+//! speed of the model, which we can only do between slices.
+
+template <class TARGET>
 void
-GdbServerImpl::rspContinue ()
+GdbServerImpl<TARGET>::runContinue ()
 {
-  // We have two timeouts to worry about.  The first is any timeout set by
-  // the user (through "monitor timeout", the second is a timeout for
-  // checking for crtl-C.
   time_point <system_clock, duration <double> >  timeout_end =
     system_clock::now () + mTimeout;
 
   // Check for break before resuming the machine.
   if (rsp->haveBreak ())
     {
-      (void) cpu->resume (ITarget::ResumeType::STOP);
+      (void) resumeTarget (ITarget::ResumeType::STOP);
       rspReportException (TargetSignal::INT);
       return;
     }
 
+  traceSpeed (true);
+
   for (;;)
     {
+      // Run a slice, and if it used its whole budget, use how long it took
+      // to size the next one.
+      uint64_t  budget = mSliceBudget;
+
+      if ((duration <double>::zero () == mTimeout) && mBreakWatcher->armed ()
+	  && !traceFlags->traceSpeed ())
+        budget = 0;
+
+      time_point <system_clock, duration <double> >  slice_start =
+        system_clock::now ();
       ITarget::ResumeRes resType =
-        cpu->resume (ITarget::ResumeType::CONTINUE,
-                     interruptTimeout);
+        resumeTarget (ITarget::ResumeType::CONTINUE, budget);
+
+      if ((ITarget::ResumeRes::TIMEOUT == resType)
+          && !mBreakWatcher->fired ())
+        adaptSlice (system_clock::now () - slice_start);
+
+      traceSpeed (false);
 
       switch (resType)
         {
@@ -332,7 +533,13 @@ GdbServerImpl::rspContinue ()
         case ITarget::ResumeRes::INTERRUPTED:
 
           // At breakpoint
-          rspReportException (TargetSignal::TRAP);
+          rspReportException (TargetSignal::TRAP,
+                              ITarget::ResumeRes::INTERRUPTED == resType);
+          return;
+
+        case ITarget::ResumeRes::WATCHPOINT:
+
+          rspReportWatchpoint ();
           return;
 
         case ITarget::ResumeRes::TIMEOUT:
@@ -343,7 +550,7 @@ GdbServerImpl::rspContinue ()
             {
               // Force the target to stop. Ignore return value.
 
-              (void) cpu->resume (ITarget::ResumeType::STOP);
+              (void) resumeTarget (ITarget::ResumeType::STOP);
               rspReportException (TargetSignal::XCPU);	// Timeout
               return;
             }
@@ -352,11 +559,16 @@ GdbServerImpl::rspContinue ()
           if (rsp->haveBreak ())
             {
               // Force the target to stop. Ignore return value.
-              (void) cpu->resume (ITarget::ResumeType::STOP);
+              (void) resumeTarget (ITarget::ResumeType::STOP);
               rspReportException (TargetSignal::INT);	// Interrupt
               return;
             }
 
+          // If the watcher fired for something other than a break, stop
+          // watching and fall back to checking between slices.
+          if (mBreakWatcher->fired ())
+            mBreakWatcher->disarm ();
+
           break;
 
         default:
@@ -367,22 +579,301 @@ GdbServerImpl::rspContinue ()
           exit (EXIT_FAILURE);
         }
     }
-}
+}	// runContinue ()
+
+
+//! Deal with the client while the target runs in non-stop mode
+
+//! If the runner has stopped the target, we notify the client.  Otherwise
+//! we wait a while for a packet, and deal with it with the target held
+//! between slices, so memory, registers and monitor commands all work
+//! while it runs.  What we see is the state of the target at the end of
+//! the last slice.
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::rspNonStopService ()
+{
+  if (!mRunning.load ())
+    {
+      mRunner.join ();
+      rspNotifyStop ();
+      return;
+    }
+
+  if (!rsp->pollInput (NON_STOP_POLL_MS))
+    return;
+
+  mTargetWaiters++;
+  std::unique_lock<std::mutex>  lock (mTargetMutex);
+  mTargetWaiters--;
+
+  invalidateCaches ();
+  rspClientRequest ();
+  lock.unlock ();
+
+  // If the client has gone, or we are to exit, the target must stop.
+  if (!rsp->isConnected () || mExitServer)
+    stopRunner ();
+
+}	// rspNonStopService ()
+
+
+//! Reply to a '?' packet in non-stop mode
+
+//! If the target is running, there is no stop to report, so we just say
+//! OK.  Otherwise we report the current hart's stop, and any other harts
+//! follow in reply to vStopped.
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::rspNonStopStatus ()
+{
+  if (mRunner.joinable ())
+    {
+      pkt->packStr ("OK");
+      rsp->putPkt (pkt);
+      return;
+    }
+
+  rspBuildStop (TargetSignal::TRAP, false);
+  queueOtherStops ();
+  rsp->putPkt (pkt);
+
+}	// rspNonStopStatus ()
+
+
+//! Notify the client the runner has stopped the target
+
+//! Every hart stopped, so the stops of the other harts follow in reply to
+//! vStopped.
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::rspNotifyStop ()
+{
+  queueOtherStops ();
+
+  switch (mStopRes)
+    {
+    case ITarget::ResumeRes::SYSCALL:
+      rspSyscallRequest (SYSCALL_THEN_FINISH_CONTINUE);
+      break;
+
+    case ITarget::ResumeRes::STEPPED:
+    case ITarget::ResumeRes::INTERRUPTED:
+      rspReportException (TargetSignal::TRAP,
+			  ITarget::ResumeRes::INTERRUPTED == mStopRes);
+      break;
+
+    case ITarget::ResumeRes::WATCHPOINT:
+      rspReportWatchpoint ();
+      break;
+
+    default:
+      rspReportException (mStopSig);
+      break;
+    }
+}	// rspNotifyStop ()
+
+
+//! Handle a RSP vStopped packet
+
+//! Report the stop of the next hart still queued, or just say OK if there
+//! are none.  A hart which did not stop for a reason of its own stopped
+//! with no signal.
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::rspStopped ()
+{
+  if (mStopQueue.empty () || (nullptr == mHarts))
+    {
+      pkt->packStr ("OK");
+      rsp->putPkt (pkt);
+      return;
+    }
+
+  int  hart    = mStopQueue.front ();
+  int  current = mHarts->currentHart ();
+
+  mStopQueue.pop_front ();
+  (void) mHarts->selectHart (hart);
+  invalidateCaches ();
+  rspBuildStop (TargetSignal::NONE, false);
+  (void) mHarts->selectHart (current);
+  invalidateCaches ();
+  rsp->putPkt (pkt);
+
+}	// rspStopped ()
+
+
+//! Queue the stops of every hart but the current one, for vStopped
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::queueOtherStops ()
+{
+  mStopQueue.clear ();
+
+  if (nullptr == mHarts)
+    return;
+
+  for (int  h = 0; h < mHarts->numHarts (); h++)
+    if (h != mHarts->currentHart ())
+      mStopQueue.push_back (h);
+
+}	// queueOtherStops ()
+
+
+//! Acknowledge a step in non-stop mode
+
+//! In non-stop mode a step is acknowledged at once, and its stop notified
+//! when it is done.  We can't step while the target is running.
+
+//! @return  TRUE if the step should go ahead, FALSE otherwise.
+
+template <class TARGET>
+bool
+GdbServerImpl<TARGET>::nonStopStep ()
+{
+  if (!mNonStop)
+    return  true;
+
+  bool  running = mRunner.joinable ();
+
+  pkt->packStr (running ? "E01" : "OK");
+  rsp->putPkt (pkt);
+  mStopQueue.clear ();
+  return  !running;
+
+}	// nonStopStep ()
+
+
+//! Start the runner thread for a continue in non-stop mode
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::startRunner ()
+{
+  time_point <system_clock, duration <double> >  deadline =
+    time_point <system_clock, duration <double> >::max ();
+
+  if (duration <double>::zero () != mTimeout)
+    deadline = system_clock::now () + mTimeout;
+
+  mStopQueue.clear ();
+  mStopRequested.store (false);
+  mRunning.store (true);
+  mRunner = std::thread (&GdbServerImpl::runNonStop, this, deadline);
+
+}	// startRunner ()
+
+
+//! Stop the target if the runner is running it, and wait for the runner
+
+//! Any stop is not reported.  We must not hold the target when we call
+//! this, or the runner could never finish.
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::stopRunner ()
+{
+  if (!mRunner.joinable ())
+    return;
+
+  mStopRequested.store (true);
+  mRunner.join ();
+
+}	// stopRunner ()
+
+
+//! Run the target for a continue in non-stop mode
+
+//! This is the runner thread.  The target runs in slices, as for an
+//! ordinary continue, holding the target for each slice and giving way
+//! between slices to any thread waiting for it.  Syscalls are serviced as
+//! we go.  We stop when the target stops for a reason of its own, or when
+//! asked (with no signal) or on the
+//! user's timeout (with XCPU).
+
+//! @param[in] deadline  When the user's timeout expires
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::runNonStop (time_point <system_clock,
+						   duration <double> >  deadline)
+{
+  ITarget::ResumeRes  resType;
+
+  // The model may ask for the time from this thread (@see sc_time_stamp ()),
+  // so it must be able to find itself.  With several harts, each is run on
+  // a worker which knows its own.
+  HartGroup::workerHart (static_cast<ITarget *> (cpu));
+
+  mStopSig = TargetSignal::TRAP;
+  traceSpeed (true);
+
+  for (;;)
+    {
+      // Give way to anyone waiting for the target.
+      while (0 != mTargetWaiters.load ())
+	std::this_thread::yield ();
+
+      std::lock_guard<std::mutex>  lock (mTargetMutex);
+      time_point <system_clock, duration <double> >  slice_start =
+	system_clock::now ();
+
+      resType = resumeTarget (ITarget::ResumeType::CONTINUE, mSliceBudget);
+
+      // Service a syscall and carry on, unless the program has exited or
+      // we don't know the syscall.  Only a full slice sizes the next one.
+      int  exitCode;
+
+      if (ITarget::ResumeRes::TIMEOUT == resType)
+	{
+	  adaptSlice (system_clock::now () - slice_start);
+	  traceSpeed (false);
+	}
+      else if ((ITarget::ResumeRes::SYSCALL != resType)
+	       || !mSyscalls->doSyscall (exitCode))
+	break;
+
+      if (mStopRequested.load ())
+	mStopSig = TargetSignal::NONE;
+      else if (deadline < system_clock::now ())
+	mStopSig = TargetSignal::XCPU;		// Timeout
+      else
+	continue;
+
+      // Force the target to stop. Ignore return value.
+      (void) resumeTarget (ITarget::ResumeType::STOP);
+      break;
+    }
+
+  mStopRes = resType;
+  mRunning.store (false);
+
+}	// runNonStop ()
 
 //! Single step one machine instruction.
 
+template <class TARGET>
 void
-GdbServerImpl::rspSingleStep ()
+GdbServerImpl<TARGET>::rspSingleStep ()
 {
+  if (!nonStopStep ())
+    return;
+
   // Check for break before resuming the machine.
   if (rsp->haveBreak ())
     {
-      (void) cpu->resume (ITarget::ResumeType::STOP);
+      (void) resumeTarget (ITarget::ResumeType::STOP);
       rspReportException (TargetSignal::INT);
       return;
     }
 
-  ITarget::ResumeRes resType = cpu->resume (ITarget::ResumeType::STEP);
+  ITarget::ResumeRes resType = resumeTarget (ITarget::ResumeType::STEP);
 
   if (resType == ITarget::ResumeRes::SYSCALL)
     {
@@ -390,18 +881,109 @@ GdbServerImpl::rspSingleStep ()
       return;
     }
 
+  if (resType == ITarget::ResumeRes::WATCHPOINT)
+    {
+      rspReportWatchpoint ();
+      return;
+    }
+
   // Check for break now we've stopped.
   if (rsp->haveBreak ())
     {
-      (void) cpu->resume (ITarget::ResumeType::STOP);
+      (void) resumeTarget (ITarget::ResumeType::STOP);
       rspReportException (TargetSignal::INT);
       return;
     }
 
-  rspReportException (TargetSignal::TRAP);
+  rspReportException (TargetSignal::TRAP,
+		      ITarget::ResumeRes::INTERRUPTED == resType);
   return;
 }
 
+//! Step while the PC is within a range
+
+//! This is a vCont range step, saving a round trip to GDB for each
+//! instruction.  We stop as soon as the PC leaves [start, end), or reaches a
+//! breakpoint, or the step itself did anything other than complete normally.
+//! Every RUN_SAMPLE_PERIOD steps we check for a break from the client and for
+//! the user's timeout, as for continue.
+
+//! @param[in] start  Start of the range
+//! @param[in] end    End of the range (exclusive)
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::rspRangeStep (uint32_t  start,
+				     uint32_t  end)
+{
+  if (!nonStopStep ())
+    return;
+
+  time_point <system_clock, duration <double> >  timeout_end =
+    system_clock::now () + mTimeout;
+
+  // Check for break before resuming the machine.
+  if (rsp->haveBreak ())
+    {
+      (void) resumeTarget (ITarget::ResumeType::STOP);
+      rspReportException (TargetSignal::INT);
+      return;
+    }
+
+  for (int  count = 1; ; count++)
+    {
+      ITarget::ResumeRes resType = resumeTarget (ITarget::ResumeType::STEP);
+
+      switch (resType)
+	{
+	case ITarget::ResumeRes::SYSCALL:
+	  rspSyscallRequest (SYSCALL_THEN_FINISH_STEPPING);
+	  return;
+
+	case ITarget::ResumeRes::WATCHPOINT:
+	  rspReportWatchpoint ();
+	  return;
+
+	case ITarget::ResumeRes::STEPPED:
+	  break;
+
+	default:
+	  rspReportException (TargetSignal::TRAP,
+			      ITarget::ResumeRes::INTERRUPTED == resType);
+	  return;
+	}
+
+      uint_reg_t  pc;
+
+      readRegister (RISCV_PC_REGNUM, pc);
+
+      if ((pc < start) || (pc >= end)
+	  || (NULL != mpHash->lookup (BP_MEMORY, pc))
+	  || (NULL != mpHash->lookup (BP_HARDWARE, pc)))
+	{
+	  rspReportException (TargetSignal::TRAP);
+	  return;
+	}
+
+      if (0 == (count % RUN_SAMPLE_PERIOD))
+	{
+	  if ((duration <double>::zero () != mTimeout)
+	      && (timeout_end < system_clock::now ()))
+	    {
+	      rspReportException (TargetSignal::XCPU);	// Timeout
+	      return;
+	    }
+
+	  if (rsp->haveBreak ())
+	    {
+	      rspReportException (TargetSignal::INT);	// Interrupt
+	      return;
+	    }
+	}
+    }
+}	// rspRangeStep ()
+
+
 //! Deal with a request from the GDB client session
 
 //! In general, apart from the simplest requests, this function replies on
@@ -413,8 +995,9 @@ GdbServerImpl::rspSingleStep ()
 
 //! @param[in] pkt  The received RSP packet
 
+template <class TARGET>
 void
-GdbServerImpl::rspClientRequest ()
+GdbServerImpl<TARGET>::rspClientRequest ()
 {
   if (!rsp->getPkt (pkt))
     {
@@ -422,6 +1005,9 @@ GdbServerImpl::rspClientRequest ()
       return;
     }
 
+  // Time handling the packet, however we leave
+  ServerStats::Timer  timer (mStats->packet (pkt->data[0]));
+
   switch (pkt->data[0])
     {
     case '!':
@@ -432,7 +1018,10 @@ GdbServerImpl::rspClientRequest ()
 
     case '?':
       // Return last signal ID
-      rspReportException ();
+      if (mNonStop)
+	rspNonStopStatus ();
+      else
+	rspReportException ();
       return;
 
     case 'A':
@@ -489,10 +1078,8 @@ GdbServerImpl::rspClientRequest ()
       return;
 
     case 'H':
-      // Set the thread number of subsequent operations. For now ignore
-      // silently and just reply "OK"
-      pkt->packStr ("OK");
-      rsp->putPkt (pkt);
+      // Set the thread number of subsequent operations.
+      rspSetThread ();
       return;
 
     case 'i':
@@ -575,10 +1162,8 @@ GdbServerImpl::rspClientRequest ()
       return;
 
     case 'T':
-      // Is the thread alive. We are bare metal, so don't have a thread
-      // context. The answer is always "OK".
-      pkt->packStr ("OK");
-      rsp->putPkt (pkt);
+      // Is the thread alive.
+      rspThreadAlive ();
       return;
 
     case 'v':
@@ -586,6 +1171,11 @@ GdbServerImpl::rspClientRequest ()
       rspVpkt ();
       return;
 
+    case 'x':
+      // Read memory (binary)
+      rspReadMemBin ();
+      return;
+
     case 'X':
       // Write memory (binary)
       rspWriteMemBin ();
@@ -611,34 +1201,193 @@ GdbServerImpl::rspClientRequest ()
 
 //! Send a packet acknowledging an exception has occurred
 
-//! @param[in] sig  The signal to send (defaults to TargetSignal::TRAP).
+//! @see rspBuildStop () for the packet, and rspSendStop () for how it is
+//! sent.
+
+//! @param[in] sig      The signal to send (defaults to TargetSignal::TRAP).
+//! @param[in] atBreak  TRUE if we stopped because of a breakpoint (defaults
+//!                     to FALSE).
 
+template <class TARGET>
 void
-GdbServerImpl::rspReportException (TargetSignal  sig)
+GdbServerImpl<TARGET>::rspReportException (TargetSignal  sig,
+					   bool  atBreak)
 {
-  // Construct a signal received packet
-  pkt->data[0] = 'S';
-  pkt->data[1] = Utils::hex2Char (static_cast<int> (sig) >> 4);
-  pkt->data[2] = Utils::hex2Char (static_cast<int> (sig) % 16);
-  pkt->data[3] = '\0';
-  pkt->setLen (strlen (pkt->data));
-
-  rsp->putPkt (pkt);
+  rspBuildStop (sig, atBreak);
+  rspSendStop ();
 
 }	// rspReportException ()
 
 
-//! Handle a RSP read all registers request
+//! Build a stop reply packet
+
+//! This is a T packet, expediting the registers GDB always wants after a
+//! stop, so it need not ask for them.  If we stopped at one of our
+//! breakpoints and the client understands it, we also say whether it was a
+//! software or hardware breakpoint.
+
+//! @param[in] sig      The signal to send.
+//! @param[in] atBreak  TRUE if we stopped because of a breakpoint.
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::rspBuildStop (TargetSignal  sig,
+				     bool  atBreak)
+{
+  char *p = pkt->data;
+
+  p += sprintf (p, "T%02x", static_cast<int> (sig));
+  p  = rspStopThread (p);
+
+  if (atBreak)
+    {
+      uint_reg_t  pc;
+
+      readRegister (RISCV_PC_REGNUM, pc);
+
+      if (mClientHwbreak && (NULL != mpHash->lookup (BP_HARDWARE, pc)))
+	p += sprintf (p, "hwbreak:;");
+      else if (mClientSwbreak && (NULL != mpHash->lookup (BP_MEMORY, pc)))
+	p += sprintf (p, "swbreak:;");
+    }
+
+  rspExpediteRegs (p);
+  pkt->setLen (strlen (pkt->data));
+
+}	// rspBuildStop ()
+
+
+//! Send a stop reply packet
+
+//! In non-stop mode the stop is not a reply, but a Stop notification.
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::rspSendStop ()
+{
+  if (!mNonStop)
+    {
+      rsp->putPkt (pkt);
+      return;
+    }
+
+  static const char  prefix[] = "Stop:";
+  int  len       = pkt->getLen ();
+  int  prefixLen = strlen (prefix);
+
+  memmove (pkt->data + prefixLen, pkt->data, len + 1);
+  memcpy (pkt->data, prefix, prefixLen);
+  pkt->setLen (len + prefixLen);
+  rsp->putNotification (pkt);
+
+}	// rspSendStop ()
+
+
+//! Add the expedited registers to a T packet
+
+//! These are the PC, SP, FP and RA, each as <regnum>:<value>;
+
+//! @param[in] buf  Where to write the registers
+//! @return  The end of what was written, which is null terminated.
+
+template <class TARGET>
+char *
+GdbServerImpl<TARGET>::rspExpediteRegs (char *buf)
+{
+  static const int  regs[] = { RISCV_PC_REGNUM, RISCV_SP_REGNUM,
+			       RISCV_FP_REGNUM, RISCV_RA_REGNUM };
+
+  for (int  regNum : regs)
+    {
+      uint_reg_t  val;
+      int  byteSize = readRegister (regNum, val);
+
+      buf += sprintf (buf, "%02x:", regNum);
+      Utils::val2Hex (val, buf, byteSize, true /* Little Endian */);
+      buf += byteSize * 2;
+      *buf++ = ';';
+    }
+
+  *buf = '\0';
+  return  buf;
+
+}	// rspExpediteRegs ()
+
+
+//! Add the stopped thread to a T packet
+
+//! Only when we have several harts, in which case the hart which stopped is
+//! now the current hart.
+
+//! @param[in] buf  Where to write the thread
+//! @return  The end of what was written, which is null terminated.
+
+template <class TARGET>
+char *
+GdbServerImpl<TARGET>::rspStopThread (char *buf)
+{
+  if (nullptr != mHarts)
+    buf += sprintf (buf, "thread:%x;", currentTid ());
+
+  *buf = '\0';
+  return  buf;
+
+}	// rspStopThread ()
+
+
+//! Send a stop packet for a watchpoint
+
+//! The target tells us which watched byte was accessed, which GDB matches
+//! against its watched regions.  If the target can't tell us, we just
+//! report a trap.
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::rspReportWatchpoint ()
+{
+  uint32_t  addr;
+  ITarget::MatchType  matchType;
+
+  if (!cpu->lastWatchpoint (addr, matchType))
+    {
+      rspReportException (TargetSignal::TRAP);
+      return;
+    }
+
+  const char *kind;
+
+  switch (matchType)
+    {
+    case ITarget::MatchType::WATCH_READ:   kind = "rwatch"; break;
+    case ITarget::MatchType::WATCH_ACCESS: kind = "awatch"; break;
+    default:                               kind = "watch";  break;
+    }
+
+  char *p = pkt->data;
+
+  p += sprintf (p, "T%02x%s:%" PRIx32 ";",
+		static_cast<int> (TargetSignal::TRAP), kind, addr);
+  p  = rspStopThread (p);
+  rspExpediteRegs (p);
+  pkt->setLen (strlen (pkt->data));
+  rspSendStop ();
+
+}	// rspReportWatchpoint ()
+
+
+//! Handle a RSP read all registers request
 
 //! This means getting the value of each simulated register and packing it
 //! into the packet.
 
-//! Each byte is packed as a pair of hex digits.
+//! Each byte is packed as a pair of hex digits.  We lay out all the register
+//! bytes first, then convert them in one go.
 
+template <class TARGET>
 void
-GdbServerImpl::rspReadAllRegs ()
+GdbServerImpl<TARGET>::rspReadAllRegs ()
 {
-  int  pktSize = 0;
+  int  nBytes = 0;
 
   // The registers. GDB client expects them to be packed according to target
   // endianness.
@@ -647,15 +1396,15 @@ GdbServerImpl::rspReadAllRegs ()
       uint_reg_t val;		// Enough for even the PC
       int       byteSize;	// Size of reg in bytes
 
-      byteSize = cpu->readRegister (regNum, val);
-      Utils::val2Hex (val, &(pkt->data[pktSize]), byteSize,
-		      true /* Little Endian */);
-      pktSize += byteSize * 2;	// 2 chars per hex digit
+      byteSize = readRegister (regNum, val);
+
+      for (int  i = 0; i < byteSize; i++)
+	mMemBuf[nBytes++] = static_cast<uint8_t> (val >> (i * 8));
     }
 
   // Finalize the packet and send it
-  pkt->data[pktSize] = 0;
-  pkt->setLen (pktSize);
+  Utils::bin2Hex (pkt->data, mMemBuf, nBytes);
+  pkt->setLen (nBytes * 2);
   rsp->putPkt (pkt);
 
 }	// rspReadAllRegs ()
@@ -663,23 +1412,36 @@ GdbServerImpl::rspReadAllRegs ()
 
 //! Handle a RSP write all registers request
 
-//! Each value is written into the simulated register.
+//! Each value is written into the simulated register.  We convert all the
+//! hex digits in one go, then pick out each register little endian.
 
+template <class TARGET>
 void
-GdbServerImpl::rspWriteAllRegs ()
+GdbServerImpl<TARGET>::rspWriteAllRegs ()
 {
-  int  pktSize = 0;
+  std::size_t  byteSize = sizeof (uint_reg_t);
+  std::size_t  nBytes   = byteSize * RISCV_NUM_REGS;
+
+  if ((static_cast<std::size_t> (pkt->getLen ()) < (nBytes * 2 + 1))
+      || !Utils::hex2Bin (mMemBuf, &(pkt->data[1]), nBytes))
+    {
+      cerr << "Warning: Failed to recognize RSP write all registers command: "
+	   << pkt->data << endl;
+      pkt->packStr ("E01");
+      rsp->putPkt (pkt);
+      return;
+    }
 
   // The registers
   for (int  regNum = 0; regNum < RISCV_NUM_REGS; regNum++)
     {
-      std::size_t byteSize = sizeof (uint_reg_t);
+      uint_reg_t  val = 0;
 
-      uint32_t val = Utils::hex2Val (&(pkt->data[pktSize]), byteSize,
-				     true /* little endian */);
-      pktSize += byteSize * 2;	// 2 chars per hex digit
+      for (std::size_t  i = 0; i < byteSize; i++)
+	val |= static_cast<uint_reg_t> (mMemBuf[regNum * byteSize + i])
+	  << (i * 8);
 
-      if (byteSize != cpu->writeRegister (regNum, val))
+      if (byteSize != writeRegister (regNum, val))
 	cerr << "Warning: Size != " << byteSize << " when writing reg "
 	     << regNum << "." << endl;
     }
@@ -700,12 +1462,13 @@ GdbServerImpl::rspWriteAllRegs ()
 
 //! The length given is the number of bytes to be read.
 
+template <class TARGET>
 void
-GdbServerImpl::rspReadMem ()
+GdbServerImpl<TARGET>::rspReadMem ()
 {
   uint32_t  addr;			// Where to read the memory
-  int       len;			// Number of bytes to read
-  int       off;			// Offset into the memory
+  uint32_t  len;			// Number of bytes to read
+  std::size_t  off;			// Number of bytes actually read
 
   if (2 != sscanf (pkt->data, "m%x,%x:", &addr, &len))
     {
@@ -716,34 +1479,108 @@ GdbServerImpl::rspReadMem ()
       return;
     }
 
-  // Make sure we won't overflow the buffer (2 chars per byte)
-  if ((len * 2) >= pkt->getBufSize())
+  // Make sure we won't overflow the buffer (2 chars per byte).  The length
+  // is unsigned, so a huge one can't pass for a small one.
+  if (len > static_cast<uint32_t> ((pkt->getBufSize() - 1) / 2))
     {
       cerr << "Warning: Memory read " << pkt->data
 	   << " too large for RSP packet: truncated" << endl;
       len = (pkt->getBufSize() - 1) / 2;
     }
 
-  // Refill the buffer with the reply
-  for (off = 0; off < len; off++)
+  // Read all the memory in one go, then refill the buffer with the
+  // reply. If we could only read some of the memory, just reply with what we
+  // have.
+  off = mMemCache->read (addr, mMemBuf, len);
+
+  if (0 == off)
     {
-      uint8_t  ch;
-      if (1 == cpu->read (addr + off, &ch, 1))
-	{
-	  pkt->data[off * 2]     = Utils::hex2Char(ch >>   4);
-	  pkt->data[off * 2 + 1] = Utils::hex2Char(ch &  0xf);
-	}
-      else
-	cerr << "Warning: failed to read char" << endl;
+      cerr << "Warning: failed to read memory at 0x" << hex << addr << dec
+	   << endl;
+      pkt->packStr ("E01");
+      rsp->putPkt (pkt);
+      return;
     }
+  else if (off < len)
+    cerr << "Warning: only " << off << " of " << len
+	 << " bytes read at 0x" << hex << addr << dec << endl;
 
-  pkt->data[off * 2] = '\0';			// End of string
-  pkt->setLen (strlen (pkt->data));
+  Utils::bin2Hex (pkt->data, mMemBuf, off);
+  pkt->setLen (off * 2);
   rsp->putPkt (pkt);
 
 }	// rsp_read_mem ()
 
 
+//! Handle a RSP read memory (binary) request
+
+//! Syntax is:
+//!   x<addr>,<length>
+
+//! The response is 'b' followed by the bytes, lowest address first, as raw
+//! binary.  This is half the size of the reply to 'm', and needs no
+//! conversion, since escaping is done when the packet is framed.
+
+//! A length of zero is just a probe to see if we support the packet, to
+//! which the reply is a bare 'b'.
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::rspReadMemBin ()
+{
+  uint32_t  addr;			// Where to read the memory
+  uint32_t  len;			// Number of bytes to read
+  std::size_t  off;			// Number of bytes actually read
+
+  if (2 != sscanf (pkt->data, "x%x,%x", &addr, &len))
+    {
+      cerr << "Warning: Failed to recognize RSP read memory (binary) "
+	   << "command: " << pkt->data << endl;
+      pkt->packStr ("E01");
+      rsp->putPkt (pkt);
+      return;
+    }
+
+  // Make sure we won't overflow the buffer (the 'b' and the EOS).  As for
+  // 'm', the length is unsigned.
+  if (len > static_cast<uint32_t> (pkt->getBufSize() - 2))
+    {
+      cerr << "Warning: Memory read " << pkt->data
+	   << " too large for RSP packet: truncated" << endl;
+      len = pkt->getBufSize() - 2;
+    }
+
+  if (0 == len)
+    {
+      pkt->packStr ("b");
+      rsp->putPkt (pkt);
+      return;
+    }
+
+  // As for 'm', reply with as much as we could read.
+  off = mMemCache->read (addr, mMemBuf, len);
+
+  if (0 == off)
+    {
+      cerr << "Warning: failed to read memory at 0x" << hex << addr << dec
+	   << endl;
+      pkt->packStr ("E01");
+      rsp->putPkt (pkt);
+      return;
+    }
+  else if (off < len)
+    cerr << "Warning: only " << off << " of " << len
+	 << " bytes read at 0x" << hex << addr << dec << endl;
+
+  pkt->data[0] = 'b';
+  memcpy (&(pkt->data[1]), mMemBuf, off);
+  pkt->data[off + 1] = '\0';
+  pkt->setLen (off + 1);
+  rsp->putPkt (pkt);
+
+}	// rspReadMemBin ()
+
+
 //! Handle a RSP write memory (symbolic) request
 
 //! Syntax is:
@@ -755,11 +1592,12 @@ GdbServerImpl::rspReadMem ()
 
 //! The length given is the number of bytes to be written.
 
+template <class TARGET>
 void
-GdbServerImpl::rspWriteMem ()
+GdbServerImpl<TARGET>::rspWriteMem ()
 {
   uint32_t  addr;			// Where to write the memory
-  int       len;			// Number of bytes to write
+  uint32_t  len;			// Number of bytes to write
 
   if (2 != sscanf (pkt->data, "M%x,%x:", &addr, &len))
     {
@@ -770,31 +1608,51 @@ GdbServerImpl::rspWriteMem ()
       return;
     }
 
+  // The data must fit in the packet (2 chars per byte).  The length is
+  // unsigned, so a huge one can't pass for a small one.
+  if (len > static_cast<uint32_t> ((pkt->getBufSize() - 1) / 2))
+    {
+      cerr << "Warning: Memory write " << pkt->data
+	   << " too large for RSP packet: packet ignored" << endl;
+      pkt->packStr ("E01");
+      rsp->putPkt (pkt);
+      return;
+    }
+
   // Find the start of the data and check there is the amount we expect.
-  char *symDat = (char *)(memchr (pkt->data, ':', pkt->getBufSize())) + 1;
-  int   datLen = pkt->getLen() - (symDat - pkt->data);
+  char *colon = (char *)(memchr (pkt->data, ':', pkt->getLen ()));
 
-  // Sanity check
-  if (len * 2 != datLen)
+  if (nullptr == colon)
     {
-      cerr << "Warning: Write of " << len * 2 << "digits requested, but "
-		<< datLen << " digits supplied: packet ignored" << endl;
+      cerr << "Warning: No data in RSP write memory " << pkt->data << endl;
       pkt->packStr ("E01");
       rsp->putPkt (pkt);
       return;
     }
 
-  // Write the bytes to memory (no check the address is OK here)
-  for (int  off = 0; off < len; off++)
-    {
-      uint8_t  nyb1 = Utils::char2Hex (symDat[off * 2]);
-      uint8_t  nyb2 = Utils::char2Hex (symDat[off * 2 + 1]);
-      uint8_t  val = static_cast<unsigned int> ((nyb1 << 4) | nyb2);
+  char *symDat = colon + 1;
+  std::size_t  datLen = pkt->getLen() - (symDat - pkt->data);
 
-      if (1 != cpu->write (addr + off, &val, 1))
-	cerr << "Warning: Failed to write character" << endl;
+  // Sanity check.  Compare in bytes, so nothing can overflow.
+  if ((0 != datLen % 2) || (static_cast<std::size_t> (len) != datLen / 2))
+    {
+      cerr << "Warning: Write of " << len << " bytes requested, but "
+		<< datLen << " digits supplied: packet ignored" << endl;
+      pkt->packStr ("E01");
+      rsp->putPkt (pkt);
+      return;
     }
 
+  // Decode the data, then write all the bytes to memory in one go (no check
+  // the address is OK here)
+  if (!Utils::hex2Bin (mMemBuf, symDat, len))
+    cerr << "Warning: Invalid hex digit in RSP write memory: "
+	 << pkt->data << endl;
+
+  if (len != mMemCache->write (addr, mMemBuf, len))
+    cerr << "Warning: Failed to write " << len << " bytes to 0x" << hex
+	 << addr << dec << endl;
+
   pkt->packStr ("OK");
   rsp->putPkt (pkt);
 
@@ -808,8 +1666,9 @@ GdbServerImpl::rspWriteMem ()
 
 //! Each byte is packed as a pair of hex digits.
 
+template <class TARGET>
 void
-GdbServerImpl::rspReadReg ()
+GdbServerImpl<TARGET>::rspReadReg ()
 {
   unsigned int  regNum;
 
@@ -828,7 +1687,7 @@ GdbServerImpl::rspReadReg ()
   uint_reg_t val;
   int byteSize;
 
-  byteSize = cpu->readRegister (regNum, val);
+  byteSize = readRegister (regNum, val);
 
   if (byteSize < 0)
     {
@@ -851,8 +1710,9 @@ GdbServerImpl::rspReadReg ()
 
 //! Each byte is packed as a pair of hex digits.
 
+template <class TARGET>
 void
-GdbServerImpl::rspWriteReg ()
+GdbServerImpl<TARGET>::rspWriteReg ()
 {
   std::size_t regByteSize = sizeof (uint_reg_t);
   unsigned int regNum;
@@ -876,7 +1736,7 @@ GdbServerImpl::rspWriteReg ()
   uint_reg_t val
     = Utils::hex2Val (valstr, regByteSize, true /* little endian */);
 
-  if (regByteSize != cpu->writeRegister (regNum, val))
+  if (regByteSize != writeRegister (regNum, val))
     cerr << "Warning: Size != " << regByteSize << " when writing reg " << regNum
 	 << "." << endl;
 
@@ -892,30 +1752,40 @@ GdbServerImpl::rspWriteReg ()
 //! response to anything else, to indicate it is not supported. This makes us
 //! flexible to future GDB releases with as yet undefined packets.
 
+template <class TARGET>
 void
-GdbServerImpl::rspQuery ()
+GdbServerImpl<TARGET>::rspQuery ()
 {
   if (0 == strcmp ("qC", pkt->data))
     {
       // Return the current thread ID (unsigned hex). A null response
-      // indicates to use the previously selected thread. We use the constant
-      // DUMMY_TID to represent our single thread of control.
-      sprintf (pkt->data, "QC%x", DUMMY_TID);
+      // indicates to use the previously selected thread.
+      sprintf (pkt->data, "QC%x", currentTid ());
       pkt->setLen (strlen (pkt->data));
       rsp->putPkt (pkt);
     }
   else if (0 == strncmp ("qCRC", pkt->data, strlen ("qCRC")))
     {
       // Return CRC of memory area
-      cerr << "Warning: RSP CRC query not supported" << endl;
-      pkt->packStr ("E01");
-      rsp->putPkt (pkt);
+      rspCrc ();
     }
   else if (0 == strcmp ("qfThreadInfo", pkt->data))
     {
-      // Return info about active threads. We return just the constant
-      // DUMMY_TID to represent our single thread of control.
-      sprintf (pkt->data, "m%x", DUMMY_TID);
+      // Return info about active threads. With a single hart, we return
+      // just the constant DUMMY_TID to represent our single thread of
+      // control.  Otherwise there is a thread for each hart.
+      if (nullptr == mHarts)
+	sprintf (pkt->data, "m%x", DUMMY_TID);
+      else
+	{
+	  char *p = pkt->data;
+
+	  p += sprintf (p, "m1");
+
+	  for (int  tid = 2; tid <= mHarts->numHarts (); tid++)
+	    p += sprintf (p, ",%x", tid);
+	}
+
       pkt->setLen (strlen (pkt->data));
       rsp->putPkt (pkt);
     }
@@ -938,14 +1808,35 @@ GdbServerImpl::rspQuery ()
       // This is used to interface to commands to do "stuff"
       rspCommand ();
     }
+  else if ((0 == strncmp ("qXfer:btrace:read:", pkt->data,
+			  strlen ("qXfer:btrace:read:")))
+	   || (0 == strncmp ("qXfer:btrace-conf:read:", pkt->data,
+			     strlen ("qXfer:btrace-conf:read:"))))
+    {
+      // Branch trace, from the instructions the target recorded
+      rspXferBtrace ();
+    }
   else if (0 == strncmp ("qSupported", pkt->data, strlen ("qSupported")))
     {
       // Report a list of the features we support. For now we just ignore any
       // supplied specific feature queries, but in the future these may be
       // supported as well. Note that the packet size allows for 'G' + all the
       // registers sent to us, or a reply to 'g' with all the registers and an
-      // EOS so the buffer is a well formed string.
-      sprintf (pkt->data, "PacketSize=%x", pkt->getBufSize());
+      // EOS so the buffer is a well formed string.  We advertise one less
+      // than the buffer size, so the largest packet GDB can send, or the
+      // largest memory read it can ask for, still leaves room for the EOS.
+      mClientSwbreak = NULL != strstr (pkt->data, "swbreak+");
+      mClientHwbreak = NULL != strstr (pkt->data, "hwbreak+");
+
+      // Branch trace is only offered if the target records the addresses
+      // the instructions were executed from.
+      sprintf (pkt->data, "PacketSize=%x;QStartNoAckMode+;QNonStop+;"
+	       "swbreak+;hwbreak+;binary-upload+%s",
+	       pkt->getBufSize() - 1,
+	       cpu->branchTrace ()
+	       ? (";Qbtrace:bts+;Qbtrace:off+;qXfer:btrace:read+;"
+		  "qXfer:btrace-conf:read+")
+	       : "");
       pkt->setLen (strlen (pkt->data));
       rsp->putPkt (pkt);
     }
@@ -976,12 +1867,161 @@ GdbServerImpl::rspQuery ()
 }	// rspQuery ()
 
 
+//! Handle a RSP CRC query
+
+//! Syntax is:
+
+//!   qCRC:<addr>,<length>
+
+//! The reply is C<crc>, the GDB CRC-32 of the memory, so GDB can verify a
+//! loaded image without reading it all back.  We read the memory in blocks
+//! the size of the packet buffer directly from the target, rather than
+//! through the memory cache, which would just be flushed by a large image.
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::rspCrc ()
+{
+  uint32_t  addr;
+  uint32_t  len;
+
+  if (2 != sscanf (pkt->data, "qCRC:%" SCNx32 ",%" SCNx32, &addr, &len))
+    {
+      cerr << "Warning: Failed to recognize RSP CRC query: " << pkt->data
+	   << endl;
+      pkt->packStr ("E01");
+      rsp->putPkt (pkt);
+      return;
+    }
+
+  uint32_t  crc = 0xffffffff;
+  std::size_t  blockSize = pkt->getBufSize ();
+
+  while (len > 0)
+    {
+      std::size_t  n = (len < blockSize) ? len : blockSize;
+
+      std::size_t  got;
+
+      {
+	ServerStats::Timer  timer (mStats->target (ServerStats::READ));
+
+	got = cpu->read (addr, mMemBuf, n);
+      }
+
+      if (n != got)
+	{
+	  cerr << "Warning: failed to read memory at 0x" << hex << addr << dec
+	       << " for CRC" << endl;
+	  pkt->packStr ("E01");
+	  rsp->putPkt (pkt);
+	  return;
+	}
+
+      crc   = Utils::crc32 (mMemBuf, n, crc);
+      addr += n;
+      len  -= n;
+    }
+
+  sprintf (pkt->data, "C%" PRIx32, crc);
+  pkt->setLen (strlen (pkt->data));
+  rsp->putPkt (pkt);
+
+}	// rspCrc ()
+
+
+//! Handle a RSP qXfer request for branch trace
+
+//! The request is "qXfer:btrace:read:<type>:<offset>,<length>" for the
+//! trace, or "qXfer:btrace-conf:read::<offset>,<length>" for how it is
+//! configured.  The document is made when it is read from offset zero, and
+//! later requests read on through it.  Each reply is 'm' followed by a piece
+//! of the document, or 'l' for the last piece.
+
+//! We have no way to send just what is new since the last read, so a type of
+//! "new" gets the whole trace, and "delta" is refused, so GDB asks again for
+//! "new".
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::rspXferBtrace ()
+{
+  bool  isConf = 0 == strncmp ("qXfer:btrace-conf:", pkt->data,
+			       strlen ("qXfer:btrace-conf:"));
+  const char *annex = strchr (pkt->data + strlen ("qXfer:"), ':')
+    + strlen (":read:");
+  const char *args  = strchr (annex, ':');
+  unsigned long int  offset;
+  unsigned long int  length;
+  const InsnTrace *trace = cpu->insnTrace ();
+
+  if ((nullptr == args)
+      || (2 != sscanf (args + 1, "%lx,%lx", &offset, &length))
+      || (nullptr == trace)
+      || !cpu->branchTrace ())
+    {
+      pkt->packStr ("E01");
+      rsp->putPkt (pkt);
+      return;
+    }
+
+  string  type (annex, args - annex);
+
+  if (0 == offset)
+    {
+      if (isConf)
+	{
+	  ostringstream  oss;
+
+	  oss << "<!DOCTYPE btrace-conf SYSTEM \"btrace-conf.dtd\">\n"
+	      << "<btrace-conf version=\"1.0\">\n"
+	      << "<bts size=\"0x" << hex
+	      << (trace->capacity () * sizeof (InsnTrace::Entry)) << "\"/>\n"
+	      << "</btrace-conf>\n";
+	  mXferDoc = oss.str ();
+	}
+      else if (("all" == type) || ("new" == type))
+	mXferDoc = trace->btraceXml ();
+      else
+	{
+	  pkt->packStr ("E01");
+	  rsp->putPkt (pkt);
+	  return;
+	}
+    }
+
+  // Leave room for the 'm' or 'l' and the EOS.  The document has no
+  // characters which need escaping.
+
+  std::size_t  n = pkt->getBufSize () - 2;
+
+  if (length < n)
+    n = length;
+
+  if (offset >= mXferDoc.size ())
+    n = 0;
+  else if (n > mXferDoc.size () - offset)
+    n = mXferDoc.size () - offset;
+
+  pkt->data[0] = (offset + n < mXferDoc.size ()) ? 'm' : 'l';
+
+  if (n > 0)
+    memcpy (&(pkt->data[1]), mXferDoc.data () + offset, n);
+
+  pkt->data[n + 1] = '\0';
+  pkt->setLen (n + 1);
+  rsp->putPkt (pkt);
+
+}	// rspXferBtrace ()
+
+
 //! Handle a RSP qRcmd request
 
 //! The actual command follows the "qRcmd," in ASCII encoded to hex
 
+template <class TARGET>
 void
-GdbServerImpl::rspCommand ()
+GdbServerImpl<TARGET>::rspCommand ()
 {
   char *cmd = new char[pkt->getBufSize ()];
   int   timeout;
@@ -1001,6 +2041,12 @@ GdbServerImpl::rspCommand ()
 	"    Produce this message\n",
 	"  reset [cold | warm]\n",
 	"    Reset the simulator (default warm)\n",
+	"  load <file>\n",
+	"    Load an ELF program straight into target memory\n",
+	"  snapshot save | restore\n",
+	"    Save the target state, or restore it from the last save.  Only\n",
+	"    the registers and the loaded image are saved, so save before the\n",
+	"    program first runs after a reset\n",
 	"  exit\n",
 	"    Exit the GDB server\n",
 	"  timeout <interval>\n",
@@ -1019,6 +2065,15 @@ GdbServerImpl::rspCommand ()
 	"    Show whether RSP tracing is enabled\n",
 	"  echo <message>\n",
 	"    Echo <message> on stdout of the gdbserver\n",
+	"  stats [reset]\n",
+	"    Report packet and target call counts and times, or reset them\n",
+	"  itrace [on | off | save <file>]\n",
+	"    Report, start or stop recording instructions, or save them\n",
+	"  speed\n",
+	"    Report the speed of the model, and where the time goes\n",
+	"  profile [start [<period>] | stop | dump [<file>]]\n",
+	"    Report, start or stop sampling the PC every <period> cycles, or\n",
+	"    save the samples for gprof (default gmon.out)\n",
 	nullptr };
 
       for (int i = 0; nullptr != mess[i]; i++)
@@ -1062,6 +2117,8 @@ GdbServerImpl::rspCommand ()
     {
       // Warm reset the CPU.  Failure to reset causes us to blow up.
 
+      invalidateCaches ();
+
       if (ITarget::ResumeRes::SUCCESS != cpu->reset (ITarget::ResetType::WARM))
 	{
 	  cerr << "*** ABORT *** Failed to reset: Terminating." << endl;
@@ -1075,6 +2132,8 @@ GdbServerImpl::rspCommand ()
     {
       // Cold reset the CPU.  Failure to reset causes us to blow up.
 
+      invalidateCaches ();
+
       if (ITarget::ResumeRes::SUCCESS != cpu->reset (ITarget::ResetType::COLD))
 	{
 	  cerr << "*** ABORT *** Failed to cold reset: Terminating." << endl;
@@ -1084,6 +2143,44 @@ GdbServerImpl::rspCommand ()
       pkt->packStr ("OK");
       rsp->putPkt (pkt);
     }
+  else if (0 == strncmp (cmd, "load ", strlen ("load ")))
+    {
+      // Load a program without GDB.  Memory and the PC change under us.
+
+      ElfLoader  loader (cpu, traceFlags);
+
+      invalidateCaches ();
+
+      if (loader.load (cmd + strlen ("load ")))
+	pkt->packStr ("OK");
+      else
+	pkt->packStr ("E01");
+
+      rsp->putPkt (pkt);
+    }
+  else if (0 == strcmp (cmd, "snapshot save"))
+    {
+      if (cpu->saveSnapshot ())
+	pkt->packStr ("OK");
+      else
+	pkt->packStr ("E01");
+
+      rsp->putPkt (pkt);
+    }
+  else if (0 == strcmp (cmd, "snapshot restore"))
+    {
+      // The target's memory and registers are rewritten, so nothing we
+      // hold is valid.
+
+      invalidateCaches ();
+
+      if (cpu->restoreSnapshot ())
+	pkt->packStr ("OK");
+      else
+	pkt->packStr ("E01");
+
+      rsp->putPkt (pkt);
+    }
   else if (0 == strcmp (cmd, "exit"))
     {
       mExitServer = true;
@@ -1139,18 +2236,153 @@ GdbServerImpl::rspCommand ()
       pkt->packStr ("OK");
       rsp->putPkt (pkt);
     }
-    else if (0 == strncmp (cmd, "echo", 4))
+    else if (0 == strcmp (cmd, "stats"))
       {
-	const char *tmp = cmd + 4;
-	while (*tmp != '\0' && isspace (*tmp))
-	  ++tmp;
-	cerr << std::flush;
-	cout << tmp << std::endl << std::flush;
-	pkt->packStr ("OK");
-	rsp->putPkt (pkt);
-      }
-    // Insert any new generic commands here.
-    // Don't forget to document them.
+	stringstream  ss;
+	string  line;
+
+	mStats->report (ss, rsp->bytesIn (), rsp->bytesOut ());
+
+	while (getline (ss, line, '\n'))
+	  {
+	    line.append ("\n");
+	    pkt->packRcmdStr (line.c_str (), true);
+	    rsp->putPkt (pkt);
+	  }
+
+	// Not silent, so acknowledge OK
+
+	pkt->packStr ("OK");
+	rsp->putPkt (pkt);
+      }
+    else if (0 == strcmp (cmd, "speed"))
+      {
+	// The target may have figures of its own to add.
+
+	stringstream  ss;
+	string  line;
+
+	mStats->reportSpeed (ss);
+	(void) cpu->command (string ("speed"), ss);
+
+	while (getline (ss, line, '\n'))
+	  {
+	    line.append ("\n");
+	    pkt->packRcmdStr (line.c_str (), true);
+	    rsp->putPkt (pkt);
+	  }
+
+	// Not silent, so acknowledge OK
+
+	pkt->packStr ("OK");
+	rsp->putPkt (pkt);
+      }
+    else if ((0 == strcmp (cmd, "itrace on"))
+	     || (0 == strcmp (cmd, "itrace off")))
+      {
+	bool  on = 0 == strcmp (cmd, "itrace on");
+
+	pkt->packStr (cpu->traceInsns (on) ? "OK" : "E01");
+	rsp->putPkt (pkt);
+      }
+    else if (0 == strncmp (cmd, "itrace save ", strlen ("itrace save ")))
+      {
+	const InsnTrace *trace = cpu->insnTrace ();
+
+	if ((nullptr != trace) && trace->save (cmd + strlen ("itrace save ")))
+	  pkt->packStr ("OK");
+	else
+	  pkt->packStr ("E01");
+
+	rsp->putPkt (pkt);
+      }
+    else if (0 == strcmp (cmd, "itrace"))
+      {
+	const InsnTrace *trace = cpu->insnTrace ();
+	std::ostringstream  oss;
+
+	if (nullptr == trace)
+	  oss << "No instructions recorded" << endl;
+	else
+	  oss << "Instructions recorded: " << trace->total () << " ("
+	      << trace->size () << " of " << trace->capacity () << " held)"
+	      << endl;
+
+	pkt->packHexstr (oss.str ().c_str ());
+	rsp->putPkt (pkt);
+
+	// Not silent, so acknowledge OK
+
+	pkt->packStr ("OK");
+	rsp->putPkt (pkt);
+      }
+    else if ((0 == strcmp (cmd, "profile start"))
+	     || (0 == strncmp (cmd, "profile start ", strlen ("profile start "))))
+      {
+	const char *arg = cmd + strlen ("profile start");
+	char *end;
+	uint64_t  period = Profile::DEFAULT_PERIOD;
+
+	if ('\0' != *arg)
+	  period = strtoull (arg, &end, 0);
+
+	if (('\0' != *arg) && (('\0' != *end) || (0 == period)))
+	  pkt->packStr ("E01");
+	else
+	  {
+	    mProfile->start (period);
+	    pkt->packStr ("OK");
+	  }
+
+	rsp->putPkt (pkt);
+      }
+    else if (0 == strcmp (cmd, "profile stop"))
+      {
+	mProfile->stop ();
+	pkt->packStr ("OK");
+	rsp->putPkt (pkt);
+      }
+    else if ((0 == strcmp (cmd, "profile dump"))
+	     || (0 == strncmp (cmd, "profile dump ", strlen ("profile dump "))))
+      {
+	const char *file = ('\0' == cmd[strlen ("profile dump")])
+	  ? "gmon.out" : cmd + strlen ("profile dump ");
+
+	pkt->packStr (mProfile->save (file) ? "OK" : "E01");
+	rsp->putPkt (pkt);
+      }
+    else if (0 == strcmp (cmd, "profile"))
+      {
+	std::ostringstream  oss;
+
+	mProfile->report (oss);
+	pkt->packHexstr (oss.str ().c_str ());
+	rsp->putPkt (pkt);
+
+	// Not silent, so acknowledge OK
+
+	pkt->packStr ("OK");
+	rsp->putPkt (pkt);
+      }
+    else if (0 == strcmp (cmd, "stats reset"))
+      {
+	mStats->reset ();
+	rsp->resetByteCounts ();
+	pkt->packStr ("OK");
+	rsp->putPkt (pkt);
+      }
+    else if (0 == strncmp (cmd, "echo", 4))
+      {
+	const char *tmp = cmd + 4;
+	while (*tmp != '\0' && isspace (*tmp))
+	  ++tmp;
+	cerr << std::flush;
+	cout << tmp << std::endl << std::flush;
+	pkt->packStr ("OK");
+	rsp->putPkt (pkt);
+      }
+    // Insert any new generic commands here.
+    // Don't forget to document them.
 
     else if (0 == strncmp (cmd, "set ", strlen ("set ")))
       {
@@ -1172,10 +2404,13 @@ GdbServerImpl::rspCommand ()
       }
     else
       {
-	// Fallback is to pass the command to the target.
+	// Fallback is to pass the command to the target, which might change
+	// its registers or memory.
 
 	ostringstream  oss;
 
+	invalidateCaches ();
+
 	if (cpu->command (string (cmd), oss))
 	  {
 	    pkt->packRcmdStr (oss.str ().c_str (), true);
@@ -1209,8 +2444,9 @@ GdbServerImpl::rspCommand ()
 
 //! @param[in] cmd  The RSP set command string (excluding "set ")
 
+template <class TARGET>
 void
-GdbServerImpl::rspSetCommand (const char* cmd)
+GdbServerImpl<TARGET>::rspSetCommand (const char* cmd)
 {
   vector<string> tokens;
   Utils::split (cmd, " ", tokens);
@@ -1268,6 +2504,8 @@ GdbServerImpl::rspSetCommand (const char* cmd)
       ostringstream  oss;
       string fullCmd = string ("set ") + string (cmd);
 
+      invalidateCaches ();
+
       if (cpu->command (string (fullCmd), oss))
 	{
 	  pkt->packRcmdStr (oss.str ().c_str (), true);
@@ -1298,8 +2536,9 @@ GdbServerImpl::rspSetCommand (const char* cmd)
 
 //! @param[in] cmd  The RSP command string (excluding "show ")
 
+template <class TARGET>
 void
-GdbServerImpl::rspShowCommand (const char* cmd)
+GdbServerImpl<TARGET>::rspShowCommand (const char* cmd)
 {
   vector<string> tokens;
   Utils::split (cmd, " ", tokens);
@@ -1375,24 +2614,333 @@ GdbServerImpl::rspShowCommand (const char* cmd)
 
 //! Handle a RSP set request.
 
-//! There are none that we support, so we always return an empty packet.
+//! We support QStartNoAckMode and QNonStop.  Our reply to QStartNoAckMode
+//! is still acknowledged by GDB, so we only switch off acknowledgements once
+//! it has been sent.  The mode can only be changed with the target stopped.
+//! For anything else we return an empty packet.
 
+template <class TARGET>
 void
-GdbServerImpl::rspSet ()
+GdbServerImpl<TARGET>::rspSet ()
 {
-  pkt->packStr ("");
-  rsp->putPkt (pkt);
+  if (0 == strcmp ("QStartNoAckMode", pkt->data))
+    {
+      pkt->packStr ("OK");
+      rsp->putPkt (pkt);
+      rsp->setNoAckMode (true);
+    }
+  else if ((0 == strcmp ("Qbtrace:bts", pkt->data))
+	   || (0 == strcmp ("Qbtrace:off", pkt->data)))
+    {
+      // Branch trace is recorded by the target, a thread at a time, if it
+      // can give us the addresses the instructions were executed from.
+      bool  on = 0 == strcmp ("Qbtrace:bts", pkt->data);
 
+      pkt->packStr ((cpu->branchTrace () && cpu->traceInsns (on))
+		    ? "OK" : "E01");
+      rsp->putPkt (pkt);
+    }
+  else if (0 == strncmp ("QNonStop:", pkt->data, strlen ("QNonStop:")))
+    {
+      const char *mode = pkt->data + strlen ("QNonStop:");
+      bool  ok = ((0 == strcmp ("0", mode)) || (0 == strcmp ("1", mode)))
+	&& !mRunner.joinable ();
+
+      if (ok)
+	{
+	  mNonStop = ('1' == mode[0]);
+	  mStopQueue.clear ();
+	}
+
+      pkt->packStr (ok ? "OK" : "E01");
+      rsp->putPkt (pkt);
+    }
+  else
+    {
+      pkt->packStr ("");
+      rsp->putPkt (pkt);
+    }
 }	// rspSet ()
 
 
+//! Handle a RSP set thread request
+
+//! Syntax is H<op><tid>, where op is 'g' for subsequent register and memory
+//! operations, or 'c' for subsequent steps.  A thread id of 0 means any
+//! thread, and -1 all threads.
+
+//! With a single hart there is only one thread, so we just say OK.  With
+//! several, 'g' changes the current hart, so the caches must go.  We always
+//! continue every hart, so 'c' only chooses the hart to step.
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::rspSetThread ()
+{
+  if (nullptr == mHarts)
+    {
+      pkt->packStr ("OK");
+      rsp->putPkt (pkt);
+      return;
+    }
+
+  bool  ok;
+
+  switch (pkt->data[1])
+    {
+    case 'g':
+      {
+	char *endptr;
+	long int  tid = strtol (pkt->data + 2, &endptr, 16);
+
+	ok = ('\0' == *endptr) && ((tid <= 0) || mHarts->selectHart (tid - 1));
+	invalidateCaches ();
+      }
+      break;
+
+    case 'c':
+      ok = selectStepThread (pkt->data + 2);
+      break;
+
+    default:
+      ok = false;
+      break;
+    }
+
+  pkt->packStr (ok ? "OK" : "E01");
+  rsp->putPkt (pkt);
+
+}	// rspSetThread ()
+
+
+//! Handle a RSP thread alive request
+
+//! Syntax is T<tid>.  With a single hart, any thread is alive, since we are
+//! bare metal and have no thread context.  With several, each hart's thread
+//! is alive.
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::rspThreadAlive ()
+{
+  if (nullptr != mHarts)
+    {
+      char *endptr;
+      long int  tid = strtol (pkt->data + 1, &endptr, 16);
+
+      if (('\0' != *endptr) || (tid < 1) || (tid > mHarts->numHarts ()))
+	{
+	  pkt->packStr ("E01");
+	  rsp->putPkt (pkt);
+	  return;
+	}
+    }
+
+  pkt->packStr ("OK");
+  rsp->putPkt (pkt);
+
+}	// rspThreadAlive ()
+
+
+//! Choose the thread to step
+
+//! @param[in] tidStr  The thread id, as hex.  0 (any thread) and -1 (all
+//!                    threads) mean the current thread.
+//! @return  TRUE if the thread id was valid, FALSE otherwise.
+
+template <class TARGET>
+bool
+GdbServerImpl<TARGET>::selectStepThread (const char *tidStr)
+{
+  char *endptr;
+  long int  tid = strtol (tidStr, &endptr, 16);
+
+  if ('\0' != *endptr)
+    return  false;
+
+  return  (nullptr == mHarts)
+    || mHarts->selectStepHart ((tid <= 0) ? -1 : static_cast<int> (tid - 1));
+
+}	// selectStepThread ()
+
+
+//! Do the continue actions of a vCont cover every thread?
+
+//! We can only continue all the harts together, so in non-stop mode we must
+//! refuse to continue just some of them.  An action with no thread, or with
+//! thread -1, covers every thread.  Thread 0 (any thread) is the current
+//! hart.
+
+//! @param[in] actions  The vCont actions, separated by ';'
+//! @return  TRUE if the continue actions name every thread, FALSE otherwise.
+
+template <class TARGET>
+bool
+GdbServerImpl<TARGET>::continuesAllThreads (const char *actions) const
+{
+  if ((nullptr == mHarts) || (1 == mHarts->numHarts ()))
+    return  true;
+
+  std::vector<bool>  named (mHarts->numHarts (), false);
+
+  for (const char *a = actions; nullptr != a; a = strchr (a, ';'))
+    {
+      if (';' == *a)
+	a++;
+
+      if (('c' != *a) && ('C' != *a))
+	continue;
+
+      const char *colon = strchr (a, ':');
+      const char *next  = strchr (a, ';');
+
+      if ((nullptr == colon) || ((nullptr != next) && (next < colon)))
+	return  true;
+
+      long int  tid = strtol (colon + 1, nullptr, 16);
+
+      if (tid < 0)
+	return  true;
+
+      int  hart = (0 == tid) ? mHarts->currentHart ()
+	: static_cast<int> (tid - 1);
+
+      if (hart < mHarts->numHarts ())
+	named[hart] = true;
+    }
+
+  for (bool n : named)
+    if (!n)
+      return  false;
+
+  return  true;
+
+}	// continuesAllThreads ()
+
+
+//! The current thread id
+
+//! @return  The thread id of the current hart
+
+template <class TARGET>
+int
+GdbServerImpl<TARGET>::currentTid () const
+{
+  return  (nullptr == mHarts) ? DUMMY_TID : mHarts->currentHart () + 1;
+
+}	// currentTid ()
+
+
 //! Handle a RSP 'v' packet
 
-//! @todo for now we don't handle V packets.
+//! For now the only 'v' packets we handle are vCont?, vCont and vStopped.
+//! We always continue every hart, so only the first action of vCont
+//! matters.  Any thread it names is the hart to step, and with no thread we
+//! step the current hart.  As with 'C' and 'S', any signal is ignored.  In
+//! all-stop mode, GDB expects the other harts may run while one is stepped
+//! or continued, but in non-stop mode it expects those it doesn't name to
+//! stay stopped, so there we refuse a continue which doesn't name them all.
+
+//! The supported actions are c, C, s, S, r<start>,<end>, the last being to
+//! keep stepping while the PC is in the range [start, end), and in non-stop
+//! mode t, to stop the target.  For anything else we return an empty packet.
 
+template <class TARGET>
 void
-GdbServerImpl::rspVpkt ()
+GdbServerImpl<TARGET>::rspVpkt ()
 {
+  if (0 == strcmp ("vCont?", pkt->data))
+    {
+      pkt->packStr ("vCont;c;C;s;S;r;t");
+      rsp->putPkt (pkt);
+      return;
+    }
+
+  if (0 == strcmp ("vStopped", pkt->data))
+    {
+      rspStopped ();
+      return;
+    }
+
+  if (0 == strncmp ("vCont;", pkt->data, strlen ("vCont;")))
+    {
+      char *action = pkt->data + strlen ("vCont;");
+      char *next   = strchr (action, ';');
+      char *colon  = strchr (action, ':');
+      uint32_t  start;
+      uint32_t  end;
+
+      if (mNonStop && (('c' == action[0]) || ('C' == action[0]))
+	  && !continuesAllThreads (action))
+	{
+	  cerr << "Warning: Cannot continue only some harts in non-stop mode: "
+	       << pkt->data << endl;
+	  pkt->packStr ("E01");
+	  rsp->putPkt (pkt);
+	  return;
+	}
+
+      if (nullptr != next)
+	*next = '\0';			// Only the first action matters
+
+      if ((nullptr != colon) && ((nullptr == next) || (colon < next)))
+	*colon = '\0';
+      else
+	colon = nullptr;
+
+      if (!selectStepThread ((nullptr == colon) ? "-1" : colon + 1))
+	{
+	  pkt->packStr ("E01");
+	  rsp->putPkt (pkt);
+	  return;
+	}
+
+      switch (action[0])
+	{
+	case 'c':
+	case 'C':
+	  rspContinue ();
+	  return;
+
+	case 's':
+	case 'S':
+	  rspSingleStep ();
+	  return;
+
+	case 'r':
+	  if (2 == sscanf (action, "r%" SCNx32 ",%" SCNx32, &start, &end))
+	    {
+	      rspRangeStep (start, end);
+	      return;
+	    }
+
+	  break;
+
+	case 't':
+	  // The runner stops the target at the end of its slice, and we
+	  // notify the stop then.  If the target is stopped already, there
+	  // is nothing to do.
+	  if (mNonStop)
+	    {
+	      mStopRequested.store (true);
+	      pkt->packStr ("OK");
+	      rsp->putPkt (pkt);
+	      return;
+	    }
+
+	  break;
+
+	default:
+	  break;
+	}
+
+      cerr << "Warning: RSP vCont action not recognized: " << pkt->data
+	   << ": ignored" << endl;
+      pkt->packStr ("E01");
+      rsp->putPkt (pkt);
+      return;
+    }
+
   pkt->packStr ("");
   rsp->putPkt (pkt);
 
@@ -1411,8 +2959,9 @@ GdbServerImpl::rspVpkt ()
 //! The length given is the number of bytes to be written. The data buffer has
 //! already been unescaped, so will hold this number of bytes.
 
+template <class TARGET>
 void
-GdbServerImpl::rspWriteMemBin ()
+GdbServerImpl<TARGET>::rspWriteMemBin ()
 {
   uint32_t  addr;			// Where to write the memory
   std::size_t len;			// Number of bytes to write
@@ -1445,7 +2994,7 @@ GdbServerImpl::rspWriteMemBin ()
     }
 
   // Write the bytes to memory.
-  if (len != cpu->write (addr, bindat, len))
+  if (len != mMemCache->write (addr, bindat, len))
     cerr << "Warning: Failed to write " << len << " bytes to 0x" << hex
 	 << addr << dec << endl;
 
@@ -1457,28 +3006,23 @@ GdbServerImpl::rspWriteMemBin ()
 
 //! Handle a RSP remove breakpoint or matchpoint request
 
-//! This checks that the matchpoint was actually set earlier. For software
-//! (memory) breakpoints, the breakpoint is cleared from memory.
-
-//! @todo This doesn't work with icache/immu yet
+//! This checks that the matchpoint was actually set earlier.  If the target
+//! is holding the matchpoint, it is asked to remove it.  Otherwise this must
+//! be a software (memory) breakpoint we planted ourselves, and the original
+//! instruction is put back in memory.
 
+template <class TARGET>
 void
-GdbServerImpl::rspRemoveMatchpoint ()
+GdbServerImpl<TARGET>::rspRemoveMatchpoint ()
 {
-  MpType    type;			// What sort of matchpoint
+  int       type;			// What sort of matchpoint
   uint32_t  addr;			// Address specified
   uint32_t  instr;			// Instruction value found
   std::size_t len;			// Matchpoint length
   uint8_t  *instrVec;			// Instruction as byte vector
 
-  pkt->packStr ("");
-  rsp->putPkt (pkt);
-  return;
-
   // Break out the instruction
-  string ui32Fmt = SCNx32;
-  string fmt = "z%ld,%" + ui32Fmt + ",%ld";
-  if (3 != sscanf (pkt->data, fmt.c_str(), (int *)&type, &addr, &len))
+  if (3 != sscanf (pkt->data, "z%d,%" SCNx32 ",%zu", &type, &addr, &len))
     {
       cerr << "Warning: RSP matchpoint deletion request not "
 	   << "recognized: ignored" << endl;
@@ -1487,178 +3031,127 @@ GdbServerImpl::rspRemoveMatchpoint ()
       return;
     }
 
-  // Sanity check len
-  if (len > sizeof (instr))
+  // Sanity check type, and len for breakpoints
+  if ((type < BP_MEMORY) || (type > WP_ACCESS))
     {
-      cerr << "Warning: RSP remove breakpoint instruction length " << len
-	   << " exceeds maximum of " << sizeof (instr) << endl;
+      cerr << "Warning: RSP matchpoint type " << type
+	   << " not recognized: ignored" << endl;
       pkt->packStr ("E01");
       rsp->putPkt (pkt);
       return;
     }
 
-  // Sort out the type of matchpoint
-  switch (type)
+  MpType  mpType = static_cast<MpType> (type);
+  ITarget::MatchType  matchType = static_cast<ITarget::MatchType> (type);
+
+  if (((BP_MEMORY == mpType) || (BP_HARDWARE == mpType))
+      && (len > sizeof (instr)))
     {
-    case BP_MEMORY:
-      // Software (memory) breakpoint
-      if (mpHash->remove (type, addr, &instr))
-	{
-	  if (traceFlags->traceRsp())
-	    {
-	      cout << "RSP trace: software (memory) breakpoint removed from 0x"
-		   << hex << addr << dec << endl;
-	    }
-	}
-      else
-	{
-	  cerr << "Warning: failed to remove software (memory) breakpoint "
-	          "from 0x" << hex << addr << dec << endl;
-	  pkt->packStr ("E01");
-	  rsp->putPkt (pkt);
-	}
-
-      if (traceFlags->traceBreak ())
-	cerr << "Putting back the instruction (0x" << hex << setfill ('0')
-	     << setw (4) << instr << ") at 0x" << setw(8) << addr
-	     << setfill (' ')  << setw (0) << dec << endl;
-
-      // Remove the breakpoint from memory. The endianness of the instruction
-      // matches that of the memory.
-      instrVec = reinterpret_cast<uint8_t *> (&instr);
-
-      if (len != cpu->write (addr, instrVec, len))
-	cerr << "Warning: Failed to write memory removing breakpoint" << endl;
-
-      pkt->packStr ("OK");
+      cerr << "Warning: RSP remove breakpoint instruction length " << len
+	   << " exceeds maximum of " << sizeof (instr) << endl;
+      pkt->packStr ("E01");
       rsp->putPkt (pkt);
       return;
+    }
 
-    case BP_HARDWARE:
-      // Hardware breakpoint
-      if (mpHash->remove (type, addr, &instr))
-	{
-	  if (traceFlags->traceRsp())
-	    {
-	      cout << "Rsp trace: hardware breakpoint removed from 0x NOT IMPLEMENTED"
-		   << hex << addr << dec << endl;
-	    }
-      /*
-	  cpu->removeBreak(addr);
-	  */
-	  pkt->packStr ("OK");
-	  rsp->putPkt (pkt);
-	}
-      else
+  // Watchpoints are held by the target alone, and may overlap.
+  if ((BP_MEMORY != mpType) && (BP_HARDWARE != mpType))
+    {
+      if ((0 == mWatchpoints.erase (std::make_tuple (mpType, addr, len)))
+	  || !targetRemoveMatchpoint (matchType, addr, len))
 	{
-	  cerr << "Warning: failed to remove hardware breakpoint from 0x"
+	  cerr << "Warning: failed to remove " << matchType << " from 0x"
 	       << hex << addr << dec << endl;
 	  pkt->packStr ("E01");
-	  rsp->putPkt (pkt);
-	}
-
-      return;
-
-    case WP_WRITE:
-      // Write watchpoint
-      if (mpHash->remove (type, addr, &instr))
-	{
-	  if (traceFlags->traceRsp())
-	    {
-	      cout << "RSP trace: write watchpoint removed from 0x"
-		   << hex << addr << dec << endl;
-	    }
-
-	  pkt->packStr ("");		// TODO: Not yet implemented
-	  rsp->putPkt (pkt);
 	}
       else
-	{
-	  cerr << "Warning: failed to remove write watchpoint from 0x"
-	       << hex << addr << dec << endl;
-	  pkt->packStr ("E01");
-	  rsp->putPkt (pkt);
-	}
-
-      return;
-
-    case WP_READ:
-      // Read watchpoint
-      if (mpHash->remove (type, addr, &instr))
 	{
 	  if (traceFlags->traceRsp())
-	    {
-	      cout << "RSP trace: read watchpoint removed from 0x"
-		   << hex << addr << dec << endl;
-	    }
+	    cout << "RSP trace: " << matchType << " removed from 0x" << hex
+		 << addr << dec << endl;
 
-	  pkt->packStr ("");		// TODO: Not yet implemented
-	  rsp->putPkt (pkt);
-	}
-      else
-	{
-	  cerr << "Warning: failed to remove read watchpoint from 0x"
-	       << hex << addr << dec << endl;
-	  pkt->packStr ("E01");
-	  rsp->putPkt (pkt);
+	  pkt->packStr ("OK");
 	}
 
+      rsp->putPkt (pkt);
       return;
+    }
 
-    case WP_ACCESS:
-      // Access (read/write) watchpoint
-      if (mpHash->remove (type, addr, &instr))
-	{
-	  if (traceFlags->traceRsp())
-	    {
-	      cout << "RSP trace: access (read/write) watchpoint removed "
-		      "from 0x" << hex << addr << dec << endl;
-	    }
+  if (!mpHash->remove (mpType, addr, &instr))
+    {
+      cerr << "Warning: failed to remove " << matchType << " from 0x"
+	   << hex << addr << dec << endl;
+      pkt->packStr ("E01");
+      rsp->putPkt (pkt);
+      return;
+    }
 
-	  pkt->packStr ("");		// TODO: Not yet implemented
-	  rsp->putPkt (pkt);
-	}
-      else
-	{
-	  cerr << "Warning: failed to remove access (read/write) watchpoint "
-	          "from 0x" << hex << addr << dec << endl;
-	  pkt->packStr ("E01");
-	  rsp->putPkt (pkt);
-	}
+  // First see if the target was holding the matchpoint
+  if (targetRemoveMatchpoint (matchType, addr, len))
+    {
+      if (traceFlags->traceRsp())
+	cout << "RSP trace: " << matchType << " removed from 0x" << hex
+	     << addr << dec << endl;
 
+      pkt->packStr ("OK");
+      rsp->putPkt (pkt);
       return;
+    }
 
-    default:
-      cerr << "Warning: RSP matchpoint type " << type
-	   << " not recognized: ignored" << endl;
+  // Only software (memory) breakpoints have a fallback
+  if (BP_MEMORY != mpType)
+    {
+      cerr << "Warning: target failed to remove " << matchType << " from 0x"
+	   << hex << addr << dec << endl;
       pkt->packStr ("E01");
       rsp->putPkt (pkt);
       return;
     }
+
+  if (traceFlags->traceBreak ())
+    cerr << "Putting back the instruction (0x" << hex << setfill ('0')
+	 << setw (4) << instr << ") at 0x" << setw(8) << addr
+	 << setfill (' ')  << setw (0) << dec << endl;
+
+  // Remove the breakpoint from memory. The endianness of the instruction
+  // matches that of the memory.
+  instrVec = reinterpret_cast<uint8_t *> (&instr);
+
+  if (len != mMemCache->write (addr, instrVec, len))
+    cerr << "Warning: Failed to write memory removing breakpoint" << endl;
+
+  if (traceFlags->traceRsp())
+    cout << "RSP trace: software (memory) breakpoint removed from 0x"
+	 << hex << addr << dec << endl;
+
+  pkt->packStr ("OK");
+  rsp->putPkt (pkt);
+
 }	// rspRemoveMatchpoint ()
 
 
 //! Handle a RSP insert breakpoint or matchpoint request
 
-//! @todo For now only memory breakpoints are handled
+//! The target is asked to hold the matchpoint first, since it can do so
+//! without any memory traffic.  If it can't, software (memory) breakpoints
+//! fall back to planting EBREAK (or C.EBREAK for a 2 byte breakpoint) in
+//! memory.  Other types of matchpoint are then unsupported.
+
+//! Insertion must be idempotent, so a matchpoint we already have is just
+//! acknowledged.
 
+template <class TARGET>
 void
-GdbServerImpl::rspInsertMatchpoint ()
+GdbServerImpl<TARGET>::rspInsertMatchpoint ()
 {
-  MpType    type;			// What sort of matchpoint
+  int       type;			// What sort of matchpoint
   uint32_t  addr;			// Address specified
   uint32_t  instr;			// Instruction value found
   std::size_t len;			// Matchpoint length
   uint8_t  *instrVec;			// Instruction as byte vector
 
-  pkt->packStr ("");
-  rsp->putPkt (pkt);
-  return;
-
   // Break out the instruction
-  string ui32Fmt = SCNx32;
-  string fmt = "Z%ld,%" + ui32Fmt + ",%ld";
-  if (3 != sscanf (pkt->data, fmt.c_str(), (int *)&type, &addr, &len))
+  if (3 != sscanf (pkt->data, "Z%d,%" SCNx32 ",%zu", &type, &addr, &len))
     {
       cerr << "Warning: RSP matchpoint insertion request not "
 	   << "recognized: ignored" << endl;
@@ -1667,8 +3160,21 @@ GdbServerImpl::rspInsertMatchpoint ()
       return;
     }
 
-  // Sanity check len
-  if (len > sizeof (instr))
+  // Sanity check type, and len for breakpoints
+  if ((type < BP_MEMORY) || (type > WP_ACCESS))
+    {
+      cerr << "Warning: RSP matchpoint type " << type
+	   << " not recognized: ignored" << endl;
+      pkt->packStr ("E01");
+      rsp->putPkt (pkt);
+      return;
+    }
+
+  MpType  mpType = static_cast<MpType> (type);
+  ITarget::MatchType  matchType = static_cast<ITarget::MatchType> (type);
+
+  if (((BP_MEMORY == mpType) || (BP_HARDWARE == mpType))
+      && (len > sizeof (instr)))
     {
       cerr << "Warning: RSP set breakpoint instruction length " << len
 	   << " exceeds maximum of " << sizeof (instr) << endl;
@@ -1677,114 +3183,444 @@ GdbServerImpl::rspInsertMatchpoint ()
       return;
     }
 
-  // Sort out the type of matchpoint
-  switch (type)
+  // Watchpoints are held by the target alone, and may overlap, so they are
+  // identified by their length as well as their address.
+  if ((BP_MEMORY != mpType) && (BP_HARDWARE != mpType))
     {
-    case BP_MEMORY:
-      // Software (memory) breakpoint. Extract the instruction.
-      instrVec = reinterpret_cast<uint8_t *> (&instr);
+      auto  key = std::make_tuple (mpType, addr, len);
 
-      if (len != cpu->read (addr, instrVec, len))
-	cerr << "Warning: Failed to read memory when inserting breakpoint"
-	     << endl;
+      if (mWatchpoints.count (key) > 0)
+	pkt->packStr ("OK");
+      else if (targetInsertMatchpoint (matchType, addr, len))
+	{
+	  mWatchpoints.insert (key);
 
-      // Record the breakpoint and write a breakpoint instruction in its
-      // place.
-      mpHash->add (type, addr, instr);
+	  if (traceFlags->traceRsp())
+	    cout << "RSP trace: " << matchType << " inserted at 0x" << hex
+		 << addr << dec << endl;
 
-      if (traceFlags->traceBreak ())
-	cerr << "Inserting a breakpoint over the  instruction (0x" << hex
-	     << setfill ('0') << setw (4) << instr << ") at 0x" << setw(8)
-	     << addr << setfill (' ')  << setw (0) << dec << endl;
+	  pkt->packStr ("OK");
+	}
+      else
+	pkt->packStr ("");		// Not supported
 
-      // Little-endian, so least significant byte is at "little" address.
+      rsp->putPkt (pkt);
+      return;
+    }
 
-      instr = BREAK_INSTR;
-      instrVec = reinterpret_cast<uint8_t *> (&instr);
+  if (NULL != mpHash->lookup (mpType, addr))
+    {
+      pkt->packStr ("OK");
+      rsp->putPkt (pkt);
+      return;
+    }
 
-      if (4 != cpu->write (addr, instrVec, 4))
-	cerr << "Warning: Failed to write BREAK instruction" << endl;
+  // First see if the target will hold the matchpoint
+  if (targetInsertMatchpoint (matchType, addr, len))
+    {
+      mpHash->add (mpType, addr, 0);	// No instr held by us
 
       if (traceFlags->traceRsp())
-	{
-	  cout << "RSP trace: software (memory) breakpoint inserted at 0x"
-	       << hex << addr << dec << endl;
-	}
+	cout << "RSP trace: " << matchType << " inserted at 0x" << hex
+	     << addr << dec << endl;
 
       pkt->packStr ("OK");
       rsp->putPkt (pkt);
       return;
+    }
+
+  // Only software (memory) breakpoints have a fallback
+  if (BP_MEMORY != mpType)
+    {
+      pkt->packStr ("");		// Not supported
+      rsp->putPkt (pkt);
+      return;
+    }
 
-    case BP_HARDWARE:
-      // Hardware breakpoint
-      mpHash->add (type, addr, 0);	// No instr for HW matchpoints
+  // Software (memory) breakpoint. Extract the instruction.
+  instr    = 0;
+  instrVec = reinterpret_cast<uint8_t *> (&instr);
 
-      if (traceFlags->traceRsp())
+  if (len != mMemCache->read (addr, instrVec, len))
+    cerr << "Warning: Failed to read memory when inserting breakpoint"
+	 << endl;
+
+  // Record the breakpoint and write a breakpoint instruction in its place.
+  mpHash->add (mpType, addr, instr);
+
+  if (traceFlags->traceBreak ())
+    cerr << "Inserting a breakpoint over the  instruction (0x" << hex
+	 << setfill ('0') << setw (4) << instr << ") at 0x" << setw(8)
+	 << addr << setfill (' ')  << setw (0) << dec << endl;
+
+  // Little-endian, so least significant byte is at "little" address.
+
+  if (2 == len)
+    instr = C_BREAK_INSTR;
+  else
+    instr = BREAK_INSTR;
+
+  instrVec = reinterpret_cast<uint8_t *> (&instr);
+
+  if (len != mMemCache->write (addr, instrVec, len))
+    cerr << "Warning: Failed to write BREAK instruction" << endl;
+
+  if (traceFlags->traceRsp())
+    cout << "RSP trace: software (memory) breakpoint inserted at 0x"
+	 << hex << addr << dec << endl;
+
+  pkt->packStr ("OK");
+  rsp->putPkt (pkt);
+
+}	// rspInsertMatchpoint ()
+
+
+//! Read a register, from the cache if we can
+
+//! Only the registers in the cache are cached.  Anything else, such as a
+//! CSR, always goes to the target.
+
+//! @param[in]  regNum  GDB number of the register to read
+//! @param[out] val     The value read
+//! @return  The size of the register in bytes, as from the target.
+
+template <class TARGET>
+std::size_t
+GdbServerImpl<TARGET>::readRegister (int  regNum,
+				     uint_reg_t & val)
+{
+  if ((regNum < 0) || (regNum >= RISCV_NUM_REGS))
+    {
+      ServerStats::Timer  timer (mStats->target (ServerStats::READ_REGISTER));
+
+      return  cpu->readRegister (regNum, val);
+    }
+
+  if (0 == mRegCacheSize[regNum])
+    {
+      std::size_t  byteSize;
+
+      {
+	ServerStats::Timer  timer
+	  (mStats->target (ServerStats::READ_REGISTER));
+
+	byteSize = cpu->readRegister (regNum, mRegCache[regNum]);
+      }
+
+      // Don't cache a failed read.
+
+      if ((0 == byteSize) || (byteSize > sizeof (uint_reg_t)))
 	{
-	  cout << "RSP trace: hardware breakpoint set at 0x NOT IMPLEMENTED"
-	       << hex << addr << dec << endl;
+	  val = mRegCache[regNum];
+	  return  byteSize;
 	}
-      /*
-      cpu->insertBreak(addr);
-      */
-      pkt->packStr ("OK");
-      rsp->putPkt (pkt);
 
-      return;
+      mRegCacheSize[regNum] = byteSize;
+    }
 
-    case WP_WRITE:
-      // Write watchpoint
-      mpHash->add (type, addr, 0);	// No instr for HW matchpoints
+  val = mRegCache[regNum];
+  return  mRegCacheSize[regNum];
 
-      if (traceFlags->traceRsp())
+}	// readRegister ()
+
+
+//! Write a register through the cache to the target
+
+//! A write to x0 is not cached, since the target ignores it and x0 always
+//! reads as zero.
+
+//! @param[in] regNum  GDB number of the register to write
+//! @param[in] val     The value to write
+//! @return  The size of the register in bytes, as from the target.
+
+template <class TARGET>
+std::size_t
+GdbServerImpl<TARGET>::writeRegister (int  regNum,
+				      uint_reg_t  val)
+{
+  std::size_t  byteSize;
+
+  {
+    ServerStats::Timer  timer (mStats->target (ServerStats::WRITE_REGISTER));
+
+    byteSize = cpu->writeRegister (regNum, val);
+  }
+
+  if ((regNum >= 0) && (regNum < RISCV_NUM_REGS))
+    {
+      if ((0 == regNum) || (0 == byteSize) || (byteSize > sizeof (uint_reg_t)))
+	mRegCacheSize[regNum] = 0;
+      else
 	{
-	  cout << "RSP trace: write watchpoint set at 0x"
-	       << hex << addr << dec << endl;
+	  mRegCache[regNum] = val;
+	  mRegCacheSize[regNum] = byteSize;
 	}
+    }
 
-      pkt->packStr ("");		// TODO: Not yet implemented
-      rsp->putPkt (pkt);
+  return  byteSize;
 
-      return;
+}	// writeRegister ()
 
-    case WP_READ:
-      // Read watchpoint
-      mpHash->add (type, addr, 0);	// No instr for HW matchpoints
 
-      if (traceFlags->traceRsp())
+//! Forget all cached registers and memory
+
+//! Needed whenever the target may have changed its state behind our back:
+//! when it runs, is reset or is given a command we don't understand.
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::invalidateCaches ()
+{
+  for (int  regNum = 0; regNum < RISCV_NUM_REGS; regNum++)
+    mRegCacheSize[regNum] = 0;
+
+  mMemCache->invalidate ();
+
+}	// invalidateCaches ()
+
+
+//! Resume the target, invalidating anything we have cached
+
+//! @param[in] step  How to resume
+//! @return  Why the target stopped
+
+template <class TARGET>
+ITarget::ResumeRes
+GdbServerImpl<TARGET>::resumeTarget (ITarget::ResumeType  step)
+{
+  invalidateCaches ();
+
+  ServerStats::RunTimer  timer (mStats, cpu);
+
+  return  cpu->resume (step);
+
+}	// resumeTarget ()
+
+
+//! Resume the target with a timeout, invalidating anything we have cached
+
+//! @param[in] step     How to resume
+//! @param[in] timeout  Longest to run for
+//! @return  Why the target stopped
+
+template <class TARGET>
+ITarget::ResumeRes
+GdbServerImpl<TARGET>::resumeTarget (ITarget::ResumeType  step,
+				     duration <double>  timeout)
+{
+  invalidateCaches ();
+
+  ServerStats::RunTimer  timer (mStats, cpu);
+
+  return  cpu->resume (step, timeout);
+
+}	// resumeTarget ()
+
+
+//! Resume the target with a budget, invalidating anything we have cached
+
+//! @param[in] step    How to resume
+//! @param[in] budget  Budget of work for the target
+//! @return  Why the target stopped
+
+template <class TARGET>
+ITarget::ResumeRes
+GdbServerImpl<TARGET>::resumeTarget (ITarget::ResumeType  step,
+				     uint64_t  budget)
+{
+  invalidateCaches ();
+
+  ServerStats::RunTimer  timer (mStats, cpu);
+
+  return  cpu->resume (step, budget);
+
+}	// resumeTarget ()
+
+
+//! Trace the speed of the model while it runs
+
+//! At the start of a run, we just note where the counts and clock are.
+//! After each slice, once speedTraceInterval has passed, we report the speed
+//! since the last report.
+
+//! @param[in] start  TRUE at the start of a run, FALSE after a slice
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::traceSpeed (bool  start)
+{
+  if (!traceFlags->traceSpeed ())
+    return;
+
+  time_point <system_clock, duration <double> >  now = system_clock::now ();
+  uint64_t  cycles = cpu->getCycleCount ();
+  uint64_t  instrs = cpu->getInstrCount ();
+
+  if (!start)
+    {
+      duration <double>  elapsed = now - mSpeedTraceTime;
+
+      if (elapsed < speedTraceInterval)
+	return;
+
+      double  secs = elapsed.count ();
+
+      cout << "Speed trace: " << std::fixed << std::setprecision (3)
+	   << (static_cast<double> (cycles - mSpeedTraceCycles) / secs / 1.0e6)
+	   << " MHz, " << std::setprecision (1)
+	   << (static_cast<double> (instrs - mSpeedTraceInstrs) / secs / 1.0e3)
+	   << " KIPS" << endl;
+    }
+
+  mSpeedTraceTime   = now;
+  mSpeedTraceCycles = cycles;
+  mSpeedTraceInstrs = instrs;
+
+}	// traceSpeed ()
+
+
+//! Size the budget of the next slice of a continue
+
+//! We want a slice to take about interruptTimeout, so we still notice an
+//! interrupt from GDB promptly, while not looking at the clock inside the
+//! target.  A slice that was quick doubles the budget, so we soon reach a
+//! sensible size however fast the target, while one that was slow scales it
+//! straight down.
+
+//! @param[in] elapsed  How long the last slice, which used its whole budget,
+//!                     took
+
+template <class TARGET>
+void
+GdbServerImpl<TARGET>::adaptSlice (duration <double>  elapsed)
+{
+  if (elapsed > interruptTimeout)
+    {
+      uint64_t  budget = static_cast<uint64_t> (mSliceBudget
+						* (interruptTimeout / elapsed));
+
+      if (budget < MIN_SLICE_BUDGET)
+	mSliceBudget = MIN_SLICE_BUDGET;
+      else
+	mSliceBudget = budget;
+    }
+  else if ((elapsed < interruptTimeout / 2)
+	   && (mSliceBudget < MAX_SLICE_BUDGET))
+    mSliceBudget *= 2;
+
+}	// adaptSlice ()
+
+
+//! Ask the target to hold a matchpoint
+
+//! Targets hold watchpoints a byte at a time, so a watchpoint is inserted
+//! for each byte of the region, and all are taken out again if any fail.
+//! Watchpoints may overlap, so we count those covering each byte, and only
+//! ask the target to watch a byte when the first of them is inserted.
+
+//! A target which reads memory in blocks can't tell which bytes of a block
+//! were wanted, so we refuse a read or access watchpoint which doesn't cover
+//! whole blocks, rather than have it hit by reads of its neighbours.  GDB
+//! then falls back as for any watchpoint the target can't hold.
+
+//! @param[in] matchType  Type of matchpoint
+//! @param[in] addr       Address of the matchpoint
+//! @param[in] len        Length of the matchpoint
+//! @return  TRUE if the target is now holding the matchpoint.
+
+template <class TARGET>
+bool
+GdbServerImpl<TARGET>::targetInsertMatchpoint (ITarget::MatchType  matchType,
+					       uint32_t  addr,
+					       std::size_t  len)
+{
+  if ((ITarget::MatchType::BREAK == matchType)
+      || (ITarget::MatchType::BREAK_HW == matchType))
+    return  cpu->insertMatchpoint (addr, matchType);
+
+  if ((ITarget::MatchType::WATCH_READ == matchType)
+      || (ITarget::MatchType::WATCH_ACCESS == matchType))
+    {
+      std::size_t  granule = cpu->readGranule ();
+
+      if ((0 != addr % granule) || (0 != len % granule))
+	return  false;
+    }
+
+  MpType  mpType = static_cast<MpType> (matchType);
+
+  for (std::size_t  i = 0; i < len; i++)
+    {
+      auto  key = std::make_pair (mpType, static_cast<uint32_t> (addr + i));
+      auto  it  = mWatchedBytes.find (key);
+
+      if (it != mWatchedBytes.end ())
+	it->second++;
+      else if (cpu->insertMatchpoint (addr + i, matchType))
+	mWatchedBytes[key] = 1;
+      else
 	{
-	  cout << "RSP trace: read watchpoint set at 0x"
-	       << hex << addr << dec << endl;
+	  (void) targetRemoveMatchpoint (matchType, addr, i);
+	  return  false;
 	}
+    }
 
-      pkt->packStr ("");		// TODO: Not yet implemented
-      rsp->putPkt (pkt);
+  return  len > 0;
 
-      return;
+}	// targetInsertMatchpoint ()
 
-    case WP_ACCESS:
-      // Access (read/write) watchpoint
-      mpHash->add (type, addr, 0);	// No instr for HW matchpoints
 
-      if (traceFlags->traceRsp())
+//! Ask the target to stop holding a matchpoint
+
+//! @see targetInsertMatchpoint () for how watchpoints are held.  The target
+//! stops watching a byte only once no watchpoint covers it.
+
+//! @param[in] matchType  Type of matchpoint
+//! @param[in] addr       Address of the matchpoint
+//! @param[in] len        Length of the matchpoint
+//! @return  TRUE if the target was holding the matchpoint.
+
+template <class TARGET>
+bool
+GdbServerImpl<TARGET>::targetRemoveMatchpoint (ITarget::MatchType  matchType,
+					       uint32_t  addr,
+					       std::size_t  len)
+{
+  if ((ITarget::MatchType::BREAK == matchType)
+      || (ITarget::MatchType::BREAK_HW == matchType))
+    return  cpu->removeMatchpoint (addr, matchType);
+
+  MpType  mpType = static_cast<MpType> (matchType);
+  bool  res = len > 0;
+
+  for (std::size_t  i = 0; i < len; i++)
+    {
+      auto  it = mWatchedBytes.find (std::make_pair (mpType,
+						      static_cast<uint32_t>
+						      (addr + i)));
+
+      if (it == mWatchedBytes.end ())
+	res = false;
+      else if (0 == --(it->second))
 	{
-	  cout << "RSP trace: access (read/write) watchpoint set at 0x"
-	       << hex << addr << dec << endl;
+	  mWatchedBytes.erase (it);
+	  res = cpu->removeMatchpoint (addr + i, matchType) && res;
 	}
+    }
 
-      pkt->packStr ("");		// TODO: Not yet implemented
-      rsp->putPkt (pkt);
+  return  res;
 
-      return;
+}	// targetRemoveMatchpoint ()
 
-    default:
-      cerr << "Warning: RSP matchpoint type " << type
-	   << "not recognized: ignored"<< endl;
-      pkt->packStr ("E01");
-      rsp->putPkt (pkt);
-      return;
-    }
-}	// rspInsertMatchpoint ()
+
+//! The server for any target, through the general interface, and for the one
+//! target a single target server is specialized for.
+
+template class GdbServerImpl<ITarget>;
+
+#ifdef HAVE_SINGLE_TARGET
+template class GdbServerImpl<SingleTarget>;
+#endif
 
 
 //! Output operator for TargetSignal enumeration
@@ -1795,18 +3631,19 @@ GdbServerImpl::rspInsertMatchpoint ()
 
 std::ostream &
 operator<< (std::ostream & s,
-	    GdbServerImpl::TargetSignal  p)
+	    AbstractGdbServerImpl::TargetSignal  p)
 {
+  typedef AbstractGdbServerImpl::TargetSignal  TargetSignal;
   const char * name;
 
   switch (p)
     {
-    case GdbServerImpl::TargetSignal::NONE:    name = "SIGNONE";    break;
-    case GdbServerImpl::TargetSignal::INT:     name = "SIGINT";     break;
-    case GdbServerImpl::TargetSignal::TRAP:    name = "SIGTRAP";    break;
-    case GdbServerImpl::TargetSignal::XCPU:    name = "SIGXCPU";    break;
-    case GdbServerImpl::TargetSignal::UNKNOWN: name = "SIGUNKNOWN"; break;
-    default:                                   name = "unknown";    break;
+    case TargetSignal::NONE:    name = "SIGNONE";    break;
+    case TargetSignal::INT:     name = "SIGINT";     break;
+    case TargetSignal::TRAP:    name = "SIGTRAP";    break;
+    case TargetSignal::XCPU:    name = "SIGXCPU";    break;
+    case TargetSignal::UNKNOWN: name = "SIGUNKNOWN"; break;
+    default:                    name = "unknown";    break;
     }
 
   return  s << name;
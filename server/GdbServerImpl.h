@@ -23,11 +23,19 @@
 #ifndef GDB_SERVER_IMPL_H
 #define GDB_SERVER_IMPL_H
 
+#include <atomic>
 #include <chrono>
 #include <cstdio>
+#include <deque>
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
+#include <map>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
 
 // General interface to targets
 
@@ -35,42 +43,52 @@
 
 // Class headers
 
+#include "BatchRunner.h"
+#include "BreakWatcher.h"
 #include "GdbServer.h"
+#include "HartGroup.h"
+#include "MemCache.h"
 #include "MpHash.h"
+#include "Profile.h"
 #include "RspConnection.h"
 #include "RspPacket.h"
+#include "ServerStats.h"
 #include "TraceFlags.h"
 #include "RegisterSizes.h"
 
 
-//! Module implementing a GDB RSP server.
+//! The interface to the GDB RSP server implementation
 
-//! A loop listens for RSP requests, which are converted to requests to read
-//! and write registers, read and write memory, or control the CPU
+//! The server may be specialized for the class of its target, so GdbServer
+//! holds it through this interface, which does not depend on the class.
 
-class GdbServerImpl
+class AbstractGdbServerImpl
 {
 public:
 
-  // Constructor and destructor
+  // Destructor
 
-  GdbServerImpl (AbstractConnection * _conn,
-		 ITarget * _cpu,
-		 TraceFlags * _traceFlags,
-		 GdbServer::KillBehaviour _killBehaviour);
-  ~GdbServerImpl ();
+  virtual ~AbstractGdbServerImpl () {};
 
   // Main loop to listen for and service RSP requests.
 
-  int  rspServer ();
+  virtual int  rspServer () = 0;
 
   // Callback for target to use
 
-  bool command (const std::string  cmd,
-		std::ostream & stream);
+  virtual bool command (const std::string  cmd,
+			std::ostream & stream) = 0;
 
+  // Are we still holding any matchpoints?
+
+  virtual bool holdingMatchpoints () const = 0;
+
+  // Dump the statistics as JSON
+
+  virtual void dumpStats (std::ostream & stream) const = 0;
 
-private:
+
+protected:
 
   //! Definition of GDB target signals.
 
@@ -82,10 +100,58 @@ private:
     UNKNOWN = 143
   };
 
-  // stream operator has to be a friend to access private members
+  // stream operator has to be a friend to access protected members
 
   friend std::ostream & operator<< (std::ostream & s,
-				    GdbServerImpl::TargetSignal  p);
+				    AbstractGdbServerImpl::TargetSignal  p);
+
+};	// AbstractGdbServerImpl ()
+
+
+//! Module implementing a GDB RSP server.
+
+//! A loop listens for RSP requests, which are converted to requests to read
+//! and write registers, read and write memory, or control the CPU
+
+//! TARGET is the class of the CPU.  In general it is ITarget, and every call
+//! to the CPU is virtual.  When configured for a single target, there is
+//! also a server for the concrete class of that target, through which those
+//! calls are direct, and may be inlined.  The instances are in
+//! GdbServerImpl.cpp.
+
+template <class TARGET>
+class GdbServerImpl final : public AbstractGdbServerImpl
+{
+public:
+
+  // Constructor and destructor
+
+  GdbServerImpl (AbstractConnection * _conn,
+		 TARGET * _cpu,
+		 TraceFlags * _traceFlags,
+		 GdbServer::KillBehaviour _killBehaviour,
+		 int _pktSize);
+  ~GdbServerImpl ();
+
+  // Main loop to listen for and service RSP requests.
+
+  virtual int  rspServer ();
+
+  // Callback for target to use
+
+  virtual bool command (const std::string  cmd,
+			std::ostream & stream);
+
+  // Are we still holding any matchpoints?
+
+  virtual bool holdingMatchpoints () const;
+
+  // Dump the statistics as JSON
+
+  virtual void dumpStats (std::ostream & stream) const;
+
+
+private:
 
   // For now these are hard-coded constants, but they need to be made
   // configurable.
@@ -94,18 +160,31 @@ private:
 
   static const int RISCV_NUM_REGS = 33;
 
+  //! GDB register number of the PC
+
+  static const int RISCV_PC_REGNUM = 32;
+
+  //! GDB register numbers of the return address, stack pointer and frame
+  //! pointer, which along with the PC are expedited in stop replies.
+
+  static const int RISCV_RA_REGNUM = 1;
+  static const int RISCV_SP_REGNUM = 2;
+  static const int RISCV_FP_REGNUM = 8;
+
   //! Total bytes taken by regs. 4 bytes for each
 
   static const int RISCV_NUM_REG_BYTES = RISCV_NUM_REGS * sizeof (uint_reg_t);
 
   //! Minimum packet size for RSP. Must be large enough for any initial
   //! dialogue. Should at least allow all the registers ASCII encloded + end of
-  //! string marker.
+  //! string marker.  The actual packet size is set when the server is
+  //! created, and may be much larger.
 
   static const int RSP_PKT_SIZE = (RISCV_NUM_REG_BYTES * 2 + 1) < 256
 				    ? 256 : RISCV_NUM_REG_BYTES * 2 + 1;
 
-  //! Constant for a thread id
+  //! Constant for a thread id, when we have a single hart.  With several
+  //! harts, each hart's thread id is one more than its number.
 
   static const int  DUMMY_TID = 1;
 
@@ -113,13 +192,25 @@ private:
 
   static const uint32_t  BREAK_INSTR = 0x100073;
 
+  //! Constant for a compressed breakpoint (C.EBREAK).
+
+  static const uint32_t  C_BREAK_INSTR = 0x9002;
+
   //! Constant which is the sample period (in instruction steps) during
   //! "continue" etc.
 
   static const int RUN_SAMPLE_PERIOD = 10000;
 
+  //! How long (in milliseconds) to wait for a packet while the target runs
+  //! in non-stop mode, before looking to see if it has stopped.
+
+  static const int NON_STOP_POLL_MS = 10;
+
   //! Our associated simulated CPU
-  ITarget * cpu;
+  TARGET * cpu;
+
+  //! The same CPU, if it is a group of harts, NULL otherwise
+  HartGroup * mHarts;
 
   //! Our trace flags
   TraceFlags *traceFlags;
@@ -131,9 +222,38 @@ private:
   //! there is no need to repeatedly allocate and delete it.
   RspPacket *pkt;
 
-  //! Hash table for matchpoints
+  //! Buffer for bulk memory transfers, so each memory packet needs just one
+  //! target access.  The same size as the packet buffer.
+  uint8_t *mMemBuf;
+
+  //! Hash table for breakpoints.  Watchpoints are not held here, since GDB
+  //! may insert several at one address with different lengths.
   MpHash *mpHash;
 
+  //! The watchpoints we hold, by type, address and length
+  std::set<std::tuple<MpType, uint32_t, std::size_t> >  mWatchpoints;
+
+  //! How many watchpoints cover each byte the target is watching, by type
+  //! and address.  The target holds one watch for each byte, however many
+  //! watchpoints cover it.
+  std::map<std::pair<MpType, uint32_t>, int>  mWatchedBytes;
+
+  //! Cache of target memory while the target is stopped
+  MemCache<TARGET> *mMemCache;
+
+  //! Watches for a break from the client while the target runs
+  BreakWatcher *mBreakWatcher;
+
+  //! Counts and times of packets and calls to the target
+  ServerStats *mStats;
+
+  //! PC samples taken by the target as it runs.  The target has it for as
+  //! long as we do, and samples only while it is on.
+  Profile *mProfile;
+
+  //! The document being read by qXfer, made when the first piece is read
+  std::string  mXferDoc;
+
   //! Timeout for continue.
   std::chrono::duration<double> mTimeout;
 
@@ -141,6 +261,25 @@ private:
   //! check for an interrupt from GDB.
   static const std::chrono::duration <double> interruptTimeout;
 
+  //! How often to report the speed of the model while it runs, when tracing
+  //! it.
+  static const std::chrono::duration <double> speedTraceInterval;
+
+  //! When we last traced the speed of the model, and the counts then.
+  std::chrono::time_point <std::chrono::system_clock,
+			   std::chrono::duration <double> >  mSpeedTraceTime;
+  uint64_t  mSpeedTraceCycles;
+  uint64_t  mSpeedTraceInstrs;
+
+  //! Limits and starting point for the budget of each slice of a continue,
+  //! which we adjust so a slice takes about interruptTimeout.
+  static const uint64_t MIN_SLICE_BUDGET = 1000;
+  static const uint64_t MAX_SLICE_BUDGET = 1ULL << 32;
+  static const uint64_t INITIAL_SLICE_BUDGET = 100000;
+
+  //! The budget of the next slice of a continue.
+  uint64_t mSliceBudget;
+
   //! How to behave when we get a kill (k) packet.
   GdbServer::KillBehaviour killBehaviour;
 
@@ -148,6 +287,61 @@ private:
 
   bool mExitServer;
 
+  //! Whether the client understands swbreak and hwbreak stop reasons
+
+  bool mClientSwbreak;
+  bool mClientHwbreak;
+
+  //! Whether the client has asked for non-stop mode
+
+  bool mNonStop;
+
+  //! In non-stop mode, the thread which runs the target for a continue, so
+  //! we can deal with packets meanwhile.  It is joinable from when the
+  //! target starts until we have reported its stop.
+
+  std::thread  mRunner;
+
+  //! Set by the runner when the target has stopped
+
+  std::atomic<bool>  mRunning;
+
+  //! Set to ask the runner to stop the target
+
+  std::atomic<bool>  mStopRequested;
+
+  //! Why the target stopped, and with what signal if it ran out of time or
+  //! was asked to stop.  Set by the runner before it clears mRunning.
+
+  ITarget::ResumeRes  mStopRes;
+  TargetSignal  mStopSig;
+
+  //! In non-stop mode a stop notification can't be an F request, so we
+  //! service syscalls ourselves, just as when running without a client.
+
+  BatchRunner *mSyscalls;
+
+  //! Held by the runner for each slice, and by us for each packet we deal
+  //! with while the target runs, so the target is never used by both.
+
+  std::mutex  mTargetMutex;
+
+  //! How many threads are waiting for mTargetMutex, so that the runner can
+  //! give way to them between slices.
+
+  std::atomic<int>  mTargetWaiters;
+
+  //! Harts whose stops are still to be reported in reply to vStopped
+
+  std::deque<int>  mStopQueue;
+
+  //! Cache of the registers while the target is stopped, so repeated queries
+  //! do not each go to the target.  A size of zero means the register is not
+  //! cached.  Invalidated whenever the target may have run.
+
+  uint_reg_t  mRegCache[RISCV_NUM_REGS];
+  std::size_t  mRegCacheSize[RISCV_NUM_REGS];
+
   //! What to do when we get a syscall reply.
   enum SyscallContinuationType
     {
@@ -162,15 +356,31 @@ private:
   // Handle the various RSP requests
   int   stringLength (uint32_t addr);
   void  rspSyscallRequest (SyscallContinuationType);
+  void  rspNonStopSyscall (SyscallContinuationType  cType);
   void  rspSyscallReply ();
-  void  rspReportException (TargetSignal  sig = TargetSignal::TRAP);
+  void  rspReportException (TargetSignal  sig = TargetSignal::TRAP,
+			    bool  atBreak = false);
+  void  rspBuildStop (TargetSignal  sig,
+		      bool  atBreak);
+  void  rspSendStop ();
+  char *rspExpediteRegs (char *buf);
+  char *rspStopThread (char *buf);
+  void  rspReportWatchpoint ();
   void  rspReadAllRegs ();
   void  rspWriteAllRegs ();
   void  rspReadMem ();
+  void  rspReadMemBin ();
   void  rspWriteMem ();
   void  rspReadReg ();
   void  rspWriteReg ();
   void  rspQuery ();
+  void  rspSetThread ();
+  void  rspThreadAlive ();
+  bool  selectStepThread (const char *tidStr);
+  bool  continuesAllThreads (const char *actions) const;
+  int   currentTid () const;
+  void  rspCrc ();
+  void  rspXferBtrace ();
   void  rspCommand ();
   void  rspSetCommand (const char* cmd);
   void  rspShowCommand (const char* cmd);
@@ -181,7 +391,38 @@ private:
   void  rspRemoveMatchpoint ();
   void  rspInsertMatchpoint ();
   void  rspContinue ();
+  void  runContinue ();
+  void  rspNonStopService ();
+  void  rspNonStopStatus ();
+  void  rspNotifyStop ();
+  void  rspStopped ();
+  void  queueOtherStops ();
+  bool  nonStopStep ();
+  void  startRunner ();
+  void  stopRunner ();
+  void  runNonStop (std::chrono::time_point<std::chrono::system_clock,
+		    std::chrono::duration<double> >  deadline);
   void  rspSingleStep ();
+  void  rspRangeStep (uint32_t  start,
+		      uint32_t  end);
+  std::size_t  readRegister (int  regNum,
+			     uint_reg_t & val);
+  std::size_t  writeRegister (int  regNum,
+			      uint_reg_t  val);
+  void  invalidateCaches ();
+  ITarget::ResumeRes  resumeTarget (ITarget::ResumeType  step);
+  ITarget::ResumeRes  resumeTarget (ITarget::ResumeType  step,
+				    std::chrono::duration <double>  timeout);
+  ITarget::ResumeRes  resumeTarget (ITarget::ResumeType  step,
+				    uint64_t  budget);
+  void  adaptSlice (std::chrono::duration <double>  elapsed);
+  void  traceSpeed (bool  start);
+  bool  targetInsertMatchpoint (ITarget::MatchType  matchType,
+				uint32_t  addr,
+				std::size_t  len);
+  bool  targetRemoveMatchpoint (ITarget::MatchType  matchType,
+				uint32_t  addr,
+				std::size_t  len);
 
 };	// GdbServerImpl ()
 
@@ -0,0 +1,724 @@
+// Group of harts presented as one target: definition
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <chrono>
+
+#include "HartGroup.h"
+
+using std::chrono::duration;
+
+
+//! How often we look at the server's break flag while the harts run.  The
+//! harts themselves only look at our halt flag.
+
+static const std::chrono::milliseconds  breakCheckPeriod (1);
+
+
+//! The hart run by this thread, if it is a worker
+
+thread_local ITarget * HartGroup::sWorkerHart = nullptr;
+
+
+//! Constructor
+
+//! Each hart is given our halt flag to watch, and a worker thread to run it.
+//! Hart 0 starts as the current hart.
+
+//! @param[in] _harts  The harts, which we now own.  There must be at least
+//!                    one.
+//! @param[in] flags   Our trace flags
+
+HartGroup::HartGroup (const std::vector<ITarget *> & _harts,
+		      const TraceFlags * flags) :
+  ITarget (flags),
+  mHarts (_harts),
+  mCurrent (0),
+  mStepHart (-1),
+  mBreakFlag (nullptr),
+  mHalt (false),
+  mGeneration (0),
+  mRunning (0),
+  mQuit (false),
+  mResults (_harts.size (), ResumeRes::NONE)
+{
+  for (std::size_t  i = 0; i < mHarts.size (); i++)
+    {
+      mHarts[i]->breakFlag (&mHalt);
+      mWorkers.push_back (std::thread (&HartGroup::worker, this,
+				       static_cast<int> (i)));
+    }
+}	// HartGroup::HartGroup ()
+
+
+//! Destructor
+
+//! Stop the workers, then delete the harts.
+
+HartGroup::~HartGroup ()
+{
+  {
+    std::lock_guard<std::mutex>  lock (mMutex);
+
+    mQuit = true;
+  }
+
+  mStartCond.notify_all ();
+
+  for (auto  it = mWorkers.begin (); it != mWorkers.end (); it++)
+    it->join ();
+
+  for (auto  it = mHarts.begin (); it != mHarts.end (); it++)
+    delete  *it;
+
+}	// HartGroup::~HartGroup ()
+
+
+//! How many harts do we have?
+
+//! @return  The number of harts
+
+int
+HartGroup::numHarts () const
+{
+  return  static_cast<int> (mHarts.size ());
+
+}	// HartGroup::numHarts ()
+
+
+//! Which is the current hart?
+
+//! @return  The number of the current hart, counting from 0.
+
+int
+HartGroup::currentHart () const
+{
+  return  mCurrent;
+
+}	// HartGroup::currentHart ()
+
+
+//! Choose the current hart
+
+//! @param[in] hart  The hart to use, counting from 0
+//! @return  TRUE if there is such a hart, FALSE otherwise.
+
+bool
+HartGroup::selectHart (int  hart)
+{
+  if ((hart < 0) || (hart >= numHarts ()))
+    return  false;
+
+  mCurrent = hart;
+  return  true;
+
+}	// HartGroup::selectHart ()
+
+
+//! Choose the hart to step
+
+//! @param[in] hart  The hart to step, counting from 0, or -1 to step the
+//!                  current hart.
+//! @return  TRUE if there is such a hart, FALSE otherwise.
+
+bool
+HartGroup::selectStepHart (int  hart)
+{
+  if ((hart < -1) || (hart >= numHarts ()))
+    return  false;
+
+  mStepHart = hart;
+  return  true;
+
+}	// HartGroup::selectStepHart ()
+
+
+//! Which hart does this thread run?
+
+//! A model may ask for the time (for example for $time in its Verilog) from
+//! whichever thread is running it, so it needs to know which hart that is.
+
+//! @return  The hart, or NULL if this is not one of our worker threads.
+
+ITarget *
+HartGroup::workerHart ()
+{
+  return  sWorkerHart;
+
+}	// HartGroup::workerHart ()
+
+
+//! Say which target this thread runs
+
+//! For threads other than our workers which run a model, such as the
+//! server's non-stop runner, so the model can still find itself.
+
+//! @param[in] hart  The target this thread runs
+
+void
+HartGroup::workerHart (ITarget * hart)
+{
+  sWorkerHart = hart;
+
+}	// HartGroup::workerHart ()
+
+
+//! Resume execution with no timeout
+
+//! @param[in] step  The type of resume
+//! @return  Why the target stopped.
+
+ITarget::ResumeRes
+HartGroup::resume (ResumeType step)
+{
+  switch (step)
+    {
+    case ResumeType::CONTINUE:
+      return  runAll ([] (ITarget * hart) {
+	  return  hart->resume (ResumeType::CONTINUE);
+	});
+
+    case ResumeType::STOP:
+      for (auto  it = mHarts.begin (); it != mHarts.end (); it++)
+	(void) (*it)->resume (ResumeType::STOP);
+
+      return  ResumeRes::SUCCESS;
+
+    default:
+      return  stepTarget ()->resume (step);
+    }
+}	// HartGroup::resume ()
+
+
+//! Resume execution with a timeout
+
+//! @param[in] step     The type of resume
+//! @param[in] timeout  How long each hart may run for
+//! @return  Why the target stopped.
+
+ITarget::ResumeRes
+HartGroup::resume (ResumeType step,
+		   duration <double>  timeout)
+{
+  switch (step)
+    {
+    case ResumeType::CONTINUE:
+      return  runAll ([timeout] (ITarget * hart) {
+	  return  hart->resume (ResumeType::CONTINUE, timeout);
+	});
+
+    case ResumeType::STOP:
+      return  resume (step);
+
+    default:
+      return  stepTarget ()->resume (step, timeout);
+    }
+}	// HartGroup::resume ()
+
+
+//! Resume execution with a budget
+
+//! Each hart has the whole budget, so the harts advance together.
+
+//! @param[in] step    The type of resume
+//! @param[in] budget  The budget of each hart
+//! @return  Why the target stopped.
+
+ITarget::ResumeRes
+HartGroup::resume (ResumeType step,
+		   uint64_t  budget)
+{
+  switch (step)
+    {
+    case ResumeType::CONTINUE:
+      return  runAll ([budget] (ITarget * hart) {
+	  return  hart->resume (ResumeType::CONTINUE, budget);
+	});
+
+    case ResumeType::STOP:
+      return  resume (step);
+
+    default:
+      return  stepTarget ()->resume (step, budget);
+    }
+}	// HartGroup::resume ()
+
+
+//! Terminate every hart
+
+//! @return  The result of terminating the current hart
+
+ITarget::ResumeRes
+HartGroup::terminate ()
+{
+  ResumeRes  res = ResumeRes::NONE;
+
+  for (int  i = 0; i < numHarts (); i++)
+    {
+      ResumeRes  hartRes = mHarts[i]->terminate ();
+
+      if (i == mCurrent)
+	res = hartRes;
+    }
+
+  return  res;
+
+}	// HartGroup::terminate ()
+
+
+//! Reset every hart
+
+//! @param[in] type  The type of reset
+//! @return  SUCCESS if every hart reset, FAILURE otherwise.
+
+ITarget::ResumeRes
+HartGroup::reset (ResetType  type)
+{
+  ResumeRes  res = ResumeRes::SUCCESS;
+
+  for (auto  it = mHarts.begin (); it != mHarts.end (); it++)
+    if (ResumeRes::SUCCESS != (*it)->reset (type))
+      res = ResumeRes::FAILURE;
+
+  return  res;
+
+}	// HartGroup::reset ()
+
+
+//! Cycle count of the current hart
+
+//! @return  The cycle count
+
+uint64_t
+HartGroup::getCycleCount () const
+{
+  return  mHarts[mCurrent]->getCycleCount ();
+
+}	// HartGroup::getCycleCount ()
+
+
+//! Instruction count of the current hart
+
+//! @return  The instruction count
+
+uint64_t
+HartGroup::getInstrCount () const
+{
+  return  mHarts[mCurrent]->getInstrCount ();
+
+}	// HartGroup::getInstrCount ()
+
+
+//! Read a register of the current hart
+
+//! @param[in]  reg    The register to read
+//! @param[out] value  The value read
+//! @return  The size of the register, or zero on failure
+
+std::size_t
+HartGroup::readRegister (const int  reg,
+			 uint_reg_t & value) const
+{
+  return  mHarts[mCurrent]->readRegister (reg, value);
+
+}	// HartGroup::readRegister ()
+
+
+//! Write a register of the current hart
+
+//! @param[in] reg    The register to write
+//! @param[in] value  The value to write
+//! @return  The size of the register, or zero on failure
+
+std::size_t
+HartGroup::writeRegister (const int  reg,
+			  const uint_reg_t  value)
+{
+  return  mHarts[mCurrent]->writeRegister (reg, value);
+
+}	// HartGroup::writeRegister ()
+
+
+//! Read memory of the current hart
+
+//! @param[in]  addr    Where to read from
+//! @param[out] buffer  Where to put the data
+//! @param[in]  size    How many bytes to read
+//! @return  The number of bytes read
+
+std::size_t
+HartGroup::read (const uint32_t  addr,
+		 uint8_t * buffer,
+		 const std::size_t  size) const
+{
+  return  mHarts[mCurrent]->read (addr, buffer, size);
+
+}	// HartGroup::read ()
+
+
+//! Write memory of every hart
+
+//! @param[in] addr    Where to write to
+//! @param[in] buffer  The data to write
+//! @param[in] size    How many bytes to write
+//! @return  The fewest bytes written to any hart
+
+std::size_t
+HartGroup::write (const uint32_t  addr,
+		  const uint8_t * buffer,
+		  const std::size_t  size)
+{
+  std::size_t  res = size;
+
+  for (auto  it = mHarts.begin (); it != mHarts.end (); it++)
+    {
+      std::size_t  hartRes = (*it)->write (addr, buffer, size);
+
+      if (hartRes < res)
+	res = hartRes;
+    }
+
+  return  res;
+
+}	// HartGroup::write ()
+
+
+//! Insert a matchpoint in every hart
+
+//! If any hart fails, the matchpoint is removed from those which succeeded.
+
+//! @param[in] addr       Address for the matchpoint
+//! @param[in] matchType  Type of breakpoint or watchpoint
+//! @return  TRUE if every hart took the matchpoint, FALSE otherwise.
+
+bool
+HartGroup::insertMatchpoint (const uint32_t  addr,
+			     const MatchType  matchType)
+{
+  for (std::size_t  i = 0; i < mHarts.size (); i++)
+    if (!mHarts[i]->insertMatchpoint (addr, matchType))
+      {
+	while (i-- > 0)
+	  (void) mHarts[i]->removeMatchpoint (addr, matchType);
+
+	return  false;
+      }
+
+  return  true;
+
+}	// HartGroup::insertMatchpoint ()
+
+
+//! Remove a matchpoint from every hart
+
+//! @param[in] addr       Address for the matchpoint
+//! @param[in] matchType  Type of breakpoint or watchpoint
+//! @return  TRUE if every hart removed the matchpoint, FALSE otherwise.
+
+bool
+HartGroup::removeMatchpoint (const uint32_t  addr,
+			     const MatchType  matchType)
+{
+  bool  res = true;
+
+  for (auto  it = mHarts.begin (); it != mHarts.end (); it++)
+    res = (*it)->removeMatchpoint (addr, matchType) && res;
+
+  return  res;
+
+}	// HartGroup::removeMatchpoint ()
+
+
+//! The last watchpoint hit by the current hart
+
+//! After a continue, the current hart is the one which stopped.
+
+//! @param[out] addr       The address accessed
+//! @param[out] matchType  The type of watchpoint hit
+//! @return  TRUE if there was such a watchpoint, FALSE otherwise.
+
+bool
+HartGroup::lastWatchpoint (uint32_t & addr,
+			   MatchType & matchType) const
+{
+  return  mHarts[mCurrent]->lastWatchpoint (addr, matchType);
+
+}	// HartGroup::lastWatchpoint ()
+
+
+//! The size of the block of memory read together by the current hart
+
+//! @return  The size of the block
+
+std::size_t
+HartGroup::readGranule () const
+{
+  return  mHarts[mCurrent]->readGranule ();
+
+}	// HartGroup::readGranule ()
+
+
+//! Save a snapshot of every hart
+
+//! @return  TRUE if every hart was saved, FALSE otherwise.
+
+bool
+HartGroup::saveSnapshot ()
+{
+  bool  res = true;
+
+  for (auto  it = mHarts.begin (); it != mHarts.end (); it++)
+    res = (*it)->saveSnapshot () && res;
+
+  return  res;
+
+}	// HartGroup::saveSnapshot ()
+
+
+//! Restore every hart from its snapshot
+
+//! @return  TRUE if every hart was restored, FALSE otherwise.
+
+bool
+HartGroup::restoreSnapshot ()
+{
+  bool  res = true;
+
+  for (auto  it = mHarts.begin (); it != mHarts.end (); it++)
+    res = (*it)->restoreSnapshot () && res;
+
+  return  res;
+
+}	// HartGroup::restoreSnapshot ()
+
+
+//! Pass a command to the current hart
+
+//! @param[in] cmd     The command
+//! @param[in] stream  Where to write any output
+//! @return  TRUE if the command was recognized, FALSE otherwise.
+
+bool
+HartGroup::command (const std::string  cmd,
+		    std::ostream & stream)
+{
+  return  mHarts[mCurrent]->command (cmd, stream);
+
+}	// HartGroup::command ()
+
+
+//! Tell every hart about the server
+
+//! @param[in] server  The server using us
+
+void
+HartGroup::gdbServer (GdbServer *server)
+{
+  for (auto  it = mHarts.begin (); it != mHarts.end (); it++)
+    (*it)->gdbServer (server);
+
+}	// HartGroup::gdbServer ()
+
+
+//! Record the server's flag telling us to stop
+
+//! The harts keep watching our halt flag, which we set if this one is set
+//! while they run (@see runAll ()).
+
+//! @param[in] flag  The flag to watch while running, or NULL if none.
+
+void
+HartGroup::breakFlag (const std::atomic<bool> * flag)
+{
+  mBreakFlag = flag;
+
+}	// HartGroup::breakFlag ()
+
+
+//! Start or stop recording the instructions of the current hart
+
+//! GDB asks for branch trace a thread at a time.
+
+//! @param[in] on  TRUE to start recording instructions, FALSE to stop
+//! @return  TRUE if the hart can record instructions, FALSE otherwise.
+
+bool
+HartGroup::traceInsns (bool  on)
+{
+  return  mHarts[mCurrent]->traceInsns (on);
+
+}	// HartGroup::traceInsns ()
+
+
+//! The instructions recorded by the current hart
+
+//! @return  The instructions recorded, or NULL if none have been
+
+const InsnTrace *
+HartGroup::insnTrace () const
+{
+  return  mHarts[mCurrent]->insnTrace ();
+
+}	// HartGroup::insnTrace ()
+
+
+//! Can the instructions recorded by the current hart be given to GDB as
+//! branch trace?
+
+//! @return  TRUE if the hart can give branch trace, FALSE otherwise.
+
+bool
+HartGroup::branchTrace () const
+{
+  return  mHarts[mCurrent]->branchTrace ();
+
+}	// HartGroup::branchTrace ()
+
+
+//! Give all the harts the profile to sample into
+
+//! The profile is of the whole program, so samples from every hart go
+//! into the same histogram.
+
+//! @param[in] prof  The profile to sample into, or NULL if none
+
+void
+HartGroup::profile (Profile * prof)
+{
+  for (auto  it = mHarts.begin (); it != mHarts.end (); it++)
+    (*it)->profile (prof);
+
+}	// HartGroup::profile ()
+
+
+//! The time stamp of the current hart
+
+//! @return  The time stamp
+
+double
+HartGroup::timeStamp ()
+{
+  return  mHarts[mCurrent]->timeStamp ();
+
+}	// HartGroup::timeStamp ()
+
+
+//! The hart to step
+
+//! This becomes the current hart.
+
+//! @return  The hart to step
+
+ITarget *
+HartGroup::stepTarget ()
+{
+  if (-1 != mStepHart)
+    mCurrent = mStepHart;
+
+  return  mHarts[mCurrent];
+
+}	// HartGroup::stepTarget ()
+
+
+//! Run a job on every hart at once
+
+//! Each hart runs on its own worker.  Meanwhile we pass on any break from the
+//! server, by setting the halt flag.  The result is that of the lowest
+//! numbered hart which stopped for a reason of its own, which becomes the
+//! current hart, or TIMEOUT if they all ran out of time or budget, or were
+//! halted.
+
+//! @param[in] job  What to run on each hart
+//! @return  Why we stopped.
+
+ITarget::ResumeRes
+HartGroup::runAll (std::function<ResumeRes (ITarget *)> job)
+{
+  std::unique_lock<std::mutex>  lock (mMutex);
+
+  mHalt.store (false);
+  mJob     = job;
+  mRunning = numHarts ();
+  mGeneration++;
+  mStartCond.notify_all ();
+
+  while (!mDoneCond.wait_for (lock, breakCheckPeriod,
+			      [this] { return  0 == mRunning; }))
+    if ((nullptr != mBreakFlag) && mBreakFlag->load ())
+      mHalt.store (true);
+
+  for (int  i = 0; i < numHarts (); i++)
+    if (ResumeRes::TIMEOUT != mResults[i])
+      {
+	mCurrent = i;
+	return  mResults[i];
+      }
+
+  return  ResumeRes::TIMEOUT;
+
+}	// HartGroup::runAll ()
+
+
+//! A worker thread
+
+//! Wait for each job and run it on our hart.  If the hart stops for a reason
+//! of its own, halt all the others.
+
+//! @param[in] hart  The hart we run
+
+void
+HartGroup::worker (int  hart)
+{
+  uint64_t  generation = 0;
+  std::unique_lock<std::mutex>  lock (mMutex);
+
+  sWorkerHart = mHarts[hart];
+
+  for (;;)
+    {
+      mStartCond.wait (lock, [this, generation] {
+	  return  mQuit || (mGeneration != generation);
+	});
+
+      if (mQuit)
+	return;
+
+      generation = mGeneration;
+      lock.unlock ();
+
+      ResumeRes  res = mJob (mHarts[hart]);
+
+      if (ResumeRes::TIMEOUT != res)
+	mHalt.store (true);
+
+      lock.lock ();
+      mResults[hart] = res;
+
+      if (0 == --mRunning)
+	mDoneCond.notify_one ();
+    }
+}	// HartGroup::worker ()
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,195 @@
+// Group of harts presented as one target: declaration
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef HART_GROUP_H
+#define HART_GROUP_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ITarget.h"
+
+
+//! Several harts, each a target of its own, presented as a single target
+
+//! The server shows each hart to GDB as a thread.  Registers, memory reads
+//! and commands go to the current hart, chosen by the server (@see
+//! selectHart ()).  Each hart has memory of its own, so debugger writes to
+//! memory go to every hart, as do matchpoints, which GDB treats as global.
+
+//! Continuing runs every hart at once, each on a worker thread of our own.
+//! The first hart to stop for a reason of its own halts the rest (through
+//! their break flags), so all the harts are stopped together, and that hart
+//! becomes the current one.  Stepping steps just the hart chosen for
+//! stepping, or the current hart.
+
+//! Every hart is run on a thread other than the one which created it, so
+//! the model must allow this.
+
+class HartGroup : public ITarget
+{
+public:
+
+  // Constructor and destructor
+
+  HartGroup (const std::vector<ITarget *> & _harts,
+	     const TraceFlags * flags);
+  ~HartGroup ();
+
+  // Hart selection.
+
+  int  numHarts () const;
+  int  currentHart () const;
+  bool  selectHart (int  hart);
+  bool  selectStepHart (int  hart);
+  static ITarget * workerHart ();
+  static void  workerHart (ITarget * hart);
+
+  // ITarget interface
+
+  virtual ResumeRes  resume (ResumeType step);
+  virtual ResumeRes  resume (ResumeType step,
+			     std::chrono::duration <double>  timeout);
+  virtual ResumeRes  resume (ResumeType step,
+			     uint64_t  budget);
+  virtual ResumeRes  terminate ();
+  virtual ResumeRes  reset (ResetType  type);
+
+  virtual uint64_t  getCycleCount () const;
+  virtual uint64_t  getInstrCount () const;
+
+  virtual std::size_t  readRegister (const int  reg,
+				     uint_reg_t & value) const;
+  virtual std::size_t  writeRegister (const int  reg,
+				      const uint_reg_t  value);
+  virtual std::size_t  read (const uint32_t  addr,
+			     uint8_t * buffer,
+			     const std::size_t  size) const;
+  virtual std::size_t  write (const uint32_t  addr,
+			      const uint8_t * buffer,
+			      const std::size_t  size);
+
+  virtual bool  insertMatchpoint (const uint32_t  addr,
+				  const MatchType  matchType);
+  virtual bool  removeMatchpoint (const uint32_t  addr,
+				  const MatchType  matchType);
+  virtual bool  lastWatchpoint (uint32_t & addr,
+				MatchType & matchType) const;
+  virtual std::size_t  readGranule () const;
+
+  virtual bool  saveSnapshot ();
+  virtual bool  restoreSnapshot ();
+
+  virtual bool command (const std::string  cmd,
+			std::ostream & stream);
+
+  virtual void gdbServer (GdbServer *server);
+  virtual void breakFlag (const std::atomic<bool> * flag);
+  virtual bool  traceInsns (bool  on);
+  virtual const InsnTrace * insnTrace () const;
+  virtual bool  branchTrace () const;
+  virtual void  profile (Profile * prof);
+
+  virtual double timeStamp ();
+
+private:
+
+  //! The hart run by this thread, if it is one of our workers
+
+  static thread_local ITarget * sWorkerHart;
+
+  //! The harts, which we own
+
+  std::vector<ITarget *>  mHarts;
+
+  //! The current hart
+
+  int  mCurrent;
+
+  //! The hart to step, or -1 to step the current hart
+
+  int  mStepHart;
+
+  //! The server's break flag, if any
+
+  const std::atomic<bool> * mBreakFlag;
+
+  //! The flag every hart watches, set to halt them all
+
+  std::atomic<bool>  mHalt;
+
+  //! Guards the job and its results
+
+  std::mutex  mMutex;
+
+  //! Signalled when there is a new job for the workers, or they must quit
+
+  std::condition_variable  mStartCond;
+
+  //! Signalled when the last worker finishes a job
+
+  std::condition_variable  mDoneCond;
+
+  //! Count of jobs started, so each worker knows when there is a new one
+
+  uint64_t  mGeneration;
+
+  //! How many workers are still running the current job
+
+  int  mRunning;
+
+  //! Set when the workers should exit
+
+  bool  mQuit;
+
+  //! The job each worker runs on its hart
+
+  std::function<ResumeRes (ITarget *)>  mJob;
+
+  //! The result of the job on each hart
+
+  std::vector<ResumeRes>  mResults;
+
+  //! The worker threads, one per hart
+
+  std::vector<std::thread>  mWorkers;
+
+  // Internal helper methods
+
+  ResumeRes  runAll (std::function<ResumeRes (ITarget *)> job);
+  void  worker (int  hart);
+  ITarget *stepTarget ();
+
+};	// class HartGroup
+
+#endif	// HART_GROUP_H
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
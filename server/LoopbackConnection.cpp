@@ -0,0 +1,353 @@
+// In-memory loopback RSP connection: definition
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "LoopbackConnection.h"
+
+using std::cerr;
+using std::endl;
+using std::chrono::milliseconds;
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+
+
+//! Times to spin with nothing to do, before we start yielding
+
+static const unsigned int  SPIN_LIMIT = 100;
+
+//! Times to yield with nothing to do, before we start napping
+
+static const unsigned int  YIELD_LIMIT = 10000;
+
+//! How long to nap for, once we are napping
+
+static const microseconds  NAP (50);
+
+
+//! Constructor
+
+//! @param[in] _traceFlags  Flags controlling tracing
+//! @param[in] capacity     The least size of each queue
+
+LoopbackConnection::LoopbackConnection (TraceFlags *_traceFlags,
+					std::size_t  capacity) :
+  AbstractConnection (_traceFlags),
+  mToServer (capacity),
+  mToClient (capacity),
+  mIsConnected (true)
+{
+  // Nothing.
+}	// LoopbackConnection ()
+
+
+//! Destructor
+
+//! Close the connection if it is still open
+
+LoopbackConnection::~LoopbackConnection ()
+{
+  this->rspClose ();		// Don't confuse with any other close ()
+
+}	// ~LoopbackConnection ()
+
+
+//! Get a new client connection.
+
+//! There is no way to connect.  We are connected from the start, and once
+//! the client has gone it can't come back.
+
+//! @return  Always FALSE
+
+bool
+LoopbackConnection::rspConnect ()
+{
+  return  false;
+
+}	// rspConnect ()
+
+
+//! Close the connection
+
+//! The client will see no more from us, once it has what is already queued.
+
+void
+LoopbackConnection::rspClose ()
+{
+  mIsConnected = false;
+  mToClient.close ();
+  clearBuffers ();
+
+}	// rspClose ()
+
+
+//! Report if we are connected to a client.
+
+//! @return  TRUE if we are connected, FALSE otherwise
+
+bool
+LoopbackConnection::isConnected ()
+{
+  return  mIsConnected;
+
+}	// isConnected ()
+
+
+//! Can we get another client once this one has gone?
+
+//! @return  Always FALSE, since there is only ever the one client
+
+bool
+LoopbackConnection::canReconnect ()
+{
+  return  false;
+
+}	// canReconnect ()
+
+
+//! Send a block of characters to the server
+
+//! For use by the client.
+
+//! @param[in] buf  The characters to send
+//! @param[in] len  The number of characters to send
+//! @return  TRUE if all chars were sent, FALSE if the server has closed the
+//!          connection.
+
+bool
+LoopbackConnection::clientWrite (const char *buf,
+				 std::size_t  len)
+{
+  return  putBlock (mToServer, mToClient, buf, len);
+
+}	// clientWrite ()
+
+
+//! Get a block of characters from the server
+
+//! For use by the client.  We return whatever is available, up to the size
+//! of the buffer.  A blocking read waits for at least one character.
+
+//! @param[out] buf       Where to put the characters received
+//! @param[in]  len       The maximum number of characters to receive
+//! @param[in]  blocking  True if the read should block.
+//! @return  The number of characters received, 0 if the read would block
+//!          and blocking is false, or -1 if the server has closed the
+//!          connection.
+
+int
+LoopbackConnection::clientRead (char *buf,
+				std::size_t  len,
+				bool  blocking)
+{
+  return  getBlock (mToClient, buf, len, blocking);
+
+}	// clientRead ()
+
+
+//! Close the client side of the connection
+
+//! The server will see the connection close, once it has read what is
+//! already queued.
+
+void
+LoopbackConnection::clientClose ()
+{
+  mToServer.close ();
+
+}	// clientClose ()
+
+
+//! Put a block of characters out to the client
+
+//! @param[in] buf  The characters to put out
+//! @param[in] len  The number of characters to put out
+//! @return  TRUE if all chars sent OK, FALSE if not (the client has gone)
+
+bool
+LoopbackConnection::putRspBlockRaw (const char  *buf,
+				    std::size_t  len)
+{
+  if (putBlock (mToClient, mToServer, buf, len))
+    return  true;
+
+  cerr << "Warning: Failed to write to RSP client: "
+       << "Closing client connection: Client has gone" << endl;
+  return  false;
+
+}	// putRspBlockRaw ()
+
+
+//! Get a block of characters from the client
+
+//! @param[out] buf       Where to put the characters received
+//! @param[in]  len       The maximum number of characters to receive
+//! @param[in]  blocking  True if the read should block.
+//! @return  The number of characters received, 0 if the read would block
+//!          and blocking is false, or -1 if the client has gone.
+
+int
+LoopbackConnection::getRspBlockRaw (char        *buf,
+				    std::size_t  len,
+				    bool         blocking)
+{
+  return  getBlock (mToServer, buf, len, blocking);
+
+}	// getRspBlockRaw ()
+
+
+//! Wait a while for the client to send something
+
+//! The client going counts, so that the caller will go on to find out.
+
+//! @param[in] timeoutMs  How long to wait in milliseconds
+//! @return  TRUE if there is input, FALSE otherwise.
+
+bool
+LoopbackConnection::waitRspInput (int  timeoutMs)
+{
+  steady_clock::time_point  deadline =
+    steady_clock::now () + milliseconds (timeoutMs);
+  unsigned int  count = 0;
+
+  while (mToServer.empty () && !mToServer.isClosed ())
+    {
+      if (steady_clock::now () >= deadline)
+	return  false;
+
+      idle (count);
+    }
+
+  return  true;
+
+}	// waitRspInput ()
+
+
+//! Put a block of characters in a queue
+
+//! We wait while the queue is full, unless the other side has gone, when
+//! no one will ever empty it.
+
+//! @param[in] out  The queue to put the characters in
+//! @param[in] in   The queue from the other side
+//! @param[in] buf  The characters to put in
+//! @param[in] len  The number of characters to put in
+//! @return  TRUE if all chars were put in, FALSE if the other side has gone
+
+bool
+LoopbackConnection::putBlock (SpscQueue & out,
+			      const SpscQueue & in,
+			      const char *buf,
+			      std::size_t  len)
+{
+  unsigned int  count = 0;
+
+  while (len > 0)
+    {
+      std::size_t  n = out.push (buf, len);
+
+      if (0 != n)
+	{
+	  buf += n;
+	  len -= n;
+	  count = 0;
+	}
+      else if (in.isClosed ())
+	return  false;
+      else
+	idle (count);
+    }
+
+  return  true;
+
+}	// putBlock ()
+
+
+//! Get a block of characters from a queue
+
+//! We must look to see if the queue is closed before finding it empty, or
+//! we could miss the last of what was put in.
+
+//! @param[in]  in        The queue to take the characters from
+//! @param[out] buf       Where to put the characters
+//! @param[in]  len       The maximum number of characters to take
+//! @param[in]  blocking  True if we should wait for at least one character
+//! @return  The number of characters taken, 0 if there were none and
+//!          blocking is false, or -1 if the queue is closed and empty.
+
+int
+LoopbackConnection::getBlock (SpscQueue & in,
+			      char *buf,
+			      std::size_t  len,
+			      bool  blocking)
+{
+  unsigned int  count = 0;
+
+  for (;;)
+    {
+      bool  closed = in.isClosed ();
+      std::size_t  n = in.pop (buf, len);
+
+      if (0 != n)
+	return  static_cast<int> (n);
+      else if (closed)
+	return  -1;
+      else if (!blocking)
+	return  0;
+
+      idle (count);
+    }
+}	// getBlock ()
+
+
+//! Wait a moment, while there is nothing to do
+
+//! The longer we have been waiting, the less eagerly we look again.  First
+//! we just spin, then we yield the processor, and after a long wait we nap,
+//! so that a side left idle does not hog a processor for ever.
+
+//! @param[in,out] count  How many times we have waited so far.  Start at
+//!                       zero.
+
+void
+LoopbackConnection::idle (unsigned int & count)
+{
+  if (count < SPIN_LIMIT)
+    count++;
+  else if (count < YIELD_LIMIT)
+    {
+      count++;
+      std::this_thread::yield ();
+    }
+  else
+    std::this_thread::sleep_for (NAP);
+
+}	// idle ()
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,122 @@
+// In-memory loopback RSP connection: declaration
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+
+#ifndef LOOPBACK_CONNECTION_H
+#define LOOPBACK_CONNECTION_H
+
+#include <cstddef>
+
+#include "AbstractConnection.h"
+#include "SpscQueue.h"
+#include "TraceFlags.h"
+
+
+//! An RSP connection to a client in the same process
+
+//! Rather than a socket or a pipe, the connection is a pair of lock-free
+//! queues (@see SpscQueue), one each way, so talking to the server costs no
+//! system calls at all.  This is for a client which links in the server,
+//! such as a test driver or a benchmark.  The server runs on a thread of its
+//! own, and the client uses the client side methods from one other thread.
+
+//! Neither side ever sleeps on the other.  A side with nothing to do spins
+//! a little, then yields, and only after a while idle naps between looks.
+
+//! Like a stream connection, we are connected from the start, and there is
+//! only ever the one client.  When the client closes its side, the server
+//! sees the connection close.
+
+class LoopbackConnection : public AbstractConnection
+{
+public:
+
+  // Constructor and destructor
+
+  LoopbackConnection (TraceFlags *_traceFlags,
+		      std::size_t  capacity = DEFAULT_CAPACITY);
+  ~LoopbackConnection ();
+
+  // Public interface: manage client connections
+
+  virtual bool  rspConnect ();
+  virtual void  rspClose ();
+  virtual bool  isConnected ();
+  virtual bool  canReconnect ();
+
+  // Public interface: the client side
+
+  bool  clientWrite (const char *buf,
+		     std::size_t  len);
+  int   clientRead (char *buf,
+		    std::size_t  len,
+		    bool  blocking);
+  void  clientClose ();
+
+private:
+
+  //! Default size of each queue
+
+  static const std::size_t  DEFAULT_CAPACITY = 65536;
+
+  //! Bytes from the client to the server
+
+  SpscQueue  mToServer;
+
+  //! Bytes from the server to the client
+
+  SpscQueue  mToClient;
+
+  //! Track whether we are connected or not.
+
+  bool  mIsConnected;
+
+  // Implementation specific routines to handle blocks of chars.
+
+  virtual bool  putRspBlockRaw (const char  *buf,
+				std::size_t  len);
+  virtual int   getRspBlockRaw (char        *buf,
+				std::size_t  len,
+				bool         blocking);
+  virtual bool  waitRspInput (int  timeoutMs);
+
+  // Routines shared by both sides
+
+  static bool  putBlock (SpscQueue & out,
+			 const SpscQueue & in,
+			 const char *buf,
+			 std::size_t  len);
+  static int   getBlock (SpscQueue & in,
+			 char *buf,
+			 std::size_t  len,
+			 bool  blocking);
+  static void  idle (unsigned int & count);
+
+};	// class LoopbackConnection
+
+#endif	// LOOPBACK_CONNECTION_H
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,255 @@
+// Target memory read cache: definition
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <cstring>
+
+#include "MemCache.h"
+#include "SingleTarget.h"
+
+
+//! Constructor
+
+//! Allocate the cache, which starts empty.
+
+//! @param[in] _cpu       The target whose memory we cache
+//! @param[in] _stats     Where to time calls to the target, or nullptr if
+//!                       they are not to be timed
+//! @param[in] _numPages  Number of pages in the cache, rounded up to a power
+//!                       of 2.  Defaults to DEFAULT_MEM_CACHE_PAGES.
+
+template <class TARGET>
+MemCache<TARGET>::MemCache (TARGET * _cpu,
+			    ServerStats * _stats,
+			    int  _numPages) :
+  cpu (_cpu),
+  stats (_stats)
+{
+  for (numPages = 1; numPages < _numPages; numPages *= 2)
+    ;
+
+  data  = new uint8_t [numPages * MEM_CACHE_PAGE_SIZE];
+  tag   = new uint32_t [numPages];
+  valid = new bool [numPages];
+
+  invalidate ();
+
+}	// MemCache ()
+
+
+//! Destructor
+
+//! Free the cache
+
+template <class TARGET>
+MemCache<TARGET>::~MemCache ()
+{
+  delete [] valid;
+  delete [] tag;
+  delete [] data;
+
+}	// ~MemCache ()
+
+
+//! Read a block of memory
+
+//! Each page touched is filled from the target if we don't already hold it.
+//! If the target can't provide a whole page (perhaps it runs off the end of
+//! memory), we read just what was asked for directly, and don't cache it.
+
+//! @param[in]  addr    Address to read from
+//! @param[out] buffer  Where to put the data read
+//! @param[in]  size    Number of bytes to read
+//! @return  The number of bytes read, which stops at the first failure.
+
+template <class TARGET>
+std::size_t
+MemCache<TARGET>::read (uint32_t  addr,
+			uint8_t * buffer,
+			std::size_t  size)
+{
+  std::size_t  done = 0;
+
+  while (done < size)
+    {
+      uint32_t  pageAddr = addr & ~(MEM_CACHE_PAGE_SIZE - 1);
+      std::size_t  off   = addr - pageAddr;
+      std::size_t  len   = MEM_CACHE_PAGE_SIZE - off;
+      int  s             = slot (pageAddr);
+      uint8_t *page      = &(data[s * MEM_CACHE_PAGE_SIZE]);
+
+      if (len > size - done)
+	len = size - done;
+
+      if (!valid[s] || (tag[s] != pageAddr))
+	{
+	  if (MEM_CACHE_PAGE_SIZE
+	      == cpuRead (pageAddr, page, MEM_CACHE_PAGE_SIZE))
+	    {
+	      tag[s]   = pageAddr;
+	      valid[s] = true;
+	    }
+	  else
+	    {
+	      // Don't leave a half filled page looking valid.
+
+	      valid[s] = false;
+	      return  done + cpuRead (addr, buffer + done, len);
+	    }
+	}
+
+      memcpy (buffer + done, page + off, len);
+      done += len;
+      addr += len;
+    }
+
+  return  done;
+
+}	// read ()
+
+
+//! Write a block of memory
+
+//! The write goes straight to the target.  Any page we hold which overlaps
+//! is updated with what was actually written.
+
+//! @param[in] addr    Address to write to
+//! @param[in] buffer  The data to write
+//! @param[in] size    Number of bytes to write
+//! @return  The number of bytes written, as from the target.
+
+template <class TARGET>
+std::size_t
+MemCache<TARGET>::write (uint32_t  addr,
+			 const uint8_t * buffer,
+			 std::size_t  size)
+{
+  std::size_t  res  = cpuWrite (addr, buffer, size);
+  std::size_t  done = 0;
+
+  while (done < res)
+    {
+      uint32_t  pageAddr = addr & ~(MEM_CACHE_PAGE_SIZE - 1);
+      std::size_t  off   = addr - pageAddr;
+      std::size_t  len   = MEM_CACHE_PAGE_SIZE - off;
+      int  s             = slot (pageAddr);
+
+      if (len > res - done)
+	len = res - done;
+
+      if (valid[s] && (tag[s] == pageAddr))
+	memcpy (&(data[s * MEM_CACHE_PAGE_SIZE + off]), buffer + done, len);
+
+      done += len;
+      addr += len;
+    }
+
+  return  res;
+
+}	// write ()
+
+
+//! Forget everything in the cache
+
+template <class TARGET>
+void
+MemCache<TARGET>::invalidate ()
+{
+  for (int  s = 0; s < numPages; s++)
+    valid[s] = false;
+
+}	// invalidate ()
+
+
+//! Which slot holds a page
+
+//! @param[in] pageAddr  Address of the start of the page
+//! @return  The slot in which the page may be held
+
+template <class TARGET>
+int
+MemCache<TARGET>::slot (uint32_t  pageAddr) const
+{
+  return  (pageAddr / MEM_CACHE_PAGE_SIZE) & (numPages - 1);
+
+}	// slot ()
+
+
+//! Read the target's memory, timing the read if we have statistics
+
+//! @param[in]  addr    Address to read from
+//! @param[out] buffer  Where to put the data read
+//! @param[in]  size    Number of bytes to read
+//! @return  The number of bytes read, as from the target.
+
+template <class TARGET>
+std::size_t
+MemCache<TARGET>::cpuRead (uint32_t  addr,
+			   uint8_t * buffer,
+			   std::size_t  size)
+{
+  if (nullptr == stats)
+    return  cpu->read (addr, buffer, size);
+
+  ServerStats::Timer  timer (stats->target (ServerStats::READ));
+
+  return  cpu->read (addr, buffer, size);
+
+}	// cpuRead ()
+
+
+//! Write the target's memory, timing the write if we have statistics
+
+//! @param[in] addr    Address to write to
+//! @param[in] buffer  The data to write
+//! @param[in] size    Number of bytes to write
+//! @return  The number of bytes written, as from the target.
+
+template <class TARGET>
+std::size_t
+MemCache<TARGET>::cpuWrite (uint32_t  addr,
+			    const uint8_t * buffer,
+			    std::size_t  size)
+{
+  if (nullptr == stats)
+    return  cpu->write (addr, buffer, size);
+
+  ServerStats::Timer  timer (stats->target (ServerStats::WRITE));
+
+  return  cpu->write (addr, buffer, size);
+
+}	// cpuWrite ()
+
+
+//! The cache in front of any target, and in front of the one target a single
+//! target server is specialized for.
+
+template class MemCache<ITarget>;
+
+#ifdef HAVE_SINGLE_TARGET
+template class MemCache<SingleTarget>;
+#endif
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,113 @@
+// Target memory read cache: declaration
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef MEM_CACHE_H
+#define MEM_CACHE_H
+
+#include <cstdint>
+#include <cstddef>
+
+#include "ITarget.h"
+#include "ServerStats.h"
+
+
+//! Size in bytes of a page of the memory cache.  Must be a power of 2.
+#define MEM_CACHE_PAGE_SIZE  256
+
+//! Default number of pages in the memory cache.  Must be a power of 2.
+#define DEFAULT_MEM_CACHE_PAGES  64
+
+
+//! A read cache in front of target memory
+
+//! While the target is stopped, GDB reads the same stack and code over and
+//! over, and on the Verilator targets every byte is a separate DPI call.  So
+//! we keep a small direct mapped cache of whole pages.  Writes go straight
+//! through to the target, updating any page we hold.
+
+//! The cache knows nothing of when the target runs, so the owner must call
+//! invalidate () whenever the target may have changed its memory.
+
+//! If given statistics, we time every read and write of the target.
+
+//! TARGET is the class of the target, which is ITarget in general, but may be
+//! the concrete class of the one target the server is specialized for, so
+//! that calls to it need not be virtual.  The instances are in MemCache.cpp.
+
+template <class TARGET>
+class MemCache
+{
+public:
+
+  // Constructor and destructor
+  MemCache (TARGET * _cpu,
+	    ServerStats * _stats = nullptr,
+	    int  _numPages = DEFAULT_MEM_CACHE_PAGES);
+  ~MemCache ();
+
+  // Accessor methods
+  std::size_t  read (uint32_t  addr,
+		     uint8_t * buffer,
+		     std::size_t  size);
+  std::size_t  write (uint32_t  addr,
+		      const uint8_t * buffer,
+		      std::size_t  size);
+  void  invalidate ();
+
+private:
+
+  //! The target whose memory we are caching
+  TARGET *cpu;
+
+  //! Where to time calls to the target, if anywhere
+  ServerStats *stats;
+
+  //! The cached data, one page after another
+  uint8_t *data;
+
+  //! The address of the page held in each slot
+  uint32_t *tag;
+
+  //! Which slots hold a page
+  bool *valid;
+
+  //! Number of pages in the cache.  Always a power of 2.
+  int  numPages;
+
+  // Internal helper methods
+  int  slot (uint32_t  pageAddr) const;
+  std::size_t  cpuRead (uint32_t  addr,
+			uint8_t * buffer,
+			std::size_t  size);
+  std::size_t  cpuWrite (uint32_t  addr,
+			 const uint8_t * buffer,
+			 std::size_t  size);
+
+};
+
+#endif	// MEM_CACHE_H
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
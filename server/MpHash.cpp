@@ -28,18 +28,24 @@
 //! Constructor
 
 //! Allocate the hash table
-//! @param[in] size  Number of slots in the  hash table. Defaults to
-//!                  DEFAULT_MP_HASH_SIZE.
+//! @param[in] size  Initial number of slots in the hash table, rounded up to
+//!                  a power of 2. Defaults to DEFAULT_MP_HASH_SIZE.
 MpHash::MpHash (int  _size) :
-  size (_size)
+  hashTab (NULL),
+  inUse (NULL),
+  size (0),
+  numEntries (0)
 {
-  // Allocate and clear the hash table
-  hashTab = new MpEntry *[size];
+  int  newSize;
+
+  for (newSize = 1; newSize < _size; newSize *= 2)
+    ;
+
+  for (int  t = 0; t < NUM_MP_TYPES; t++)
+    count[t] = 0;
+
+  resize (newSize);
 
-  for (int  i = 0; i < size; i++)
-    {
-      hashTab[i] = NULL;
-    }
 }	// MpHash ()
 
 
@@ -49,6 +55,7 @@ MpHash::MpHash (int  _size) :
 MpHash::~MpHash ()
 {
   delete [] hashTab;
+  delete [] inUse;
 
 }	// ~MpHash ()
 
@@ -60,38 +67,36 @@ MpHash::~MpHash ()
 //! a duplicate insertion (perhaps due to a lost packet) they will be
 //! different.
 
-//! @note This method allocates memory. Care must be taken to delete it when
-//! done.
+//! The table is kept at most half full, doubling in size when needed.
 
 //! @param[in] type   The type of matchpoint
 //! @param[in] addr   The address of the matchpoint
 //! @para[in]  instr  The instruction to associate with the address
+
 void
 MpHash::add (MpType    type,
 	     uint32_t  addr,
 	     uint32_t  instr)
 {
-  int      hv    = addr % size;
-  MpEntry *curr;
+  if (find (type, addr) >= 0)
+    return;				// We already have the entry
 
-  // See if we already have the entry
-  for(curr = hashTab[hv]; NULL != curr; curr = curr->next)
-    {
-      if ((type == curr->type) && (addr == curr->addr))
-	{
-	  return;		// We already have the entry
-	}
-    }
+  if ((numEntries + 1) * 2 > size)
+    resize (size * 2);
+
+  int  mask = size - 1;
+  int  i;
 
-  // Insert the new entry at the head of the chain
-  curr = new MpEntry ();
-  
-  curr->type  = type;
-  curr->addr  = addr;
-  curr->instr = instr;
-  curr->next  = hashTab[hv];
+  for (i = hash (type, addr); inUse[i]; i = (i + 1) & mask)
+    ;
 
-  hashTab[hv] = curr;
+  hashTab[i].type  = type;
+  hashTab[i].addr  = addr;
+  hashTab[i].instr = instr;
+  inUse[i]         = true;
+
+  numEntries++;
+  count[type]++;
 
 }	// add ()
 
@@ -100,26 +105,22 @@ MpHash::add (MpType    type,
 
 //! The match must be on type AND addr.
 
+//! @note The entry returned is only valid until the table is next changed.
+
 //! @param[in] type   The type of matchpoint
 //! @param[in] addr   The address of the matchpoint
-
 //! @return  The entry found, or NULL if the entry was not found
+
 MpEntry *
 MpHash::lookup (MpType    type,
 		uint32_t  addr)
 {
-  int      hv   = addr % size;
+  if (0 == count[type])
+    return  NULL;			// Nothing to find
 
-  // Search
-  for (MpEntry *curr = hashTab[hv]; NULL != curr; curr = curr->next)
-    {
-      if ((type == curr->type) && (addr == curr->addr))
-	{
-	  return  curr;		// The entry found
-	}
-    }
+  int  i = find (type, addr);
 
-  return  NULL;			// Not found
+  return  (i < 0) ? NULL : &(hashTab[i]);
 
 }	// lookup ()
 
@@ -127,55 +128,132 @@ MpHash::lookup (MpType    type,
 //! Delete an entry from the matchpoint hash table
 
 //! If it is there the entry is deleted from the hash table. If it is not
-//! there, no action is taken. The match must be on type AND addr. The entry
-//! (MpEntry::) is itself deleted
+//! there, no action is taken. The match must be on type AND addr.
 
-//! The usual fun and games tracking the previous entry, so we can delete
-//! things.
+//! To keep probe sequences unbroken, any following entries in the same run
+//! which could live in the vacated slot are shifted back into it.
 
 //! @param[in]  type   The type of matchpoint
 //! @param[in]  addr   The address of the matchpoint
 //! @param[out] instr  Location to place the instruction found. If NULL (the
 //!                    default) then the instruction is not written back.
-
 //! @return  TRUE if an entry was found and deleted
+
 bool
 MpHash::remove (MpType    type,
 		uint32_t  addr,
 		uint32_t *instr)
 {
-  int      hv   = addr % size;
-  MpEntry *prev = NULL;
-  MpEntry *curr;
+  int  i = find (type, addr);
+
+  if (i < 0)
+    return  false;			// Not found
+
+  if (NULL != instr)
+    *instr = hashTab[i].instr;		// Return the found instruction
 
-  // Search
-  for (curr  = hashTab[hv]; NULL != curr; curr = curr->next)
+  numEntries--;
+  count[type]--;
+
+  // Shift back following entries until we reach an empty slot.  An entry at
+  // j, with home slot h, may move to the hole at i if h does not lie
+  // cyclically in (i, j].
+  int  mask = size - 1;
+
+  for (int  j = (i + 1) & mask; inUse[j]; j = (j + 1) & mask)
     {
-      if ((type == curr->type) && (addr == curr->addr))
+      int  h = hash (hashTab[j].type, hashTab[j].addr);
+
+      if (((j - h) & mask) >= ((j - i) & mask))
 	{
-	  // Found - delete. Method depends on whether we are the head of
-	  // chain.
-	  if (NULL == prev)
-	    {
-	      hashTab[hv] = curr->next;
-	    }
-	  else
-	    {
-	      prev->next = curr->next;
-	    }
-
-	  if (NULL != instr)
-	    {
-	      *instr = curr->instr;	// Return the found instruction
-	    }
-
-	  delete curr;
-	  return true;			// Success
+	  hashTab[i] = hashTab[j];
+	  i = j;
 	}
-
-      prev = curr;
     }
 
-  return  false;			// Not found
+  inUse[i] = false;
+  return true;				// Success
 
 }	// remove ()
+
+
+//! Compute the home slot for a key
+
+//! Addresses are typically aligned, so we use a multiplicative hash, folding
+//! in the top bits, rather than just the bottom bits of the address.
+
+//! @param[in] type   The type of matchpoint
+//! @param[in] addr   The address of the matchpoint
+//! @return  The home slot in the table.
+
+int
+MpHash::hash (MpType    type,
+	      uint32_t  addr) const
+{
+  uint32_t  key = addr ^ (static_cast<uint32_t> (type) << 29);
+  uint32_t  hv  = key * UINT32_C (0x9e3779b1);
+
+  return  static_cast<int> (hv ^ (hv >> 16)) & (size - 1);
+
+}	// hash ()
+
+
+//! Find the slot holding a key
+
+//! @param[in] type   The type of matchpoint
+//! @param[in] addr   The address of the matchpoint
+//! @return  The slot holding the entry, or -1 if not found.
+
+int
+MpHash::find (MpType    type,
+	      uint32_t  addr) const
+{
+  int  mask = size - 1;
+
+  for (int  i = hash (type, addr); inUse[i]; i = (i + 1) & mask)
+    if ((addr == hashTab[i].addr) && (type == hashTab[i].type))
+      return  i;
+
+  return  -1;
+
+}	// find ()
+
+
+//! Resize the hash table, rehashing all the entries
+
+//! @param[in] newSize  The new size. Must be a power of 2.
+
+void
+MpHash::resize (int  newSize)
+{
+  MpEntry *oldTab   = hashTab;
+  bool    *oldInUse = inUse;
+  int      oldSize  = size;
+
+  hashTab = new MpEntry [newSize];
+  inUse   = new bool [newSize];
+  size    = newSize;
+
+  for (int  i = 0; i < size; i++)
+    inUse[i] = false;
+
+  int  mask = size - 1;
+
+  for (int  i = 0; i < oldSize; i++)
+    if (oldInUse[i])
+      {
+	int  j;
+
+	for (j = hash (oldTab[i].type, oldTab[i].addr);
+	     inUse[j];
+	     j = (j + 1) & mask)
+	  ;
+
+	hashTab[j] = oldTab[i];
+	inUse[j]   = true;
+      }
+
+  delete [] oldTab;
+  delete [] oldInUse;
+
+}	// resize ()
@@ -25,10 +25,12 @@
 #define MP_HASH_H
 
 #include <stdint.h>
+#include <cstddef>
 
 
-//! Default size of the matchpoint hash table. Largest prime < 2^10
-#define DEFAULT_MP_HASH_SIZE  1021
+//! Default initial size of the matchpoint hash table.  Must be a power of 2.
+//! The table grows as needed.
+#define DEFAULT_MP_HASH_SIZE  64
 
 
 //! Enumeration of different types of matchpoint.
@@ -44,30 +46,31 @@ enum MpType {
 };
 
 
-class MpHash;
+//! Number of different types of matchpoint
+#define NUM_MP_TYPES  5
+
 
 //! A structure for a matchpoint hash table entry
 struct MpEntry
 {
 public:
 
-  friend class MpHash;		// The only one which can get at next
-
   MpType    type;		//!< Type of matchpoint
   uint32_t  addr;		//!< Address with the matchpoint
   uint32_t  instr;		//!< Substituted instruction
-
-
-private:
-
-  MpEntry *next;		//!< Next in this slot
 };
 
 
 //! A hash table for matchpoints
 
-//! We do this as our own open hash table. Our keys are a pair of entities
-//! (address and type), so STL map is not trivial to use.
+//! We do this as our own hash table, since our keys are a pair of entities
+//! (address and type), so STL map is not trivial to use.  This may be looked
+//! up on every cycle, so it is a flat open addressed table with linear
+//! probing, with no allocation per entry.  Deletion shifts following entries
+//! back, so there are no tombstones.
+
+//! A count is kept of each type of matchpoint, so callers can check cheaply
+//! whether there is anything to look up at all.
 
 class MpHash
 {
@@ -87,14 +90,54 @@ public:
 		uint32_t  addr,
 		uint32_t *instr = NULL);
 
+  //! Are there any matchpoints of the given type?
+
+  //! @param[in] type  The type of matchpoint
+  //! @return  TRUE if there is at least one matchpoint of this type.
+
+  bool  any (MpType  type) const
+  {
+    return  0 != count[type];
+  }
+
+  //! Apply a function to every entry
+
+  //! The table must not be changed by the function.
+
+  //! @param[in] f  The function to apply, taking a reference to an MpEntry.
+
+  template <typename F>
+  void  forEach (F  f)
+  {
+    for (int  i = 0; i < size; i++)
+      if (inUse[i])
+	f (hashTab[i]);
+  }
+
 private:
 
   //! The hash table
-  MpEntry **hashTab;
+  MpEntry *hashTab;
 
-  //! Size of the hash table
+  //! Which slots of the hash table hold an entry
+  bool *inUse;
+
+  //! Size of the hash table.  Always a power of 2.
   int  size;
 
+  //! Number of entries in the table
+  int  numEntries;
+
+  //! Number of entries of each type
+  int  count[NUM_MP_TYPES];
+
+  // Internal helper methods
+  int  hash (MpType    type,
+	     uint32_t  addr) const;
+  int  find (MpType    type,
+	     uint32_t  addr) const;
+  void  resize (int  newSize);
+
 };
 
 #endif	// MP_HASH_H
@@ -50,14 +50,53 @@ using std::setw;
 
 //! Constructor when using a port number
 
-//! Sets up various parameters
+//! Sets up various parameters.  Once we start listening on the port, we
+//! carry on for as long as we exist, so a client can reconnect as soon as
+//! the last one has gone.
 
 //! @param[in] _portNum     the port number to connect to
 //! @param[in] _traceFlags  flags controlling tracing
 RspConnection::RspConnection (int         _portNum,
 			      TraceFlags *_traceFlags) :
   AbstractConnection (_traceFlags),
-  portNum (_portNum),
+  listener (new RspListener (_portNum, _traceFlags)),
+  ownListener (true),
+  clientFd (-1)
+{
+
+}	// RspConnection ()
+
+
+//! Constructor when using a Unix domain socket
+
+//! Otherwise just like using a port number.
+
+//! @param[in] _sockPath    the path of the socket to listen on
+//! @param[in] _traceFlags  flags controlling tracing
+RspConnection::RspConnection (const std::string & _sockPath,
+			      TraceFlags *_traceFlags) :
+  AbstractConnection (_traceFlags),
+  listener (new RspListener (_sockPath, _traceFlags)),
+  ownListener (true),
+  clientFd (-1)
+{
+
+}	// RspConnection ()
+
+
+//! Constructor when sharing a listener
+
+//! Several connections may take clients from the same listener at once, and
+//! each serves just one client, after which it can't reconnect.
+
+//! @param[in] _listener    the listener to take our client from, which must
+//!                         already be listening
+//! @param[in] _traceFlags  flags controlling tracing
+RspConnection::RspConnection (RspListener *_listener,
+			      TraceFlags  *_traceFlags) :
+  AbstractConnection (_traceFlags),
+  listener (_listener),
+  ownListener (false),
   clientFd (-1)
 {
 
@@ -71,6 +110,9 @@ RspConnection::~RspConnection ()
 {
   this->rspClose ();		// Don't confuse with any other close ()
 
+  if (ownListener)
+    delete  listener;
+
 }	// ~RspConnection ()
 
 
@@ -80,89 +122,46 @@ RspConnection::~RspConnection ()
 
 //! A lot of this code is copied from remote_open in gdbserver remote-utils.c.
 
-//! This involves setting up a socket to listen on a socket for attempted
-//! connections from a single GDB instance (we couldn't be talking to multiple
-//! GDBs at once!).
-
-//! The service is specified either as a port number in the Or1ksim
-//! configuration (parameter rsp_port in section debug, default 51000) or as a
-//! service name in the constant OR1KSIM_RSP_SERVICE.
-
-//! If there is a catastrophic communication failure, service will be
-//! terminated using sc_stop.
-
-//! The protocol used for communication is specified in OR1KSIM_RSP_PROTOCOL.
+//! If we own our listener, we start it listening the first time through,
+//! and leave it listening thereafter.  We only talk to one GDB at a time, so
+//! another client trying to connect waits until this one has gone.
 
 //! @return  TRUE if the connection was established or can be retried. FALSE
 //!          if the error was so serious the program must be aborted.
 bool
 RspConnection::rspConnect ()
 {
-  // Open a socket on which we'll listen for clients
-  int  tmpFd = socket (PF_INET, SOCK_STREAM, IPPROTO_TCP);
-  if (tmpFd < 0)
-    {
-      cerr << "ERROR: Cannot open RSP socket" << endl;
-      return  false;
-    }
-
-  // Allow rapid reuse of the port on this socket
-  int  optval = 1;
-  setsockopt (tmpFd, SOL_SOCKET, SO_REUSEADDR, (char *)&optval,
-	      sizeof (optval));
-
-  // Bind the port to the socket
-  struct sockaddr_in  sockAddr;
-  sockAddr.sin_family      = PF_INET;
-  sockAddr.sin_port        = htons (portNum);
-  sockAddr.sin_addr.s_addr = INADDR_ANY;
-
-  if (bind (tmpFd, (struct sockaddr *) &sockAddr, sizeof (sockAddr)))
-    {
-      cerr << "ERROR: Cannot bind to RSP socket" << endl;
-      return  false;
-    }
+  if (ownListener && !listener->rspListen (1))
+    return  false;
 
-  // Listen for (at most one) client
-  if (listen (tmpFd, 1))
+  if (!listener->isListening ())
     {
-      cerr << "ERROR: Cannot listen on RSP socket" << endl;
+      cerr << "ERROR: RSP listener is not listening" << endl;
       return  false;
     }
 
-  if (! traceFlags->traceSilent ())
-    cout << "Listening for RSP on port " <<  portNum << endl << flush;
-
   // Accept a client which connects
-  socklen_t  len = sizeof (sockAddr);		// Size of the socket address
-  clientFd = accept (tmpFd, (struct sockaddr *)&sockAddr, &len);
+  clientFd = listener->rspAccept ();
 
   if (-1 == clientFd)
+    return  true;			// OK to retry
+
+  if (!listener->isLocal ())
     {
-	cerr << "Warning: Failed to accept RSP client: " << strerror (errno)
-	     << endl;
-      return  true;			// OK to retry
+      // Enable TCP keep alive process
+      int  optval = 1;
+      setsockopt (clientFd, SOL_SOCKET, SO_KEEPALIVE, (char *)&optval,
+		  sizeof (optval));
+
+      // Don't delay small packets, for better interactive response
+      // (disable Nagel's algorithm)
+      optval = 1;
+      setsockopt (clientFd, IPPROTO_TCP, TCP_NODELAY, (char *)&optval,
+		  sizeof (optval));
     }
 
-  // Enable TCP keep alive process
-  optval = 1;
-  setsockopt (clientFd, SOL_SOCKET, SO_KEEPALIVE, (char *)&optval,
-	      sizeof (optval));
-
-  // Don't delay small packets, for better interactive response (disable
-  // Nagel's algorithm)
-  optval = 1;
-  setsockopt (clientFd, IPPROTO_TCP, TCP_NODELAY, (char *)&optval,
-	      sizeof (optval));
-
-  // Socket is no longer needed
-  close (tmpFd);			// No longer need this
   signal (SIGPIPE, SIG_IGN);		// So we don't exit if client dies
 
-  if (! traceFlags->traceSilent ())
-    cout << "Remote debugging from host " << inet_ntoa (sockAddr.sin_addr)
-	 << endl;
-
   return true;
 
 }	// rspConnect ()
@@ -179,10 +178,28 @@ RspConnection::rspClose ()
 
       close (clientFd);
       clientFd = -1;
+      clearBuffers ();
     }
 }	// rspClose ()
 
 
+//! Forget a client connection if it is open
+
+//! This is for the parent of a forked child which now serves the client.
+//! We close our copy of the connection quietly, and the client stays
+//! connected to the child.
+void
+RspConnection::rspForget ()
+{
+  if (isConnected ())
+    {
+      close (clientFd);
+      clientFd = -1;
+      clearBuffers ();
+    }
+}	// rspForget ()
+
+
 //! Report if we are connected to a client.
 
 //! @return  TRUE if we are connected, FALSE otherwise
@@ -193,30 +210,59 @@ RspConnection::isConnected ()
 
 }	// isConnected ()
 
-//! Put a single character out on the RSP connection
+
+//! Report if we can get another client once this one has gone.
+
+//! A connection on a shared listener serves just one client.
+
+//! @return  TRUE if we can reconnect, FALSE otherwise
+bool
+RspConnection::canReconnect ()
+{
+  return  ownListener;
+
+}	// canReconnect ()
+
+
+//! The file descriptor to watch for input from the client
+
+//! @return  The client file descriptor, or -1 if we are not connected
+int
+RspConnection::watchFd ()
+{
+  return  clientFd;
+
+}	// watchFd ()
+
+
+//! Put a block of characters out on the RSP connection
 
 //! Utility routine. This should only be called if the client is open, but we
 //! check for safety.
 
-//! @param[in] c         The character to put out
+//! @param[in] buf  The characters to put out
+//! @param[in] len  The number of characters to put out
 
-//! @return  TRUE if char sent OK, FALSE if not (communications failure)
+//! @return  TRUE if all chars sent OK, FALSE if not (communications failure)
 
 bool
-RspConnection::putRspCharRaw (char  c)
+RspConnection::putRspBlockRaw (const char  *buf,
+			       std::size_t  len)
 {
   if (-1 == clientFd)
     {
-      cerr << "Warning: Attempt to write '" << c
-		<< "' to unopened RSP client: Ignored" << endl;
+      cerr << "Warning: Attempt to write " << len
+	   << " chars to unopened RSP client: Ignored" << endl;
       return  false;
     }
 
-  // Write until successful (we retry after interrupts) or catastrophic
-  // failure.
-  while (true)
+  // Write until everything is sent (we retry after interrupts and partial
+  // writes) or catastrophic failure.
+  while (len > 0)
     {
-      switch (write (clientFd, &c, sizeof (c)))
+      ssize_t  res = write (clientFd, buf, len);
+
+      switch (res)
 	{
 	case -1:
 	  // Error: only allow interrupts or would block
@@ -234,23 +280,35 @@ RspConnection::putRspCharRaw (char  c)
 	  break;		// Nothing written! Try again
 
 	default:
-	  return  true;		// Success, we can return
+	  buf += res;		// Some written, carry on with the rest
+	  len -= res;
+	  break;
 	}
     }
-}	// putRspCharRaw ()
 
+  return  true;
+
+}	// putRspBlockRaw ()
 
-//! Get a single character from the RSP connection
+
+//! Get a block of characters from the RSP connection
 
 //! Utility routine. This should only be called if the client is open, but we
 //! check for safety.
 
-//! @param[in] blocking  True if the read should block.
-//! @return  The character received or -1 on failure, or if the read would
-//!          block, and blocking is true.
+//! We return whatever is available, up to the size of the buffer.  A
+//! blocking read waits for at least one character.
+
+//! @param[out] buf       Where to put the characters received
+//! @param[in]  len       The maximum number of characters to receive
+//! @param[in]  blocking  True if the read should block.
+//! @return  The number of characters received, 0 if the read would block
+//!          and blocking is false, or -1 on failure.
 
 int
-RspConnection::getRspCharRaw (bool blocking)
+RspConnection::getRspBlockRaw (char        *buf,
+			       std::size_t  len,
+			       bool         blocking)
 {
   if (-1 == clientFd)
     {
@@ -264,14 +322,14 @@ RspConnection::getRspCharRaw (bool blocking)
 
   for (;;)
     {
-      unsigned char  c;
+      ssize_t  res = recv (clientFd, buf, len, (blocking ? 0 : MSG_DONTWAIT));
 
-      switch (recv (clientFd, &c, sizeof (c), (blocking ? 0 : MSG_DONTWAIT)))
+      switch (res)
   	{
   	case -1:
 	  if (!blocking
 	      && (errno == EAGAIN || errno == EWOULDBLOCK))
-	    return -1;
+	    return 0;
 
   	  // Error: only allow interrupts
 
@@ -288,10 +346,10 @@ RspConnection::getRspCharRaw (bool blocking)
   	  return  -1;
 
   	default:
-  	  return  c & 0xff;	// Success, we can return (no sign extend!)
+  	  return  res;		// Success, we can return
   	}
     }
-}	// getRspCharRaw ()
+}	// getRspBlockRaw ()
 
 
 // Local Variables:
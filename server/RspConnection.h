@@ -22,7 +22,10 @@
 #ifndef RSP_CONNECTION_H
 #define RSP_CONNECTION_H
 
+#include <string>
+
 #include "AbstractConnection.h"
+#include "RspListener.h"
 #include "RspPacket.h"
 #include "TraceFlags.h"
 
@@ -39,28 +42,43 @@ public:
 
   RspConnection (int         _portNum,
 		 TraceFlags *_traceFlags);
+  RspConnection (const std::string & _sockPath,
+		 TraceFlags *_traceFlags);
+  RspConnection (RspListener *_listener,
+		 TraceFlags  *_traceFlags);
   ~RspConnection ();
 
   // Public interface: manage client connections
 
   bool  rspConnect ();
   void  rspClose ();
+  void  rspForget ();
   bool  isConnected ();
+  bool  canReconnect ();
+  int  watchFd ();
 
 private:
 
-  //! The port number to listen on
+  //! Where we get our clients from
+
+  RspListener *listener;
+
+  //! Do we own the listener?  If not it is shared with other connections,
+  //! and we serve just one client from it.
 
-  int  portNum;
+  bool  ownListener;
 
   //! The client file descriptor
 
   int  clientFd;
 
-  // Implementation specific routines to handle individual chars.
+  // Implementation specific routines to handle blocks of chars.
 
-  virtual bool  putRspCharRaw (char  c);
-  virtual int   getRspCharRaw (bool blocking);
+  virtual bool  putRspBlockRaw (const char  *buf,
+				std::size_t  len);
+  virtual int   getRspBlockRaw (char        *buf,
+				std::size_t  len,
+				bool         blocking);
 
 };	// RspConnection ()
 
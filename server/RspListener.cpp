@@ -0,0 +1,327 @@
+// Remote Serial Protocol listening socket: implementation
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+
+#include <cerrno>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "RspListener.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::flush;
+
+
+//! Constructor
+
+//! We don't start listening until asked.
+
+//! @param[in] _portNum     the port number to listen on
+//! @param[in] _traceFlags  flags controlling tracing
+
+RspListener::RspListener (int         _portNum,
+			  TraceFlags *_traceFlags) :
+  portNum (_portNum),
+  listenFd (-1),
+  traceFlags (_traceFlags)
+{
+
+}	// RspListener ()
+
+
+//! Constructor for a Unix domain socket
+
+//! We don't start listening until asked.
+
+//! @param[in] _sockPath    the path of the socket to listen on
+//! @param[in] _traceFlags  flags controlling tracing
+
+RspListener::RspListener (const std::string & _sockPath,
+			  TraceFlags *_traceFlags) :
+  portNum (-1),
+  sockPath (_sockPath),
+  listenFd (-1),
+  traceFlags (_traceFlags)
+{
+
+}	// RspListener ()
+
+
+//! Destructor
+
+//! Stop listening if we still are
+
+RspListener::~RspListener ()
+{
+  rspUnlisten ();
+
+}	// ~RspListener ()
+
+
+//! Start listening for clients
+
+//! @param[in] backlog  How many clients may be waiting to be accepted
+//! @return  TRUE if we are now listening, FALSE if the socket could not be
+//!          set up.
+
+bool
+RspListener::rspListen (int  backlog)
+{
+  if (isListening ())
+    return  true;
+
+  int  tmpFd = isLocal () ? openLocal () : openTcp ();
+
+  if (tmpFd < 0)
+    return  false;
+
+  if (listen (tmpFd, backlog))
+    {
+      cerr << "ERROR: Cannot listen on RSP socket" << endl;
+      close (tmpFd);
+      return  false;
+    }
+
+  listenFd = tmpFd;
+
+  if (! traceFlags->traceSilent ())
+    {
+      if (isLocal ())
+	cout << "Listening for RSP on " << sockPath << endl << flush;
+      else
+	cout << "Listening for RSP on port " <<  portNum << endl << flush;
+    }
+
+  return  true;
+
+}	// rspListen ()
+
+
+//! Stop listening for clients
+
+void
+RspListener::rspUnlisten ()
+{
+  if (isListening ())
+    {
+      close (listenFd);
+      listenFd = -1;
+
+      if (isLocal ())
+	unlink (sockPath.c_str ());
+    }
+}	// rspUnlisten ()
+
+
+//! Forget the socket we listen on
+
+//! This is for a forked child, whose parent still listens.  We close our
+//! copy of the socket, but unlike rspUnlisten (), leave any Unix domain
+//! socket in place.
+
+void
+RspListener::rspForget ()
+{
+  if (isListening ())
+    {
+      close (listenFd);
+      listenFd = -1;
+    }
+}	// rspForget ()
+
+
+//! Report if we are listening for clients
+
+//! @return  TRUE if we are listening, FALSE otherwise
+
+bool
+RspListener::isListening () const
+{
+  return  -1 != listenFd;
+
+}	// isListening ()
+
+
+//! Report if we are a Unix domain socket
+
+//! @return  TRUE if we are a Unix domain socket, FALSE if a TCP port
+
+bool
+RspListener::isLocal () const
+{
+  return  -1 == portNum;
+
+}	// isLocal ()
+
+
+//! Accept a client
+
+//! Blocks until a client connects.
+
+//! @return  The file descriptor of the client, or -1 if none could be
+//!          accepted.
+
+int
+RspListener::rspAccept ()
+{
+  struct sockaddr_in  sockAddr;
+  socklen_t  len = sizeof (sockAddr);		// Size of the socket address
+  int  clientFd;
+
+  // A Unix domain client has no address worth knowing.
+
+  if (isLocal ())
+    clientFd = accept (listenFd, nullptr, nullptr);
+  else
+    clientFd = accept (listenFd, (struct sockaddr *)&sockAddr, &len);
+
+  if (-1 == clientFd)
+    {
+      cerr << "Warning: Failed to accept RSP client: " << strerror (errno)
+	   << endl;
+      return  -1;
+    }
+
+  if (traceFlags->traceSilent ())
+    return  clientFd;
+
+  if (isLocal ())
+    cout << "Remote debugging from " << sockPath << endl;
+  else
+    {
+      char  host[INET_ADDRSTRLEN];	// Not inet_ntoa, which isn't reentrant
+
+      inet_ntop (AF_INET, &(sockAddr.sin_addr), host, sizeof (host));
+      cout << "Remote debugging from host " << host << endl;
+    }
+
+  return  clientFd;
+
+}	// rspAccept ()
+
+
+//! Open and bind a TCP socket on our port
+
+//! @return  The file descriptor of the socket, or -1 on failure.
+
+int
+RspListener::openTcp ()
+{
+  // Open a socket on which we'll listen for clients
+  int  tmpFd = socket (PF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (tmpFd < 0)
+    {
+      cerr << "ERROR: Cannot open RSP socket" << endl;
+      return  -1;
+    }
+
+  // Allow rapid reuse of the port on this socket
+  int  optval = 1;
+  setsockopt (tmpFd, SOL_SOCKET, SO_REUSEADDR, (char *)&optval,
+	      sizeof (optval));
+
+  // Bind the port to the socket
+  struct sockaddr_in  sockAddr;
+  sockAddr.sin_family      = PF_INET;
+  sockAddr.sin_port        = htons (portNum);
+  sockAddr.sin_addr.s_addr = INADDR_ANY;
+
+  if (bind (tmpFd, (struct sockaddr *) &sockAddr, sizeof (sockAddr)))
+    {
+      cerr << "ERROR: Cannot bind to RSP socket" << endl;
+      close (tmpFd);
+      return  -1;
+    }
+
+  return  tmpFd;
+
+}	// openTcp ()
+
+
+//! Open and bind a Unix domain socket on our path
+
+//! Any stale socket left at the path (perhaps by a server which was killed)
+//! is removed first.  Anything else at the path is left alone, and we fail,
+//! so a mistyped endpoint can't delete a file.
+
+//! @return  The file descriptor of the socket, or -1 on failure.
+
+int
+RspListener::openLocal ()
+{
+  struct sockaddr_un  sockAddr;
+  struct stat  st;
+
+  if (sockPath.size () >= sizeof (sockAddr.sun_path))
+    {
+      cerr << "ERROR: RSP socket path " << sockPath << " too long" << endl;
+      return  -1;
+    }
+
+  if (0 == lstat (sockPath.c_str (), &st))
+    {
+      if (! S_ISSOCK (st.st_mode))
+	{
+	  cerr << "ERROR: RSP socket path " << sockPath
+	       << " exists and is not a socket" << endl;
+	  return  -1;
+	}
+
+      unlink (sockPath.c_str ());
+    }
+
+  int  tmpFd = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (tmpFd < 0)
+    {
+      cerr << "ERROR: Cannot open RSP socket" << endl;
+      return  -1;
+    }
+
+  memset (&sockAddr, 0, sizeof (sockAddr));
+  sockAddr.sun_family = AF_UNIX;
+  strcpy (sockAddr.sun_path, sockPath.c_str ());
+
+  if (bind (tmpFd, (struct sockaddr *) &sockAddr, sizeof (sockAddr)))
+    {
+      cerr << "ERROR: Cannot bind to RSP socket " << sockPath << ": "
+	   << strerror (errno) << endl;
+      close (tmpFd);
+      return  -1;
+    }
+
+  return  tmpFd;
+
+}	// openLocal ()
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,91 @@
+// Remote Serial Protocol listening socket: declaration
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef RSP_LISTENER_H
+#define RSP_LISTENER_H
+
+#include <string>
+
+#include "TraceFlags.h"
+
+
+//! Class implementing the socket on which we listen for RSP clients
+
+//! This just binds and listens on the port, and accepts clients, which are
+//! then served through an RspConnection.  Any number of threads may accept
+//! clients from the same listener at once.
+
+//! We may listen on a TCP port, or on a Unix domain socket, which avoids the
+//! TCP stack altogether when GDB (or a harness) is on the same machine.
+
+class RspListener
+{
+public:
+
+  // Constructor and destructor
+
+  RspListener (int         _portNum,
+	       TraceFlags *_traceFlags);
+  RspListener (const std::string & _sockPath,
+	       TraceFlags *_traceFlags);
+  ~RspListener ();
+
+  // Public interface: listen for and accept clients
+
+  bool  rspListen (int  backlog);
+  void  rspUnlisten ();
+  void  rspForget ();
+  bool  isListening () const;
+  bool  isLocal () const;
+  int   rspAccept ();
+
+private:
+
+  //! The port number to listen on, or -1 for a Unix domain socket
+
+  int  portNum;
+
+  //! The path of the Unix domain socket to listen on, if not a port
+
+  std::string  sockPath;
+
+  //! The listening file descriptor
+
+  int  listenFd;
+
+  //! Trace flags
+
+  TraceFlags *traceFlags;
+
+  // Helper methods to open each type of socket
+
+  int  openTcp ();
+  int  openLocal ();
+
+};	// RspListener ()
+
+#endif	// RSP_LISTENER_H
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,398 @@
+// Counters and latency histograms for the server: definition
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+
+#include "ServerStats.h"
+
+using std::endl;
+using std::fixed;
+using std::left;
+using std::ostream;
+using std::right;
+using std::setprecision;
+using std::setw;
+using std::string;
+
+
+//! The top of a histogram bucket
+
+//! @param[in] b  The bucket
+//! @return  The time at the top of the bucket in nanoseconds
+
+static uint64_t
+bucketTop (int  b)
+{
+  return  (b >= 63) ? UINT64_MAX : (static_cast<uint64_t> (1) << (b + 1));
+
+}	// bucketTop ()
+
+
+//! A time in nanoseconds as microseconds
+
+//! @param[in] ns  The time in nanoseconds
+//! @return  The time in microseconds
+
+static double
+usec (uint64_t  ns)
+{
+  return  static_cast<double> (ns) / 1.0e3;
+
+}	// usec ()
+
+
+//! Estimate a quantile of the times recorded
+
+//! We can only say which bucket the quantile is in, so give the top of that
+//! bucket, which is within a factor of two.  Nothing was longer than the
+//! longest time, so it is never more than that.
+
+//! @param[in] q  The quantile, between 0 and 1
+//! @return  The estimated quantile in nanoseconds
+
+uint64_t
+ServerStats::Entry::quantile (double  q) const
+{
+  uint64_t  want = static_cast<uint64_t> (q * static_cast<double> (count));
+  uint64_t  seen = 0;
+
+  if (0 == count)
+    return  0;
+
+  if (want >= count)
+    want = count - 1;
+
+  for (int  b = 0; b < NUM_BUCKETS; b++)
+    {
+      seen += hist[b];
+
+      if (seen > want)
+	return  (bucketTop (b) < maxNs) ? bucketTop (b) : maxNs;
+    }
+
+  return  maxNs;
+
+}	// ServerStats::Entry::quantile ()
+
+
+//! Constructor
+
+ServerStats::ServerStats ()
+{
+  reset ();
+
+}	// ServerStats ()
+
+
+//! Destructor
+
+ServerStats::~ServerStats ()
+{
+}	// ~ServerStats ()
+
+
+//! Forget everything so far
+
+void
+ServerStats::reset ()
+{
+  memset (mPackets, 0, sizeof (mPackets));
+  memset (mTarget, 0, sizeof (mTarget));
+  mStart  = std::chrono::steady_clock::now ();
+  mCycles = 0;
+  mInstrs = 0;
+
+}	// reset ()
+
+
+//! Report the statistics as a table
+
+//! Only packets and calls we have seen are reported.  Times are in
+//! microseconds, except the total, which is in milliseconds.
+
+//! @param[in] s         The stream for the report
+//! @param[in] bytesIn   Bytes received on the connection
+//! @param[in] bytesOut  Bytes sent on the connection
+
+void
+ServerStats::report (ostream & s,
+		     uint64_t  bytesIn,
+		     uint64_t  bytesOut) const
+{
+  reportHeader (s, "Packet");
+
+  for (int  t = 0; t < NUM_PACKET_TYPES; t++)
+    if (0 != mPackets[t].count)
+      {
+	char  name[8];
+
+	if (isgraph (t))
+	  sprintf (name, "%c", t);
+	else
+	  sprintf (name, "\\x%02x", t);
+
+	reportEntry (s, name, mPackets[t]);
+      }
+
+  s << endl;
+  reportHeader (s, "Target call");
+
+  for (int  c = 0; c < NUM_TARGET_CALLS; c++)
+    if (0 != mTarget[c].count)
+      reportEntry (s, callName (c), mTarget[c]);
+
+  s << endl
+    << "Bytes in: " << bytesIn << ", bytes out: " << bytesOut << endl;
+
+}	// report ()
+
+
+//! Dump the statistics as JSON
+
+//! Unlike the report, this has everything, including the histograms, which
+//! count the times from 2^i to 2^(i+1) nanoseconds in entry i.
+
+//! @param[in] s         The stream for the dump
+//! @param[in] bytesIn   Bytes received on the connection
+//! @param[in] bytesOut  Bytes sent on the connection
+
+void
+ServerStats::dumpJson (ostream & s,
+		       uint64_t  bytesIn,
+		       uint64_t  bytesOut) const
+{
+  const char *sep = "";
+
+  s << "{" << endl
+    << "  \"packets\": {";
+
+  for (int  t = 0; t < NUM_PACKET_TYPES; t++)
+    if (0 != mPackets[t].count)
+      {
+	char  name[8];
+
+	if (isgraph (t) && ('"' != t) && ('\\' != t))
+	  sprintf (name, "%c", t);
+	else
+	  sprintf (name, "\\u%04x", t);
+
+	s << sep << endl << "    \"" << name << "\": ";
+	dumpEntry (s, mPackets[t]);
+	sep = ",";
+      }
+
+  s << endl << "  }," << endl
+    << "  \"target\": {";
+  sep = "";
+
+  for (int  c = 0; c < NUM_TARGET_CALLS; c++)
+    if (0 != mTarget[c].count)
+      {
+	s << sep << endl << "    \"" << callName (c) << "\": ";
+	dumpEntry (s, mTarget[c]);
+	sep = ",";
+      }
+
+  s << endl << "  }," << endl
+    << "  \"bytes\": { \"in\": " << bytesIn << ", \"out\": " << bytesOut
+    << " }" << endl
+    << "}" << endl;
+
+}	// dumpJson ()
+
+
+//! Report the speed of the model, and where the time went
+
+//! The speed is what was simulated over the time spent resuming the
+//! target, so it is the speed of the model alone.  Of the rest of the time,
+//! some was spent in other calls to the target, some handling packets, and
+//! the remainder waiting for the client.  While the target runs in non-stop
+//! mode, its time overlaps with the others, so they may add up to more than
+//! the total.
+
+//! @param[in] s  The stream for the report
+
+void
+ServerStats::reportSpeed (ostream & s) const
+{
+  double  wall = std::chrono::duration <double>
+    (std::chrono::steady_clock::now () - mStart).count ();
+  double  run = static_cast<double> (mTarget[RESUME].totalNs) / 1.0e9;
+  double  target = 0.0;
+  double  packets = 0.0;
+
+  for (int  c = 0; c < NUM_TARGET_CALLS; c++)
+    target += static_cast<double> (mTarget[c].totalNs) / 1.0e9;
+
+  for (int  t = 0; t < NUM_PACKET_TYPES; t++)
+    packets += static_cast<double> (mPackets[t].totalNs) / 1.0e9;
+
+  // Handling packets includes any calls to the target
+  double  protocol = (packets > target) ? packets - target : 0.0;
+  double  idle = wall - target - protocol;
+
+  idle = (idle > 0.0) ? idle : 0.0;
+  wall = (wall > 0.0) ? wall : 1.0e-9;
+
+  s << fixed << setprecision (3)
+    << "Cycles simulated:       " << mCycles;
+
+  if (run > 0.0)
+    s << " (" << (static_cast<double> (mCycles) / run / 1.0e6) << " MHz)";
+
+  s << endl
+    << "Instructions simulated: " << mInstrs;
+
+  if (run > 0.0)
+    s << " (" << setprecision (1)
+      << (static_cast<double> (mInstrs) / run / 1.0e3) << " KIPS)";
+
+  s << endl
+    << setprecision (3)
+    << "Total time:             " << wall << " s" << endl
+    << "  Running the target:   " << run << " s ("
+    << setprecision (1) << (run / wall * 100.0) << "%)" << endl
+    << setprecision (3)
+    << "  Other target calls:   " << (target - run) << " s ("
+    << setprecision (1) << ((target - run) / wall * 100.0) << "%)" << endl
+    << setprecision (3)
+    << "  Handling packets:     " << protocol << " s ("
+    << setprecision (1) << (protocol / wall * 100.0) << "%)" << endl
+    << setprecision (3)
+    << "  Waiting for client:   " << idle << " s ("
+    << setprecision (1) << (idle / wall * 100.0) << "%)" << endl;
+
+}	// reportSpeed ()
+
+
+//! The name of a type of call to the target
+
+//! @param[in] call  The type of call
+//! @return  Its name
+
+const char *
+ServerStats::callName (int  call)
+{
+  switch (call)
+    {
+    case READ:           return  "read";
+    case WRITE:          return  "write";
+    case READ_REGISTER:  return  "readRegister";
+    case WRITE_REGISTER: return  "writeRegister";
+    case RESUME:         return  "resume";
+    default:             return  "unknown";
+    }
+}	// callName ()
+
+
+//! How much a count went up by
+
+//! A cold reset puts the target's counts back to zero, so if a count went
+//! down, it must have started again from zero.
+
+//! @param[in] before  The count before
+//! @param[in] after   The count after
+//! @return  How much it went up by
+
+uint64_t
+ServerStats::delta (uint64_t  before,
+		    uint64_t  after)
+{
+  return  (after >= before) ? after - before : after;
+
+}	// delta ()
+
+
+//! Report the heading of a table
+
+//! @param[in] s     The stream for the report
+//! @param[in] what  What each line of the table is for
+
+void
+ServerStats::reportHeader (ostream & s,
+			   const string & what)
+{
+  s << left << setw (16) << what << right
+    << setw (10) << "Count"
+    << setw (12) << "Total(ms)"
+    << setw (10) << "Mean(us)"
+    << setw (10) << "p50(us)"
+    << setw (10) << "p99(us)"
+    << setw (10) << "Max(us)" << endl;
+
+}	// reportHeader ()
+
+
+//! Report one line of the table
+
+//! @param[in] s     The stream for the report
+//! @param[in] name  What the line is for
+//! @param[in] e     The statistics
+
+void
+ServerStats::reportEntry (ostream & s,
+			  const string & name,
+			  const Entry & e)
+{
+  s << left << setw (16) << name << right
+    << setw (10) << e.count
+    << fixed << setprecision (3)
+    << setw (12) << (static_cast<double> (e.totalNs) / 1.0e6)
+    << setprecision (1)
+    << setw (10) << usec (e.totalNs / e.count)
+    << setw (10) << usec (e.quantile (0.5))
+    << setw (10) << usec (e.quantile (0.99))
+    << setw (10) << usec (e.maxNs) << endl;
+
+}	// reportEntry ()
+
+
+//! Dump one entry as a JSON object
+
+//! @param[in] s  The stream for the dump
+//! @param[in] e  The statistics
+
+void
+ServerStats::dumpEntry (ostream & s,
+			const Entry & e)
+{
+  s << "{ \"count\": " << e.count
+    << ", \"total_ns\": " << e.totalNs
+    << ", \"max_ns\": " << e.maxNs
+    << ", \"histogram\": [";
+
+  for (int  b = 0; b < NUM_BUCKETS; b++)
+    s << ((0 == b) ? "" : ", ") << e.hist[b];
+
+  s << "] }";
+
+}	// dumpEntry ()
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,303 @@
+// Counters and latency histograms for the server: declaration
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+
+#ifndef SERVER_STATS_H
+#define SERVER_STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "ITarget.h"
+
+
+//! Counters and latency histograms for the server, cheap enough to leave on
+
+//! We keep a count, the total and greatest time, and a histogram of times,
+//! for each type of RSP packet (by its first character) and for each type
+//! of call to the target (@see TargetCall).  The histogram has a bucket for
+//! each power of two nanoseconds, so recording a time is just a few adds.
+
+//! A Timer times whatever is done while it is in scope, so a caller need
+//! only declare one, and all the ways out of its scope are timed.  A
+//! RunTimer is for resuming the target, and also counts the cycles and
+//! instructions simulated, from which we can work out the speed of the
+//! model.
+
+//! The counts are not atomic.  The owner must make sure only one thread
+//! records at once, which the server does by holding the target while it
+//! handles a packet or calls the target.
+
+class ServerStats
+{
+public:
+
+  //! The calls to the target we time
+
+  enum TargetCall
+    {
+      READ,				//!< ITarget::read ()
+      WRITE,				//!< ITarget::write ()
+      READ_REGISTER,			//!< ITarget::readRegister ()
+      WRITE_REGISTER,			//!< ITarget::writeRegister ()
+      RESUME,				//!< ITarget::resume ()
+      NUM_TARGET_CALLS			//!< Not a call, just how many
+    };
+
+  //! Number of histogram buckets.  The last bucket holds everything from
+  //! 2^(NUM_BUCKETS - 1) ns (about 9 minutes) up.
+
+  static const int  NUM_BUCKETS = 40;
+
+  //! The statistics for one thing we time
+
+  struct Entry
+  {
+    uint64_t  count;			//!< How many times
+    uint64_t  totalNs;			//!< Total time in nanoseconds
+    uint64_t  maxNs;			//!< Greatest time in nanoseconds
+    uint64_t  hist[NUM_BUCKETS];	//!< Bucket i counts times in
+					//!< [2^i, 2^(i+1)) ns
+
+    void  record (uint64_t  ns);
+    uint64_t  quantile (double  q) const;
+  };
+
+  //! Time whatever is done while in scope
+
+  class Timer
+  {
+  public:
+
+    Timer (Entry & _entry);
+    ~Timer ();
+
+  private:
+
+    //! Where to record the time
+
+    Entry &  mEntry;
+
+    //! When we started
+
+    std::chrono::steady_clock::time_point  mStart;
+  };
+
+  //! Time resuming the target, and count what it simulates, while in scope
+
+  class RunTimer
+  {
+  public:
+
+    RunTimer (ServerStats * _stats,
+	      const ITarget * _cpu);
+    ~RunTimer ();
+
+  private:
+
+    //! Where to record the time and counts
+
+    ServerStats *  mStats;
+
+    //! The target being resumed
+
+    const ITarget *  mCpu;
+
+    //! The cycle and instruction counts when we started
+
+    uint64_t  mCycles;
+    uint64_t  mInstrs;
+
+    //! Time the resume
+
+    Timer  mTimer;
+  };
+
+  // Constructor and destructor
+
+  ServerStats ();
+  ~ServerStats ();
+
+  // Where to record
+
+  Entry &  packet (char  type);
+  Entry &  target (TargetCall  call);
+
+  // Forget everything so far
+
+  void  reset ();
+
+  // Report, given the bytes each way on the connection
+
+  void  report (std::ostream & s,
+		uint64_t  bytesIn,
+		uint64_t  bytesOut) const;
+  void  dumpJson (std::ostream & s,
+		  uint64_t  bytesIn,
+		  uint64_t  bytesOut) const;
+  void  reportSpeed (std::ostream & s) const;
+
+private:
+
+  //! Number of packet types.  Packets are ASCII, so just the range of 7
+  //! bits.
+
+  static const int  NUM_PACKET_TYPES = 128;
+
+  //! For each type of packet
+
+  Entry  mPackets[NUM_PACKET_TYPES];
+
+  //! For each type of call to the target
+
+  Entry  mTarget[NUM_TARGET_CALLS];
+
+  //! When we started counting
+
+  std::chrono::steady_clock::time_point  mStart;
+
+  //! Cycles and instructions simulated while resuming the target
+
+  uint64_t  mCycles;
+  uint64_t  mInstrs;
+
+  // Helper methods
+
+  static const char * callName (int  call);
+  static uint64_t  delta (uint64_t  before,
+			  uint64_t  after);
+  static void  reportHeader (std::ostream & s,
+			     const std::string & what);
+  static void  reportEntry (std::ostream & s,
+			    const std::string & name,
+			    const Entry & e);
+  static void  dumpEntry (std::ostream & s,
+			  const Entry & e);
+
+};	// class ServerStats
+
+
+//! Record one time
+
+//! The bucket is the position of the top bit set, which is one instruction
+//! on most hosts.
+
+//! @param[in] ns  The time in nanoseconds
+
+inline void
+ServerStats::Entry::record (uint64_t  ns)
+{
+  int  b = (0 == ns) ? 0 : 63 - __builtin_clzll (ns);
+
+  count++;
+  totalNs += ns;
+  maxNs = (ns > maxNs) ? ns : maxNs;
+  hist[(b < NUM_BUCKETS) ? b : NUM_BUCKETS - 1]++;
+
+}	// ServerStats::Entry::record ()
+
+
+//! Start timing
+
+//! @param[in] _entry  Where to record the time
+
+inline
+ServerStats::Timer::Timer (Entry & _entry) :
+  mEntry (_entry),
+  mStart (std::chrono::steady_clock::now ())
+{
+}	// ServerStats::Timer::Timer ()
+
+
+//! Stop timing, and record the time
+
+inline
+ServerStats::Timer::~Timer ()
+{
+  mEntry.record (std::chrono::duration_cast<std::chrono::nanoseconds>
+		 (std::chrono::steady_clock::now () - mStart).count ());
+
+}	// ServerStats::Timer::~Timer ()
+
+
+//! Start timing a resume, noting where the counts start
+
+//! @param[in] _stats  Where to record the time and counts
+//! @param[in] _cpu    The target being resumed
+
+inline
+ServerStats::RunTimer::RunTimer (ServerStats * _stats,
+				 const ITarget * _cpu) :
+  mStats (_stats),
+  mCpu (_cpu),
+  mCycles (_cpu->getCycleCount ()),
+  mInstrs (_cpu->getInstrCount ()),
+  mTimer (_stats->target (RESUME))
+{
+}	// ServerStats::RunTimer::RunTimer ()
+
+
+//! Stop timing a resume, and add what was simulated
+
+inline
+ServerStats::RunTimer::~RunTimer ()
+{
+  mStats->mCycles += delta (mCycles, mCpu->getCycleCount ());
+  mStats->mInstrs += delta (mInstrs, mCpu->getInstrCount ());
+
+}	// ServerStats::RunTimer::~RunTimer ()
+
+
+//! Where to record a type of packet
+
+//! @param[in] type  The first character of the packet
+//! @return  The entry for that type of packet
+
+inline ServerStats::Entry &
+ServerStats::packet (char  type)
+{
+  return  mPackets[static_cast<unsigned char> (type) % NUM_PACKET_TYPES];
+
+}	// ServerStats::packet ()
+
+
+//! Where to record a call to the target
+
+//! @param[in] call  The type of call
+//! @return  The entry for that type of call
+
+inline ServerStats::Entry &
+ServerStats::target (TargetCall  call)
+{
+  return  mTarget[call];
+
+}	// ServerStats::target ()
+
+#endif	// SERVER_STATS_H
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,164 @@
+// GDB sessions each served by a forked process: implementation
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "GdbServer.h"
+#include "ITarget.h"
+#include "RspConnection.h"
+#include "SessionForker.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::flush;
+
+
+//! Constructor
+
+//! We don't start listening until we are run.
+
+//! @param[in] _listener    Where to listen for clients
+//! @param[in] _cpu         The target, already set up for a client
+//! @param[in] _traceFlags  Flags controlling tracing
+//! @param[in] _pktSize     Maximum RSP packet size
+
+SessionForker::SessionForker (RspListener *_listener,
+			      ITarget     *_cpu,
+			      TraceFlags  *_traceFlags,
+			      int          _pktSize) :
+  listener (_listener),
+  cpu (_cpu),
+  traceFlags (_traceFlags),
+  pktSize (_pktSize)
+{
+
+}	// SessionForker ()
+
+
+//! Destructor
+
+//! The listener and the target are not ours to delete.
+
+SessionForker::~SessionForker ()
+{
+
+}	// ~SessionForker ()
+
+
+//! Serve clients
+
+//! Accept clients for ever, forking a child to serve each one.  We never
+//! wait for the children, so we ignore SIGCHLD, which has them reaped for
+//! us as they exit.
+
+//! Clients may connect while we fork, so there is room for as many waiting
+//! clients as the system allows.
+
+//! @return  EXIT_FAILURE if we could not listen or accept clients.
+//!          Otherwise does not return.  In a child, does not return either,
+//!          since the child exits once its client has gone.
+
+int
+SessionForker::run ()
+{
+  if (!listener->rspListen (SOMAXCONN))
+    {
+      cerr << "*** Unable to listen for RSP clients: ABORTING" << endl;
+      return  EXIT_FAILURE;
+    }
+
+  signal (SIGCHLD, SIG_IGN);
+
+  for (;;)
+    {
+      RspConnection  conn (listener, traceFlags);
+
+      if (!conn.rspConnect ())
+	return  EXIT_FAILURE;		// Serious failure
+
+      if (!conn.isConnected ())
+	continue;			// Retry
+
+      // Anything still buffered would be written again by the child.
+
+      cout << flush;
+
+      pid_t  pid = fork ();
+
+      if (0 == pid)
+	{
+	  signal (SIGCHLD, SIG_DFL);
+	  listener->rspForget ();
+	  exit (serve (conn));
+	}
+
+      if (pid < 0)
+	{
+	  cerr << "Warning: Cannot fork to serve RSP client: "
+	       << strerror (errno) << endl;
+	  continue;			// Drops the client
+	}
+
+      if (traceFlags->traceConn ())
+	cout << "RSP client served by process " << pid << endl;
+
+      // The client is the child's now.
+
+      conn.rspForget ();
+    }
+}	// run ()
+
+
+//! Serve one client, in the child forked for it
+
+//! The target is ours alone, so a kill ends the session, and with it the
+//! child.
+
+//! @param[in] conn  The connection to the client
+//! @return  The return code for the child.
+
+int
+SessionForker::serve (RspConnection & conn)
+{
+  GdbServer  server (&conn, cpu, traceFlags,
+		     GdbServer::KillBehaviour::EXIT_ON_KILL, pktSize);
+  cpu->gdbServer (&server);
+  int  ret = server.rspServer ();
+  cpu->gdbServer (nullptr);
+  conn.rspClose ();
+
+  return  ret;
+
+}	// serve ()
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,91 @@
+// GDB sessions each served by a forked process: declaration
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SESSION_FORKER_H
+#define SESSION_FORKER_H
+
+#include "RspListener.h"
+#include "TraceFlags.h"
+
+class ITarget;
+class RspConnection;
+
+
+//! Class serving each GDB client in a process of its own
+
+//! The target is built, and any program loaded into it, just once, before
+//! we start listening.  Each client is then served by a child forked for
+//! it, which gets the target as it was, copy on write, so the expensive
+//! setup is never repeated.  The parent only accepts clients and forks, so
+//! as many clients may be served at once as there are connections, each
+//! free to do what it likes to its own copy of the target.
+
+//! The target must not have threads of its own (as a group of harts or a
+//! VCD writer does), since a forked child has only the thread which forked
+//! it.
+
+class SessionForker
+{
+public:
+
+  // Constructor and destructor
+
+  SessionForker (RspListener *_listener,
+		 ITarget     *_cpu,
+		 TraceFlags  *_traceFlags,
+		 int          _pktSize);
+  ~SessionForker ();
+
+  // Serve clients.  Only returns if we can't listen.
+
+  int  run ();
+
+private:
+
+  //! Where our clients come from
+
+  RspListener *listener;
+
+  //! The target, ready for a client, of which each child gets a copy
+
+  ITarget *cpu;
+
+  //! Trace flags
+
+  TraceFlags *traceFlags;
+
+  //! Maximum RSP packet size
+
+  int  pktSize;
+
+  // Serve one client in a forked child
+
+  int  serve (RspConnection & conn);
+
+};	// SessionForker ()
+
+#endif	// SESSION_FORKER_H
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
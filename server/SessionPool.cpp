@@ -0,0 +1,167 @@
+// Pool of GDB sessions served at once: implementation
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "GdbServer.h"
+#include "ITarget.h"
+#include "RspConnection.h"
+#include "SessionPool.h"
+
+using std::cerr;
+using std::endl;
+using std::thread;
+using std::vector;
+
+
+//! Constructor
+
+//! We don't start listening until we are run.
+
+//! @param[in] _listener      Where to listen for clients
+//! @param[in] _numWorkers    How many clients to serve at once
+//! @param[in] _createTarget  How to build a target
+//! @param[in] _traceFlags    Flags controlling tracing
+//! @param[in] _pktSize       Maximum RSP packet size
+//! @param[in] _setupTarget   How to get a target ready for each client.
+//!                           Defaults to doing nothing.
+
+SessionPool::SessionPool (RspListener   *_listener,
+			  int            _numWorkers,
+			  TargetFactory  _createTarget,
+			  TraceFlags    *_traceFlags,
+			  int            _pktSize,
+			  TargetSetup    _setupTarget) :
+  listener (_listener),
+  numWorkers (_numWorkers),
+  createTarget (_createTarget),
+  setupTarget (_setupTarget),
+  traceFlags (_traceFlags),
+  pktSize (_pktSize)
+{
+
+}	// SessionPool ()
+
+
+//! Destructor
+
+//! The listener is not ours to close.
+
+SessionPool::~SessionPool ()
+{
+
+}	// ~SessionPool ()
+
+
+//! Serve clients
+
+//! Start listening, with room for as many waiting clients as we have
+//! workers, then start the workers.  They run for ever.
+
+//! @return  EXIT_FAILURE if we could not listen.  Otherwise does not return.
+
+int
+SessionPool::run ()
+{
+  if (!listener->rspListen (numWorkers))
+    {
+      cerr << "*** Unable to listen for RSP clients: ABORTING" << endl;
+      return  EXIT_FAILURE;
+    }
+
+  vector<thread>  workers;
+
+  for (int  i = 0; i < numWorkers; i++)
+    workers.push_back (thread (&SessionPool::worker, this));
+
+  for (auto & w : workers)
+    w.join ();
+
+  return  EXIT_SUCCESS;
+
+}	// run ()
+
+
+//! Serve clients one after another
+
+//! The target is built on the first client, in this thread, so anything the
+//! model keeps per thread is right.  Kill just ends the session, since other
+//! clients are still being served.
+
+void
+SessionPool::worker ()
+{
+  TraceFlags  flags (*traceFlags);
+  ITarget *cpu = nullptr;
+
+  for (;;)
+    {
+      RspConnection  conn (listener, &flags);
+
+      if (!conn.rspConnect ())
+	break;				// Serious failure
+
+      if (!conn.isConnected ())
+	continue;			// Retry
+
+      if (nullptr == cpu)
+	{
+	  cpu = createTarget (&flags);
+
+	  if (nullptr == cpu)
+	    break;
+	}
+
+      // A target which can't be got ready won't be any better next time.
+
+      if (setupTarget && !setupTarget (cpu))
+	break;
+
+      GdbServer  server (&conn, cpu, &flags,
+			 GdbServer::KillBehaviour::EXIT_ON_KILL, pktSize);
+      cpu->gdbServer (&server);
+      (void) server.rspServer ();
+      cpu->gdbServer (nullptr);
+
+      // Get the target ready for the next client, unless this one left it
+      // in a state we can't undo.
+
+      if (server.holdingMatchpoints ()
+	  || (ITarget::ResumeRes::SUCCESS
+	      != cpu->reset (ITarget::ResetType::COLD)))
+	{
+	  delete  cpu;
+	  cpu = nullptr;
+	}
+    }
+
+  delete  cpu;
+
+}	// worker ()
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
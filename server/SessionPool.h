@@ -0,0 +1,108 @@
+// Pool of GDB sessions served at once: declaration
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SESSION_POOL_H
+#define SESSION_POOL_H
+
+#include <functional>
+
+#include "RspListener.h"
+#include "TraceFlags.h"
+
+class ITarget;
+
+
+//! Class serving many GDB clients at once from one port
+
+//! A fixed number of worker threads take clients from a shared listener.
+//! Each client gets a session of its own, with its own GDB server and
+//! target.  Targets are expensive to build (particularly Verilator models),
+//! so each worker builds its target once, in its own thread, and reuses it
+//! for client after client, with a cold reset in between.  If a client
+//! leaves matchpoints behind, the target is thrown away and rebuilt for the
+//! next client instead.
+
+class SessionPool
+{
+public:
+
+  //! How to build a target, given its trace flags
+
+  typedef std::function<ITarget * (TraceFlags *)>  TargetFactory;
+
+  //! How to get a target ready for a client, for example by loading a
+  //! program.  Returns FALSE if this could not be done.
+
+  typedef std::function<bool (ITarget *)>  TargetSetup;
+
+  // Constructor and destructor
+
+  SessionPool (RspListener   *_listener,
+	       int            _numWorkers,
+	       TargetFactory  _createTarget,
+	       TraceFlags    *_traceFlags,
+	       int            _pktSize,
+	       TargetSetup    _setupTarget = nullptr);
+  ~SessionPool ();
+
+  // Serve clients.  Only returns if we can't listen.
+
+  int  run ();
+
+private:
+
+  //! Where our clients come from
+
+  RspListener *listener;
+
+  //! How many clients we serve at once
+
+  int  numWorkers;
+
+  //! How to build a target
+
+  TargetFactory  createTarget;
+
+  //! How to get a target ready for each client, if anything is needed
+
+  TargetSetup  setupTarget;
+
+  //! Trace flags, which each worker takes a copy of
+
+  TraceFlags *traceFlags;
+
+  //! Maximum RSP packet size
+
+  int  pktSize;
+
+  // Serve clients one after another in one thread
+
+  void  worker ();
+
+};	// SessionPool ()
+
+#endif	// SESSION_POOL_H
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,60 @@
+// The one target a single target server is specialized for: declaration
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SINGLE_TARGET_H
+#define SINGLE_TARGET_H
+
+//! When configured with --with-single-target, the server is specialized for
+//! that target's concrete class, so that its calls to the target need not
+//! be virtual.  The configure option defines just one of the macros below,
+//! and we define SingleTarget as the class it names, and HAVE_SINGLE_TARGET
+//! to show we have done so.
+
+//! Without the option, HAVE_SINGLE_TARGET is not defined, and the server
+//! uses only the general ITarget interface.
+
+#if defined (SINGLE_TARGET_RI5CY)
+
+#include "Ri5cy.h"
+typedef Ri5cy  SingleTarget;
+#define HAVE_SINGLE_TARGET 1
+
+#elif defined (SINGLE_TARGET_PICORV32)
+
+#include "Picorv32.h"
+typedef Picorv32  SingleTarget;
+#define HAVE_SINGLE_TARGET 1
+
+#elif defined (SINGLE_TARGET_GDBSIM)
+
+#include "GdbSim.h"
+typedef GdbSim  SingleTarget;
+#define HAVE_SINGLE_TARGET 1
+
+#endif
+
+#endif	// SINGLE_TARGET_H
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,177 @@
+// Lock-free single producer, single consumer byte queue: definition
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+
+#include <cstring>
+
+#include "SpscQueue.h"
+
+
+//! Constructor
+
+//! @param[in] capacity  The least number of bytes the queue must hold.  We
+//!                      round this up to a power of two.
+
+SpscQueue::SpscQueue (std::size_t  capacity) :
+  mHead (0),
+  mTail (0),
+  mClosed (false)
+{
+  std::size_t  size = 1;
+
+  while (size < capacity)
+    size <<= 1;
+
+  mBuf.resize (size);
+  mMask = size - 1;
+
+}	// SpscQueue ()
+
+
+//! Destructor
+
+SpscQueue::~SpscQueue ()
+{
+}	// ~SpscQueue ()
+
+
+//! Put bytes in the queue
+
+//! Only the writer may call this.
+
+//! @param[in] buf  The bytes to put in
+//! @param[in] len  How many bytes to put in
+//! @return  How many bytes there was room for, which may be none
+
+std::size_t
+SpscQueue::push (const char *buf,
+		 std::size_t  len)
+{
+  std::size_t  tail = mTail.load (std::memory_order_relaxed);
+  std::size_t  head = mHead.load (std::memory_order_acquire);
+  std::size_t  room = mBuf.size () - (tail - head);
+
+  if (len > room)
+    len = room;
+
+  // Copy in at most two pieces, either side of the end of the buffer
+  std::size_t  off = tail & mMask;
+  std::size_t  first = ((mBuf.size () - off) < len) ? mBuf.size () - off : len;
+
+  memcpy (&(mBuf[off]), buf, first);
+  memcpy (&(mBuf[0]), buf + first, len - first);
+
+  mTail.store (tail + len, std::memory_order_release);
+  return  len;
+
+}	// push ()
+
+
+//! Take bytes out of the queue
+
+//! Only the reader may call this.
+
+//! @param[out] buf  Where to put the bytes taken out
+//! @param[in]  len  The most bytes to take out
+//! @return  How many bytes were taken out, which may be none
+
+std::size_t
+SpscQueue::pop (char *buf,
+		std::size_t  len)
+{
+  std::size_t  head = mHead.load (std::memory_order_relaxed);
+  std::size_t  tail = mTail.load (std::memory_order_acquire);
+  std::size_t  avail = tail - head;
+
+  if (len > avail)
+    len = avail;
+
+  std::size_t  off = head & mMask;
+  std::size_t  first = ((mBuf.size () - off) < len) ? mBuf.size () - off : len;
+
+  memcpy (buf, &(mBuf[off]), first);
+  memcpy (buf + first, &(mBuf[0]), len - first);
+
+  mHead.store (head + len, std::memory_order_release);
+  return  len;
+
+}	// pop ()
+
+
+//! Is the queue empty?
+
+//! This is only certain for the reader, since the writer may add to it at
+//! any time.
+
+//! @return  TRUE if there is nothing in the queue, FALSE otherwise
+
+bool
+SpscQueue::empty () const
+{
+  return  mHead.load (std::memory_order_relaxed)
+    == mTail.load (std::memory_order_acquire);
+
+}	// empty ()
+
+
+//! How many bytes the queue can hold
+
+//! @return  The capacity of the queue
+
+std::size_t
+SpscQueue::capacity () const
+{
+  return  mBuf.size ();
+
+}	// capacity ()
+
+
+//! Say there is no more to come
+
+//! Only the writer may call this.  Since it comes after any bytes the writer
+//! put in, a reader which sees the queue closed and then finds it empty
+//! knows that it has had everything.
+
+void
+SpscQueue::close ()
+{
+  mClosed.store (true, std::memory_order_release);
+
+}	// close ()
+
+
+//! Has the writer said there is no more to come?
+
+//! @return  TRUE if the queue is closed, FALSE otherwise
+
+bool
+SpscQueue::isClosed () const
+{
+  return  mClosed.load (std::memory_order_acquire);
+
+}	// isClosed ()
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,111 @@
+// Lock-free single producer, single consumer byte queue: declaration
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+
+//! A lock-free queue of bytes, for one writer and one reader
+
+//! The queue is a ring buffer whose size is a power of two.  The head, where
+//! the reader takes bytes, is only written by the reader, and the tail,
+//! where the writer puts them, only by the writer.  Each publishes its index
+//! with release ordering once it is done with the bytes, and reads the
+//! other's with acquire ordering, so no lock is needed.  The two indices are
+//! kept on separate cache lines, so the two sides don't fight over one.
+
+//! Neither side ever waits.  A push or pop does as much as it can and says
+//! how much that was.  It is up to the caller to decide how to wait.
+
+//! The writer can close the queue, to tell the reader there will be no more.
+
+class SpscQueue
+{
+public:
+
+  // Constructor and destructor
+
+  SpscQueue (std::size_t  capacity);
+  ~SpscQueue ();
+
+  // Put bytes in and take them out
+
+  std::size_t  push (const char *buf,
+		     std::size_t  len);
+  std::size_t  pop (char *buf,
+		    std::size_t  len);
+
+  // Accessors
+
+  bool  empty () const;
+  std::size_t  capacity () const;
+
+  // Say there is no more to come
+
+  void  close ();
+  bool  isClosed () const;
+
+private:
+
+  //! Size to keep the indices apart by
+
+  static const std::size_t  CACHE_LINE = 64;
+
+  //! The bytes in the queue
+
+  std::vector<char>  mBuf;
+
+  //! One less than the size of the buffer, since that is a power of two
+
+  std::size_t  mMask;
+
+  //! Where the reader takes the next byte.  Always increasing, and reduced
+  //! modulo the buffer size when used.
+
+  std::atomic<std::size_t>  mHead;
+
+  //! Keep the head and tail on different cache lines
+
+  char  mPad[CACHE_LINE - sizeof (std::atomic<std::size_t>)];
+
+  //! Where the writer puts the next byte.  Always increasing.
+
+  std::atomic<std::size_t>  mTail;
+
+  //! Set once the writer has said there is no more to come
+
+  std::atomic<bool>  mClosed;
+
+};	// class SpscQueue
+
+#endif	// SPSC_QUEUE_H
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -45,10 +45,15 @@ using std::setw;
 
 //! Sets up various parameters
 
-//! @param[in] _portNum     the port number to connect to
 //! @param[in] _traceFlags  flags controlling tracing
-StreamConnection::StreamConnection (TraceFlags *_traceFlags) :
+//! @param[in] _inFd        file descriptor to read from (default stdin)
+//! @param[in] _outFd       file descriptor to write to (default stdout)
+StreamConnection::StreamConnection (TraceFlags *_traceFlags,
+				    int  _inFd,
+				    int  _outFd) :
   AbstractConnection (_traceFlags),
+  mInFd (_inFd),
+  mOutFd (_outFd),
   mIsConnected (true)
 {
   // Nothing.
@@ -101,6 +106,7 @@ void
 StreamConnection::rspClose ()
 {
   mIsConnected = false;
+  clearBuffers ();
 }	// rspClose ()
 
 
@@ -113,23 +119,37 @@ StreamConnection::isConnected ()
   return mIsConnected;
 }	// isConnected ()
 
-//! Put a single character out on the RSP connection
+
+//! The file descriptor to watch for input from the client
+
+//! @return  The input stream while we are connected, -1 otherwise
+int
+StreamConnection::watchFd ()
+{
+  return mIsConnected ? mInFd : -1;
+}	// watchFd ()
+
+//! Put a block of characters out on the RSP connection
 
 //! Utility routine. This should only be called if the client is open, but we
 //! check for safety.
 
-//! @param[in] c         The character to put out
+//! @param[in] buf  The characters to put out
+//! @param[in] len  The number of characters to put out
 
-//! @return  TRUE if char sent OK, FALSE if not (communications failure)
+//! @return  TRUE if all chars sent OK, FALSE if not (communications failure)
 
 bool
-StreamConnection::putRspCharRaw (char  c)
+StreamConnection::putRspBlockRaw (const char  *buf,
+				  std::size_t  len)
 {
-  // Write until successful (we retry after interrupts) or catastrophic
-  // failure.
-  while (true)
+  // Write until everything is sent (we retry after interrupts and partial
+  // writes) or catastrophic failure.
+  while (len > 0)
     {
-      switch (write (STDOUT_FILENO, &c, sizeof (c)))
+      ssize_t  res = write (mOutFd, buf, len);
+
+      switch (res)
 	{
 	case -1:
 	  // Error: only allow interrupts or would block
@@ -147,30 +167,41 @@ StreamConnection::putRspCharRaw (char  c)
 	  break;		// Nothing written! Try again
 
 	default:
-	  return  true;		// Success, we can return
+	  buf += res;		// Some written, carry on with the rest
+	  len -= res;
+	  break;
 	}
     }
-}	// putRspCharRaw ()
 
+  return  true;
+
+}	// putRspBlockRaw ()
 
-//! Get a single character from the RSP connection
+
+//! Get a block of characters from the RSP connection
 
 //! Utility routine. This should only be called if the client is open, but we
 //! check for safety.
 
-//! @param[in] blocking  True if the read should block.
-//! @return  The character received or -1 on failure, or if the read would
-//!          block, and blocking is true.
+//! We return whatever is available, up to the size of the buffer.  A
+//! blocking read waits for at least one character.
+
+//! @param[out] buf       Where to put the characters received
+//! @param[in]  len       The maximum number of characters to receive
+//! @param[in]  blocking  True if the read should block.
+//! @return  The number of characters received, 0 if the read would block
+//!          and blocking is false, or -1 on failure.
 
 int
-StreamConnection::getRspCharRaw (bool blocking)
+StreamConnection::getRspBlockRaw (char        *buf,
+				  std::size_t  len,
+				  bool         blocking)
 {
   // Blocking read until successful (we retry after interrupts) or
   // catastrophic failure.
 
   for (;;)
     {
-      unsigned char  c;
       int res;
       struct timeval timeout;
       fd_set readfds;
@@ -179,9 +210,9 @@ StreamConnection::getRspCharRaw (bool blocking)
       timeout.tv_usec = 0;
 
       FD_ZERO (&readfds);
-      FD_SET (STDIN_FILENO, &readfds);
+      FD_SET (mInFd, &readfds);
 
-      res = select (STDIN_FILENO + 1,
+      res = select (mInFd + 1,
                     &readfds, NULL, NULL,
                     (blocking ? NULL : &timeout));
 
@@ -200,24 +231,24 @@ StreamConnection::getRspCharRaw (bool blocking)
   	  break;
 
   	case 0:
-          // Timeout, only happens in the blocking case.
-  	  return  -1;
+          // Timeout, only happens in the non-blocking case.
+  	  return  0;
 
   	default:
 	  {
 	    ssize_t count;
 
-	    if ((count = read (STDIN_FILENO, &c, sizeof (c))) == -1)
+	    if ((count = read (mInFd, buf, len)) == -1)
 	      return -1;
 
 	    if (count == 0)
 	      return -1;
 
-	    return  c & 0xff;	// Success, we can return (no sign extend!)
+	    return  count;	// Success, we can return
 	  }
   	}
     }
-}	// getRspCharRaw ()
+}	// getRspBlockRaw ()
 
 
 // Local Variables:
@@ -20,6 +20,8 @@
 #ifndef STREAM_CONNECTION_H
 #define STREAM_CONNECTION_H
 
+#include <unistd.h>
+
 #include "AbstractConnection.h"
 #include "TraceFlags.h"
 
@@ -28,13 +30,18 @@
 //! This class is entirely passive. It is up to the caller to determine
 //! that a packet will become available before calling ::getPkt ().
 
+//! By default the stream is standard input and output, but any pair of file
+//! descriptors will do (for example, one end of a socket pair).
+
 class StreamConnection : public AbstractConnection
 {
 public:
 
   // Constructors and destructor
 
-  StreamConnection (TraceFlags *_traceFlags);
+  StreamConnection (TraceFlags *_traceFlags,
+		    int  _inFd = STDIN_FILENO,
+		    int  _outFd = STDOUT_FILENO);
   ~StreamConnection ();
 
   // Public interface: manage client connections
@@ -42,13 +49,21 @@ public:
   virtual bool  rspConnect ();
   virtual void  rspClose ();
   virtual bool  isConnected ();
+  virtual int   watchFd ();
 
 private:
 
-  // Implementation specific routines to handle individual chars.
+  // Implementation specific routines to handle blocks of chars.
+
+  virtual bool  putRspBlockRaw (const char  *buf,
+				std::size_t  len);
+  virtual int   getRspBlockRaw (char        *buf,
+				std::size_t  len,
+				bool         blocking);
 
-  virtual bool  putRspCharRaw (char  c);
-  virtual int   getRspCharRaw (bool blocking);
+  // The file descriptors to read from and write to
+  int  mInFd;
+  int  mOutFd;
 
   // Track whether we are connected or not.
   bool mIsConnected;
@@ -20,8 +20,15 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 // ----------------------------------------------------------------------------
 
+#include <cstring>
 #include <iostream>
 
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#elif defined (__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include "Utils.h"
 
 using std::cout;
@@ -166,6 +173,266 @@ Utils::hex2Val (char *buf,
 }	// hex2Val ()
 
 
+//! Convert a block of bytes to pairs of hex digits
+
+//! Used for bulk memory transfers, so where we have SSE2 or NEON we convert
+//! 16 bytes at a time.  Otherwise, and for any tail, we index a digit table
+//! directly rather than going through hex2Char () for each nybble.  The
+//! result is null terminated for convenience, so dest must have room for
+//! (len * 2 + 1) chars.
+
+//! @param[out] dest  Buffer to store the hex digit pairs (null terminated)
+//! @param[in]  src   The bytes to convert
+//! @param[in]  len   The number of bytes to convert
+void
+Utils::bin2Hex (char          *dest,
+		const uint8_t *src,
+		std::size_t    len)
+{
+  static const char  digits[] = "0123456789abcdef";
+  std::size_t  i = 0;
+
+#if defined (__SSE2__)
+  // Split each byte into nybbles, interleave them high first, and make each
+  // into a digit, adding the gap from '9' to 'a' to those over 9.
+  const __m128i  nybMask = _mm_set1_epi8 (0x0f);
+  const __m128i  nine    = _mm_set1_epi8 (9);
+  const __m128i  zero    = _mm_set1_epi8 ('0');
+  const __m128i  gap     = _mm_set1_epi8 ('a' - '0' - 10);
+
+  for (; i + 16 <= len; i += 16)
+    {
+      __m128i  v  = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (src + i));
+      __m128i  hi = _mm_and_si128 (_mm_srli_epi16 (v, 4), nybMask);
+      __m128i  lo = _mm_and_si128 (v, nybMask);
+      __m128i  n0 = _mm_unpacklo_epi8 (hi, lo);
+      __m128i  n1 = _mm_unpackhi_epi8 (hi, lo);
+
+      n0 = _mm_add_epi8 (_mm_add_epi8 (n0, zero),
+			 _mm_and_si128 (_mm_cmpgt_epi8 (n0, nine), gap));
+      n1 = _mm_add_epi8 (_mm_add_epi8 (n1, zero),
+			 _mm_and_si128 (_mm_cmpgt_epi8 (n1, nine), gap));
+      _mm_storeu_si128 (reinterpret_cast<__m128i *> (dest + i * 2), n0);
+      _mm_storeu_si128 (reinterpret_cast<__m128i *> (dest + i * 2 + 16), n1);
+    }
+#elif defined (__ARM_NEON)
+  // As for SSE2, but the interleaving store puts the nybbles in order.
+  const uint8x16_t  nybMask = vdupq_n_u8 (0x0f);
+  const uint8x16_t  nine    = vdupq_n_u8 (9);
+  const uint8x16_t  zero    = vdupq_n_u8 ('0');
+  const uint8x16_t  gap     = vdupq_n_u8 ('a' - '0' - 10);
+
+  for (; i + 16 <= len; i += 16)
+    {
+      uint8x16_t    v = vld1q_u8 (src + i);
+      uint8x16x2_t  n;
+
+      n.val[0] = vshrq_n_u8 (v, 4);
+      n.val[1] = vandq_u8 (v, nybMask);
+      n.val[0] = vaddq_u8 (vaddq_u8 (n.val[0], zero),
+			   vandq_u8 (vcgtq_u8 (n.val[0], nine), gap));
+      n.val[1] = vaddq_u8 (vaddq_u8 (n.val[1], zero),
+			   vandq_u8 (vcgtq_u8 (n.val[1], nine), gap));
+      vst2q_u8 (reinterpret_cast<uint8_t *> (dest + i * 2), n);
+    }
+#endif
+
+  for (; i < len; i++)
+    {
+      dest[i * 2]     = digits[src[i] >> 4];
+      dest[i * 2 + 1] = digits[src[i] & 0xf];
+    }
+
+  dest[len * 2] = '\0';
+
+}	// bin2Hex ()
+
+
+//! Convert pairs of hex digits to a block of bytes
+
+//! The counterpart of bin2Hex (), so also converts 16 bytes at a time where
+//! it can.  Digits are valid in either case.
+
+//! @param[out] dest  Buffer to store the bytes
+//! @param[in]  src   The hex digit pairs (need not be null terminated)
+//! @param[in]  len   The number of bytes to convert (i.e. half the number of
+//!                   hex digits).
+//! @return  TRUE if all the digits were valid hex, FALSE otherwise.
+bool
+Utils::hex2Bin (uint8_t     *dest,
+		const char  *src,
+		std::size_t  len)
+{
+  bool  isValid = true;
+  std::size_t  i = 0;
+
+#if defined (__SSE2__)
+  // SSE2 only has signed comparisons, so we check a digit is in range by
+  // offsetting it to the bottom of the signed range (-128).  Each pair of
+  // nybbles is then a 16-bit lane, which we combine and pack back to bytes.
+  const __m128i  bias    = _mm_set1_epi8 (-128);
+  const __m128i  lower   = _mm_set1_epi8 (0x20);
+  const __m128i  decLim  = _mm_set1_epi8 (-128 + 10);
+  const __m128i  alphLim = _mm_set1_epi8 (-128 + 6);
+  const __m128i  dec0    = _mm_set1_epi8 ('0');
+  const __m128i  alph0   = _mm_set1_epi8 ('a' - 10);
+  const __m128i  alphA   = _mm_set1_epi8 ('a');
+  const __m128i  loByte  = _mm_set1_epi16 (0x00ff);
+
+  for (; i + 16 <= len; i += 16)
+    {
+      __m128i  nyb[2];
+      int      valid = 0xffff;
+
+      for (int  j = 0; j < 2; j++)
+	{
+	  __m128i  c = _mm_loadu_si128
+	    (reinterpret_cast<const __m128i *> (src + i * 2 + j * 16));
+	  __m128i  l = _mm_or_si128 (c, lower);
+	  __m128i  isDec
+	    = _mm_cmplt_epi8 (_mm_add_epi8 (_mm_sub_epi8 (c, dec0), bias),
+			      decLim);
+	  __m128i  isAlph
+	    = _mm_cmplt_epi8 (_mm_add_epi8 (_mm_sub_epi8 (l, alphA), bias),
+			      alphLim);
+
+	  nyb[j] = _mm_or_si128 (_mm_and_si128 (isDec, _mm_sub_epi8 (c, dec0)),
+				 _mm_and_si128 (isAlph,
+						_mm_sub_epi8 (l, alph0)));
+	  valid &= _mm_movemask_epi8 (_mm_or_si128 (isDec, isAlph));
+	}
+
+      isValid = isValid && (0xffff == valid);
+
+      for (int  j = 0; j < 2; j++)
+	nyb[j] = _mm_or_si128 (_mm_slli_epi16 (_mm_and_si128 (nyb[j], loByte),
+					       4),
+			       _mm_srli_epi16 (nyb[j], 8));
+
+      _mm_storeu_si128 (reinterpret_cast<__m128i *> (dest + i),
+			_mm_packus_epi16 (nyb[0], nyb[1]));
+    }
+#elif defined (__ARM_NEON)
+  // The deinterleaving load separates the high and low nybbles.
+  const uint8x16_t  lower = vdupq_n_u8 (0x20);
+  const uint8x16_t  ten   = vdupq_n_u8 (10);
+  const uint8x16_t  six   = vdupq_n_u8 (6);
+  const uint8x16_t  dec0  = vdupq_n_u8 ('0');
+  const uint8x16_t  alph0 = vdupq_n_u8 ('a' - 10);
+  const uint8x16_t  alphA = vdupq_n_u8 ('a');
+
+  for (; i + 16 <= len; i += 16)
+    {
+      uint8x16x2_t  c = vld2q_u8 (reinterpret_cast<const uint8_t *> (src
+								    + i * 2));
+      uint8x16_t    nyb[2];
+      uint8x16_t    valid = vdupq_n_u8 (0xff);
+
+      for (int  j = 0; j < 2; j++)
+	{
+	  uint8x16_t  l      = vorrq_u8 (c.val[j], lower);
+	  uint8x16_t  isDec  = vcltq_u8 (vsubq_u8 (c.val[j], dec0), ten);
+	  uint8x16_t  isAlph = vcltq_u8 (vsubq_u8 (l, alphA), six);
+
+	  nyb[j] = vorrq_u8 (vandq_u8 (isDec, vsubq_u8 (c.val[j], dec0)),
+			     vandq_u8 (isAlph, vsubq_u8 (l, alph0)));
+	  valid = vandq_u8 (valid, vorrq_u8 (isDec, isAlph));
+	}
+
+      uint64x2_t  v64 = vreinterpretq_u64_u8 (valid);
+
+      isValid = isValid
+	&& (~UINT64_C (0) == (vgetq_lane_u64 (v64, 0)
+			      & vgetq_lane_u64 (v64, 1)));
+      vst1q_u8 (dest + i, vorrq_u8 (vshlq_n_u8 (nyb[0], 4), nyb[1]));
+    }
+#endif
+
+  for (; i < len; i++)
+    {
+      uint8_t  nyb1 = char2Hex (src[i * 2]);
+      uint8_t  nyb2 = char2Hex (src[i * 2 + 1]);
+
+      isValid = isValid && (nyb1 < 16) && (nyb2 < 16);
+      dest[i] = (nyb1 << 4) | (nyb2 & 0xf);
+    }
+
+  return  isValid;
+
+}	// hex2Bin ()
+
+
+//! Compute the CRC-32 of a block of bytes, as used by GDB
+
+//! This is the CRC GDB uses for the qCRC packet (see xcrc32 in libiberty):
+//! polynomial 0x04c11db7, most significant bit first, with no reflection and
+//! no final inversion.  GDB starts with a CRC of 0xffffffff.  Blocks may be
+//! processed one after another by passing the result back in.
+
+//! @param[in] buf  The bytes to compute the CRC of
+//! @param[in] len  The number of bytes
+//! @param[in] crc  The CRC so far
+//! @return  The CRC including this block
+uint32_t
+Utils::crc32 (const uint8_t *buf,
+	      std::size_t    len,
+	      uint32_t       crc)
+{
+  static const uint32_t  crcTable[256] =
+    {
+      0x00000000, 0x04c11db7, 0x09823b6e, 0x0d4326d9, 0x130476dc, 0x17c56b6b,
+      0x1a864db2, 0x1e475005, 0x2608edb8, 0x22c9f00f, 0x2f8ad6d6, 0x2b4bcb61,
+      0x350c9b64, 0x31cd86d3, 0x3c8ea00a, 0x384fbdbd, 0x4c11db70, 0x48d0c6c7,
+      0x4593e01e, 0x4152fda9, 0x5f15adac, 0x5bd4b01b, 0x569796c2, 0x52568b75,
+      0x6a1936c8, 0x6ed82b7f, 0x639b0da6, 0x675a1011, 0x791d4014, 0x7ddc5da3,
+      0x709f7b7a, 0x745e66cd, 0x9823b6e0, 0x9ce2ab57, 0x91a18d8e, 0x95609039,
+      0x8b27c03c, 0x8fe6dd8b, 0x82a5fb52, 0x8664e6e5, 0xbe2b5b58, 0xbaea46ef,
+      0xb7a96036, 0xb3687d81, 0xad2f2d84, 0xa9ee3033, 0xa4ad16ea, 0xa06c0b5d,
+      0xd4326d90, 0xd0f37027, 0xddb056fe, 0xd9714b49, 0xc7361b4c, 0xc3f706fb,
+      0xceb42022, 0xca753d95, 0xf23a8028, 0xf6fb9d9f, 0xfbb8bb46, 0xff79a6f1,
+      0xe13ef6f4, 0xe5ffeb43, 0xe8bccd9a, 0xec7dd02d, 0x34867077, 0x30476dc0,
+      0x3d044b19, 0x39c556ae, 0x278206ab, 0x23431b1c, 0x2e003dc5, 0x2ac12072,
+      0x128e9dcf, 0x164f8078, 0x1b0ca6a1, 0x1fcdbb16, 0x018aeb13, 0x054bf6a4,
+      0x0808d07d, 0x0cc9cdca, 0x7897ab07, 0x7c56b6b0, 0x71159069, 0x75d48dde,
+      0x6b93dddb, 0x6f52c06c, 0x6211e6b5, 0x66d0fb02, 0x5e9f46bf, 0x5a5e5b08,
+      0x571d7dd1, 0x53dc6066, 0x4d9b3063, 0x495a2dd4, 0x44190b0d, 0x40d816ba,
+      0xaca5c697, 0xa864db20, 0xa527fdf9, 0xa1e6e04e, 0xbfa1b04b, 0xbb60adfc,
+      0xb6238b25, 0xb2e29692, 0x8aad2b2f, 0x8e6c3698, 0x832f1041, 0x87ee0df6,
+      0x99a95df3, 0x9d684044, 0x902b669d, 0x94ea7b2a, 0xe0b41de7, 0xe4750050,
+      0xe9362689, 0xedf73b3e, 0xf3b06b3b, 0xf771768c, 0xfa325055, 0xfef34de2,
+      0xc6bcf05f, 0xc27dede8, 0xcf3ecb31, 0xcbffd686, 0xd5b88683, 0xd1799b34,
+      0xdc3abded, 0xd8fba05a, 0x690ce0ee, 0x6dcdfd59, 0x608edb80, 0x644fc637,
+      0x7a089632, 0x7ec98b85, 0x738aad5c, 0x774bb0eb, 0x4f040d56, 0x4bc510e1,
+      0x46863638, 0x42472b8f, 0x5c007b8a, 0x58c1663d, 0x558240e4, 0x51435d53,
+      0x251d3b9e, 0x21dc2629, 0x2c9f00f0, 0x285e1d47, 0x36194d42, 0x32d850f5,
+      0x3f9b762c, 0x3b5a6b9b, 0x0315d626, 0x07d4cb91, 0x0a97ed48, 0x0e56f0ff,
+      0x1011a0fa, 0x14d0bd4d, 0x19939b94, 0x1d528623, 0xf12f560e, 0xf5ee4bb9,
+      0xf8ad6d60, 0xfc6c70d7, 0xe22b20d2, 0xe6ea3d65, 0xeba91bbc, 0xef68060b,
+      0xd727bbb6, 0xd3e6a601, 0xdea580d8, 0xda649d6f, 0xc423cd6a, 0xc0e2d0dd,
+      0xcda1f604, 0xc960ebb3, 0xbd3e8d7e, 0xb9ff90c9, 0xb4bcb610, 0xb07daba7,
+      0xae3afba2, 0xaafbe615, 0xa7b8c0cc, 0xa379dd7b, 0x9b3660c6, 0x9ff77d71,
+      0x92b45ba8, 0x9675461f, 0x8832161a, 0x8cf30bad, 0x81b02d74, 0x857130c3,
+      0x5d8a9099, 0x594b8d2e, 0x5408abf7, 0x50c9b640, 0x4e8ee645, 0x4a4ffbf2,
+      0x470cdd2b, 0x43cdc09c, 0x7b827d21, 0x7f436096, 0x7200464f, 0x76c15bf8,
+      0x68860bfd, 0x6c47164a, 0x61043093, 0x65c52d24, 0x119b4be9, 0x155a565e,
+      0x18197087, 0x1cd86d30, 0x029f3d35, 0x065e2082, 0x0b1d065b, 0x0fdc1bec,
+      0x3793a651, 0x3352bbe6, 0x3e119d3f, 0x3ad08088, 0x2497d08d, 0x2056cd3a,
+      0x2d15ebe3, 0x29d4f654, 0xc5a92679, 0xc1683bce, 0xcc2b1d17, 0xc8ea00a0,
+      0xd6ad50a5, 0xd26c4d12, 0xdf2f6bcb, 0xdbee767c, 0xe3a1cbc1, 0xe760d676,
+      0xea23f0af, 0xeee2ed18, 0xf0a5bd1d, 0xf464a0aa, 0xf9278673, 0xfde69bc4,
+      0x89b8fd09, 0x8d79e0be, 0x803ac667, 0x84fbdbd0, 0x9abc8bd5, 0x9e7d9662,
+      0x933eb0bb, 0x97ffad0c, 0xafb010b1, 0xab710d06, 0xa6322bdf, 0xa2f33668,
+      0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
+    };
+
+  for (std::size_t  i = 0; i < len; i++)
+    crc = (crc << 8) ^ crcTable[((crc >> 24) ^ buf[i]) & 0xff];
+
+  return  crc;
+
+}	// crc32 ()
+
+
 //! Convert an ASCII character string to pairs of hex digits
 
 //! Both source and destination are null terminated.
@@ -233,6 +500,44 @@ Utils::rspUnescape (char *buf,
   int  fromOffset = 0;		// Offset to source char
   int  toOffset   = 0;		// Offset to dest char
 
+#if defined (__SSE2__) || defined (__ARM_NEON)
+  // Escapes are rare, so look 16 bytes at a time for the next one, and move
+  // everything before it in one go.  Until we see the first, nothing moves.
+  while (fromOffset + 16 <= len)
+    {
+#if defined (__SSE2__)
+      __m128i  v = _mm_loadu_si128
+	(reinterpret_cast<const __m128i *> (buf + fromOffset));
+      int  mask = _mm_movemask_epi8 (_mm_cmpeq_epi8 (v, _mm_set1_epi8 ('}')));
+      int  n = (0 == mask) ? 16 : __builtin_ctz (mask);
+#else
+      uint8x16_t  v = vld1q_u8 (reinterpret_cast<const uint8_t *>
+				(buf + fromOffset));
+      uint64x2_t  hits = vreinterpretq_u64_u8 (vceqq_u8 (v, vdupq_n_u8 ('}')));
+      uint64_t    lo = vgetq_lane_u64 (hits, 0);
+      uint64_t    hi = vgetq_lane_u64 (hits, 1);
+      int  n = (0 != lo) ? (__builtin_ctzll (lo) / 8)
+	: (0 != hi) ? (8 + __builtin_ctzll (hi) / 8) : 16;
+#endif
+
+      if (toOffset != fromOffset)
+	memmove (buf + toOffset, buf + fromOffset, n);
+
+      fromOffset += n;
+      toOffset   += n;
+
+      if (n < 16)
+	{
+	  // The escape, which must have the char it escapes after it
+	  if (fromOffset + 1 >= len)
+	    break;
+
+	  buf[toOffset++] = buf[fromOffset + 1] ^ 0x20;
+	  fromOffset += 2;
+	}
+    }
+#endif
+
   while (fromOffset < len)
     {
       // Is it escaped
@@ -44,6 +44,15 @@ public:
   static uint64_t    hex2Val (char *buf,
 			      int   numBytes,
 			      bool  isLittleEndianP);
+  static void        bin2Hex (char          *dest,
+			      const uint8_t *src,
+			      std::size_t    len);
+  static bool        hex2Bin (uint8_t     *dest,
+			      const char  *src,
+			      std::size_t  len);
+  static uint32_t    crc32 (const uint8_t *buf,
+			    std::size_t    len,
+			    uint32_t       crc);
   static void        ascii2Hex (char *dest,
 				char *src);
   static void        hex2Ascii (char *dest,
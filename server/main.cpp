@@ -24,9 +24,11 @@
 #include "config.h"
 
 #include <iostream>
+#include <fstream>
 #include <cstdlib>
 #include <cstring>
 #include <getopt.h>
+#include <vector>
 
 // RISC-V headers in general and for each target
 
@@ -47,23 +49,31 @@
 
 // Class headers
 
+#include "BatchRunner.h"
+#include "ElfLoader.h"
 #include "GdbServer.h"
+#include "HartGroup.h"
+#include "InsnTrace.h"
 #include "TraceFlags.h"
 
 #include "RspConnection.h"
+#include "SessionForker.h"
+#include "SessionPool.h"
 #include "StreamConnection.h"
 
-using std::atoi;
 using std::cerr;
 using std::cout;
 using std::endl;
 using std::ostream;
 using std::strcmp;
+using std::strtol;
 
 
-//! The RISC-V model
+//! The RISC-V model.  When serving many clients at once, each thread has its
+//! own model.  Hart worker threads have their own hart instead (@see
+//! sc_time_stamp ()).
 
-static ITarget *globalCpu = nullptr;
+static thread_local ITarget *globalCpu = nullptr;
 
 static const std::string gdbserver_name =
 #ifdef BUILD_64_BIT
@@ -84,20 +94,112 @@ usage (ostream & s)
     << "                         [ --trace | -t <traceflag> ]" << endl
     << "                         [ --silent | -q ]" << endl
     << "                         [ --stdin | -s ]" << endl
+    << "                         [ --packet-size | -p <bytes> ]" << endl
+    << "                         [ --clients | -j <n> ]" << endl
+    << "                         [ --fork | -f ]" << endl
+    << "                         [ --harts | -n <n> ]" << endl
+    << "                         [ --load | -l <elf-file> ]" << endl
+    << "                         [ --batch | -b ]" << endl
+    << "                         [ --stats | -S <json-file> ]" << endl
+    << "                         [ --decode-itrace | -D <itrace-file> ]"
+    << endl
     << "                         [ --help | -h ]" << endl
     << "                         [ --version | -v ]" << endl
-    << "                         <rsp-port>" << endl
+    << "                         <rsp-port> | <socket-path>" << endl
     << endl
     << "The trace option may appear multiple times. Trace flags are:" << endl
     << "  rsp     Trace RSP packets" << endl
     << "  conn    Trace RSP connection handling" << endl
     << "  break   Trace breakpoint handling" << endl
     << "  vcd     Generate a Verilog Change Dump" << endl
-    << "  silent  Minimize informative messages (synonym for -q)" << endl;
+    << "  silent  Minimize informative messages (synonym for -q)" << endl
+    << "  speed   Report the speed of the model every second while it runs"
+    << endl
+    << "  vcdgz   Generate a gzip compressed Verilog Change Dump" << endl
+    << "  disas   Record the instructions executed, in gdbserver.itrace"
+    << endl
+    << endl
+    << "The packet size is the maximum RSP packet size advertised to GDB"
+    << endl
+    << "(default " << GdbServer::DEFAULT_PKT_SIZE << " bytes)." << endl
+    << endl
+    << "If the last argument is not a port number, it is the path of a Unix"
+    << endl
+    << "domain socket to listen on." << endl
+    << endl
+    << "With --clients, up to n GDB clients are served at once on the port,"
+    << endl
+    << "each with a core of its own.  Cores are kept for reuse by later"
+    << endl
+    << "clients, and a kill just ends the client's session." << endl
+    << endl
+    << "With --fork, the core is built (and any program loaded) just once, and"
+    << endl
+    << "each GDB client is served by a process forked for it, with a copy of"
+    << endl
+    << "the core as it was then.  Any number of clients are served at once,"
+    << endl
+    << "and a kill just ends the client's session.  It cannot be used with"
+    << endl
+    << "several harts or VCD tracing, which need threads of their own."
+    << endl
+    << endl
+    << "With --load, the program is loaded straight into the core before"
+    << endl
+    << "the first client connects (with --clients, before each client)."
+    << endl
+    << endl
+    << "With --harts, the core has n harts, which GDB sees as threads.  They"
+    << endl
+    << "each have memory of their own, to which GDB's writes all go, and they"
+    << endl
+    << "run in parallel, each on a thread of its own, until one of them stops."
+    << endl
+    << endl
+    << "With --batch, there is no GDB client and no port.  The program given"
+    << endl
+    << "with --load is run to completion, with its file I/O done on the host,"
+    << endl
+    << "and the cycle and instruction counts are reported.  The exit code is"
+    << endl
+    << "that of the program." << endl
+    << endl
+    << "With --stats, the counts and times of packets and calls to the core"
+    << endl
+    << "(as from \"monitor stats\") are written as JSON to the file when the"
+    << endl
+    << "server exits.  It cannot be used with --clients or --batch." << endl
+    << endl
+    << "With --decode-itrace, an instruction trace saved by the disas trace"
+    << endl
+    << "flag or \"monitor itrace save\" is written out as text, and the"
+    << endl
+    << "server exits.  No core or port is needed." << endl;
 
 }	// usage ()
 
 
+//! Convenience function to parse the RSP end point
+
+//! This is a port number, or if not a number, the path of a Unix domain
+//! socket.
+
+//! @param[in]  arg   The argument giving the end point.
+//! @param[out] port  The port number, if there is one.
+//! @return  TRUE if the end point is a port number, FALSE if a path.
+
+static bool
+isPortNum (const char *arg,
+	   int  & port)
+{
+  char *endptr;
+
+  port = static_cast<int> (strtol (arg, &endptr, 0));
+  return  ('\0' != *arg) && ('\0' == *endptr) && (port > 0);
+
+}	// isPortNum ()
+
+
 //! Convenience function to output the version information
 
 //! @param[in] s  Output stream to use.
@@ -147,6 +249,46 @@ createCpu (const char *name, TraceFlags *traceFlags)
 }	// createCpu
 
 
+//! Create the target for a core with a number of harts
+
+//! With just one hart, this is just the core.  Otherwise it is a group of
+//! cores, one per hart.
+
+//! @param[in] name        C string containing cpu model name.
+//! @param[in] numHarts    The number of harts
+//! @param[in] traceFlags  Pointer to TraceFlags used to create model.
+//! @return  Pointer to new ITarget instance, or nullptr.
+
+static ITarget *
+createTarget (const char *name,
+	      int  numHarts,
+	      TraceFlags *traceFlags)
+{
+  if (1 == numHarts)
+    return  createCpu (name, traceFlags);
+
+  std::vector<ITarget *>  harts;
+
+  for (int  i = 0; i < numHarts; i++)
+    {
+      ITarget *hart = createCpu (name, traceFlags);
+
+      if (nullptr == hart)
+	{
+	  for (auto  it = harts.begin (); it != harts.end (); it++)
+	    delete  *it;
+
+	  return  nullptr;
+	}
+
+      harts.push_back (hart);
+    }
+
+  return  new HartGroup (harts, traceFlags);
+
+}	// createTarget ()
+
+
 
 //! Main function
 
@@ -166,6 +308,14 @@ main (int   argc,
   char         *coreName = nullptr;
   bool          from_stdin = false;
   int           port = -1;
+  int           pktSize = GdbServer::DEFAULT_PKT_SIZE;
+  int           numClients = 0;
+  bool          forkSessions = false;
+  int           numHarts = 1;
+  char         *loadFile = nullptr;
+  bool          batch = false;
+  char         *statsFile = nullptr;
+  char         *itraceFile = nullptr;
   TraceFlags *  traceFlags = new TraceFlags ();
   int           nextArg;
 
@@ -178,11 +328,19 @@ main (int   argc,
       {"silent", no_argument,       nullptr,  'q' },
       {"trace",  required_argument, nullptr,  't' },
       {"stdin",  no_argument,       nullptr,  's' },
+      {"packet-size", required_argument, nullptr, 'p' },
+      {"clients", required_argument, nullptr,  'j' },
+      {"fork",   no_argument,       nullptr,  'f' },
+      {"harts",  required_argument, nullptr,  'n' },
+      {"load",   required_argument, nullptr,  'l' },
+      {"batch",  no_argument,       nullptr,  'b' },
+      {"stats",  required_argument, nullptr,  'S' },
+      {"decode-itrace", required_argument, nullptr, 'D' },
       {"version", no_argument,      nullptr,  'v' },
       {0,       0,                 0,  0 }
     };
 
-    if ((c = getopt_long (argc, argv, "c:hqt:sv", longOptions, &longOptind)) == -1)
+    if ((c = getopt_long (argc, argv, "c:hqt:sp:j:fn:l:bS:D:v", longOptions, &longOptind)) == -1)
       break;
 
     switch (c) {
@@ -215,6 +373,68 @@ main (int   argc,
       from_stdin = true;
       break;
 
+    case 'p':
+      {
+	char *endptr;
+
+	pktSize = static_cast<int> (strtol (optarg, &endptr, 0));
+	if ((*endptr != '\0') || (pktSize <= 0))
+	  {
+	    cerr << "ERROR: Bad packet size " << optarg << endl;
+	    usage (cerr);
+	    return EXIT_FAILURE;
+	  }
+      }
+      break;
+
+    case 'j':
+      {
+	char *endptr;
+
+	numClients = static_cast<int> (strtol (optarg, &endptr, 0));
+	if ((*endptr != '\0') || (numClients <= 0))
+	  {
+	    cerr << "ERROR: Bad number of clients " << optarg << endl;
+	    usage (cerr);
+	    return EXIT_FAILURE;
+	  }
+      }
+      break;
+
+    case 'f':
+      forkSessions = true;
+      break;
+
+    case 'n':
+      {
+	char *endptr;
+
+	numHarts = static_cast<int> (strtol (optarg, &endptr, 0));
+	if ((*endptr != '\0') || (numHarts <= 0))
+	  {
+	    cerr << "ERROR: Bad number of harts " << optarg << endl;
+	    usage (cerr);
+	    return EXIT_FAILURE;
+	  }
+      }
+      break;
+
+    case 'l':
+      loadFile = strdup (optarg);
+      break;
+
+    case 'b':
+      batch = true;
+      break;
+
+    case 'S':
+      statsFile = strdup (optarg);
+      break;
+
+    case 'D':
+      itraceFile = strdup (optarg);
+      break;
+
     case '?':
     case ':':
       usage (cerr);
@@ -230,22 +450,165 @@ main (int   argc,
     }
   }
 
+  // Decoding an instruction trace needs nothing else.
+  if (nullptr != itraceFile)
+    {
+      std::ifstream  ifs (itraceFile, std::ios::binary);
+
+      if (!ifs)
+	{
+	  cerr << "ERROR: Unable to open instruction trace file " << itraceFile
+	       << endl;
+	  return  EXIT_FAILURE;
+	}
+
+      return  InsnTrace::decode (ifs, cout) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
   // Check for 1 positional arg (sometimes).  Also, stop using OPTIND, this
   // is a global and can be modified if we ever invoke the getopt framework
   // again (for example in starting a target).
   nextArg = optind;
-  if (((argc - nextArg) != 1 && !from_stdin)
+  if (((argc - nextArg) != 1 && !from_stdin && !batch)
       || coreName == nullptr)
     {
       usage (cerr);
       return  EXIT_FAILURE;
     }
 
+  // A batch run has a program, and nothing to talk to.
+  if (batch
+      && ((nullptr == loadFile) || from_stdin || (numClients > 0)
+	  || (argc != nextArg)))
+    {
+      cerr << "ERROR: Batch mode needs a program, and no client" << endl;
+      usage (cerr);
+      return  EXIT_FAILURE;
+    }
+
+  // Statistics are only kept by a single server.
+  if ((nullptr != statsFile) && (batch || (numClients > 0)))
+    {
+      cerr << "ERROR: Statistics need a single server" << endl;
+      usage (cerr);
+      return  EXIT_FAILURE;
+    }
+
+  // Forked sessions each copy the one core, from a listener of their own.
+  if (forkSessions
+      && (from_stdin || batch || (numClients > 0) || (nullptr != statsFile)))
+    {
+      cerr << "ERROR: Forked sessions need a port, and no other mode" << endl;
+      usage (cerr);
+      return  EXIT_FAILURE;
+    }
+
+  // A forked child has just one thread, so the core can't need any more.
+  if (forkSessions
+      && ((numHarts > 1) || traceFlags->traceVcd ()
+	  || traceFlags->traceVcdGz ()))
+    {
+      cerr << "ERROR: Cannot fork sessions with several harts or VCD tracing"
+	   << endl;
+      usage (cerr);
+      return  EXIT_FAILURE;
+    }
+
+  // Serving many clients, each session creates its own cpu model in its own
+  // thread.
+  if (numClients > 0)
+    {
+      if (from_stdin)
+	{
+	  cerr << "ERROR: Cannot serve several clients on stdin" << endl;
+	  usage (cerr);
+	  return  EXIT_FAILURE;
+	}
+
+      auto  factory = [coreName, numHarts] (TraceFlags * flags) -> ITarget *
+	{
+	  globalCpu = createTarget (coreName, numHarts, flags);
+	  return  globalCpu;
+	};
+
+      auto  setup = [loadFile, traceFlags] (ITarget * cpu) -> bool
+	{
+	  if (nullptr == loadFile)
+	    return  true;
+
+	  ElfLoader  loader (cpu, traceFlags);
+	  return  loader.load (loadFile);
+	};
+
+      RspListener *listener;
+
+      if (isPortNum (argv[nextArg], port))
+	listener = new RspListener (port, traceFlags);
+      else
+	listener = new RspListener (std::string (argv[nextArg]), traceFlags);
+
+      SessionPool *pool = new SessionPool (listener, numClients, factory,
+					   traceFlags, pktSize, setup);
+      int ret = pool->run ();
+
+      delete  pool;
+      delete  listener;
+      delete  traceFlags;
+      free (coreName);
+      free (loadFile);
+      return  ret;
+    }
+
   // Create the cpu model.
-  globalCpu = createCpu (coreName, traceFlags);
+  globalCpu = createTarget (coreName, numHarts, traceFlags);
   if (globalCpu == nullptr)
     return  EXIT_FAILURE;
 
+  // Load any program we were given, before GDB sees the core.
+  if (nullptr != loadFile)
+    {
+      ElfLoader  loader (globalCpu, traceFlags);
+
+      if (!loader.load (loadFile))
+	return  EXIT_FAILURE;
+    }
+
+  // Serve each client from a copy of the core, made ready just the once.
+  if (forkSessions)
+    {
+      RspListener *listener;
+
+      if (isPortNum (argv[nextArg], port))
+	listener = new RspListener (port, traceFlags);
+      else
+	listener = new RspListener (std::string (argv[nextArg]), traceFlags);
+
+      SessionForker *forker = new SessionForker (listener, globalCpu,
+						 traceFlags, pktSize);
+      int ret = forker->run ();
+
+      delete  forker;
+      delete  listener;
+      delete  globalCpu;
+      delete  traceFlags;
+      free (coreName);
+      free (loadFile);
+      return  ret;
+    }
+
+  // Without a client, just run the program.
+  if (batch)
+    {
+      BatchRunner  runner (globalCpu, traceFlags);
+      int  ret = runner.run ();
+
+      delete  globalCpu;
+      delete  traceFlags;
+      free (coreName);
+      free (loadFile);
+      return  ret;
+    }
+
   AbstractConnection *conn;
   GdbServer::KillBehaviour killBehaviour;
   if (from_stdin)
@@ -255,21 +618,36 @@ main (int   argc,
     }
   else
     {
-      port = atoi (argv[nextArg]);
-      conn = new RspConnection (port, traceFlags);
+      if (isPortNum (argv[nextArg], port))
+	conn = new RspConnection (port, traceFlags);
+      else
+	conn = new RspConnection (std::string (argv[nextArg]), traceFlags);
+
       killBehaviour = GdbServer::KillBehaviour::RESET_ON_KILL;
     }
 
   // The RSP server, connecting it to its CPU.
 
   GdbServer *gdbServer = new GdbServer (conn, globalCpu, traceFlags,
-                                        killBehaviour);
+                                        killBehaviour, pktSize);
   globalCpu->gdbServer (gdbServer);
 
   // Run the GDB server.
 
   int ret = gdbServer->rspServer ();
 
+  // Save the statistics if asked to.
+
+  if (nullptr != statsFile)
+    {
+      std::ofstream  ofs (statsFile);
+
+      if (ofs)
+	gdbServer->dumpStats (ofs);
+      else
+	cerr << "Warning: Cannot write statistics to " << statsFile << endl;
+    }
+
   // Free memory
 
   delete  conn;
@@ -277,6 +655,8 @@ main (int   argc,
   delete  globalCpu;
   delete  traceFlags;
   free (coreName);
+  free (loadFile);
+  free (statsFile);
 
   return ret;
 
@@ -285,12 +665,21 @@ main (int   argc,
 
 //! Function to handle $time calls in the Verilog
 
+//! With several harts, each is run on a worker thread of its own, and the
+//! model asking is the hart that thread runs.  In non-stop mode the server
+//! runs the target on a thread of its own, which likewise says so.
+
 double
 sc_time_stamp ()
 {
+  ITarget *cpu = HartGroup::workerHart ();
+
+  if (cpu == nullptr)
+    cpu = globalCpu;
+
   // If we are called before cpu has been constructed, return 0.0
-  if (globalCpu != nullptr)
-    return globalCpu->timeStamp ();
+  if (cpu != nullptr)
+    return cpu->timeStamp ();
   else
     return 0.0;
 }
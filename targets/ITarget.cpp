@@ -72,6 +72,7 @@ operator<< (std::ostream & s,
     case ITarget::ResumeRes::TIMEOUT:     name = "timeout";     break;
     case ITarget::ResumeRes::SYSCALL:     name = "syscall";     break;
     case ITarget::ResumeRes::STEPPED:     name = "stepped";     break;
+    case ITarget::ResumeRes::WATCHPOINT:  name = "watchpoint";  break;
     default:                              name = "unknown";     break;
     }
 
@@ -22,6 +22,7 @@
 #ifndef ITARGET_H
 #define ITARGET_H
 
+#include <atomic>
 #include <chrono>
 #include <cstddef>
 #include <cstdint>
@@ -33,6 +34,8 @@
 
 class TraceFlags;
 class GdbServer;
+class InsnTrace;
+class Profile;
 
 
 //! Generic interface class for GDB RSP server targets.
@@ -66,6 +69,7 @@ class ITarget
     TIMEOUT     = 4,		//!< Execution hit time limit.
     SYSCALL     = 5,		//!< Target needs some host I/O.
     STEPPED     = 6,		//!< Single step was completed.
+    WATCHPOINT  = 7,		//!< Execution hit a watchpoint.
   };
 
   //! Type of reset
@@ -93,6 +97,14 @@ class ITarget
   virtual ResumeRes  resume (ResumeType step,
                              std::chrono::duration <double>  timeout) = 0;
 
+  // Resume with a budget of work rather than a time limit, stopping with
+  // TIMEOUT once it is used up.  The budget is counted in whatever the target
+  // can count most cheaply (typically cycles or instructions), so callers
+  // should size it by measurement.  Zero means no limit.
+
+  virtual ResumeRes  resume (ResumeType step,
+                             uint64_t  budget) = 0;
+
   virtual ResumeRes  terminate () = 0;
   virtual ResumeRes  reset (ResetType  type) = 0;
 
@@ -123,12 +135,33 @@ class ITarget
 
   // Insert and remove a matchpoint (breakpoint or watchpoint) at the given
   // address.  Return value indicates whether the operation was successful.
+  // Watchpoints are for a single byte.
 
   virtual bool  insertMatchpoint (const uint32_t  addr,
 				  const MatchType  matchType) = 0;
   virtual bool  removeMatchpoint (const uint32_t  addr,
 				  const MatchType  matchType) = 0;
 
+  // Find the address and type of the watchpoint which caused the last
+  // resume to return WATCHPOINT.  Return value indicates whether there was
+  // such a watchpoint.
+
+  virtual bool  lastWatchpoint (uint32_t & addr,
+				MatchType & matchType) const = 0;
+
+  // The size of the aligned block of memory the target sees read together.
+  // A read of any byte in a block is a read of all of them, so read and
+  // access watchpoints must cover whole blocks.  1 if reads are of bytes.
+
+  virtual std::size_t  readGranule () const = 0;
+
+  // Save the state of a stopped target as a snapshot, and restore the
+  // target to that snapshot.  Matchpoints are not part of the snapshot.
+  // Return value indicates whether the operation was successful.
+
+  virtual bool  saveSnapshot () = 0;
+  virtual bool  restoreSnapshot () = 0;
+
   // Generic pass through of command
 
   virtual bool command (const std::string  cmd,
@@ -138,6 +171,33 @@ class ITarget
 
   virtual void gdbServer (GdbServer *server) = 0;
 
+  // Give the target a flag to watch while it runs.  Once the flag is set, a
+  // continue stops with TIMEOUT as soon as the target notices, as though its
+  // budget had been used up.  The target only reads the flag, which may be
+  // set from another thread.  NULL means there is no flag to watch.
+
+  virtual void breakFlag (const std::atomic<bool> * flag) = 0;
+
+  // Start or stop recording each instruction executed.  Stopping keeps what
+  // has been recorded.  Return value indicates whether the target can
+  // record instructions.
+
+  virtual bool  traceInsns (bool  on) = 0;
+
+  // The instructions recorded, or NULL if none have been (@see InsnTrace).
+
+  virtual const InsnTrace * insnTrace () const = 0;
+
+  // Can the instructions recorded be given to GDB as branch trace?  Only if
+  // each is recorded at the address from which it was executed.
+
+  virtual bool  branchTrace () const = 0;
+
+  // Give the target a profile to sample its PC into as it runs, whenever
+  // the profile is on (@see Profile).  NULL means there is no profile.
+
+  virtual void  profile (Profile * prof) = 0;
+
   // Verilator support
 
   virtual double timeStamp () = 0;
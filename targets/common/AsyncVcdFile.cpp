@@ -0,0 +1,226 @@
+// Asynchronous VCD file writer: definition
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include "AsyncVcdFile.h"
+
+using std::cerr;
+using std::endl;
+using std::lock_guard;
+using std::mutex;
+using std::string;
+using std::unique_lock;
+
+
+//! Constructor.
+
+//! The file is not opened until Verilator asks us to.
+
+AsyncVcdFile::AsyncVcdFile () :
+  mFile (nullptr),
+  mIsPipe (false),
+  mDrainFull (false),
+  mDone (false)
+{
+  mFill.reserve (BUF_SIZE);
+  mDrain.reserve (BUF_SIZE);
+
+}	// AsyncVcdFile::AsyncVcdFile ()
+
+
+//! Destructor.
+
+//! Make sure everything is written out, if Verilator has not closed us.
+
+AsyncVcdFile::~AsyncVcdFile ()
+{
+  close ();
+
+}	// AsyncVcdFile::~AsyncVcdFile ()
+
+
+//! Open the file and start the writer
+
+//! @param[in] name  The name of the file.  If it ends in ".gz", it will be
+//!                  compressed.
+//! @return  TRUE if the file was opened, FALSE otherwise.
+
+bool
+AsyncVcdFile::open (const string & name)
+{
+  static const string  GZ_SUFFIX (".gz");
+
+  mIsPipe = (name.size () > GZ_SUFFIX.size ())
+    && (0 == name.compare (name.size () - GZ_SUFFIX.size (),
+			   GZ_SUFFIX.size (), GZ_SUFFIX));
+
+  if (mIsPipe)
+    {
+      // Quote the name for the shell
+
+      string  cmd = "gzip -c > '";
+
+      for (auto  it = name.begin (); it != name.end (); it++)
+	if ('\'' == *it)
+	  cmd.append ("'\\''");
+	else
+	  cmd.push_back (*it);
+
+      cmd.append ("'");
+      mFile = popen (cmd.c_str (), "w");
+    }
+  else
+    mFile = fopen (name.c_str (), "w");
+
+  if (nullptr == mFile)
+    {
+      cerr << "ERROR: Unable to open VCD file " << name << ": "
+	   << strerror (errno) << endl;
+      return  false;
+    }
+
+  mDrainFull = false;
+  mDone = false;
+  mWriter = std::thread (&AsyncVcdFile::writer, this);
+  return  true;
+
+}	// AsyncVcdFile::open ()
+
+
+//! Write out anything left, stop the writer and close the file
+
+void
+AsyncVcdFile::close ()
+{
+  if (nullptr == mFile)
+    return;
+
+  if (!mFill.empty ())
+    handOver ();
+
+  {
+    lock_guard<mutex>  lock (mMutex);
+    mDone = true;
+  }
+
+  mCond.notify_all ();
+  mWriter.join ();
+
+  if (mIsPipe)
+    pclose (mFile);
+  else
+    fclose (mFile);
+
+  mFile = nullptr;
+
+}	// AsyncVcdFile::close ()
+
+
+//! Take a block of VCD from Verilator
+
+//! This is on the simulation thread, so we just copy it, and only wait if
+//! both buffers are full.
+
+//! @param[in] bufp  The VCD text
+//! @param[in] len   Its length
+//! @return  The number of bytes taken, which is always all of them.
+
+ssize_t
+AsyncVcdFile::write (const char *bufp,
+		     ssize_t  len)
+{
+  mFill.insert (mFill.end (), bufp, bufp + len);
+
+  if (mFill.size () >= BUF_SIZE)
+    handOver ();
+
+  return  len;
+
+}	// AsyncVcdFile::write ()
+
+
+//! Give the buffer we have filled to the writer
+
+//! We wait for the writer to finish the other buffer, then swap them.  The
+//! writer leaves the buffer it gives back empty.
+
+void
+AsyncVcdFile::handOver ()
+{
+  {
+    unique_lock<mutex>  lock (mMutex);
+
+    mCond.wait (lock, [this] { return !mDrainFull; });
+    mFill.swap (mDrain);
+    mDrainFull = true;
+  }
+
+  mCond.notify_all ();
+
+}	// AsyncVcdFile::handOver ()
+
+
+//! The writer thread
+
+//! Write out each buffer we are handed, until told to finish.  We only
+//! report the first failure, but keep emptying buffers, so the model never
+//! waits on a broken file.
+
+void
+AsyncVcdFile::writer ()
+{
+  bool  failed = false;
+  unique_lock<mutex>  lock (mMutex);
+
+  for (;;)
+    {
+      mCond.wait (lock, [this] { return mDrainFull || mDone; });
+
+      if (!mDrainFull)
+	return;
+
+      // We own mDrain until we clear mDrainFull, so write it unlocked
+
+      lock.unlock ();
+
+      if (!failed
+	  && (fwrite (mDrain.data (), 1, mDrain.size (), mFile)
+	      != mDrain.size ()))
+	{
+	  cerr << "ERROR: Failed to write VCD: " << strerror (errno) << endl;
+	  failed = true;
+	}
+
+      mDrain.clear ();
+      lock.lock ();
+      mDrainFull = false;
+      mCond.notify_all ();
+    }
+}	// AsyncVcdFile::writer ()
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,117 @@
+// Asynchronous VCD file writer: declaration
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ASYNC_VCD_FILE_H
+#define ASYNC_VCD_FILE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "verilated_vcd_c.h"
+
+
+//! A VCD file written by a background thread
+
+//! Verilator formats the VCD into its own buffer, and hands it to us
+//! whenever that fills.  Writing it out (and compressing it) on the
+//! simulation thread would stall the model, so we just copy it into one of
+//! two buffers.  When that buffer is full, we hand it to a writer thread and
+//! fill the other.  The model only waits if it gets a whole buffer ahead of
+//! the writer.
+
+//! If the file name ends in ".gz", the file is compressed through a pipe to
+//! gzip, which therefore also runs alongside the model.
+
+class AsyncVcdFile : public VerilatedVcdFile
+{
+ public:
+
+  AsyncVcdFile ();
+  virtual ~AsyncVcdFile ();
+
+  // VerilatedVcdFile interface
+
+  virtual bool  open (const std::string & name);
+  virtual void  close ();
+  virtual ssize_t  write (const char *bufp,
+			  ssize_t  len);
+
+ private:
+
+  //! Size at which a buffer is handed to the writer
+
+  static const std::size_t  BUF_SIZE = 1 << 20;
+
+  //! Where the writer writes to, NULL if not open
+
+  FILE *mFile;
+
+  //! Is mFile a pipe to gzip?
+
+  bool  mIsPipe;
+
+  //! The writer thread
+
+  std::thread  mWriter;
+
+  //! Guards mDrain, mDrainFull and mDone
+
+  std::mutex  mMutex;
+
+  //! Signalled whenever mDrainFull or mDone changes
+
+  std::condition_variable  mCond;
+
+  //! The buffer the simulation thread is filling
+
+  std::vector<char>  mFill;
+
+  //! The buffer the writer thread is emptying
+
+  std::vector<char>  mDrain;
+
+  //! Does mDrain hold data still to be written?
+
+  bool  mDrainFull;
+
+  //! Have we been told to finish?
+
+  bool  mDone;
+
+  // Helper methods
+
+  void  handOver ();
+  void  writer ();
+
+};	// class AsyncVcdFile
+
+#endif	// ASYNC_VCD_FILE_H
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,311 @@
+// Instruction trace ring buffer: definition
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "InsnTrace.h"
+
+using std::cerr;
+using std::endl;
+using std::hex;
+using std::ostringstream;
+using std::setfill;
+using std::setw;
+using std::size_t;
+using std::string;
+
+const char  InsnTrace::MAGIC[8] = { 'R', 'V', 'I', 'T', 'R', 'A', 'C', 'E' };
+
+
+//! Pack a value little endian
+
+//! @param[out] buf    Where to pack it
+//! @param[in]  val    The value
+//! @param[in]  bytes  How many bytes to pack
+
+static void
+packLe (uint8_t *buf,
+	uint64_t  val,
+	int  bytes)
+{
+  for (int  i = 0; i < bytes; i++)
+    buf[i] = static_cast<uint8_t> (val >> (8 * i));
+
+}	// packLe ()
+
+
+//! Unpack a little endian value
+
+//! @param[in] buf    Where to unpack it from
+//! @param[in] bytes  How many bytes to unpack
+//! @return  The value
+
+static uint64_t
+unpackLe (const uint8_t *buf,
+	  int  bytes)
+{
+  uint64_t  val = 0;
+
+  for (int  i = bytes - 1; i >= 0; i--)
+    val = (val << 8) | buf[i];
+
+  return  val;
+
+}	// unpackLe ()
+
+
+//! Constructor.
+
+//! @param[in] size  The most entries to hold, which is rounded up to a power
+//!                  of two.
+
+InsnTrace::InsnTrace (size_t  size) :
+  mTotal (0)
+{
+  size_t  n = 1;
+
+  while (n < size)
+    n <<= 1;
+
+  mBuf.resize (n);
+  mMask = n - 1;
+
+}	// InsnTrace::InsnTrace ()
+
+
+//! Forget all the instructions recorded
+
+void
+InsnTrace::clear ()
+{
+  mTotal = 0;
+
+}	// InsnTrace::clear ()
+
+
+//! The most entries we can hold
+
+//! @return  The number of entries
+
+size_t
+InsnTrace::capacity () const
+{
+  return  mBuf.size ();
+
+}	// InsnTrace::capacity ()
+
+
+//! The entries we hold
+
+//! @return  The number of entries, which is at most capacity ()
+
+size_t
+InsnTrace::size () const
+{
+  return  (mTotal < mBuf.size ()) ? static_cast<size_t> (mTotal)
+    : mBuf.size ();
+
+}	// InsnTrace::size ()
+
+
+//! The instructions recorded since the last clear
+
+//! This keeps counting once the buffer is full, so it changes whenever an
+//! instruction is recorded.
+
+//! @return  The number of instructions
+
+uint64_t
+InsnTrace::total () const
+{
+  return  mTotal;
+
+}	// InsnTrace::total ()
+
+
+//! An entry we hold
+
+//! @param[in] i  The entry, counting from zero as the oldest
+//! @return  The entry
+
+const InsnTrace::Entry &
+InsnTrace::operator[] (size_t  i) const
+{
+  return  mBuf[(mTotal - size () + i) & mMask];
+
+}	// InsnTrace::operator[] ()
+
+
+//! Save the trace to a file
+
+//! @param[in] filename  The file to save to
+//! @return  TRUE if the trace was saved, FALSE otherwise.
+
+bool
+InsnTrace::save (const string & filename) const
+{
+  std::ofstream  ofs (filename, std::ios::binary);
+
+  if (!ofs)
+    {
+      cerr << "ERROR: Unable to open instruction trace file " << filename
+	   << endl;
+      return  false;
+    }
+
+  uint8_t  hdr[16];
+  size_t   n = size ();
+
+  memcpy (hdr, MAGIC, sizeof (MAGIC));
+  packLe (hdr + 8, FORMAT_VERSION, 4);
+  packLe (hdr + 12, n, 4);
+  ofs.write (reinterpret_cast<char *> (hdr), sizeof (hdr));
+
+  for (size_t  i = 0; ofs && (i < n); i++)
+    {
+      const Entry & e = (*this)[i];
+      uint8_t  rec[16];
+
+      packLe (rec, e.cycle, 8);
+      packLe (rec + 8, e.addr, 4);
+      packLe (rec + 12, e.insn, 4);
+      ofs.write (reinterpret_cast<char *> (rec), sizeof (rec));
+    }
+
+  if (!ofs)
+    {
+      cerr << "ERROR: Failed to write instruction trace file " << filename
+	   << endl;
+      return  false;
+    }
+
+  return  true;
+
+}	// InsnTrace::save ()
+
+
+//! The trace as GDB branch trace
+
+//! A block is a run of instructions, each following on from the last, given
+//! by the address of its first and last instructions.  GDB wants the most
+//! recent block first.  It is not told the instruction words, since it can
+//! read them from memory, but we need them for the length of each
+//! instruction, which is 2 bytes if compressed.  This is only meaningful if
+//! each instruction was recorded at the address it was executed from.
+
+//! @return  The branch trace as an XML document
+
+string
+InsnTrace::btraceXml () const
+{
+  std::vector<std::pair<uint32_t, uint32_t> >  blocks;
+  uint32_t  next = 0;
+  size_t  n = size ();
+
+  for (size_t  i = 0; i < n; i++)
+    {
+      const Entry & e = (*this)[i];
+
+      if (blocks.empty () || (e.addr != next))
+	blocks.push_back (std::make_pair (e.addr, e.addr));
+      else
+	blocks.back ().second = e.addr;
+
+      next = e.addr + ((0x3 == (e.insn & 0x3)) ? 4 : 2);
+    }
+
+  ostringstream  oss;
+
+  oss << "<!DOCTYPE btrace SYSTEM \"btrace.dtd\">\n"
+      << "<btrace version=\"1.0\">\n" << hex;
+
+  for (auto  it = blocks.rbegin (); it != blocks.rend (); it++)
+    oss << "<block begin=\"0x" << it->first << "\" end=\"0x" << it->second
+	<< "\"/>\n";
+
+  oss << "</btrace>\n";
+  return  oss.str ();
+
+}	// InsnTrace::btraceXml ()
+
+
+//! Decode a saved trace to text
+
+//! Each instruction is a line giving its cycle, address and word.
+
+//! @param[in]  in   The saved trace
+//! @param[out] out  Where to write the text
+//! @return  TRUE if the trace was decoded, FALSE if it was not a valid
+//!          trace.
+
+bool
+InsnTrace::decode (std::istream & in,
+		   std::ostream & out)
+{
+  uint8_t  hdr[16];
+
+  if (!in.read (reinterpret_cast<char *> (hdr), sizeof (hdr))
+      || (0 != memcmp (hdr, MAGIC, sizeof (MAGIC))))
+    {
+      cerr << "ERROR: Not an instruction trace" << endl;
+      return  false;
+    }
+
+  if (FORMAT_VERSION != unpackLe (hdr + 8, 4))
+    {
+      cerr << "ERROR: Unknown instruction trace version "
+	   << unpackLe (hdr + 8, 4) << endl;
+      return  false;
+    }
+
+  uint64_t  n = unpackLe (hdr + 12, 4);
+
+  out << setfill (' ') << setw (20) << "Cycle" << "  "
+      << setw (10) << "Address" << "  " << setw (10) << "Instr" << endl;
+
+  for (uint64_t  i = 0; i < n; i++)
+    {
+      uint8_t  rec[16];
+
+      if (!in.read (reinterpret_cast<char *> (rec), sizeof (rec)))
+	{
+	  cerr << "ERROR: Instruction trace truncated after " << i
+	       << " of " << n << " entries" << endl;
+	  return  false;
+	}
+
+      out << std::dec << setfill (' ') << setw (20) << unpackLe (rec, 8)
+	  << "  0x" << hex << setfill ('0') << setw (8) << unpackLe (rec + 8, 4)
+	  << "  0x" << setw (8) << unpackLe (rec + 12, 4) << '\n';
+    }
+
+  return  true;
+
+}	// InsnTrace::decode ()
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
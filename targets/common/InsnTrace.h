@@ -0,0 +1,136 @@
+// Instruction trace ring buffer: declaration
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef INSN_TRACE_H
+#define INSN_TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+//! A trace of the instructions a target has executed
+
+//! Each entry is the address and word of an instruction, and the cycle on
+//! which it was seen.  The entries are kept in a ring buffer of fixed size,
+//! so recording never allocates, and once it is full the oldest entries are
+//! lost.
+
+//! The trace can be saved to a file, in a compact binary form, which is
+//! decoded to text offline (@see decode ()).  The file is a header of the
+//! 8 byte magic "RVITRACE", then the version and the number of entries as
+//! 32-bit values, followed by the entries, oldest first, each of the cycle
+//! as a 64-bit value, then the address and the word as 32-bit values.
+//! Everything is little endian.
+
+//! If the instructions are recorded at the addresses they were executed
+//! from, the trace can also be given to GDB as branch trace, in the form of
+//! blocks of consecutive instructions (@see btraceXml ()).
+
+class InsnTrace final
+{
+ public:
+
+  //! One instruction
+
+  struct Entry
+  {
+    uint64_t  cycle;			//!< When it was seen
+    uint32_t  addr;			//!< Where it is
+    uint32_t  insn;			//!< The instruction word
+  };
+
+  //! Default number of entries held
+
+  static const std::size_t  DEFAULT_SIZE = 1 << 20;
+
+  explicit InsnTrace (std::size_t  size = DEFAULT_SIZE);
+
+  //! Record an instruction
+
+  //! This is on the simulation's critical path, so it is inline.
+
+  //! @param[in] addr   The address of the instruction
+  //! @param[in] insn   The instruction word
+  //! @param[in] cycle  The cycle on which it was seen
+
+  void  record (uint32_t  addr,
+		uint32_t  insn,
+		uint64_t  cycle)
+  {
+    Entry & e = mBuf[mTotal & mMask];
+
+    e.cycle = cycle;
+    e.addr  = addr;
+    e.insn  = insn;
+    mTotal++;
+  }
+
+  void  clear ();
+
+  // Accessors
+
+  std::size_t  capacity () const;
+  std::size_t  size () const;
+  uint64_t  total () const;
+  const Entry & operator[] (std::size_t  i) const;
+
+  // Output
+
+  bool  save (const std::string & filename) const;
+  std::string  btraceXml () const;
+  static bool  decode (std::istream & in,
+		       std::ostream & out);
+
+ private:
+
+  //! Magic at the start of a saved trace
+
+  static const char  MAGIC[8];
+
+  //! Version of the saved trace format
+
+  static const uint32_t  FORMAT_VERSION = 1;
+
+  //! The entries
+
+  std::vector<Entry>  mBuf;
+
+  //! One less than the number of entries, which is a power of two
+
+  std::size_t  mMask;
+
+  //! Instructions recorded since the last clear, of which the last
+  //! capacity () are held.
+
+  uint64_t  mTotal;
+
+};	// class InsnTrace
+
+#endif	// INSN_TRACE_H
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,275 @@
+// PC sampling profile: definition
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstring>
+#include <fstream>
+
+#include "Profile.h"
+#include "RegisterSizes.h"
+
+using std::cerr;
+using std::endl;
+using std::lock_guard;
+using std::mutex;
+using std::size_t;
+using std::string;
+
+
+//! Pack a value little endian
+
+//! @param[out] buf    Where to pack it
+//! @param[in]  val    The value
+//! @param[in]  bytes  How many bytes to pack
+
+static void
+packLe (uint8_t *buf,
+	uint64_t  val,
+	int  bytes)
+{
+  for (int  i = 0; i < bytes; i++)
+    buf[i] = static_cast<uint8_t> (val >> (8 * i));
+
+}	// packLe ()
+
+
+//! Constructor.
+
+//! We start off not profiling.
+
+Profile::Profile () :
+  mOn (false),
+  mPeriod (DEFAULT_PERIOD),
+  mLowPc (0),
+  mSamples (0),
+  mMissed (0)
+{
+}	// Profile::Profile ()
+
+
+//! Start profiling afresh
+
+//! Anything from a previous profile is thrown away.
+
+//! @param[in] period  Cycles between samples
+
+void
+Profile::start (uint64_t  period)
+{
+  lock_guard<mutex>  lock (mMutex);
+
+  mHist.clear ();
+  mLowPc   = 0;
+  mSamples = 0;
+  mMissed  = 0;
+  mPeriod.store ((0 == period) ? 1 : period, std::memory_order_relaxed);
+  mOn.store (true, std::memory_order_relaxed);
+
+}	// Profile::start ()
+
+
+//! Stop profiling
+
+//! The samples are kept, so they can be saved.
+
+void
+Profile::stop ()
+{
+  mOn.store (false, std::memory_order_relaxed);
+
+}	// Profile::stop ()
+
+
+//! Add a sample
+
+//! If the PC is outside the histogram, we grow it to cover the PC, so long
+//! as it would still be no more than MAX_SPAN bytes.
+
+//! @param[in] pc  The PC sampled
+
+void
+Profile::sample (uint32_t  pc)
+{
+  lock_guard<mutex>  lock (mMutex);
+
+  mSamples++;
+
+  if (mHist.empty ())
+    {
+      mLowPc = pc & ~(BUCKET_SIZE - 1);
+      mHist.assign (1, 0);
+    }
+  else if (pc < mLowPc)
+    {
+      uint32_t  newLow = pc & ~(GROW_ALIGN - 1);
+      uint64_t  span = static_cast<uint64_t> (mLowPc) - newLow
+	+ mHist.size () * BUCKET_SIZE;
+
+      if (span > MAX_SPAN)
+	{
+	  mMissed++;
+	  return;
+	}
+
+      mHist.insert (mHist.begin (), (mLowPc - newLow) / BUCKET_SIZE, 0);
+      mLowPc = newLow;
+    }
+  else
+    {
+      size_t  bucket = (pc - mLowPc) / BUCKET_SIZE;
+
+      if (bucket >= mHist.size ())
+	{
+	  if ((bucket + 1) * BUCKET_SIZE > MAX_SPAN)
+	    {
+	      mMissed++;
+	      return;
+	    }
+
+	  mHist.resize (bucket + 1, 0);
+	}
+    }
+
+  mHist[(pc - mLowPc) / BUCKET_SIZE]++;
+
+}	// Profile::sample ()
+
+
+//! Report the state of the profile
+
+//! @param[in] s  The stream for the report
+
+void
+Profile::report (std::ostream & s) const
+{
+  lock_guard<mutex>  lock (mMutex);
+
+  s << "Profiling " << (isOn () ? "on" : "off") << ", every " << period ()
+    << " cycles" << endl
+    << "Samples:                " << mSamples;
+
+  if (0 != mMissed)
+    s << " (" << mMissed << " outside the histogram)";
+
+  s << endl;
+
+  if (!mHist.empty ())
+    s << "Addresses:              0x" << std::hex << mLowPc << " to 0x"
+      << (mLowPc + mHist.size () * BUCKET_SIZE) << std::dec << endl;
+
+}	// Profile::report ()
+
+
+//! Save the profile as a gmon.out file
+
+//! The file is the gmon header, then one or more histogram records, each
+//! for the whole histogram.  Addresses are the size of a register, and
+//! everything is little endian, as for the target.
+
+//! @param[in] filename  The file to save to
+//! @return  TRUE if the profile was saved, FALSE otherwise.
+
+bool
+Profile::save (const string & filename) const
+{
+  lock_guard<mutex>  lock (mMutex);
+
+  if (mHist.empty ())
+    {
+      cerr << "ERROR: No profile samples to save" << endl;
+      return  false;
+    }
+
+  std::ofstream  ofs (filename, std::ios::binary);
+
+  if (!ofs)
+    {
+      cerr << "ERROR: Unable to open profile file " << filename << endl;
+      return  false;
+    }
+
+  // The header: "gmon", version 1 and 12 spare bytes
+
+  uint8_t  hdr[20];
+
+  memset (hdr, 0, sizeof (hdr));
+  memcpy (hdr, "gmon", 4);
+  packLe (hdr + 4, 1, 4);
+  ofs.write (reinterpret_cast<char *> (hdr), sizeof (hdr));
+
+  // Histogram records, until every count has been written.  Each is the
+  // tag, the low and high PC, the number of buckets and the samples per
+  // unit of time, then the name and abbreviation of the unit.
+
+  const int  addrBytes = sizeof (uint_reg_t);
+  std::vector<uint32_t>  left (mHist);
+  size_t    n = mHist.size ();
+  bool      more = true;
+
+  while (ofs && more)
+    {
+      uint8_t  rec[1 + 2 * 8 + 4 + 4 + 15 + 1];
+      uint8_t *p = rec;
+
+      memset (rec, 0, sizeof (rec));
+      *p++ = 0;				// GMON_TAG_TIME_HIST
+      packLe (p, mLowPc, addrBytes);
+      p += addrBytes;
+      packLe (p, mLowPc + n * BUCKET_SIZE, addrBytes);
+      p += addrBytes;
+      packLe (p, n, 4);
+      p += 4;
+      packLe (p, 1, 4);
+      p += 4;
+      strcpy (reinterpret_cast<char *> (p), "samples");
+      p += 15;
+      *p++ = 's';
+      ofs.write (reinterpret_cast<char *> (rec), p - rec);
+
+      more = false;
+
+      for (size_t  i = 0; i < n; i++)
+	{
+	  uint32_t  count = (left[i] > MAX_GMON_COUNT)
+	    ? MAX_GMON_COUNT : left[i];
+	  uint8_t   buf[2];
+
+	  left[i] -= count;
+	  more = more || (0 != left[i]);
+	  packLe (buf, count, 2);
+	  ofs.write (reinterpret_cast<char *> (buf), sizeof (buf));
+	}
+    }
+
+  if (!ofs)
+    {
+      cerr << "ERROR: Failed to write profile file " << filename << endl;
+      return  false;
+    }
+
+  return  true;
+
+}	// Profile::save ()
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,149 @@
+// PC sampling profile: declaration
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+//! A statistical profile of where a target spends its time
+
+//! While a target runs, it samples its PC every so often (the period, in
+//! cycles where the target counts them) and adds it to a histogram of
+//! address buckets.  The histogram only covers the addresses seen, growing
+//! as new ones are, up to MAX_SPAN bytes.  Samples beyond that are counted
+//! as missed.
+
+//! The profile is saved as a gmon.out file, holding just the histogram, so
+//! that gprof can give a flat profile of the program.  Time is given in
+//! samples.
+
+//! The server owns the profile, and gives it to the target for good, so
+//! starting and stopping never changes the target while it runs.  Samples
+//! may come from several harts at once, so the histogram is guarded by a
+//! mutex, which is cheap, since samples are rare.
+
+class Profile final
+{
+ public:
+
+  //! Default cycles between samples
+
+  static const uint64_t  DEFAULT_PERIOD = 1000;
+
+  Profile ();
+
+  // Control
+
+  void  start (uint64_t  period = DEFAULT_PERIOD);
+  void  stop ();
+
+  //! Are we profiling?
+
+  //! This is checked by the target as it runs, so is inline.
+
+  //! @return  TRUE if samples are wanted, FALSE otherwise
+
+  bool  isOn () const
+  {
+    return  mOn.load (std::memory_order_relaxed);
+  }
+
+  //! Cycles between samples
+
+  //! @return  The period
+
+  uint64_t  period () const
+  {
+    return  mPeriod.load (std::memory_order_relaxed);
+  }
+
+  void  sample (uint32_t  pc);
+
+  // Output
+
+  void  report (std::ostream & s) const;
+  bool  save (const std::string & filename) const;
+
+ private:
+
+  //! Bytes of address covered by each bucket, since compressed instructions
+  //! may start on any halfword.
+
+  static const uint32_t  BUCKET_SIZE = 2;
+
+  //! Most bytes of address the histogram may cover
+
+  static const uint32_t  MAX_SPAN = 1 << 24;
+
+  //! When the histogram grows down, it grows to this alignment, so it does
+  //! not have to move each time.
+
+  static const uint32_t  GROW_ALIGN = 1 << 10;
+
+  //! Most a gmon.out bucket may count, since counts are 16 bits.  Larger
+  //! counts are split over several histogram records, which gprof adds up.
+
+  static const uint32_t  MAX_GMON_COUNT = 0xffff;
+
+  //! Whether we are profiling
+
+  std::atomic<bool>  mOn;
+
+  //! Cycles between samples
+
+  std::atomic<uint64_t>  mPeriod;
+
+  //! Guards everything below
+
+  mutable std::mutex  mMutex;
+
+  //! Address of the first bucket
+
+  uint32_t  mLowPc;
+
+  //! Samples in each bucket
+
+  std::vector<uint32_t>  mHist;
+
+  //! Samples taken, including those missed
+
+  uint64_t  mSamples;
+
+  //! Samples outside the addresses the histogram can cover
+
+  uint64_t  mMissed;
+
+};	// class Profile
+
+#endif	// PROFILE_H
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// End:
@@ -0,0 +1,255 @@
+// Snapshot of target state: definition
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <iterator>
+
+#include "Snapshot.h"
+
+
+//! Constructor.
+
+//! We start with no writes noted and no snapshot, and the target not yet
+//! run.
+
+Snapshot::Snapshot () :
+  mResumed (false),
+  mHaveSnapshot (false),
+  mRestoring (false)
+{
+}	// Snapshot::Snapshot ()
+
+
+//! Note a write to memory by the debugger, before it is made
+
+//! The new extent is merged with any it overlaps or abuts.  If we have a
+//! snapshot, we also note the old value of any byte we have not yet.
+
+//! @param[in] target  The target being written
+//! @param[in] addr    Address of the write
+//! @param[in] size    Number of bytes written
+
+void
+Snapshot::noteWrite (ITarget * target,
+		     const uint32_t  addr,
+		     const std::size_t  size)
+{
+  if ((0 == size) || mRestoring)
+    return;
+
+  if (mHaveSnapshot)
+    {
+      std::vector<uint8_t>  buf (size);
+
+      if (target->read (addr, buf.data (), size) == size)
+	for (std::size_t  i = 0; i < size; i++)
+	  noteOld (addr + i, buf[i]);
+    }
+
+  uint32_t  start = addr;
+  uint64_t  end   = static_cast<uint64_t> (addr) + size;
+  auto  it = mWritten.upper_bound (start);
+
+  if (it != mWritten.begin ())
+    {
+      auto  prev = std::prev (it);
+
+      if (prev->second >= start)
+	{
+	  start = prev->first;
+
+	  if (prev->second > end)
+	    end = prev->second;
+
+	  mWritten.erase (prev);
+	}
+    }
+
+  while ((it != mWritten.end ()) && (it->first <= end))
+    {
+      if (it->second > end)
+	end = it->second;
+
+      it = mWritten.erase (it);
+    }
+
+  mWritten[start] = end;
+
+}	// Snapshot::noteWrite ()
+
+
+//! Forget all the writes noted
+
+//! For use when the target's memory has been cleared, for instance by a cold
+//! reset.  Any saved snapshot is kept.  A target with clear memory has
+//! nothing left from any earlier run, and outside the extents saved is once
+//! more as it was saved, so we need no old values either.
+
+void
+Snapshot::forgetWrites ()
+{
+  mWritten.clear ();
+  mOld.clear ();
+  mResumed = false;
+
+}	// Snapshot::forgetWrites ()
+
+
+//! Note the target has resumed
+
+//! From now on its memory may differ from what the debugger wrote, so a
+//! snapshot saved now could not be restored faithfully.
+
+void
+Snapshot::noteResume ()
+{
+  mResumed = true;
+
+}	// Snapshot::noteResume ()
+
+
+//! Note the target has been reset
+
+//! For a target whose reset keeps its memory.  The program starts again from
+//! its reset state, so we may once again save a snapshot.
+
+void
+Snapshot::noteReset ()
+{
+  mResumed = false;
+
+}	// Snapshot::noteReset ()
+
+
+//! Save the state of a target
+
+//! The target must be stopped, and must not have resumed since it was last
+//! reset, since we could not then capture all the memory the program has
+//! changed.  In that case any previous snapshot is kept, otherwise it is
+//! discarded, along with the old values noted for it.
+
+//! @param[in] target  The target to save
+//! @return  TRUE if all the state could be read, FALSE otherwise, in which
+//!          case there is no longer a snapshot unless the target had
+//!          resumed
+
+bool
+Snapshot::save (ITarget * target)
+{
+  if (mResumed)
+    return  false;
+
+  mHaveSnapshot = false;
+  mImage.clear ();
+  mOld.clear ();
+
+  for (auto  it = mWritten.begin (); it != mWritten.end (); it++)
+    {
+      std::size_t  size = static_cast<std::size_t> (it->second - it->first);
+
+      mImage.emplace_back (it->first, std::vector<uint8_t> (size));
+
+      if (target->read (it->first, mImage.back ().second.data (), size)
+	  != size)
+	{
+	  mImage.clear ();
+	  return  false;
+	}
+    }
+
+  for (int  reg = 1; reg < NUM_REGS; reg++)
+    if (0 == target->readRegister (reg, mRegs[reg]))
+      {
+	mImage.clear ();
+	return  false;
+      }
+
+  mHaveSnapshot = true;
+  return  true;
+
+}	// Snapshot::save ()
+
+
+//! Restore the state of a target
+
+//! The caller should already have got the target's model out of any trap
+//! or halt of its own.  Memory is written back first, the bytes changed
+//! since the snapshot, then the extents saved, so that writing the PC last
+//! leaves the target ready to resume.  The target is then as it was saved,
+//! so not yet resumed, and has only the extents saved written.
+
+//! @param[in] target  The target to restore
+//! @return  TRUE if there was a snapshot and all of it could be written,
+//!          FALSE otherwise.
+
+bool
+Snapshot::restore (ITarget * target)
+{
+  if (!mHaveSnapshot)
+    return  false;
+
+  bool  ok = true;
+
+  mRestoring = true;
+
+  for (auto  it = mOld.begin (); ok && (it != mOld.end ()); it++)
+    ok = target->write (it->first, &(it->second), 1) == 1;
+
+  for (auto  it = mImage.begin (); ok && (it != mImage.end ()); it++)
+    ok = target->write (it->first, it->second.data (), it->second.size ())
+      == it->second.size ();
+
+  for (int  reg = 1; ok && (reg < NUM_REGS); reg++)
+    ok = 0 != target->writeRegister (reg, mRegs[reg]);
+
+  mRestoring = false;
+
+  if (!ok)
+    return  false;
+
+  mWritten.clear ();
+
+  for (auto  it = mImage.begin (); it != mImage.end (); it++)
+    mWritten[it->first] = it->first + it->second.size ();
+
+  mOld.clear ();
+  mResumed = false;
+  return  true;
+
+}	// Snapshot::restore ()
+
+
+//! Do we have a snapshot?
+
+//! @return  TRUE if there is a snapshot from which to restore.
+
+bool
+Snapshot::haveSnapshot () const
+{
+  return  mHaveSnapshot;
+
+}	// Snapshot::haveSnapshot ()
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// show-trailing-whitespace: t
+// End:
@@ -0,0 +1,155 @@
+// Snapshot of target state: declaration
+
+// Copyright (C) 2026  agent <agent@local>
+
+// Contributor agent <agent@local>
+
+// This file is part of the RISC-V GDB server
+
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ITarget.h"
+
+
+//! A snapshot of the state of a target, from which it can be restarted.
+
+//! None of the models can tell us how big their memory is, and copying the
+//! whole address space would be slower than reloading the program.  So the
+//! target tells us about every write made by the debugger, and we keep the
+//! extents written (in practice the program GDB loaded).  A snapshot is then
+//! those extents, together with the general registers and the PC.
+
+//! That is only the whole state of the target before the program has run,
+//! since running changes memory outside the extents (stack, heap and bss).
+//! So the target also tells us when it resumes and when it is reset, and we
+//! refuse to save a snapshot once it has resumed since the last reset.
+
+//! Once saved, we also keep the old value of every byte changed, so it can
+//! be rolled back.  The target tells us before the debugger writes, and a
+//! target which can see the program's stores on its memory bus tells us
+//! before each of those lands (RI5CY and PicoRV32).  A target which can't
+//! (gdbsim) must instead reset its model, clearing memory, before restoring.
+
+//! On restore we write the old values back, then the extents and registers,
+//! through the target's own interface.
+
+class Snapshot final
+{
+ public:
+
+  Snapshot ();
+
+  // Track memory written by the debugger
+
+  void  noteWrite (ITarget * target,
+		   const uint32_t  addr,
+		   const std::size_t  size);
+  void  forgetWrites ();
+
+  //! Have we the old value of a byte?
+
+  //! Only the first change to a byte since the snapshot matters, so a
+  //! target need only read a byte about to be stored if we have not.  This
+  //! is on the simulation's critical path, so it is inline.
+
+  //! @param[in] addr  The address of the byte
+  //! @return  TRUE if we have its value as saved, FALSE otherwise.
+
+  bool  haveOld (const uint32_t  addr) const
+  {
+    return  mOld.end () != mOld.find (addr);
+  }
+
+  //! Note the old value of a byte about to be changed
+
+  //! Only the first value noted for each byte is kept.
+
+  //! @param[in] addr  The address of the byte
+  //! @param[in] val   Its value before the change
+
+  void  noteOld (const uint32_t  addr,
+		 const uint8_t  val)
+  {
+    (void) mOld.emplace (addr, val);
+  }
+
+  // Track whether the target has run since it was reset
+
+  void  noteResume ();
+  void  noteReset ();
+
+  // Save and restore the state of a target
+
+  bool  save (ITarget * target);
+  bool  restore (ITarget * target);
+  bool  haveSnapshot () const;
+
+
+ private:
+
+  //! Number of registers we save: the general registers and the PC.
+
+  static const int NUM_REGS = 33;
+
+  //! Extents written by the debugger, as start address mapped to the address
+  //! just beyond the end.  Extents never overlap or abut.
+
+  std::map<uint32_t, uint64_t>  mWritten;
+
+  //! The saved memory image, one block for each extent.
+
+  std::vector<std::pair<uint32_t, std::vector<uint8_t> > >  mImage;
+
+  //! The value as saved of each byte changed since, by address.
+
+  std::unordered_map<uint32_t, uint8_t>  mOld;
+
+  //! The saved registers.  We never restore R0.
+
+  uint_reg_t  mRegs[NUM_REGS];
+
+  //! Has the target resumed since it was last reset or restored?  If so
+  //! its memory is no longer just what the debugger wrote.
+
+  bool  mResumed;
+
+  //! Have we a saved snapshot?
+
+  bool  mHaveSnapshot;
+
+  //! Are we restoring?  Our own writes need not be noted.
+
+  bool  mRestoring;
+
+};	// class Snapshot
+
+
+#endif	// SNAPSHOT_H
+
+
+// Local Variables:
+// mode: C++
+// c-file-style: "gnu"
+// show-trailing-whitespace: t
+// End:
@@ -61,6 +61,9 @@ GdbSim::~GdbSim ()
 ITarget::ResumeRes
 GdbSim::resume (ResumeType  step)
 {
+  if (ResumeType::STOP != step)
+    mSnapshot.noteResume ();
+
   return mGdbSimImpl->resume (step);
 
 }	// GdbSim::resume ()
@@ -78,11 +81,34 @@ ITarget::ResumeRes
 GdbSim::resume (ResumeType  step,
 	       std::chrono::duration <double>  timeout)
 {
+  if (ResumeType::STOP != step)
+    mSnapshot.noteResume ();
+
   return mGdbSimImpl->resume (step, timeout);
 
 }	// GdbSim::resume ()
 
 
+//! Resume execution with a budget
+
+//! Wrapper for the implementation class
+
+//! @param[in] step         Type of resumption required
+//! @param[in] budget       Budget of work
+//! @return The type of termination encountered.
+
+ITarget::ResumeRes
+GdbSim::resume (ResumeType  step,
+	       uint64_t  budget)
+{
+  if (ResumeType::STOP != step)
+    mSnapshot.noteResume ();
+
+  return mGdbSimImpl->resume (step, budget);
+
+}	// GdbSim::resume ()
+
+
 //! Terminate execution
 
 //! Wrapper for the implementation class.
@@ -106,6 +132,10 @@ GdbSim::terminate (void)
 ITarget::ResumeRes
 GdbSim::reset (ITarget::ResetType  type)
 {
+  // A new simulator instance has none of our memory.
+
+  mSnapshot.forgetWrites ();
+
   return mGdbSimImpl->reset (type);
 
 }	// GdbSim::reset ()
@@ -206,6 +236,7 @@ GdbSim::write (const uint32_t  addr,
 	      const uint8_t * buffer,
 	      const std::size_t size)
 {
+  mSnapshot.noteWrite (this, addr, size);
   return mGdbSimImpl->write (addr, buffer, size);
 
 }	// GdbSim::write ()
@@ -245,6 +276,69 @@ GdbSim::removeMatchpoint (const uint32_t  addr,
 }	// GdbSim::removeMatchpoint ()
 
 
+//! Find the watchpoint which last stopped execution
+
+//! Wrapper for the implementation class.
+
+//! @param[out] addr       Address of the byte which was watched
+//! @param[out] matchType  Type of watchpoint
+//! @return  TRUE if the last resume stopped at a watchpoint, FALSE
+//!          otherwise.
+
+bool
+GdbSim::lastWatchpoint (uint32_t & addr,
+		       MatchType & matchType) const
+{
+  return mGdbSimImpl->lastWatchpoint (addr, matchType);
+
+}	// GdbSim::lastWatchpoint ()
+
+
+//! The size of the block of memory read together
+
+//! @return  Always 1, since the simulator sees each byte read.
+
+std::size_t
+GdbSim::readGranule () const
+{
+  return  1;
+
+}	// GdbSim::readGranule ()
+
+
+//! Save a snapshot of the target state
+
+//! @return  TRUE if the snapshot was saved, FALSE otherwise.
+
+bool
+GdbSim::saveSnapshot ()
+{
+  return  mSnapshot.save (this);
+
+}	// GdbSim::saveSnapshot ()
+
+
+//! Restore the target state from the last snapshot
+
+//! The state of a stopped simulator is no more than its memory and
+//! registers.  A reset opens a new instance with empty memory, so resetting
+//! first discards everything the program changed since the snapshot, before
+//! we write the saved state back.
+
+//! @return  TRUE if the target was restored, FALSE otherwise.
+
+bool
+GdbSim::restoreSnapshot ()
+{
+  if (!mSnapshot.haveSnapshot ()
+      || (ResumeRes::SUCCESS != reset (ResetType::WARM)))
+    return  false;
+
+  return  mSnapshot.restore (this);
+
+}	// GdbSim::restoreSnapshot ()
+
+
 //! Pass a command through to the target
 
 //! Wrapper for the implementation class.
@@ -274,6 +368,69 @@ GdbSim::gdbServer (GdbServer * server)
 }	// GdbSim::gdbServer ()
 
 
+//! Wrapper for the implementation class
+
+//! @param[in] flag  The flag to watch while running
+
+void
+GdbSim::breakFlag (const std::atomic<bool> * flag)
+{
+  mGdbSimImpl->breakFlag (flag);
+
+}	// GdbSim::breakFlag ()
+
+
+//! Start or stop recording instructions, which we can't do
+
+//! The GDB simulator runs whole instructions out of sight, so there is
+//! nothing to watch.
+
+//! @return  Always FALSE
+
+bool
+GdbSim::traceInsns (bool  on __attribute__ ((unused)))
+{
+  return  false;
+
+}	// GdbSim::traceInsns ()
+
+
+//! The instructions recorded, of which there are none
+
+//! @return  Always NULL
+
+const InsnTrace *
+GdbSim::insnTrace () const
+{
+  return  nullptr;
+
+}	// GdbSim::insnTrace ()
+
+
+//! Can the instructions recorded be given to GDB as branch trace?
+
+//! @return  Always FALSE, since we record none
+
+bool
+GdbSim::branchTrace () const
+{
+  return  false;
+
+}	// GdbSim::branchTrace ()
+
+
+//! Wrapper for the implementation class
+
+//! @param[in] prof  The profile to sample into, or NULL if none
+
+void
+GdbSim::profile (Profile * prof)
+{
+  mGdbSimImpl->profile (prof);
+
+}	// GdbSim::profile ()
+
+
 //! Return a timestamp.
 
 //! This is needed to support the $time function in Verilog.  This in turn is
@@ -24,6 +24,7 @@
 #define GDBSIM_H
 
 #include "ITarget.h"
+#include "Snapshot.h"
 
 
 class GdbSimImpl;
@@ -46,6 +47,8 @@ class GdbSim final : public ITarget
   virtual ResumeRes  resume (ResumeType step);
   virtual ResumeRes  resume (ResumeType step,
                              std::chrono::duration <double>  timeout);
+  virtual ResumeRes  resume (ResumeType step,
+                             uint64_t  budget);
 
   virtual ResumeRes  terminate (void);
   virtual ResumeRes  reset (ITarget::ResetType  type);
@@ -83,6 +86,20 @@ class GdbSim final : public ITarget
   virtual bool  removeMatchpoint (const uint32_t  addr,
 				  const MatchType  matchType);
 
+  // Find the watchpoint which last stopped execution
+
+  virtual bool  lastWatchpoint (uint32_t & addr,
+				MatchType & matchType) const;
+
+  // Granularity of reads, for watchpoints
+
+  virtual std::size_t  readGranule () const;
+
+  // Save and restore a snapshot of the target state
+
+  virtual bool  saveSnapshot ();
+  virtual bool  restoreSnapshot ();
+
   // Generic pass through of command
 
   virtual bool command (const std::string  cmd,
@@ -92,6 +109,20 @@ class GdbSim final : public ITarget
 
   void gdbServer (GdbServer *server);
 
+  // Watch for a request to stop
+
+  void breakFlag (const std::atomic<bool> * flag);
+
+  // Instruction trace
+
+  bool  traceInsns (bool  on);
+  const InsnTrace * insnTrace () const;
+  bool  branchTrace () const;
+
+  // Profiling
+
+  void  profile (Profile * prof);
+
   // Verilator support
 
   virtual double timeStamp ();
@@ -103,6 +134,11 @@ class GdbSim final : public ITarget
 
   GdbSimImpl * mGdbSimImpl;
 
+  //! The snapshot from which we can be restored, which also tracks the
+  //! memory written by the debugger.
+
+  Snapshot  mSnapshot;
+
 };	// class GdbSim
 
 
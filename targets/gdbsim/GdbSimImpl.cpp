@@ -34,6 +34,12 @@
 #include "gdb/signals.h"
 #include "gdb/sim-riscv.h"
 
+
+//! The simulator running freely on this thread.
+
+thread_local GdbSimImpl * GdbSimImpl::sRunning = nullptr;
+
+
 //! Constructor.
 
 //! Initialize the counters and instantiate the Verilator model. Take the
@@ -43,7 +49,11 @@
 
 GdbSimImpl::GdbSimImpl (const TraceFlags *flags)
   : mFlags (flags),
-    mHaveReset (false)
+    mHaveReset (false),
+    mBreakFlag (nullptr),
+    mProfile (nullptr),
+    mProfilePolls (0),
+    mBreaksPlanted (false)
 {
   reset (ITarget::ResetType::COLD);
 }	// GdbSimImpl::GdbSimImpl ()
@@ -92,7 +102,7 @@ GdbSimImpl::resume (ITarget::ResumeType step,
       return doOneStep (timeout);
 
     case ITarget::ResumeType::CONTINUE:
-      return doRunToBreak (timeout);
+      return doRunToBreak (timeout, 0);
 
     default:
       // Shouldn't see anything else here.
@@ -104,6 +114,28 @@ GdbSimImpl::resume (ITarget::ResumeType step,
 }	// GdbSimImpl::resume ()
 
 
+//! Resume execution with a budget
+
+//! The simulator doesn't count instructions for us, so the budget is in
+//! polls of the simulator (@see pollQuit ()), each a few instructions.  It
+//! only applies to continuing, since a step is always short.
+
+//! @param[in]  step    The type of resume to carry out.
+//! @param[in]  budget  Maximum simulator polls.  Zero means no limit.
+//! @return Why the target stopped.
+
+ITarget::ResumeRes
+GdbSimImpl::resume (ITarget::ResumeType step,
+                    uint64_t  budget)
+{
+  if (ITarget::ResumeType::CONTINUE != step)
+    return resume (step, std::chrono::duration <double>::zero ());
+
+  return doRunToBreak (std::chrono::duration <double>::zero (), budget);
+
+}	// GdbSimImpl::resume ()
+
+
 //! Terminate.
 
 //! This has no meaning for an embedded system, so it does nothing.
@@ -134,7 +166,29 @@ GdbSimImpl::reset (ITarget::ResetType type __attribute__ ((unused)))
     gdb_callback.shutdown (&gdb_callback);
   mHaveReset = true;
 
+  // The simulator starts afresh, so any breakpoints we planted are gone.
+
+  mPlanted.clear ();
+  mBreaksPlanted = false;
+
   gdb_callback = default_callback;
+
+  // When running freely, the simulator services syscalls itself through the
+  // host callbacks, so we hook those used for the syscalls GDB handles for
+  // us, and the poll used to check whether to stop.  See doRunToBreak ().
+  gdb_callback.close        = trapSyscall;
+  gdb_callback.lseek        = trapSyscall;
+  gdb_callback.open         = trapSyscall;
+  gdb_callback.read         = trapSyscall;
+  gdb_callback.read_stdin   = trapSyscall;
+  gdb_callback.unlink       = trapSyscall;
+  gdb_callback.write        = trapSyscall;
+  gdb_callback.write_stdout = trapSyscall;
+  gdb_callback.write_stderr = trapSyscall;
+  gdb_callback.to_stat      = trapSyscall;
+  gdb_callback.to_fstat     = trapSyscall;
+  gdb_callback.poll_quit    = pollQuit;
+
   gdb_callback.init (&gdb_callback);
 
   gdbsim_desc = sim_open (SIM_OPEN_DEBUG, &gdb_callback,
@@ -246,6 +300,9 @@ GdbSimImpl::writeRegister (const int reg __attribute__ ((unused)),
 //! Otherwise we may have to put the memory external to the core instead of in
 //! top.sv, but that would be painful to implement.
 
+//! Our breakpoints may still be planted after a timed out run (@see
+//! doRunToBreak ()), so we show the instructions they displaced instead.
+
 //! @param[in]  addr    Address to read from
 //! @param[out] buffer  Buffer into which read data is placed
 //! @param[in]  size    Number of bytes to read
@@ -263,6 +320,17 @@ GdbSimImpl::read (const uint32_t addr __attribute__ ((unused)),
       std::cerr << "In " << __PRETTY_FUNCTION__ << " failed to read "
                 << "memory at " << std::hex << addr << std::endl;
     }
+
+  for (auto &p : mPlanted)
+    {
+      std::size_t  len = (0x3 == (p.second & 0x3)) ? 4 : 2;
+      const uint8_t * orig = reinterpret_cast <const uint8_t *> (&p.second);
+
+      for (std::size_t  i = 0; i < len; i++)
+        if ((p.first + i >= addr) && (p.first + i - addr < size))
+          buffer[p.first + i - addr] = orig[i];
+    }
+
   return ans;
 }	// GdbSimImpl::read ()
 
@@ -273,6 +341,9 @@ GdbSimImpl::read (const uint32_t addr __attribute__ ((unused)),
 
 //! For discussion, @see read ()
 
+//! Any breakpoints still planted are restored first, so the write can't be
+//! undone by restoring them later.
+
 //! @param[in] addr    Address to write to
 //! @param[in] buffer  Buffer of data to write
 //! @param[in] size    Number of bytes to write
@@ -283,6 +354,8 @@ GdbSimImpl::write (const uint32_t addr __attribute__ ((unused)),
 		  const uint8_t *buffer __attribute__ ((unused)),
 		  const std::size_t size __attribute__ ((unused)))
 {
+  unplantBreakpoints ();
+
   int res
     = sim_write (gdbsim_desc, addr, buffer, size);
   if (static_cast <int> (size) != res)
@@ -297,46 +370,74 @@ GdbSimImpl::write (const uint32_t addr __attribute__ ((unused)),
 
 //! Insert a matchpoint (breakpoint or watchpoint)
 
-//! @todo
-
-//! It is acceptable to always fail. GDB will then use memory breakpoints,
-//! implemented by writing EBREAK to the location.
+//! We hold breakpoints of either kind in our own table, so inserting one
+//! costs no memory traffic.  They are only planted in the simulator's memory
+//! while running freely (@see doRunToBreak ()), so any still planted are
+//! restored before the table changes.  We have no support for watchpoints.
 
 //! @param[in] addr       Address for the matchpoint
 //! @param[in] matchType  Type of breakpoint or watchpoint
 //! @return  TRUE if the operation was successful, false otherwise.
 
 bool
-GdbSimImpl::insertMatchpoint (const uint32_t  addr __attribute__ ((unused)),
-			     const ITarget::MatchType  matchType __attribute__ ((unused)))
+GdbSimImpl::insertMatchpoint (const uint32_t  addr,
+			     const ITarget::MatchType  matchType)
 {
-  std::cerr << "In " << __PRETTY_FUNCTION__ << std::endl;
-  abort ();
-  return  false;
-}	// GdbSimImpl::insertMatchpoint ()
-
+  switch (matchType)
+    {
+    case ITarget::MatchType::BREAK:
+    case ITarget::MatchType::BREAK_HW:
+      unplantBreakpoints ();
+      mMatchpoints.add (static_cast<MpType> (matchType), addr, 0);
+      return  true;
 
-//! Insert a matchpoint (breakpoint or watchpoint)
+    default:
+      return  false;
+    }
+}	// GdbSimImpl::insertMatchpoint ()
 
-//! @todo
 
-//! It is acceptable to always fail. GDB will then use memory breakpoints,
-//! implemented by writing EBREAK to the location.
+//! Remove a matchpoint (breakpoint or watchpoint)
 
 //! @param[in] addr       Address for the matchpoint
 //! @param[in] matchType  Type of breakpoint or watchpoint
 //! @return  TRUE if the operation was successful, false otherwise.
 
 bool
-GdbSimImpl::removeMatchpoint (const uint32_t  addr __attribute__ ((unused)),
-			     const ITarget::MatchType  matchType __attribute__ ((unused)) )
+GdbSimImpl::removeMatchpoint (const uint32_t  addr,
+			     const ITarget::MatchType  matchType)
 {
-  std::cerr << "In " << __PRETTY_FUNCTION__ << std::endl;
-  abort ();
-  return  false;
+  switch (matchType)
+    {
+    case ITarget::MatchType::BREAK:
+    case ITarget::MatchType::BREAK_HW:
+      unplantBreakpoints ();
+      return  mMatchpoints.remove (static_cast<MpType> (matchType), addr);
+
+    default:
+      return  false;
+    }
 }	// GdbSimImpl::removeMatchpoint ()
 
 
+//! Find the watchpoint which last stopped execution
+
+//! We have no support for watchpoints, so there never is one.
+
+//! @param[out] addr       Address of the byte which was watched
+//! @param[out] matchType  Type of watchpoint
+//! @return  TRUE if the last resume stopped at a watchpoint, FALSE
+//!          otherwise.  We always return FALSE.
+
+bool
+GdbSimImpl::lastWatchpoint (uint32_t & addr __attribute__ ((unused)),
+			   ITarget::MatchType & matchType __attribute__ ((unused))) const
+{
+  return  false;
+
+}	// GdbSimImpl::lastWatchpoint ()
+
+
 //! Generic pass through of command
 
 //! @todo
@@ -370,6 +471,35 @@ GdbSimImpl::gdbServer (GdbServer *server)
 }	// GdbSimImpl::gdbServer ()
 
 
+//! Record the flag telling us to stop
+
+//! We look at it on every poll by the simulator (@see pollQuit ()).
+
+//! @param[in] flag  The flag to watch while running, or NULL if none.
+
+void
+GdbSimImpl::breakFlag (const std::atomic<bool> * flag)
+{
+  mBreakFlag = flag;
+
+}	// GdbSimImpl::breakFlag ()
+
+
+//! Record the profile to sample into
+
+//! We sample on every profile period polls by the simulator (@see
+//! pollQuit ()).
+
+//! @param[in] prof  The profile to sample into, or NULL if none.
+
+void
+GdbSimImpl::profile (Profile * prof)
+{
+  mProfile = prof;
+
+}	// GdbSimImpl::profile ()
+
+
 //! Provide a time stamp (needed for $time)
 
 //! We count in nanoseconds since (cold) reset.
@@ -389,12 +519,13 @@ ITarget::ResumeRes
 GdbSimImpl::doOneStep (std::chrono::duration <double> timeout)
 {
   uint32_t insn;
-  uint16_t cinsn;
   uint_reg_t stepAddr;
   enum sim_stop stop_reason;
   int signo;
   (void) timeout;
 
+  unplantBreakpoints ();
+
   /* If we are sat looking at a syscall (ECALL instruction) then nudge the
      $pc past the ECALL, and then return that a syscall has been
      performed.  */
@@ -419,16 +550,7 @@ GdbSimImpl::doOneStep (std::chrono::duration <double> timeout)
         {
           /* If we stopped looking at either C.EBREAK or EBREAK then we
              have hit a breakpoint.  Return an appropriate reply.  */
-          read (stepAddr,
-                reinterpret_cast <uint8_t *> (&cinsn),
-                sizeof (cinsn));
-          if (cinsn == 0x9002 /* C.EBREAK */)
-            return ITarget::ResumeRes::INTERRUPTED;
-
-          read (stepAddr,
-                reinterpret_cast <uint8_t *> (&insn),
-                sizeof (insn));
-          if (insn == 0x00100073 /* EBREAK */)
+          if (atBreak (stepAddr))
             return ITarget::ResumeRes::INTERRUPTED;
 
           /* We must have just completed a step.  */
@@ -469,33 +591,323 @@ GdbSimImpl::doOneStep (std::chrono::duration <double> timeout)
 }
 
 
+//! Run freely until a breakpoint, syscall or timeout
+
+//! Rather than stepping one instruction at a time, we let the simulator run
+//! freely (sim_resume with step=0) and have it stop itself.
+
+//! - The simulator regularly polls the poll_quit host callback, which we use
+//!   to check the deadline and count down any budget, stopping the
+//!   simulator when either has passed.
+
+//! - The simulator services ECALL itself through the host callbacks.  So we
+//!   hook those callbacks (see reset ()), and use them to note the value of
+//!   A0 and stop the simulator instead.  Once it stops, just after the ECALL,
+//!   we restore A0, so the server sees the same state as if we had stepped
+//!   over the ECALL in doOneStep ().  Any syscall the simulator services
+//!   without these callbacks is handled entirely within the simulator.
+
+//! - Exit halts the simulator, which we report as a syscall, just as
+//!   doOneStep () does.
+
+//! - EBREAK and C.EBREAK stop the simulator with SIGTRAP, leaving the PC at
+//!   the breakpoint.  Our own breakpoints are planted as such for the run,
+//!   having first stepped off any at the current PC.  They stay planted if
+//!   the run times out, so a continue run in slices doesn't rewrite them on
+//!   every slice.  They are restored when we really stop, or before the
+//!   server next steps, touches memory or changes the breakpoints.
+
+//! @param[in] timeout  Maximum time to run.  Zero means no limit.
+//! @param[in] budget   Maximum simulator polls.  Zero means no limit.
+//! @return  Why we stopped.
+
 ITarget::ResumeRes
-GdbSimImpl::doRunToBreak (std::chrono::duration <double> timeout)
+GdbSimImpl::doRunToBreak (std::chrono::duration <double> timeout,
+                          uint64_t  budget)
 {
-  bool haveTimeout = std::chrono::duration <double>::zero() != timeout;
-  std::chrono::time_point <std::chrono::system_clock,
-                           std::chrono::duration <double> > timeout_end;
+  enum sim_stop stop_reason;
+  int signo;
 
-  if (haveTimeout)
-    timeout_end = std::chrono::system_clock::now () + timeout;
+  mHaveDeadline = std::chrono::duration <double>::zero() != timeout;
+  mHaveBudget   = 0 != budget;
+  mBudgetLeft   = budget;
 
-  do
+  if (mHaveDeadline)
+    mDeadline = std::chrono::system_clock::now () + timeout;
+
+  if (mMatchpoints.any (BP_MEMORY) || mMatchpoints.any (BP_HARDWARE))
     {
-      // Step without a timeout.
-      ITarget::ResumeRes res
-        = doOneStep (std::chrono::duration <double>::zero ());
-
-      // If the result is anything other than "step completed" then we're
-      // done.
-      if (res != ITarget::ResumeRes::STEPPED)
-        return res;
-
-      // Have we been running too long?
-      if (haveTimeout && (std::chrono::system_clock::now () > timeout_end))
-        return ITarget::ResumeRes::TIMEOUT;
+      uint_reg_t  pc;
+
+      readRegister (SIM_RISCV_PC_REGNUM, pc);
+      if (isBreakpoint (pc))
+        {
+          ITarget::ResumeRes  res = doOneStep (timeout);
+
+          if (ITarget::ResumeRes::STEPPED != res)
+            return res;
+
+          readRegister (SIM_RISCV_PC_REGNUM, pc);
+          if (isBreakpoint (pc))
+            return ITarget::ResumeRes::INTERRUPTED;
+        }
     }
-  while (true);
-}
+
+  mPollCount      = 0;
+  mTimedOut       = false;
+  mSyscallPending = false;
+
+  plantBreakpoints ();
+  sRunning = this;
+  sim_resume (gdbsim_desc, 0, 0 /* No signal.  */);
+  sRunning = nullptr;
+
+  sim_stop_reason (gdbsim_desc, &stop_reason, &signo);
+
+  if ((sim_stopped == stop_reason) && (signo == GDB_SIGNAL_INT) && mTimedOut
+      && !mSyscallPending)
+    return ITarget::ResumeRes::TIMEOUT;
+
+  unplantBreakpoints ();
+
+  if (mSyscallPending)
+    {
+      writeRegister (SIM_RISCV_A0_REGNUM, mSyscallA0);
+      return ITarget::ResumeRes::SYSCALL;
+    }
+
+  switch (stop_reason)
+    {
+    case sim_stopped:
+      if (signo == GDB_SIGNAL_TRAP)
+        {
+          uint_reg_t  pc;
+
+          readRegister (SIM_RISCV_PC_REGNUM, pc);
+          if (isBreakpoint (pc) || atBreak (pc))
+            return ITarget::ResumeRes::INTERRUPTED;
+        }
+
+      std::cerr << "Unexpected signal " << std::dec << signo
+                << " from simulator" << std::endl;
+      return ITarget::ResumeRes::INTERRUPTED;
+
+    case sim_signalled:
+      /* Simulator was terminated with a signal.  There's currently no way
+         to pass the signal number back out to the gdbserver code.  */
+      std::cerr << "Simulator terminated with signal "
+                << signo << std::endl;
+      break;
+
+    case sim_exited:
+      /* Simulator exited.  */
+      return ITarget::ResumeRes::SYSCALL;
+
+    default:
+    case sim_running:
+    case sim_polling:
+      /* These should not happen.  */
+      std::cerr << "Error, unexpected simulator stop, reason = "
+                << stop_reason << ", signal = " << signo << std::endl;
+      break;
+    }
+
+  std::cerr << "Invalid simulator stop" << std::endl;
+  abort ();
+  return ITarget::ResumeRes::FAILURE;
+}	// GdbSimImpl::doRunToBreak ()
+
+
+//! Is there a breakpoint (C.EBREAK or EBREAK) at an address?
+
+//! @param[in] addr  The address to check
+//! @return  TRUE if there is a breakpoint instruction at addr.
+
+bool
+GdbSimImpl::atBreak (uint_reg_t  addr) const
+{
+  uint32_t insn;
+  uint16_t cinsn;
+
+  read (addr, reinterpret_cast <uint8_t *> (&cinsn), sizeof (cinsn));
+  if (cinsn == 0x9002 /* C.EBREAK */)
+    return true;
+
+  read (addr, reinterpret_cast <uint8_t *> (&insn), sizeof (insn));
+  return insn == 0x00100073 /* EBREAK */;
+
+}	// GdbSimImpl::atBreak ()
+
+
+//! Is there a breakpoint of either kind at an address?
+
+//! @param[in] addr  The address to check
+//! @return  TRUE if we are holding a breakpoint at addr.
+
+bool
+GdbSimImpl::isBreakpoint (uint32_t  addr)
+{
+  return (NULL != mMatchpoints.lookup (BP_MEMORY, addr))
+    || (NULL != mMatchpoints.lookup (BP_HARDWARE, addr));
+
+}	// GdbSimImpl::isBreakpoint ()
+
+
+//! Plant our breakpoints in the simulator's memory
+
+//! We use C.EBREAK over a compressed instruction, so we never overwrite the
+//! following instruction.  Nothing is done if they are already planted.
+
+void
+GdbSimImpl::plantBreakpoints ()
+{
+  if (mBreaksPlanted)
+    return;
+
+  mPlanted.clear ();
+
+  mMatchpoints.forEach ([this] (MpEntry & e) {
+      // A hardware breakpoint sharing its address with a software one only
+      // needs planting once.
+
+      if (((BP_MEMORY != e.type) && (BP_HARDWARE != e.type))
+          || ((BP_HARDWARE == e.type)
+              && (NULL != mMatchpoints.lookup (BP_MEMORY, e.addr))))
+        return;
+
+      uint32_t  insn;
+
+      read (e.addr, reinterpret_cast <uint8_t *> (&insn), sizeof (insn));
+      mPlanted.push_back (std::make_pair (e.addr, insn));
+
+      if (0x3 == (insn & 0x3))
+        {
+          const uint32_t  ebreak = 0x00100073;
+          write (e.addr, reinterpret_cast <const uint8_t *> (&ebreak),
+                 sizeof (ebreak));
+        }
+      else
+        {
+          const uint16_t  c_ebreak = 0x9002;
+          write (e.addr, reinterpret_cast <const uint8_t *> (&c_ebreak),
+                 sizeof (c_ebreak));
+        }
+    });
+
+  mBreaksPlanted = true;
+
+}	// GdbSimImpl::plantBreakpoints ()
+
+
+//! Restore the instructions displaced by our planted breakpoints
+
+//! Nothing is done if they are not planted.  We note they are gone before
+//! restoring them, since write () restores them itself.
+
+void
+GdbSimImpl::unplantBreakpoints ()
+{
+  if (!mBreaksPlanted)
+    return;
+
+  mBreaksPlanted = false;
+
+  for (auto &p : mPlanted)
+    {
+      std::size_t  len = (0x3 == (p.second & 0x3)) ? 4 : 2;
+      write (p.first, reinterpret_cast <const uint8_t *> (&p.second), len);
+    }
+
+  mPlanted.clear ();
+
+}	// GdbSimImpl::unplantBreakpoints ()
+
+
+//! Host callback to say whether the simulator should stop
+
+//! Called regularly by the simulator while running freely.  Any break flag
+//! is checked and any budget counted down on every call, but we only look at
+//! the clock every POLL_CLOCK_PERIOD calls.  If we are profiling, we sample
+//! the PC every profile period calls.
+
+//! @param[in] cb  The host callbacks (unused)
+//! @return  Non-zero if the simulator should stop.
+
+int
+GdbSimImpl::pollQuit (host_callback * cb __attribute__ ((unused)))
+{
+  GdbSimImpl * sim = sRunning;
+
+  if (nullptr == sim)
+    return 0;
+
+  if ((nullptr != sim->mBreakFlag)
+      && sim->mBreakFlag->load (std::memory_order_relaxed))
+    {
+      sim->mTimedOut = true;
+      return 1;
+    }
+
+  if ((nullptr != sim->mProfile) && sim->mProfile->isOn ()
+      && (++sim->mProfilePolls >= sim->mProfile->period ()))
+    {
+      uint_reg_t  pc;
+
+      sim->mProfilePolls = 0;
+      sim->readRegister (SIM_RISCV_PC_REGNUM, pc);
+      sim->mProfile->sample (pc);
+    }
+
+  if (sim->mHaveBudget && (0 == --sim->mBudgetLeft))
+    {
+      sim->mTimedOut = true;
+      return 1;
+    }
+
+  if (!sim->mHaveDeadline || (++sim->mPollCount < POLL_CLOCK_PERIOD))
+    return 0;
+
+  sim->mPollCount = 0;
+  if (std::chrono::system_clock::now () > sim->mDeadline)
+    {
+      sim->mTimedOut = true;
+      return 1;
+    }
+
+  return 0;
+
+}	// GdbSimImpl::pollQuit ()
+
+
+//! Host callback used by the simulator to service a syscall
+
+//! One template serves all the hooked callbacks, whatever their signature.
+//! We note A0 (which the simulator is about to overwrite with our result)
+//! and stop the simulator, which will happen as soon as the ECALL completes.
+//! The syscall itself is then done by the server.  We return failure, so
+//! the simulator doesn't touch target memory with any result.
+
+//! @param[in] cb  The host callbacks (unused)
+//! @return  -1 (failure)
+
+template <typename R, typename... Args>
+R
+GdbSimImpl::trapSyscall (host_callback * cb __attribute__ ((unused)),
+			 Args...)
+{
+  GdbSimImpl * sim = sRunning;
+
+  if ((nullptr != sim) && !sim->mSyscallPending)
+    {
+      sim->mSyscallPending = true;
+      sim->readRegister (SIM_RISCV_A0_REGNUM, sim->mSyscallA0);
+      sim_stop (sim->gdbsim_desc);
+    }
+
+  return static_cast <R> (-1);
+
+}	// GdbSimImpl::trapSyscall ()
+
 
 // Local Variables:
 // mode: C++
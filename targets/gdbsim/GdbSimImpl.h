@@ -23,10 +23,16 @@
 #ifndef GDBSIM_IMPL_H
 #define GDBSIM_IMPL_H
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <fstream>
+#include <utility>
+#include <vector>
 
 #include "ITarget.h"
+#include "MpHash.h"
+#include "Profile.h"
 #include "gdb/remote-sim.h"
 #include "gdb/callback.h"
 
@@ -44,6 +50,8 @@ class GdbSimImpl final
   ITarget::ResumeRes  resume (ITarget::ResumeType step);
   ITarget::ResumeRes  resume (ITarget::ResumeType step,
 			      std::chrono::duration <double>  timeout);
+  ITarget::ResumeRes  resume (ITarget::ResumeType step,
+			      uint64_t  budget);
 
   ITarget::ResumeRes  terminate ();
   ITarget::ResumeRes  reset (ITarget::ResetType  type);
@@ -81,6 +89,11 @@ class GdbSimImpl final
   bool  removeMatchpoint (const uint32_t  addr,
 			  const ITarget::MatchType  matchType);
 
+  // Find the watchpoint which last stopped execution
+
+  bool  lastWatchpoint (uint32_t & addr,
+			ITarget::MatchType & matchType) const;
+
   // Generic pass through of command
 
   bool command (const std::string  cmd,
@@ -90,6 +103,14 @@ class GdbSimImpl final
 
   void gdbServer (GdbServer *server);
 
+  // Watch for a request to stop
+
+  void breakFlag (const std::atomic<bool> * flag);
+
+  // Profiling
+
+  void profile (Profile * prof);
+
   // Verilog support functions
 
   double timeStamp ();
@@ -114,8 +135,92 @@ class GdbSimImpl final
 
   bool mHaveReset;
 
+  //! Flag telling us to stop running freely, if any
+
+  const std::atomic<bool> * mBreakFlag;
+
+  //! How many simulator polls between checks of the clock when running
+  //! freely.  The simulator polls every few instructions, and reading the
+  //! clock costs far more than that.
+
+  static const int POLL_CLOCK_PERIOD = 1024;
+
+  //! The simulator instance currently running freely on this thread, if
+  //! any.  The host callbacks are not passed any context of their own.
+
+  static thread_local GdbSimImpl * sRunning;
+
+  //! Are we enforcing a deadline while running freely?
+
+  bool  mHaveDeadline;
+
+  //! When we must stop running freely
+
+  std::chrono::time_point <std::chrono::system_clock,
+			   std::chrono::duration <double> >  mDeadline;
+
+  //! Count of polls since we last checked the clock
+
+  int  mPollCount;
+
+  //! Are we enforcing a budget of polls while running freely?
+
+  bool  mHaveBudget;
+
+  //! How many polls we have left of the budget
+
+  uint64_t  mBudgetLeft;
+
+  //! Did we stop running freely because of the deadline?
+
+  bool  mTimedOut;
+
+  //! Did we stop running freely because of a syscall?
+
+  bool  mSyscallPending;
+
+  //! The value of A0 when the syscall trapped, before the simulator
+  //! overwrote it with its own result.
+
+  uint_reg_t  mSyscallA0;
+
+  //! The profile to sample into, if any
+
+  Profile * mProfile;
+
+  //! Count of polls since we last took a profile sample.  The simulator
+  //! counts no cycles, so the profile period is in polls.
+
+  uint64_t  mProfilePolls;
+
+  //! The breakpoints we are holding.
+
+  MpHash  mMatchpoints;
+
+  //! Breakpoints currently planted in memory, with the instructions they
+  //! displaced.
+
+  std::vector<std::pair<uint32_t, uint32_t> >  mPlanted;
+
+  //! Are our breakpoints planted in memory?  They stay planted from one
+  //! timed out run to the next, until we really stop.
+
+  bool  mBreaksPlanted;
+
   ITarget::ResumeRes doOneStep (std::chrono::duration <double>);
-  ITarget::ResumeRes doRunToBreak (std::chrono::duration <double>);
+  ITarget::ResumeRes doRunToBreak (std::chrono::duration <double>,
+				   uint64_t  budget);
+  bool  atBreak (uint_reg_t  addr) const;
+  bool  isBreakpoint (uint32_t  addr);
+  void  plantBreakpoints ();
+  void  unplantBreakpoints ();
+
+  // Host callbacks hooked while running freely
+
+  static int  pollQuit (host_callback * cb);
+  template <typename R, typename... Args>
+  static R  trapSyscall (host_callback * cb,
+			 Args...);
 };
 
 #endif	// GDBSIM_IMPL_H
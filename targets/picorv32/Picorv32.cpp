@@ -26,6 +26,7 @@
 
 #include "Picorv32.h"
 #include "Picorv32Impl.h"
+#include "Profile.h"
 #include "Vtestbench_testbench.h"
 #include "Vtestbench_picorv32__C1_EF1_EH1.h"
 
@@ -47,16 +48,38 @@ static const size_t RUN_SAMPLE_PERIOD = 10000;
 Picorv32::Picorv32 (TraceFlags * flags) :
   ITarget (flags),
   mServer (nullptr),
-  mFlags (flags)
+  mBreakFlag (nullptr),
+  mFlags (flags),
+  mInsnTrace (nullptr),
+  mInsnTraceOn (false),
+  mProfile (nullptr),
+  mProfileNext (0)
 {
   mPicorv32Impl = new Picorv32Impl (flags);
 
+  // With the disas trace flag, we record instructions from the start.
+
+  if (flags->traceDisas ())
+    (void) traceInsns (true);
+
 }	// Picorv32::Picorv32 ()
 
 
+//! Destructor
+
+//! Save any instruction trace asked for by the disas trace flag.
+
 Picorv32::~Picorv32()
 {
   delete mPicorv32Impl;
+
+  if (nullptr != mInsnTrace)
+    {
+      if (mFlags->traceDisas ())
+	(void) mInsnTrace->save ("gdbserver.itrace");
+
+      delete mInsnTrace;
+    }
 }
 
 ITarget::ResumeRes
@@ -72,39 +95,129 @@ Picorv32::resume (ResumeType step,
   time_point <system_clock, duration <double> > timeout_end =
     system_clock::now () + timeout;
 
+  mPicorv32Impl->clearWatchHit ();
+
+  if (ResumeType::STOP != step)
+  {
+    mSnapshot.noteResume ();
+  }
+
   switch (step)
   {
   case ResumeType::STEP:
     if (mPicorv32Impl->step ())
     {
-      return ResumeRes::TIMEOUT;
-    } else {
       return ResumeRes::INTERRUPTED;
+    } else if (mPicorv32Impl->haveWatchHit ()) {
+      return ResumeRes::WATCHPOINT;
+    } else {
+      return ResumeRes::STEPPED;
     }
     break;
   case ResumeType::CONTINUE:
-    for (;;)
+    return runToBreak (timeout_end, 0);
+  case ResumeType::STOP:
+    // Do nothing. We are already "stopped"?
+    break;
+  }
+  return ResumeRes::NONE;
+}
+
+//! Resume execution with a budget
+
+//! The budget is in instructions, and only applies to continuing, since a
+//! step is a single instruction anyway.
+
+//! @param[in] step    Type of resumption required
+//! @param[in] budget  Maximum instructions to run.  Zero means no limit.
+//! @return  Why we stopped.
+
+ITarget::ResumeRes
+Picorv32::resume (ResumeType step,
+        uint64_t  budget)
+{
+  if (ResumeType::CONTINUE != step)
+  {
+    return resume (step, duration <double>::zero ());
+  }
+
+  mPicorv32Impl->clearWatchHit ();
+  mSnapshot.noteResume ();
+  return runToBreak (time_point <system_clock, duration <double> >::max (),
+                     budget);
+}
+
+
+//! Run until a breakpoint, watchpoint or trap, or we are out of time or
+//! budget
+
+//! Each step clocks the model in batches (@see Picorv32Impl::step ()), and
+//! we only ask for the PC after it if we are holding breakpoints.
+
+//! Without a budget, we look at the clock every RUN_SAMPLE_PERIOD
+//! instructions.  With one, the clock doesn't matter.  Either way we look at
+//! any break flag every RUN_SAMPLE_PERIOD instructions.  If we are
+//! profiling, we sample the PC after the instruction which takes us past
+//! each profile period.
+
+//! @param[in] timeout_end  When to stop, if there is no budget
+//! @param[in] budget       Maximum instructions to run.  Zero means no
+//!                         budget.
+//! @return  Why we stopped.
+
+ITarget::ResumeRes
+Picorv32::runToBreak (time_point <system_clock, duration <double> > timeout_end,
+                      uint64_t  budget)
+{
+  uint64_t  left = budget;
+
+  for (;;)
+  {
+    bool  profiling = (nullptr != mProfile) && mProfile->isOn ();
+    bool  breaking  = mMatchpoints.any (BP_MEMORY)
+      || mMatchpoints.any (BP_HARDWARE);
+
+    for (size_t i = 0; i < RUN_SAMPLE_PERIOD; i++)
     {
-      for (size_t i = 0; i < RUN_SAMPLE_PERIOD; i++)
+      if (mPicorv32Impl->step ())
+      {
+        return ResumeRes::INTERRUPTED;
+      }
+
+      if (profiling && (mPicorv32Impl->getCycleCount () >= mProfileNext))
       {
-        if (mPicorv32Impl->step ())
-        {
-          return ResumeRes::INTERRUPTED;
-        }
+        mProfile->sample (mPicorv32Impl->readProgramAddr ());
+        mProfileNext = mPicorv32Impl->getCycleCount () + mProfile->period ();
       }
 
-      if (timeout_end < system_clock::now ())
+      if (mPicorv32Impl->haveWatchHit ())
+      {
+        return ResumeRes::WATCHPOINT;
+      }
+
+      if (breaking && isBreakpoint (mPicorv32Impl->readProgramAddr ()))
+      {
+        return ResumeRes::INTERRUPTED;
+      }
+
+      if ((0 != budget) && (0 == --left))
       {
         return ResumeRes::TIMEOUT;
       }
     }
-    break;
-  case ResumeType::STOP:
-    // Do nothing. We are already "stopped"?
-    break;
+
+    if ((nullptr != mBreakFlag)
+        && mBreakFlag->load (std::memory_order_relaxed))
+    {
+      return ResumeRes::TIMEOUT;
+    }
+
+    if ((0 == budget) && (timeout_end < system_clock::now ()))
+    {
+      return ResumeRes::TIMEOUT;
+    }
   }
-  return ResumeRes::NONE;
-}
+}	// Picorv32::runToBreak ()
 
 ITarget::ResumeRes
 Picorv32::terminate ()
@@ -118,6 +231,16 @@ Picorv32::reset (ITarget::ResetType  type  __attribute__ ((unused)) )
 {
   delete mPicorv32Impl;
   mPicorv32Impl = new Picorv32Impl (mFlags);
+  mSnapshot.forgetWrites ();
+  updateWatch ();
+
+  // The cycle count starts again, so the trace must too.
+
+  if (nullptr != mInsnTrace)
+    mInsnTrace->clear ();
+
+  updateTrace ();
+  updateSnapshot ();
 
   if (mPicorv32Impl)
   {
@@ -167,10 +290,7 @@ Picorv32::read (const uint32_t addr,
                 uint8_t * buffer,
                 const std::size_t  size) const
 {
-  size_t i;
-  for (i = 0; i < size; i++)
-    buffer[i] = mPicorv32Impl->readMem (addr + i);
-  return i;
+  return mPicorv32Impl->readMem (addr, buffer, size);
 }
 
 std::size_t
@@ -178,25 +298,204 @@ Picorv32::write (const uint32_t addr,
                  const uint8_t * buffer,
                  const std::size_t size)
 {
-  size_t i;
-  for (i = 0; i < size; i++)
-    mPicorv32Impl->writeMem (addr + i, buffer[i]);
-  return i;
+  mSnapshot.noteWrite (this, addr, size);
+  return mPicorv32Impl->writeMem (addr, buffer, size);
 }
 
+//! Insert a matchpoint (breakpoint or watchpoint)
+
+//! We hold breakpoints of either kind ourselves, and the continue loop
+//! checks the PC against them, so no memory need be changed.  Watchpoints
+//! are also held by us, but matched against the memory bus by the
+//! implementation.
+
+//! @param[in] addr       Address for the matchpoint
+//! @param[in] matchType  Type of breakpoint or watchpoint
+//! @return  TRUE if the operation was successful, false otherwise.
+
 bool
 Picorv32::insertMatchpoint (const uint32_t  addr, const MatchType matchType)
 {
-  std::cerr << "insertMatchpoint NOT IMPLEMENTED" << std::endl;
-  return false;
-}
+  switch (matchType)
+  {
+  case MatchType::BREAK:
+  case MatchType::BREAK_HW:
+    mMatchpoints.add (static_cast<MpType> (matchType), addr, 0);
+    return true;
+
+  case MatchType::WATCH_WRITE:
+  case MatchType::WATCH_READ:
+  case MatchType::WATCH_ACCESS:
+    mMatchpoints.add (static_cast<MpType> (matchType), addr, 0);
+    updateWatch ();
+    return true;
+
+  default:
+    return false;
+  }
+}	// Picorv32::insertMatchpoint ()
+
+
+//! Remove a matchpoint (breakpoint or watchpoint)
+
+//! @param[in] addr       Address for the matchpoint
+//! @param[in] matchType  Type of breakpoint or watchpoint
+//! @return  TRUE if the operation was successful, false otherwise.
 
 bool
 Picorv32::removeMatchpoint (const uint32_t  addr, const MatchType matchType)
 {
-  std::cerr << "removeMatchpoint NOT IMPLEMENTED" << std::endl;
-  return false;
-}
+  switch (matchType)
+  {
+  case MatchType::BREAK:
+  case MatchType::BREAK_HW:
+    return mMatchpoints.remove (static_cast<MpType> (matchType), addr);
+
+  case MatchType::WATCH_WRITE:
+  case MatchType::WATCH_READ:
+  case MatchType::WATCH_ACCESS:
+    {
+      bool res = mMatchpoints.remove (static_cast<MpType> (matchType), addr);
+
+      updateWatch ();
+      return res;
+    }
+
+  default:
+    return false;
+  }
+}	// Picorv32::removeMatchpoint ()
+
+
+//! Find the watchpoint which last stopped execution
+
+//! @param[out] addr       Address of the byte which was watched
+//! @param[out] matchType  Type of watchpoint
+//! @return  TRUE if the last resume stopped at a watchpoint, FALSE
+//!          otherwise.
+
+bool
+Picorv32::lastWatchpoint (uint32_t & addr, MatchType & matchType) const
+{
+  return mPicorv32Impl->lastWatchpoint (addr, matchType);
+
+}	// Picorv32::lastWatchpoint ()
+
+
+//! The size of the block of memory read together
+
+//! PicoRV32 always reads a whole word, even for a byte or halfword load, and
+//! the memory bus doesn't say which bytes it wanted (@see
+//! Picorv32Impl::snoopMemBus ()).  So a read or access watchpoint on only
+//! part of a word would also be hit by loads of its neighbours.
+
+//! @return  Always 4, the size of a word.
+
+std::size_t
+Picorv32::readGranule () const
+{
+  return  4;
+
+}	// Picorv32::readGranule ()
+
+
+//! Is there a breakpoint of either kind at an address?
+
+//! Cheap when there are no breakpoints, since the lookup first checks there
+//! are any of the type.
+
+//! @param[in] addr  The address to check
+//! @return  TRUE if we are holding a breakpoint at addr.
+
+bool
+Picorv32::isBreakpoint (uint32_t  addr)
+{
+  return (NULL != mMatchpoints.lookup (BP_MEMORY, addr))
+    || (NULL != mMatchpoints.lookup (BP_HARDWARE, addr));
+
+}	// Picorv32::isBreakpoint ()
+
+
+//! Tell the implementation about our watchpoints
+
+//! It only needs the table if there are watchpoints, so it can snoop the
+//! memory bus at no cost otherwise.
+
+void
+Picorv32::updateWatch ()
+{
+  bool watching = mMatchpoints.any (WP_WRITE)
+    || mMatchpoints.any (WP_READ)
+    || mMatchpoints.any (WP_ACCESS);
+
+  mPicorv32Impl->watch (watching ? &mMatchpoints : nullptr);
+
+}	// Picorv32::updateWatch ()
+
+//! Tell the implementation where to record instructions
+
+//! It only needs the trace while we are recording, so it need not look at
+//! each instruction otherwise.
+
+void
+Picorv32::updateTrace ()
+{
+  mPicorv32Impl->trace (mInsnTraceOn ? mInsnTrace : nullptr);
+
+}	// Picorv32::updateTrace ()
+
+
+//! Tell the implementation about our snapshot
+
+//! It only needs it if we have one, so it can snoop the memory bus at no
+//! cost otherwise.
+
+void
+Picorv32::updateSnapshot ()
+{
+  mPicorv32Impl->snapshot (mSnapshot.haveSnapshot () ? &mSnapshot : nullptr);
+
+}	// Picorv32::updateSnapshot ()
+
+
+//! Save a snapshot of the target state
+
+//! From now on the old value of every byte the program stores to is noted,
+//! so it can be rolled back.
+
+//! @return  TRUE if the snapshot was saved, FALSE otherwise.
+
+bool
+Picorv32::saveSnapshot ()
+{
+  bool  res = mSnapshot.save (this);
+
+  updateSnapshot ();
+  return  res;
+
+}	// Picorv32::saveSnapshot ()
+
+
+//! Restore the target state from the last snapshot
+
+//! The model is restored in place, rather than rebuilt.  Any trap since the
+//! snapshot is cleared, then every byte changed since, by the program or
+//! the debugger, is rolled back, and the memory and registers saved
+//! written back.
+
+//! @return  TRUE if the target was restored, FALSE otherwise.
+
+bool
+Picorv32::restoreSnapshot ()
+{
+  if (!mSnapshot.haveSnapshot ())
+    return  false;
+
+  mPicorv32Impl->clearTrapAndRestartInstruction ();
+  return  mSnapshot.restore (this);
+
+}	// Picorv32::restoreSnapshot ()
+
 
 bool
 Picorv32::command (const std::string cmd, std::ostream & stream)
@@ -213,6 +512,82 @@ Picorv32::gdbServer (GdbServer *server)
 }
 
 
+//! Record the flag telling us to stop
+
+//! We look at it every RUN_SAMPLE_PERIOD instructions (@see runToBreak ()).
+
+//! @param[in] flag  The flag to watch while running, or NULL if none.
+
+void
+Picorv32::breakFlag (const std::atomic<bool> * flag)
+{
+  mBreakFlag = flag;
+}
+
+
+//! Start or stop recording instructions
+
+//! The buffer is only made when first needed, and is kept when we stop, so
+//! what was recorded can still be read.
+
+//! @param[in] on  TRUE to start recording instructions, FALSE to stop
+//! @return  TRUE, since we can always record instructions
+
+bool
+Picorv32::traceInsns (bool  on)
+{
+  if (on && (nullptr == mInsnTrace))
+    mInsnTrace = new InsnTrace;
+
+  mInsnTraceOn = on;
+  updateTrace ();
+  return  true;
+
+}	// Picorv32::traceInsns ()
+
+
+//! The instructions recorded
+
+//! @return  The instructions recorded, or NULL if we have never been asked
+//!          to record them.
+
+const InsnTrace *
+Picorv32::insnTrace () const
+{
+  return  mInsnTrace;
+
+}	// Picorv32::insnTrace ()
+
+
+//! Can the instructions recorded be given to GDB as branch trace?
+
+//! Yes.  Each instruction is recorded at the address it was executed from,
+//! once it has retired (@see Picorv32Impl::step ()), so GDB decodes the
+//! trace from the right boundaries.
+
+//! @return  Always TRUE
+
+bool
+Picorv32::branchTrace () const
+{
+  return  true;
+
+}	// Picorv32::branchTrace ()
+
+
+//! Record the profile to sample into
+
+//! We sample while running freely (@see runToBreak ()).
+
+//! @param[in] prof  The profile to sample into, or NULL if none.
+
+void
+Picorv32::profile (Profile * prof)
+{
+  mProfile = prof;
+}
+
+
 //! Return a timestamp.
 
 //! This is needed to support the $time function in Verilog.  This in turn is
@@ -23,7 +23,10 @@
 #ifndef PICORV32_H
 #define PICORV32_H
 
+#include "InsnTrace.h"
 #include "ITarget.h"
+#include "MpHash.h"
+#include "Snapshot.h"
 
 
 class Picorv32Impl;
@@ -46,6 +49,8 @@ class Picorv32 final : public ITarget
   virtual ResumeRes  resume (ResumeType step);
   virtual ResumeRes  resume (ResumeType step,
                              std::chrono::duration <double>  timeout);
+  virtual ResumeRes  resume (ResumeType step,
+                             uint64_t  budget);
 
   virtual ResumeRes  terminate ();
   virtual ResumeRes  reset (ITarget::ResetType  type);
@@ -83,6 +88,20 @@ class Picorv32 final : public ITarget
   virtual bool  removeMatchpoint (const uint32_t  addr,
 				  const MatchType  matchType);
 
+  // Find the watchpoint which last stopped execution
+
+  virtual bool  lastWatchpoint (uint32_t & addr,
+				MatchType & matchType) const;
+
+  // Granularity of reads, for watchpoints
+
+  virtual std::size_t  readGranule () const;
+
+  // Save and restore a snapshot of the target state
+
+  virtual bool  saveSnapshot ();
+  virtual bool  restoreSnapshot ();
+
   // Generic pass through of command
 
   virtual bool command (const std::string  cmd,
@@ -92,6 +111,20 @@ class Picorv32 final : public ITarget
 
   void gdbServer (GdbServer *server);
 
+  // Watch for a request to stop
+
+  void breakFlag (const std::atomic<bool> * flag);
+
+  // Instruction trace
+
+  bool  traceInsns (bool  on);
+  const InsnTrace * insnTrace () const;
+  bool  branchTrace () const;
+
+  // Profiling
+
+  void  profile (Profile * prof);
+
 // Verilator support
 
   virtual double timeStamp ();
@@ -103,6 +136,10 @@ class Picorv32 final : public ITarget
 
   GdbServer *mServer;
 
+  //! Flag telling us to stop running, if any
+
+  const std::atomic<bool> * mBreakFlag;
+
   //! The traceflags we were given. @todo Should not have this in this class.
 
   TraceFlags *mFlags;
@@ -111,6 +148,43 @@ class Picorv32 final : public ITarget
 
   Picorv32Impl * mPicorv32Impl;
 
+  //! The matchpoints we are holding.  We check the PC against breakpoints
+  //! after each instruction when continuing, while the implementation
+  //! matches watchpoints against the memory bus.
+
+  MpHash  mMatchpoints;
+
+  //! The snapshot from which we can be restored, which also tracks the
+  //! memory written by the debugger.
+
+  Snapshot  mSnapshot;
+
+  //! The instructions recorded, or NULL if we have never been asked to
+  //! record them.  It belongs to us, not the implementation, so survives a
+  //! reset.
+
+  InsnTrace * mInsnTrace;
+
+  //! Are we recording instructions?
+
+  bool  mInsnTraceOn;
+
+  //! The profile to sample into, if any
+
+  Profile * mProfile;
+
+  //! The cycle on which to take the next profile sample
+
+  uint64_t  mProfileNext;
+
+  ResumeRes  runToBreak (std::chrono::time_point <std::chrono::system_clock,
+			 std::chrono::duration <double> >  timeout_end,
+			 uint64_t  budget);
+  bool  isBreakpoint (uint32_t  addr);
+  void  updateWatch ();
+  void  updateTrace ();
+  void  updateSnapshot ();
+
 };	// class Picorv232
 
 
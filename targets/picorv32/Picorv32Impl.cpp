@@ -35,21 +35,35 @@
 
 Picorv32Impl::Picorv32Impl (TraceFlags * flags) :
   mWantVcd (flags->traceVcd ()),
+  mTfp (nullptr),
+  mVcdFile (nullptr),
   mCpuTime (0),
   mClk (0),
-  mInstr (0)
+  mInstr (0),
+  mWatchpoints (nullptr),
+  mWatchHit (false),
+  mWatchAddr (0),
+  mWatchType (ITarget::MatchType::WATCH_WRITE),
+  mSnapshot (nullptr),
+  mInsnTrace (nullptr),
+  mFetching (false)
 {
   mCpu = new Vtestbench;
 
-  // Open VCD file if requested
+  // Open VCD file if requested, and choose how to advance the clock
+  // accordingly.
 
   if (mWantVcd)
     {
       Verilated::traceEverOn (true);
-      mTfp = new VerilatedVcdC;
+      mVcdFile = new AsyncVcdFile;
+      mTfp = new VerilatedVcdC (mVcdFile);
       mCpu->trace (mTfp, 99);
-      mTfp->open ("gdbserver.vcd");
+      mTfp->open (flags->traceVcdGz () ? "gdbserver.vcd.gz"
+		  : "gdbserver.vcd");
     }
+
+  selectClock ();
 }	// Picorv32Impl::Picorv32Impl ()
 
 
@@ -61,8 +75,12 @@ Picorv32Impl::~Picorv32Impl ()
 {
   // Close VCD file if requested
 
-  if (mWantVcd)
-    mTfp->close ();
+  if (nullptr != mTfp)
+    {
+      mTfp->close ();
+      delete mTfp;
+      delete mVcdFile;
+    }
 
   delete mCpu;
 }
@@ -98,21 +116,159 @@ Picorv32Impl::getInstrCount () const
 }	// Picorv32Impl::getInstrCount ()
 
 
-// ! Step one single clock of the processor
+//! Step several clocks of the processor
+
+//! Calls whichever implementation was chosen at construction.
+
+//! @param[in] n            The number of clocks to step
+//! @param[in] stopOnFetch  Stop at the clock an instruction fetch starts
+//! @return  The number of clocks actually stepped
+
+uint64_t
+Picorv32Impl::clockN (uint64_t  n,
+		      bool  stopOnFetch)
+{
+  return  (this->*mClockN) (n, stopOnFetch);
+
+}	// Picorv32Impl::clockN ()
+
+
+//! Step several clocks of the processor
+
+//! Specialized on whether we want VCD, so without VCD the loop is just
+//! setting the clock and eval (), and on whether we are snooping the memory
+//! bus, for watchpoints or a snapshot.  We stop early if a watchpoint is
+//! hit.
+
+//! We follow instruction fetches on the memory bus, which costs nothing,
+//! unlike asking the core for its PC.  If asked, we stop at the clock a
+//! fetch starts.
+
+//! @param[in] n            The number of clocks to step
+//! @param[in] stopOnFetch  Stop at the clock an instruction fetch starts
+//! @return  The number of clocks actually stepped
+
+template <bool WANT_VCD, bool WANT_WATCH>
+uint64_t
+Picorv32Impl::clockNImpl (uint64_t  n,
+			  bool  stopOnFetch)
+{
+  auto  tb = mCpu->testbench;
+  uint64_t  i;
+
+  for (i = 0; i < n; i++)
+    {
+      mCpu->clk = mClk;
+      mCpu->eval ();
+      mClk++;
+
+      if (WANT_VCD)
+	{
+	  mCpuTime += 5;		// in ns
+	  mTfp->dump (mCpuTime);
+	}
+
+      bool  fetchStarted = !mFetching;
+
+      mFetching    = tb->mem_valid && tb->mem_instr;
+      fetchStarted = fetchStarted && mFetching;
+
+      if (WANT_WATCH && snoopMemBus ())
+	{
+	  i++;
+	  break;
+	}
+
+      if (stopOnFetch && fetchStarted)
+	{
+	  i++;
+	  break;
+	}
+    }
+
+  return  i;
+
+}	// Picorv32Impl::clockNImpl ()
+
+
+//! Choose the routine to advance the clock
+
+//! This depends on whether we are generating VCD and whether there are any
+//! watchpoints or a snapshot, both of which need the memory bus snooped.
 
 void
-Picorv32Impl::clockStep ()
+Picorv32Impl::selectClock ()
 {
-  mCpu->clk = mClk;
-  mCpu->eval ();
-  mClk++;
+  bool  snooping = (nullptr != mWatchpoints) || (nullptr != mSnapshot);
 
   if (mWantVcd)
+    mClockN = snooping
+      ? &Picorv32Impl::clockNImpl<true, true>
+      : &Picorv32Impl::clockNImpl<true, false>;
+  else
+    mClockN = snooping
+      ? &Picorv32Impl::clockNImpl<false, true>
+      : &Picorv32Impl::clockNImpl<false, false>;
+
+}	// Picorv32Impl::selectClock ()
+
+
+//! Check the testbench memory bus for an access to a watched byte
+
+//! Reads are always of a whole word, while writes have a strobe for each
+//! byte written.  So a read of a watched byte may have been for another byte
+//! of its word, which is why read and access watchpoints must cover whole
+//! words (@see Picorv32::readGranule ()).  The first hit is recorded, and
+//! later ones are ignored until cleared.
+
+//! The testbench memory takes the access on a later rising edge, so a
+//! write has not yet landed, and if there is a snapshot we can note the old
+//! value of each byte written first.
+
+//! @return  TRUE if this clock hit a watchpoint for the first time.
+
+bool
+Picorv32Impl::snoopMemBus ()
+{
+  auto  tb = mCpu->testbench;
+
+  if (!tb->mem_valid || tb->mem_instr)
+    return  false;
+
+  uint32_t  wordAddr = tb->mem_addr & ~0x3;
+  bool      isWrite  = 0 != tb->mem_wstrb;
+  MpType    type     = isWrite ? WP_WRITE : WP_READ;
+  unsigned  strobe   = isWrite ? tb->mem_wstrb : 0xf;
+
+  if (isWrite && (nullptr != mSnapshot))
+    for (uint32_t  i = 0; i < 4; i++)
+      if ((0 != (strobe & (1 << i)))
+	  && !mSnapshot->haveOld (wordAddr + i))
+	mSnapshot->noteOld (wordAddr + i, tb->readMem (wordAddr + i));
+
+  if (mWatchHit || (nullptr == mWatchpoints))
+    return  false;
+
+  for (uint32_t  i = 0; i < 4; i++)
     {
-      mCpuTime += 5;			// in ns
-      mTfp->dump (mCpuTime);
+      if (0 == (strobe & (1 << i)))
+	continue;
+
+      if (nullptr != mWatchpoints->lookup (type, wordAddr + i))
+	mWatchType = static_cast<ITarget::MatchType> (type);
+      else if (nullptr != mWatchpoints->lookup (WP_ACCESS, wordAddr + i))
+	mWatchType = ITarget::MatchType::WATCH_ACCESS;
+      else
+	continue;
+
+      mWatchHit  = true;
+      mWatchAddr = wordAddr + i;
+      return  true;
     }
-}	// Picorv32Impl::clockStep ()
+
+  return  false;
+
+}	// Picorv32Impl::snoopMemBus ()
 
 
 // ! If trap is set, then get the processor in the right state to
@@ -136,7 +292,7 @@ Picorv32Impl::clearTrapAndRestartInstruction ()
     // the value we wrote above
     do
     {
-      clockStep ();
+      clockN (1);
     }
     while (prev_pc == readProgramAddr ());
     // pc now is at the prev instruction, which will effectively work as a NOP
@@ -152,16 +308,55 @@ Picorv32Impl::clearTrapAndRestartInstruction ()
 
 //! Step one instruction execution
 
+//! The instruction is done when the PC changes, but reading the PC is a DPI
+//! call, which costs far more than a clock.  The PC only changes once the
+//! next instruction is being fetched, so we clock in batches of
+//! FETCH_CHECK_CLOCKS, each stopping at the clock a fetch starts, looking
+//! at the PC and for a trap only between batches.  Once a fetch has
+//! started, we clock singly until the PC changes.
+
+//! The instruction is recorded once it has retired, if we are recording
+//! instructions, so the trace holds exactly the addresses executed.
+
+//! @return  TRUE if we hit a trap, FALSE otherwise.
+
 bool
 Picorv32Impl::step ()
 {
-  uint32_t prev_pc = readProgramAddr ();
-  do
-  {
-    clockStep ();
-  }
-  while (prev_pc == readProgramAddr () && haveTrap () == 0);
-  return haveTrap () == 1;
+  uint32_t  prevPc = readProgramAddr ();
+  bool  fetched = mFetching;
+
+  for (;;)
+    {
+      if (fetched)
+	(void) clockN (1);
+      else
+	fetched = (clockN (FETCH_CHECK_CLOCKS, true) < FETCH_CHECK_CLOCKS)
+	  || mFetching;
+
+      if (haveTrap ())
+	return  true;
+
+      if (prevPc != readProgramAddr ())
+	{
+	  mInstr++;
+
+	  if (nullptr != mInsnTrace)
+	    {
+	      uint8_t  buf[4];
+
+	      (void) readMem (prevPc, buf, sizeof (buf));
+	      mInsnTrace->record (prevPc,
+				  static_cast<uint32_t> (buf[0])
+				  | (static_cast<uint32_t> (buf[1]) << 8)
+				  | (static_cast<uint32_t> (buf[2]) << 16)
+				  | (static_cast<uint32_t> (buf[3]) << 24),
+				  mClk);
+	    }
+
+	  return  false;
+	}
+    }
 }	// Picorv32Impl::step ()
 
 
@@ -187,24 +382,51 @@ Picorv32Impl::haveTrap (void) const
 }	// haveTrap ()
 
 
-//! Read from memory
+//! Read a block from memory
 
-uint8_t
-Picorv32Impl::readMem (uint32_t addr) const
+//! The testbench only offers a byte wide task, so we look up the testbench
+//! once and then loop over it for the whole block.
+
+//! @param[in]  addr    Address to read from
+//! @param[out] buffer  Buffer into which read data is placed
+//! @param[in]  size    Number of bytes to read
+//! @return  Number of bytes read
+
+std::size_t
+Picorv32Impl::readMem (uint32_t     addr,
+		       uint8_t     *buffer,
+		       std::size_t  size) const
 {
-  uint8_t res = mCpu->testbench->readMem (addr);
-  return res;
+  auto  tb = mCpu->testbench;
+  std::size_t  i;
+
+  for (i = 0; i < size; i++)
+    buffer[i] = tb->readMem (addr + i);
+
+  return i;
 
 }	// Picorv32Impl::readMem ()
 
 
-//! Write to memory
+//! Write a block to memory
 
-void
-Picorv32Impl::writeMem (uint32_t addr,
-	       uint8_t  val)
+//! @param[in] addr    Address to write to
+//! @param[in] buffer  Buffer of data to write
+//! @param[in] size    Number of bytes to write
+//! @return  Number of bytes written
+
+std::size_t
+Picorv32Impl::writeMem (uint32_t       addr,
+			const uint8_t *buffer,
+			std::size_t    size)
 {
-  mCpu->testbench->writeMem (addr, val);
+  auto  tb = mCpu->testbench;
+  std::size_t  i;
+
+  for (i = 0; i < size; i++)
+    tb->writeMem (addr + i, buffer[i]);
+
+  return i;
 
 }	// Picorv32Impl::writeMem ()
 
@@ -248,13 +470,95 @@ Picorv32Impl::writeProgramAddr (uint32_t val)
   while (inReset ()) {
     // keep stepping the clock and writing PC while in reset, so that we are
     // at the desired start address once out of reset.
-    clockStep ();
+    clockN (1);
     mCpu->testbench->uut->writePc (val);
   }
 
 }	// Picorv32Impl::writeProgramAddr ()
 
 
+//! Set the watchpoints to match against the memory bus
+
+//! @param[in] watchpoints  The watchpoints, or NULL if there are none.
+
+void
+Picorv32Impl::watch (MpHash * watchpoints)
+{
+  mWatchpoints = watchpoints;
+  selectClock ();
+
+}	// Picorv32Impl::watch ()
+
+
+//! Forget any watchpoint hit
+
+void
+Picorv32Impl::clearWatchHit ()
+{
+  mWatchHit = false;
+
+}	// Picorv32Impl::clearWatchHit ()
+
+
+//! Have we hit a watchpoint since last cleared?
+
+bool
+Picorv32Impl::haveWatchHit () const
+{
+  return  mWatchHit;
+
+}	// Picorv32Impl::haveWatchHit ()
+
+
+//! Find the watchpoint hit since last cleared
+
+//! @param[out] addr       Address of the byte which was watched
+//! @param[out] matchType  Type of watchpoint
+//! @return  TRUE if there was a hit, FALSE otherwise.
+
+bool
+Picorv32Impl::lastWatchpoint (uint32_t & addr,
+			      ITarget::MatchType & matchType) const
+{
+  if (!mWatchHit)
+    return  false;
+
+  addr      = mWatchAddr;
+  matchType = mWatchType;
+  return  true;
+
+}	// Picorv32Impl::lastWatchpoint ()
+
+
+//! Set where to record instructions as they retire
+
+//! @param[in] insnTrace  Where to record instructions, or NULL to stop
+//!                       recording them.
+
+void
+Picorv32Impl::trace (InsnTrace * insnTrace)
+{
+  mInsnTrace = insnTrace;
+
+}	// Picorv32Impl::trace ()
+
+
+//! Set the snapshot to note the program's stores in
+
+//! We snoop the memory bus for stores while there is a snapshot (@see
+//! snoopMemBus ()).
+
+//! @param[in] snap  The snapshot, or NULL if there is none.
+
+void
+Picorv32Impl::snapshot (Snapshot * snap)
+{
+  mSnapshot = snap;
+  selectClock ();
+
+}	// Picorv32Impl::snapshot ()
+
+
 //! Provide a time stamp (needed for $time)
 
 //! We count in nanoseconds.
@@ -26,6 +26,11 @@
 #include <cstdint>
 
 #include "GdbServer.h"
+#include "InsnTrace.h"
+#include "ITarget.h"
+#include "MpHash.h"
+#include "Snapshot.h"
+#include "AsyncVcdFile.h"
 #include "TraceFlags.h"
 #include "Vtestbench.h"
 #include "verilated_vcd_c.h"
@@ -48,15 +53,34 @@ class Picorv32Impl final
   bool step (void);
   bool inReset (void) const;
   bool haveTrap (void) const;
-  uint8_t readMem (uint32_t addr) const;
-  void writeMem (uint32_t addr,
-		 uint8_t  val);
+  std::size_t readMem (uint32_t     addr,
+		       uint8_t     *buffer,
+		       std::size_t  size) const;
+  std::size_t writeMem (uint32_t       addr,
+			const uint8_t *buffer,
+			std::size_t    size);
   uint32_t readReg (unsigned int regno) const;
   void writeReg (unsigned int regno,
 		 uint32_t     val);
   uint32_t readProgramAddr () const;
   void writeProgramAddr (uint32_t addr);
 
+  // Watchpoint support
+
+  void watch (MpHash * watchpoints);
+  void clearWatchHit ();
+  bool haveWatchHit () const;
+  bool lastWatchpoint (uint32_t & addr,
+		       ITarget::MatchType & matchType) const;
+
+  // Instruction trace
+
+  void trace (InsnTrace * insnTrace);
+
+  // Snapshot to note the program's stores in
+
+  void snapshot (Snapshot * snap);
+
   // Verilog support functions
 
   double timeStamp ();
@@ -76,6 +100,10 @@ class Picorv32Impl final
 
   VerilatedVcdC * mTfp;
 
+  //! The file the VCD is written to in the background
+
+  AsyncVcdFile * mVcdFile;
+
   //! VCD time. This will be in ns and we have a 100MHz device
 
   vluint64_t  mCpuTime;
@@ -88,9 +116,57 @@ class Picorv32Impl final
 
   uint64_t  mInstr;
 
+  //! Watchpoints to match against the memory bus, or NULL if there are none.
+
+  MpHash * mWatchpoints;
+
+  //! Have we seen an access to a watched byte since last cleared?
+
+  bool  mWatchHit;
+
+  //! The watched byte which was accessed
+
+  uint32_t  mWatchAddr;
+
+  //! The type of watchpoint which was hit
+
+  ITarget::MatchType  mWatchType;
+
+  //! The snapshot to note the old value of each byte the program stores to,
+  //! or NULL if there is none.
+
+  Snapshot * mSnapshot;
+
+  //! Where to record instructions as they retire, or NULL if we are not
+  //! recording them.
+
+  InsnTrace * mInsnTrace;
+
+  //! Is the memory bus fetching an instruction?
+
+  bool  mFetching;
+
+  //! Most clocks to run between looking at the PC when stepping.  The batch
+  //! itself stops at the clock a fetch starts, after which the PC soon
+  //! changes.
+
+  const uint64_t FETCH_CHECK_CLOCKS = 16;
+
+  //! The routine to advance the clock, chosen according to whether we want
+  //! VCD and whether there are watchpoints or a snapshot.
+
+  uint64_t (Picorv32Impl::*mClockN) (uint64_t  n,
+				     bool  stopOnFetch);
+
   //! For advancing the clock
 
-  void clockStep (void);
+  uint64_t clockN (uint64_t  n,
+		   bool  stopOnFetch = false);
+  template <bool WANT_VCD, bool WANT_WATCH>
+  uint64_t clockNImpl (uint64_t  n,
+		       bool  stopOnFetch);
+  void selectClock ();
+  bool snoopMemBus ();
 };
 
 #endif
@@ -61,6 +61,9 @@ Ri5cy::~Ri5cy ()
 ITarget::ResumeRes
 Ri5cy::resume (ResumeType  step)
 {
+  if (ResumeType::STOP != step)
+    mSnapshot.noteResume ();
+
   return mRi5cyImpl->resume (step);
 
 }	// Ri5cy::resume ()
@@ -78,11 +81,34 @@ ITarget::ResumeRes
 Ri5cy::resume (ResumeType  step,
 	       std::chrono::duration <double>  timeout)
 {
+  if (ResumeType::STOP != step)
+    mSnapshot.noteResume ();
+
   return mRi5cyImpl->resume (step, timeout);
 
 }	// Ri5cy::resume ()
 
 
+//! Resume execution with a budget
+
+//! Wrapper for the implementation class
+
+//! @param[in] step         Type of resumption required
+//! @param[in] budget       Budget of work
+//! @return The type of termination encountered.
+
+ITarget::ResumeRes
+Ri5cy::resume (ResumeType  step,
+	       uint64_t  budget)
+{
+  if (ResumeType::STOP != step)
+    mSnapshot.noteResume ();
+
+  return mRi5cyImpl->resume (step, budget);
+
+}	// Ri5cy::resume ()
+
+
 //! Terminate execution
 
 //! Wrapper for the implementation class.
@@ -99,13 +125,16 @@ Ri5cy::terminate (void)
 
 //! Reset execution
 
-//! Wrapper for the implementation class.
+//! Wrapper for the implementation class.  The RAM keeps its contents, but
+//! the program starts again, so a snapshot may be saved once more.
 
 //! @return  Result of reset
 
 ITarget::ResumeRes
 Ri5cy::reset (ITarget::ResetType  type)
 {
+  mSnapshot.noteReset ();
+
   return mRi5cyImpl->reset (type);
 
 }	// Ri5cy::reset ()
@@ -206,6 +235,7 @@ Ri5cy::write (const uint32_t  addr,
 	      const uint8_t * buffer,
 	      const std::size_t size)
 {
+  mSnapshot.noteWrite (this, addr, size);
   return mRi5cyImpl->write (addr, buffer, size);
 
 }	// Ri5cy::write ()
@@ -245,6 +275,77 @@ Ri5cy::removeMatchpoint (const uint32_t  addr,
 }	// Ri5cy::removeMatchpoint ()
 
 
+//! Find the watchpoint which last stopped execution
+
+//! Wrapper for the implementation class.
+
+//! @param[out] addr       Address of the byte which was watched
+//! @param[out] matchType  Type of watchpoint
+//! @return  TRUE if the last resume stopped at a watchpoint, FALSE
+//!          otherwise.
+
+bool
+Ri5cy::lastWatchpoint (uint32_t & addr,
+		       MatchType & matchType) const
+{
+  return mRi5cyImpl->lastWatchpoint (addr, matchType);
+
+}	// Ri5cy::lastWatchpoint ()
+
+
+//! The size of the block of memory read together
+
+//! @return  Always 1, since the RAM data port has a byte enable for each
+//!          byte read (@see Ri5cyImpl::snoopDataBus ()).
+
+std::size_t
+Ri5cy::readGranule () const
+{
+  return  1;
+
+}	// Ri5cy::readGranule ()
+
+
+//! Save a snapshot of the target state
+
+//! @return  TRUE if the snapshot was saved, FALSE otherwise.
+
+bool
+Ri5cy::saveSnapshot ()
+{
+  bool  res = mSnapshot.save (this);
+
+  // From now on the old value of every byte the program stores to is
+  // noted, so it can be rolled back.
+  mRi5cyImpl->snapshot (mSnapshot.haveSnapshot () ? &mSnapshot : nullptr);
+  return  res;
+
+}	// Ri5cy::saveSnapshot ()
+
+
+//! Restore the target state from the last snapshot
+
+//! The model is put through a warm reset, to clear out the pipeline and the
+//! debug unit, before the memory and registers are written back.  Like any
+//! warm reset, this leaves the counters running.  It also leaves the RAM,
+//! but every byte changed since the snapshot, by the program or the
+//! debugger, is rolled back (@see Ri5cyImpl::snoopDataBus ()).
+
+//! @return  TRUE if the target was restored, FALSE otherwise.
+
+bool
+Ri5cy::restoreSnapshot ()
+{
+  if (!mSnapshot.haveSnapshot ()
+      || (ITarget::ResumeRes::SUCCESS
+	  != mRi5cyImpl->reset (ITarget::ResetType::WARM)))
+    return  false;
+
+  return  mSnapshot.restore (this);
+
+}	// Ri5cy::restoreSnapshot ()
+
+
 //! Pass a command through to the target
 
 //! Wrapper for the implementation class.
@@ -274,6 +375,72 @@ Ri5cy::gdbServer (GdbServer * server)
 }	// Ri5cy::gdbServer ()
 
 
+//! Wrapper for the implementation class
+
+//! @param[in] flag  The flag to watch while running
+
+void
+Ri5cy::breakFlag (const std::atomic<bool> * flag)
+{
+  mRi5cyImpl->breakFlag (flag);
+
+}	// Ri5cy::breakFlag ()
+
+
+//! Wrapper for the implementation class
+
+//! @param[in] on  TRUE to start recording instructions, FALSE to stop
+//! @return  TRUE, since we can record instructions
+
+bool
+Ri5cy::traceInsns (bool  on)
+{
+  return  mRi5cyImpl->traceInsns (on);
+
+}	// Ri5cy::traceInsns ()
+
+
+//! Wrapper for the implementation class
+
+//! @return  The instructions recorded, or NULL if none have been
+
+const InsnTrace *
+Ri5cy::insnTrace () const
+{
+  return  mRi5cyImpl->insnTrace ();
+
+}	// Ri5cy::insnTrace ()
+
+
+//! Can the instructions recorded be given to GDB as branch trace?
+
+//! No.  We record the words fetched on the RAM instruction port (@see
+//! Ri5cyImpl::snoopInsnBus ()), whose addresses are not those of
+//! compressed instructions, and which include prefetches discarded on a
+//! taken branch.  GDB would decode the trace from the wrong boundaries.
+
+//! @return  Always FALSE
+
+bool
+Ri5cy::branchTrace () const
+{
+  return  false;
+
+}	// Ri5cy::branchTrace ()
+
+
+//! Wrapper for the implementation class
+
+//! @param[in] prof  The profile to sample into, or NULL if none
+
+void
+Ri5cy::profile (Profile * prof)
+{
+  mRi5cyImpl->profile (prof);
+
+}	// Ri5cy::profile ()
+
+
 //! Return a timestamp.
 
 //! This is needed to support the $time function in Verilog.  This in turn is
@@ -20,11 +20,14 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <iomanip>
 #include <iostream>
 #include <cstdint>
 #include <cstdlib>
+#include <limits>
 #include <sstream>
 
+#include "AsyncVcdFile.h"
 #include "GdbServer.h"
 #include "Ri5cyImpl.h"
 #include "TraceFlags.h"
@@ -38,6 +41,7 @@ using std::chrono::time_point;
 using std::cerr;
 using std::cout;
 using std::endl;
+using std::istringstream;
 using std::ostringstream;
 
 //! Constructor.
@@ -49,24 +53,54 @@ using std::ostringstream;
 
 Ri5cyImpl::Ri5cyImpl (const TraceFlags * flags) :
   mServer (nullptr),
+  mBreakFlag (nullptr),
   mFlags (flags),
   mCoreHalted (false),
   mCycleCnt (0),
+  mDebugCycleCnt (0),
+  mBreaksPlanted (false),
+  mWatchHit (false),
+  mWatchAddr (0),
+  mWatchType (ITarget::MatchType::WATCH_WRITE),
   mInstrCnt (0),
+  mVcdFile (nullptr),
+  mTfp (nullptr),
+  mVcdOn (true),
+  mVcdFrom (0),
+  mVcdTo (std::numeric_limits<uint64_t>::max ()),
+  mInsnTrace (nullptr),
+  mInsnTraceOn (false),
+  mProfile (nullptr),
+  mProfileNext (0),
+  mSnapshot (nullptr),
   mCpuTime (0)
 {
   mCpu = new Vtop;
 
-  // Open VCD file if requested
+  // Open VCD file if requested, and choose how to clock the model
+  // accordingly.  The VCD is written by a background thread, so the model
+  // does not wait on the file.
 
   if (mFlags->traceVcd ())
     {
       Verilated::traceEverOn (true);
-      mTfp = new VerilatedVcdC;
+      mVcdFile = new AsyncVcdFile;
+      mTfp = new VerilatedVcdC (mVcdFile);
       mCpu->trace (mTfp, 99);
-      mTfp->open ("gdbserver.vcd");
+      mTfp->open (mFlags->traceVcdGz () ? "gdbserver.vcd.gz"
+		  : "gdbserver.vcd");
     }
 
+  // With the disas trace flag, we record instructions from the start.
+
+  if (mFlags->traceDisas ())
+    {
+      mInsnTrace = new InsnTrace;
+      mInsnTraceOn = true;
+    }
+
+  selectClock ();
+
   // Reset and halt the model
 
   resetModel ();
@@ -76,14 +110,27 @@ Ri5cyImpl::Ri5cyImpl (const TraceFlags * flags) :
 
 //! Destructor.
 
-//! Close VCD and delete the Verilator model.
+//! Close VCD, save any instruction trace asked for by the disas trace flag,
+//! and delete the Verilator model.
 
 Ri5cyImpl::~Ri5cyImpl ()
 {
   // Close VCD file if requested
 
-  if (mFlags->traceVcd ())
-    mTfp->close ();
+  if (nullptr != mTfp)
+    {
+      mTfp->close ();
+      delete mTfp;
+      delete mVcdFile;
+    }
+
+  if (nullptr != mInsnTrace)
+    {
+      if (mFlags->traceDisas ())
+	(void) mInsnTrace->save ("gdbserver.itrace");
+
+      delete mInsnTrace;
+    }
 
   delete mCpu;
 
@@ -119,6 +166,8 @@ ITarget::ResumeRes
 Ri5cyImpl::resume (ITarget::ResumeType step,
 		   duration <double>  timeout)
 {
+  mWatchHit = false;
+
   switch (step)
     {
     case ITarget::ResumeType::STEP:
@@ -127,7 +176,7 @@ Ri5cyImpl::resume (ITarget::ResumeType step,
 
     case ITarget::ResumeType::CONTINUE:
 
-      return runToBreak (timeout);
+      return runToBreak (timeout, 0);
 
     case ITarget::ResumeType::STOP:
 
@@ -147,6 +196,28 @@ Ri5cyImpl::resume (ITarget::ResumeType step,
 }	// Ri5cyImpl::resume ()
 
 
+//! Resume execution with a budget
+
+//! The budget is in cycles, and only applies to continuing, since a step is
+//! always short.
+
+//! @param[in]  step    The type of resume to carry out.
+//! @param[in]  budget  Maximum cycles to run for.  Zero means no limit.
+//! @return Why the target stopped.
+
+ITarget::ResumeRes
+Ri5cyImpl::resume (ITarget::ResumeType step,
+		   uint64_t  budget)
+{
+  if (ITarget::ResumeType::CONTINUE != step)
+    return resume (step, duration <double>::zero ());
+
+  mWatchHit = false;
+  return runToBreak (duration <double>::zero (), budget);
+
+}	// Ri5cyImpl::resume ()
+
+
 //! Terminate.
 
 //! This has no meaning for an embedded system, so it does nothing.
@@ -170,11 +241,17 @@ Ri5cyImpl::terminate ()
 ITarget::ResumeRes
 Ri5cyImpl::reset (ITarget::ResetType  type)
 {
+  unplantBreakpoints ();
+
   if (type == ITarget::ResetType::COLD)
     {
       mCycleCnt = 0;
+      mDebugCycleCnt = 0;
       mInstrCnt = 0;
 
+      if (nullptr != mInsnTrace)
+	mInsnTrace->clear ();
+
       // Reset the time to make it consistent with the other counters
       mCpuTime = 0;
     }
@@ -316,6 +393,11 @@ Ri5cyImpl::writeRegister (const int  reg,
 //! Otherwise we may have to put the memory external to the core instead of in
 //! top.sv, but that would be painful to implement.
 
+//! The model only offers a byte wide task, so we look up the RAM instance
+//! once and then loop over it for the whole block.  Our breakpoints may
+//! still be planted after a timed out continue (@see runToBreak ()), so we
+//! show the instructions they displaced instead.
+
 //! @param[in]  addr    Address to read from
 //! @param[out] buffer  Buffer into which read data is placed
 //! @param[in]  size    Number of bytes to read
@@ -326,10 +408,21 @@ Ri5cyImpl::read (const uint32_t  addr,
 		 uint8_t * buffer,
 		 const std::size_t  size) const
 {
+  auto  ram = mCpu->top->ram_i->dp_ram_i;
   size_t i;
 
   for (i = 0; i < size; i++)
-    buffer[i] = mCpu->top->ram_i->dp_ram_i->readByte (addr + i);
+    buffer[i] = ram->readByte (addr + i);
+
+  for (auto &p : mPlanted)
+    {
+      std::size_t  len = (0x3 == (p.second & 0x3)) ? 4 : 2;
+      const uint8_t * orig = reinterpret_cast<const uint8_t *> (&p.second);
+
+      for (std::size_t  j = 0; j < len; j++)
+	if ((p.first + j >= addr) && (p.first + j - addr < size))
+	  buffer[p.first + j - addr] = orig[j];
+    }
 
   return i;
 
@@ -342,6 +435,9 @@ Ri5cyImpl::read (const uint32_t  addr,
 
 //! For discussion, @see read ()
 
+//! Any breakpoints still planted are restored first, so the write can't be
+//! undone by restoring them later.
+
 //! @param[in] addr    Address to write to
 //! @param[in] buffer  Buffer of data to write
 //! @param[in] size    Number of bytes to write
@@ -352,10 +448,13 @@ Ri5cyImpl::write (const uint32_t  addr,
 		  const uint8_t * buffer,
 		  const std::size_t  size)
 {
+  auto  ram = mCpu->top->ram_i->dp_ram_i;
   size_t  i;
 
+  unplantBreakpoints ();
+
   for (i = 0; i < size; i++)
-    mCpu->top->ram_i->dp_ram_i->writeByte (addr + i, buffer[i]);
+    ram->writeByte (addr + i, buffer[i]);
 
   return i;
 
@@ -364,65 +463,223 @@ Ri5cyImpl::write (const uint32_t  addr,
 
 //! Insert a matchpoint (breakpoint or watchpoint)
 
-//! @todo
+//! We hold breakpoints of either kind in our own table, so inserting one
+//! costs no memory traffic.  They are only planted in memory, through the
+//! RAM backdoor, while continuing (@see runToBreak ()), so any still planted
+//! are restored before the table changes.
 
-//! It is acceptable to always fail. GDB will then use memory breakpoints,
-//! implemented by writing EBREAK to the location.
+//! Watchpoints are also held in the table, and matched against the data port
+//! of the RAM on every cycle while there are any (@see snoopDataBus ()).
 
 //! @param[in] addr       Address for the matchpoint
 //! @param[in] matchType  Type of breakpoint or watchpoint
 //! @return  TRUE if the operation was successful, false otherwise.
 
 bool
-Ri5cyImpl::insertMatchpoint (const uint32_t  addr __attribute__ ((unused)),
-			     const ITarget::MatchType  matchType __attribute__ ((unused)))
+Ri5cyImpl::insertMatchpoint (const uint32_t  addr,
+			     const ITarget::MatchType  matchType)
 {
-  return  false;
+  switch (matchType)
+    {
+    case ITarget::MatchType::BREAK:
+    case ITarget::MatchType::BREAK_HW:
 
-}	// Ri5cyImpl::insertMatchpoint ()
+      unplantBreakpoints ();
+      mMatchpoints.add (static_cast<MpType> (matchType), addr, 0);
+      return  true;
 
+    case ITarget::MatchType::WATCH_WRITE:
+    case ITarget::MatchType::WATCH_READ:
+    case ITarget::MatchType::WATCH_ACCESS:
 
-//! Insert a matchpoint (breakpoint or watchpoint)
+      mMatchpoints.add (static_cast<MpType> (matchType), addr, 0);
+      selectClock ();
+      return  true;
+
+    default:
+
+      return  false;
+    }
+}	// Ri5cyImpl::insertMatchpoint ()
 
-//! @todo
 
-//! It is acceptable to always fail. GDB will then use memory breakpoints,
-//! implemented by writing EBREAK to the location.
+//! Remove a matchpoint (breakpoint or watchpoint)
 
 //! @param[in] addr       Address for the matchpoint
 //! @param[in] matchType  Type of breakpoint or watchpoint
 //! @return  TRUE if the operation was successful, false otherwise.
 
 bool
-Ri5cyImpl::removeMatchpoint (const uint32_t  addr __attribute__ ((unused)),
-			     const ITarget::MatchType  matchType __attribute__ ((unused)) )
+Ri5cyImpl::removeMatchpoint (const uint32_t  addr,
+			     const ITarget::MatchType  matchType)
 {
-  return  false;
+  switch (matchType)
+    {
+    case ITarget::MatchType::BREAK:
+    case ITarget::MatchType::BREAK_HW:
+
+      unplantBreakpoints ();
+      return  mMatchpoints.remove (static_cast<MpType> (matchType), addr);
 
+    case ITarget::MatchType::WATCH_WRITE:
+    case ITarget::MatchType::WATCH_READ:
+    case ITarget::MatchType::WATCH_ACCESS:
+      {
+	bool  res = mMatchpoints.remove (static_cast<MpType> (matchType), addr);
+
+	selectClock ();
+	return  res;
+      }
+
+    default:
+
+      return  false;
+    }
 }	// Ri5cyImpl::removeMatchpoint ()
 
 
+//! Find the watchpoint which last stopped execution
+
+//! @param[out] addr       Address of the byte which was watched
+//! @param[out] matchType  Type of watchpoint
+//! @return  TRUE if the last resume stopped at a watchpoint, FALSE
+//!          otherwise.
+
+bool
+Ri5cyImpl::lastWatchpoint (uint32_t & addr,
+			   ITarget::MatchType & matchType) const
+{
+  if (!mWatchHit)
+    return  false;
+
+  addr      = mWatchAddr;
+  matchType = mWatchType;
+  return  true;
+
+}	// Ri5cyImpl::lastWatchpoint ()
+
+
 //! Generic pass through of command
 
-//! @todo
+//! The "speed" command is passed on by the server to add to its report of
+//! the speed of the model.  We report the cycles spent on the debug unit,
+//! which are counted as cycles but do not run the program.
 
-//! For now we have no commands, so we should never receive this, and thus
-//! always fail.
+//! If we are generating VCD, the "vcd" commands choose when it is dumped
+//! (@see vcdCommand ()).
 
 //!@param[in]  cmd     The command to process
 //!@param[out] stream  A stream to write any output from the command
-//!@return  TRUE if the command was handled successfully, FALSE otherwise. We
-//!         awlways return FALSE.
+//!@return  TRUE if the command was handled successfully, FALSE otherwise.
 
 bool
-Ri5cyImpl::command (const std::string  cmd __attribute__ ((unused)),
-		    std::ostream & stream __attribute__ ((unused)))
+Ri5cyImpl::command (const std::string  cmd,
+		    std::ostream & stream)
 {
+  if ("help" == cmd)
+    {
+      if (nullptr == mTfp)
+	return  false;
+
+      stream << "  vcd [on|off]" << endl
+	     << "    Report, start or stop dumping VCD" << endl
+	     << "  vcd cycles <from> [<to>]" << endl
+	     << "    Only dump VCD from cycle <from> until cycle <to>" << endl;
+      return  true;
+    }
+  else if ((0 == cmd.compare (0, 3, "vcd"))
+	   && ((3 == cmd.size ()) || (' ' == cmd[3])))
+    return  vcdCommand (cmd.substr (3), stream);
+  else if ("speed" == cmd)
+    {
+      stream << "Debug unit cycles:      " << mDebugCycleCnt;
+
+      if (0 != mCycleCnt)
+	stream << " (" << std::fixed << std::setprecision (1)
+	       << (static_cast<double> (mDebugCycleCnt) * 100.0
+		   / static_cast<double> (mCycleCnt))
+	       << "% of cycles)";
+
+      stream << std::endl;
+      return  true;
+    }
+
   return false;
 
 }	// Ri5cyImpl::command ()
 
 
+//! Control when VCD is dumped
+
+//! Dumping can be turned on and off, and limited to a range of cycles, so
+//! that a waveform can be got for just the part of the run of interest.  The
+//! range can be given before the run starts, so dumping starts and stops of
+//! its own accord.  With no arguments we just report the state of dumping.
+
+//! @param[in]  args    The command after "vcd"
+//! @param[out] stream  A stream for any output from the command
+//! @return  TRUE if the command was valid, FALSE otherwise.
+
+bool
+Ri5cyImpl::vcdCommand (const std::string  args,
+		       std::ostream & stream)
+{
+  if (nullptr == mTfp)
+    {
+      stream << "Not generating VCD: use the \"vcd\" trace flag" << endl;
+      return  false;
+    }
+
+  istringstream  iss (args);
+  std::string  sub;
+
+  if (iss >> sub)
+    {
+      if ("on" == sub)
+	mVcdOn = true;
+      else if ("off" == sub)
+	mVcdOn = false;
+      else if ("cycles" == sub)
+	{
+	  uint64_t  from;
+	  uint64_t  to = std::numeric_limits<uint64_t>::max ();
+
+	  if (!(iss >> from) || (!(iss >> to) && !iss.eof ()) || (to <= from))
+	    {
+	      stream << "Usage: vcd cycles <from> [<to>]" << endl;
+	      return  false;
+	    }
+
+	  mVcdFrom = from;
+	  mVcdTo = to;
+	}
+      else
+	return  false;
+
+      std::string  junk;
+
+      if (iss >> junk)
+	return  false;
+
+      selectClock ();
+    }
+
+  stream << "VCD dumping " << (mVcdOn ? "on" : "off");
+
+  if ((0 != mVcdFrom) || (std::numeric_limits<uint64_t>::max () != mVcdTo))
+    {
+      stream << ", from cycle " << mVcdFrom;
+
+      if (std::numeric_limits<uint64_t>::max () != mVcdTo)
+	stream << " until cycle " << mVcdTo;
+    }
+
+  stream << endl;
+  return  true;
+
+}	// Ri5cyImpl::vcdCommand ()
+
+
 //! Record the server we are associated with.
 
 //! @param[in] server  Our invoking server.
@@ -435,6 +692,84 @@ Ri5cyImpl::gdbServer (GdbServer *server)
 }	// Ri5cyImpl::gdbServer ()
 
 
+//! Record the flag telling us to stop
+
+//! We look at it as often as at the clock (@see runToBreak ()).
+
+//! @param[in] flag  The flag to watch while running, or NULL if none.
+
+void
+Ri5cyImpl::breakFlag (const std::atomic<bool> * flag)
+{
+  mBreakFlag = flag;
+
+}	// Ri5cyImpl::breakFlag ()
+
+
+//! Start or stop recording instructions
+
+//! The buffer is only made when first needed, and is kept when we stop, so
+//! what was recorded can still be read.
+
+//! @param[in] on  TRUE to start recording instructions, FALSE to stop
+//! @return  TRUE, since we can always record instructions
+
+bool
+Ri5cyImpl::traceInsns (bool  on)
+{
+  if (on && (nullptr == mInsnTrace))
+    mInsnTrace = new InsnTrace;
+
+  mInsnTraceOn = on;
+  selectClock ();
+  return  true;
+
+}	// Ri5cyImpl::traceInsns ()
+
+
+//! The instructions recorded
+
+//! @return  The instructions recorded, or NULL if we have never been asked
+//!          to record them.
+
+const InsnTrace *
+Ri5cyImpl::insnTrace () const
+{
+  return  mInsnTrace;
+
+}	// Ri5cyImpl::insnTrace ()
+
+
+//! Record the profile to sample into
+
+//! We sample while running freely (@see runToBreak ()).
+
+//! @param[in] prof  The profile to sample into, or NULL if none.
+
+void
+Ri5cyImpl::profile (Profile * prof)
+{
+  mProfile = prof;
+
+}	// Ri5cyImpl::profile ()
+
+
+//! Set the snapshot to note the program's stores in
+
+//! We snoop the RAM data port for stores while there is a snapshot (@see
+//! snoopDataBus ()).
+
+//! @param[in] snap  The snapshot, or NULL if there is none.
+
+void
+Ri5cyImpl::snapshot (Snapshot * snap)
+{
+  mSnapshot = snap;
+  selectClock ();
+
+}	// Ri5cyImpl::snapshot ()
+
+
 //! Provide a time stamp (needed for $time)
 
 //! We count in nanoseconds since (cold) reset.
@@ -457,24 +792,238 @@ Ri5cyImpl::timeStamp ()
 void
 Ri5cyImpl::clockModel ()
 {
-  mCpu->clk_i = 0;
-  mCpu->eval ();
+  clockN (1);
 
-  mCpuTime += CLK_PERIOD_NS / 2;
+}	// Ri5cyImpl::clockModel ()
 
-  if (mFlags->traceVcd ())
-    mTfp->dump (mCpuTime);
 
-  mCpu->clk_i = 1;
-  mCpu->eval ();
+//! Helper method to clock the model through several cycles
 
-  mCpuTime += CLK_PERIOD_NS / 2;
+//! Calls whichever implementation was chosen at construction.  It is up to
+//! the caller to set any other signals.
 
-  if (mFlags->traceVcd ())
-    mTfp->dump (mCpuTime);
+//! @param[in] n           The number of full cycles to clock
+//! @param[in] stopOnHalt  Stop at the cycle the core halts
+//! @return  The number of cycles actually clocked
 
-  mCycleCnt++;
-}	// Ri5cyImpl::clockModel ()
+uint64_t
+Ri5cyImpl::clockN (uint64_t  n,
+		   bool  stopOnHalt)
+{
+  return  (this->*mClockN) (n, stopOnHalt);
+
+}	// Ri5cyImpl::clockN ()
+
+
+//! Clock the model through several cycles
+
+//! Specialized on whether we want VCD, so without VCD the loop is just
+//! toggling the clock and eval (), and on whether we are snooping for
+//! watchpoints and for instructions to record.  The cycle count and time
+//! are updated once at the end.  With VCD, we only dump the cycles in the
+//! range asked for.
+
+//! If a watchpoint is hit we stop early, so the caller can halt the core as
+//! soon as possible.  If asked, we also stop once the core halts, so the
+//! cycles after the halt are neither run nor counted.
+
+//! @param[in] n           The number of full cycles to clock
+//! @param[in] stopOnHalt  Stop at the cycle the core halts
+//! @return  The number of cycles actually clocked
+
+template <bool WANT_VCD, bool WANT_WATCH, bool WANT_TRACE>
+uint64_t
+Ri5cyImpl::clockNImpl (uint64_t  n,
+		       bool  stopOnHalt)
+{
+  uint64_t  i;
+
+  for (i = 0; i < n; i++)
+    {
+      bool  dumping = WANT_VCD && (mCycleCnt + i >= mVcdFrom)
+	&& (mCycleCnt + i < mVcdTo);
+
+      mCpu->clk_i = 0;
+      mCpu->eval ();
+
+      if (WANT_VCD)
+	{
+	  mCpuTime += CLK_PERIOD_NS / 2;
+
+	  if (dumping)
+	    mTfp->dump (mCpuTime);
+	}
+
+      mCpu->clk_i = 1;
+      mCpu->eval ();
+
+      if (WANT_VCD)
+	{
+	  mCpuTime += CLK_PERIOD_NS / 2;
+
+	  if (dumping)
+	    mTfp->dump (mCpuTime);
+	}
+
+      if (WANT_TRACE)
+	snoopInsnBus (mCycleCnt + i);
+
+      if (WANT_WATCH && snoopDataBus ())
+	{
+	  i++;
+	  break;
+	}
+
+      if (stopOnHalt && mCpu->debug_halted_o)
+	{
+	  i++;
+	  break;
+	}
+    }
+
+  if (!WANT_VCD)
+    mCpuTime += i * CLK_PERIOD_NS;
+
+  mCycleCnt += i;
+  return  i;
+
+}	// Ri5cyImpl::clockNImpl ()
+
+
+//! Choose the routine to clock the model
+
+//! This depends on whether we are dumping VCD, whether there are any
+//! watchpoints or a snapshot, both of which need the data port snooped,
+//! and whether we are recording instructions, so must be called whenever
+//! any of these change.
+
+void
+Ri5cyImpl::selectClock ()
+{
+  bool  watching = mMatchpoints.any (WP_WRITE)
+    || mMatchpoints.any (WP_READ)
+    || mMatchpoints.any (WP_ACCESS)
+    || (nullptr != mSnapshot);
+
+  static uint64_t (Ri5cyImpl::* const CLOCKS[2][2][2]) (uint64_t, bool) = {
+    { { &Ri5cyImpl::clockNImpl<false, false, false>,
+	&Ri5cyImpl::clockNImpl<false, false, true> },
+      { &Ri5cyImpl::clockNImpl<false, true, false>,
+	&Ri5cyImpl::clockNImpl<false, true, true> } },
+    { { &Ri5cyImpl::clockNImpl<true, false, false>,
+	&Ri5cyImpl::clockNImpl<true, false, true> },
+      { &Ri5cyImpl::clockNImpl<true, true, false>,
+	&Ri5cyImpl::clockNImpl<true, true, true> } }
+  };
+
+  bool  dumping = (nullptr != mTfp) && mVcdOn;
+
+  mClockN = CLOCKS[dumping][watching][mInsnTraceOn];
+
+}	// Ri5cyImpl::selectClock ()
+
+
+//! Check the RAM data port for an access to a watched byte
+
+//! Port B of the dual ported RAM is the data port.  The address is that of
+//! the word, with byte enables for the bytes accessed, so we look up each
+//! enabled byte in turn.  The first hit is recorded, and later ones are
+//! ignored until the next resume.
+
+//! The RAM takes the access on the next rising edge, so a store has not yet
+//! landed, and if there is a snapshot we can note the old value of each
+//! byte stored to first.
+
+//! @return  TRUE if this cycle hit a watchpoint for the first time.
+
+bool
+Ri5cyImpl::snoopDataBus ()
+{
+  auto  ram = mCpu->top->ram_i->dp_ram_i;
+
+  if (!ram->en_b_i)
+    return  false;
+
+  uint32_t  wordAddr = ram->addr_b_i & ~0x3;
+  MpType    type     = ram->we_b_i ? WP_WRITE : WP_READ;
+
+  if (ram->we_b_i && (nullptr != mSnapshot))
+    for (uint32_t  i = 0; i < 4; i++)
+      if ((0 != (ram->be_b_i & (1 << i)))
+	  && !mSnapshot->haveOld (wordAddr + i))
+	mSnapshot->noteOld (wordAddr + i, ram->readByte (wordAddr + i));
+
+  if (mWatchHit)
+    return  false;
+
+  for (uint32_t  i = 0; i < 4; i++)
+    {
+      if (0 == (ram->be_b_i & (1 << i)))
+	continue;
+
+      if (nullptr != mMatchpoints.lookup (type, wordAddr + i))
+	mWatchType = static_cast<ITarget::MatchType> (type);
+      else if (nullptr != mMatchpoints.lookup (WP_ACCESS, wordAddr + i))
+	mWatchType = ITarget::MatchType::WATCH_ACCESS;
+      else
+	continue;
+
+      mWatchHit  = true;
+      mWatchAddr = wordAddr + i;
+      return  true;
+    }
+
+  return  false;
+
+}	// Ri5cyImpl::snoopDataBus ()
+
+
+//! Take a profile sample
+
+//! Reading the PC would need the core halted, so as for the instruction
+//! trace, we take the address last fetched on the RAM instruction port
+//! (@see snoopInsnBus ()), which is a few instructions ahead of the PC at
+//! most.
+
+void
+Ri5cyImpl::sampleProfile ()
+{
+  mProfile->sample (mCpu->top->ram_i->dp_ram_i->addr_a_i);
+  mProfileNext = mCycleCnt + mProfile->period ();
+
+}	// Ri5cyImpl::sampleProfile ()
+
+
+//! Record any instruction fetch on the RAM instruction port
+
+//! Port A of the dual ported RAM is the instruction port.  We can't see
+//! instructions retire, but the pipeline is short and in order, so the
+//! fetches are nearly the instructions executed.  The exceptions are
+//! fetches by the prefetcher which are discarded when a branch is taken.
+//! Fetches are of whole words, so a compressed instruction is recorded with
+//! the address of its word.  So this is a trace of fetches rather than of
+//! instructions, which we can't give GDB as branch trace (@see
+//! Ri5cy::branchTrace ()).
+
+//! @param[in] cycle  The cycle just clocked
+
+void
+Ri5cyImpl::snoopInsnBus (uint64_t  cycle)
+{
+  auto  ram = mCpu->top->ram_i->dp_ram_i;
+
+  if (!ram->en_a_i)
+    return;
+
+  uint32_t  addr = ram->addr_a_i & ~0x3;
+  uint32_t  insn = 0;
+
+  for (int  i = 3; i >= 0; i--)
+    insn = (insn << 8) | (ram->readByte (addr + i) & 0xff);
+
+  mInsnTrace->record (addr, insn, cycle);
+
+}	// Ri5cyImpl::snoopInsnBus ()
 
 
 //! Helper method to reset the model
@@ -554,6 +1103,8 @@ Ri5cyImpl::waitForHalt ()
 uint_reg_t
 Ri5cyImpl::readDebugReg (const uint16_t  dbg_reg)
 {
+  uint64_t  startCycles = mCycleCnt;
+
   // Set up the register to read
 
   mCpu->debug_req_i   = 1;
@@ -574,6 +1125,7 @@ Ri5cyImpl::readDebugReg (const uint16_t  dbg_reg)
   while (mCpu->debug_rvalid_o == 0)
     clockModel ();
 
+  mDebugCycleCnt += mCycleCnt - startCycles;
   return mCpu->debug_rdata_o;
 
 }	// Ri5cyImpl::readDebugReg ()
@@ -591,6 +1143,8 @@ void
 Ri5cyImpl::writeDebugReg (const uint16_t  dbg_reg,
 			  const uint_reg_t  dbg_val)
 {
+  uint64_t  startCycles = mCycleCnt;
+
   mCpu->debug_req_i   = 1;
   mCpu->debug_addr_i  = dbg_reg;
   mCpu->debug_we_i    = 1;
@@ -603,6 +1157,7 @@ Ri5cyImpl::writeDebugReg (const uint16_t  dbg_reg,
   while (mCpu->debug_gnt_o == 0);
 
   mCpu->debug_req_i = 0;		// Stop requesting
+  mDebugCycleCnt += mCycleCnt - startCycles;
 
 }	// Ri5cyImpl::writeDebugReg ()
 
@@ -621,6 +1176,8 @@ Ri5cyImpl::stepInstr (duration <double>  timeout)
   if (haveTimeout)
     timeout_end = system_clock::now () + timeout;
 
+  unplantBreakpoints ();
+
   // @todo Fetch enable turns off fetching of new instructions.
 
   mCpu->fetch_enable_i = 1;
@@ -629,6 +1186,9 @@ Ri5cyImpl::stepInstr (duration <double>  timeout)
   writeDebugReg (DBG_HIT, 0);				// Release
   waitForHalt ();
 
+  if (mWatchHit)
+    return ITarget::ResumeRes::WATCHPOINT;
+
   // @todo For now only timeout if it took too long.
 
   if (haveTimeout && (system_clock::now () > timeout_end))
@@ -689,15 +1249,65 @@ Ri5cyImpl::stoppedAtSyscall ()
 }	// Ri5cyImpl::checkForSyscall
 
 
+//! Run until the core halts or we time out
+
+//! Reading DBG_CTRL to see if we have halted takes a multi-cycle debug bus
+//! handshake, so instead we watch the core's debug_halted_o output, which
+//! costs nothing to check.  We clock in batches of HALT_CHECK_CYCLES, each
+//! stopping at the cycle debug_halted_o goes high, so we count only the
+//! cycles up to the halt.  We only look at the clock every
+//! TIMEOUT_CHECK_CYCLES, which is also how often we check any budget and
+//! the break flag.
+//! Once halted, we confirm via the debug unit before looking at why.
+
+//! If we are profiling, we take a sample between batches, once every
+//! profile period (@see sampleProfile ()).
+
+//! Our breakpoints stay planted if we time out, so a continue run in slices
+//! doesn't rewrite them on every slice.  They are restored when we really
+//! stop, or before the server next steps, touches memory or changes the
+//! breakpoints.
+
+//! @param[in] timeout  Maximum time to run.  Zero means no limit.
+//! @param[in] budget   Maximum cycles to run.  Zero means no limit.
+//! @return  Why we stopped.
+
 ITarget::ResumeRes
-Ri5cyImpl::runToBreak (duration <double>  timeout)
+Ri5cyImpl::runToBreak (duration <double>  timeout,
+		       uint64_t  budget)
 {
   bool haveTimeout = duration <double>::zero() != timeout;
+  uint64_t  cyclesRun = 0;
   time_point <system_clock, duration <double> > timeout_end;
 
   if (haveTimeout)
     timeout_end = system_clock::now () + timeout;
 
+  // If we are sitting on one of our breakpoints, step off it first, since
+  // planting it would stop us straight away.
+
+  if (mMatchpoints.any (BP_MEMORY) || mMatchpoints.any (BP_HARDWARE))
+    {
+      uint_reg_t  pc;
+
+      readRegister (REG_PC, pc);
+
+      if (isBreakpoint (pc))
+	{
+	  ITarget::ResumeRes  res = stepInstr (timeout);
+
+	  if (ITarget::ResumeRes::STEPPED != res)
+	    return  res;
+
+	  readRegister (REG_PC, pc);
+
+	  if (isBreakpoint (pc))
+	    return  ITarget::ResumeRes::INTERRUPTED;
+	}
+    }
+
+  plantBreakpoints ();
+
   mCpu->fetch_enable_i = 1;
 
   uint32_t newDbgCtrl;
@@ -705,16 +1315,43 @@ Ri5cyImpl::runToBreak (duration <double>  timeout)
   newDbgCtrl = readDebugReg (DBG_CTRL) & ~(DBG_CTRL_SSTE | DBG_CTRL_HALT);
   writeDebugReg (DBG_CTRL, newDbgCtrl);
 
-  // @todo this is a type of waitForHalt
+  while (true)
+    {
+      bool  profiling = (nullptr != mProfile) && mProfile->isOn ();
+      int  i = 0;
 
-  while (DBG_CTRL_HALT != (readDebugReg (DBG_CTRL) & DBG_CTRL_HALT))
-    if (haveTimeout && (system_clock::now () > timeout_end))
-      {
-	haltModel ();
-	return ITarget::ResumeRes::TIMEOUT;
-      }
-    else
-      clockModel ();
+      while ((i < TIMEOUT_CHECK_CYCLES) && !mCpu->debug_halted_o && !mWatchHit)
+	{
+	  i += static_cast<int> (clockN (HALT_CHECK_CYCLES, true));
+
+	  if (profiling && (mCycleCnt >= mProfileNext))
+	    sampleProfile ();
+	}
+
+      cyclesRun += i;
+
+      if (mWatchHit)
+	{
+	  haltModel ();
+	  unplantBreakpoints ();
+	  return ITarget::ResumeRes::WATCHPOINT;
+	}
+
+      if (mCpu->debug_halted_o)
+	break;
+
+      if ((haveTimeout && (system_clock::now () > timeout_end))
+	  || ((0 != budget) && (cyclesRun >= budget))
+	  || ((nullptr != mBreakFlag)
+	      && mBreakFlag->load (std::memory_order_relaxed)))
+	{
+	  haltModel ();
+	  return ITarget::ResumeRes::TIMEOUT;
+	}
+    }
+
+  waitForHalt ();
+  unplantBreakpoints ();
 
   if (stoppedAtSyscall ())
     return ITarget::ResumeRes::SYSCALL;
@@ -727,6 +1364,92 @@ Ri5cyImpl::runToBreak (duration <double>  timeout)
 }	// Ri5cyImpl::runToBreak ()
 
 
+
+//! Is there a breakpoint of either kind at an address?
+
+//! @param[in] addr  The address to check
+//! @return  TRUE if we are holding a breakpoint at addr.
+
+bool
+Ri5cyImpl::isBreakpoint (uint32_t  addr)
+{
+  return (NULL != mMatchpoints.lookup (BP_MEMORY, addr))
+    || (NULL != mMatchpoints.lookup (BP_HARDWARE, addr));
+
+}	// Ri5cyImpl::isBreakpoint ()
+
+
+//! Plant our breakpoints in memory
+
+//! Each is written through the RAM backdoor, so this works for memory the
+//! core itself cannot write.  We use C.EBREAK over a compressed instruction,
+//! so we never overwrite the following instruction.  Nothing is done if they
+//! are already planted.
+
+void
+Ri5cyImpl::plantBreakpoints ()
+{
+  if (mBreaksPlanted)
+    return;
+
+  mPlanted.clear ();
+
+  mMatchpoints.forEach ([this] (MpEntry & e) {
+      // A hardware breakpoint sharing its address with a software one only
+      // needs planting once.
+
+      if (((BP_MEMORY != e.type) && (BP_HARDWARE != e.type))
+	  || ((BP_HARDWARE == e.type)
+	      && (NULL != mMatchpoints.lookup (BP_MEMORY, e.addr))))
+	return;
+
+      uint32_t  instr;
+
+      read (e.addr, reinterpret_cast<uint8_t *> (&instr), sizeof (instr));
+      mPlanted.push_back (std::make_pair (e.addr, instr));
+
+      if (0x3 == (instr & 0x3))
+	{
+	  const uint32_t  ebreak = 0x00100073;
+	  write (e.addr, reinterpret_cast<const uint8_t *> (&ebreak),
+		 sizeof (ebreak));
+	}
+      else
+	{
+	  const uint16_t  c_ebreak = 0x9002;
+	  write (e.addr, reinterpret_cast<const uint8_t *> (&c_ebreak),
+		 sizeof (c_ebreak));
+	}
+    });
+
+  mBreaksPlanted = true;
+
+}	// Ri5cyImpl::plantBreakpoints ()
+
+
+//! Restore the instructions displaced by our planted breakpoints
+
+//! Nothing is done if they are not planted.  We note they are gone before
+//! restoring them, since write () restores them itself.
+
+void
+Ri5cyImpl::unplantBreakpoints ()
+{
+  if (!mBreaksPlanted)
+    return;
+
+  mBreaksPlanted = false;
+
+  for (auto &p : mPlanted)
+    {
+      std::size_t  len = (0x3 == (p.second & 0x3)) ? 4 : 2;
+      write (p.first, reinterpret_cast<const uint8_t *> (&p.second), len);
+    }
+
+  mPlanted.clear ();
+
+}	// Ri5cyImpl::unplantBreakpoints ()
+
 // Local Variables:
 // mode: C++
 // c-file-style: "gnu"
@@ -23,11 +23,20 @@
 #ifndef RI5CY_IMPL_H
 #define RI5CY_IMPL_H
 
+#include <atomic>
 #include <cstdint>
+#include <utility>
+#include <vector>
 
 #include "ITarget.h"
+#include "InsnTrace.h"
+#include "MpHash.h"
+#include "Profile.h"
+#include "Snapshot.h"
 #include "Vtop.h"
 
+class AsyncVcdFile;
+
 
 //! The RI5CY implementation class.
 
@@ -43,6 +52,8 @@ class Ri5cyImpl final
   ITarget::ResumeRes  resume (ITarget::ResumeType step);
   ITarget::ResumeRes  resume (ITarget::ResumeType step,
 			      std::chrono::duration <double>  timeout);
+  ITarget::ResumeRes  resume (ITarget::ResumeType step,
+			      uint64_t  budget);
 
   ITarget::ResumeRes  terminate ();
   ITarget::ResumeRes  reset (ITarget::ResetType  type);
@@ -80,6 +91,11 @@ class Ri5cyImpl final
   bool  removeMatchpoint (const uint32_t  addr,
 			  const ITarget::MatchType  matchType);
 
+  // Find the watchpoint which last stopped execution
+
+  bool  lastWatchpoint (uint32_t & addr,
+			ITarget::MatchType & matchType) const;
+
   // Generic pass through of command
 
   bool command (const std::string  cmd,
@@ -89,6 +105,23 @@ class Ri5cyImpl final
 
   void gdbServer (GdbServer *server);
 
+  // Watch for a request to stop
+
+  void breakFlag (const std::atomic<bool> * flag);
+
+  // Instruction trace
+
+  bool traceInsns (bool  on);
+  const InsnTrace * insnTrace () const;
+
+  // Profiling
+
+  void profile (Profile * prof);
+
+  // Snapshot to note the program's stores in
+
+  void snapshot (Snapshot * snap);
+
   // Verilog support functions
 
   double timeStamp ();
@@ -104,6 +137,16 @@ private:
 
   const int RESET_CYCLES = 5;
 
+  //! How many cycles to run between checks of the clock for a timeout
+
+  const int TIMEOUT_CHECK_CYCLES = 10000;
+
+  //! Most cycles to run between checks for the core halting.  The batch
+  //! itself stops at the cycle the core halts, so no cycles are counted
+  //! after it.
+
+  const int HALT_CHECK_CYCLES = 16;
+
   // Debug registers
 
   const uint16_t DBG_CTRL    = 0x0000;	//!< Debug control
@@ -151,6 +194,10 @@ private:
 
   GdbServer * mServer;
 
+  //! Flag telling us to stop running, if any
+
+  const std::atomic<bool> * mBreakFlag;
+
   //! The trace flags with which we were called.
 
   const TraceFlags * mFlags;
@@ -167,21 +214,107 @@ private:
 
   uint64_t  mCycleCnt;
 
+  //! Cycles spent on the debug unit, talking to the core rather than
+  //! running it.  Part of the cycle count.
+
+  uint64_t  mDebugCycleCnt;
+
+  //! The breakpoints we are holding.
+
+  MpHash  mMatchpoints;
+
+  //! Breakpoints currently planted in memory, with the instructions they
+  //! displaced.
+
+  std::vector<std::pair<uint32_t, uint32_t> >  mPlanted;
+
+  //! Are our breakpoints planted in memory?  They stay planted from one
+  //! timed out continue to the next, until we really stop.
+
+  bool  mBreaksPlanted;
+
+  //! Have we seen an access to a watched byte since the last resume?
+
+  bool  mWatchHit;
+
+  //! The watched byte which was accessed
+
+  uint32_t  mWatchAddr;
+
+  //! The type of watchpoint which was hit
+
+  ITarget::MatchType  mWatchType;
+
   //! Instruction count
 
   uint64_t  mInstrCnt;
 
+  //! The file the VCD is written to in the background
+
+  AsyncVcdFile * mVcdFile;
+
   //! VCD trace file pointer
 
   VerilatedVcdC * mTfp;
 
+  //! Are we dumping VCD at the moment?
+
+  bool  mVcdOn;
+
+  //! The range of cycles to dump, from mVcdFrom up to but not including
+  //! mVcdTo.
+
+  uint64_t  mVcdFrom;
+  uint64_t  mVcdTo;
+
+  //! The instructions fetched, NULL until we are first asked to record
+  //! them.
+
+  InsnTrace * mInsnTrace;
+
+  //! Are we recording instructions at the moment?
+
+  bool  mInsnTraceOn;
+
+  //! The profile to sample into, if any
+
+  Profile * mProfile;
+
+  //! The snapshot to note the old value of each byte the program stores to,
+  //! or NULL if there is none.
+
+  Snapshot * mSnapshot;
+
+  //! The cycle on which to take the next profile sample
+
+  uint64_t  mProfileNext;
+
   //! VCD time. This will be in ns and we have a 50MHz device
 
   vluint64_t  mCpuTime;
 
+  //! The routine to clock the model, chosen according to whether we want
+  //! VCD, whether there are watchpoints or a snapshot and whether we are
+  //! recording instructions, so the common case has nothing but eval () and the check
+  //! for halting in its loop.
+
+  uint64_t (Ri5cyImpl::*mClockN) (uint64_t  n,
+				  bool  stopOnHalt);
+
   // Helper methods
 
   void clockModel ();
+  uint64_t clockN (uint64_t  n,
+		   bool  stopOnHalt = false);
+  template <bool WANT_VCD, bool WANT_WATCH, bool WANT_TRACE>
+  uint64_t clockNImpl (uint64_t  n,
+		       bool  stopOnHalt);
+  void selectClock ();
+  bool vcdCommand (const std::string  args,
+		   std::ostream & stream);
+  bool snoopDataBus ();
+  void snoopInsnBus (uint64_t  cycle);
+  void sampleProfile ();
   void resetModel ();
   void haltModel ();
   void waitForHalt ();
@@ -189,9 +322,13 @@ private:
   void writeDebugReg (const uint16_t  dbg_reg,
 		      const uint_reg_t  dbg_val);
   ITarget::ResumeRes  stepInstr (std::chrono::duration <double>  timeout);
-  ITarget::ResumeRes  runToBreak (std::chrono::duration <double>  timeout);
+  ITarget::ResumeRes  runToBreak (std::chrono::duration <double>  timeout,
+				  uint64_t  budget);
 
   bool stoppedAtSyscall ();
+  bool isBreakpoint (uint32_t  addr);
+  void plantBreakpoints ();
+  void unplantBreakpoints ();
 };
 
 #endif	// RI5CY_IMPL_H
@@ -140,6 +140,9 @@ TraceFlags::TraceFlags () :
       sFlagInfo.push_back ({ TRACE_BREAK,  "break"  });
       sFlagInfo.push_back ({ TRACE_VCD,    "vcd"    });
       sFlagInfo.push_back ({ TRACE_SILENT, "silent" });
+      sFlagInfo.push_back ({ TRACE_SPEED,  "speed"  });
+      sFlagInfo.push_back ({ TRACE_VCDGZ,  "vcdgz"  });
+      sFlagInfo.push_back ({ TRACE_DISAS,  "disas"  });
     }
 }	// TraceFlags::TraceFlags ()
 
@@ -190,16 +193,30 @@ TraceFlags::traceBreak () const
 
 //! Is VCD tracing enabled?
 
-//! @return  TRUE if the VCD tracing flag is set, FALSE otherwise
+//! Compressed VCD is still VCD.
+
+//! @return  TRUE if either VCD tracing flag is set, FALSE otherwise
 
 bool
 TraceFlags::traceVcd () const
 {
-  return (mFlags & TRACE_VCD) == TRACE_VCD;
+  return (mFlags & (TRACE_VCD | TRACE_VCDGZ)) != 0;
 
 }	// TraceFlags::traceVcd ()
 
 
+//! Should the VCD be compressed?
+
+//! @return  TRUE if the VCDGZ tracing flag is set, FALSE otherwise
+
+bool
+TraceFlags::traceVcdGz () const
+{
+  return (mFlags & TRACE_VCDGZ) == TRACE_VCDGZ;
+
+}	// TraceFlags::traceVcdGz ()
+
+
 //! Is silent running enabled?
 
 //! @return  TRUE if the SILENT tracing flag is set, FALSE otherwise
@@ -212,6 +229,30 @@ TraceFlags::traceSilent () const
 }	// TraceFlags::traceSilent ()
 
 
+//! Is speed tracing enabled?
+
+//! @return  TRUE if the SPEED tracing flag is set, FALSE otherwise
+
+bool
+TraceFlags::traceSpeed () const
+{
+  return (mFlags & TRACE_SPEED) == TRACE_SPEED;
+
+}	// TraceFlags::traceSpeed ()
+
+
+//! Is instruction tracing enabled?
+
+//! @return  TRUE if the DISAS tracing flag is set, FALSE otherwise
+
+bool
+TraceFlags::traceDisas () const
+{
+  return (mFlags & TRACE_DISAS) == TRACE_DISAS;
+
+}	// TraceFlags::traceDisas ()
+
+
 //! Is this a real flag
 
 //! @param[in] flagName  Case insensitive name to check.
@@ -71,7 +71,10 @@ public:
   bool traceConn () const;
   bool traceBreak () const;
   bool traceVcd () const;
+  bool traceVcdGz () const;
   bool traceSilent () const;
+  bool traceSpeed () const;
+  bool traceDisas () const;
   bool isFlag (const char *flagName) const;
   void flag (const char *flagName,
 	     const bool  val);
@@ -92,7 +95,9 @@ private:
   static const unsigned int TRACE_BREAK  = 0x00000004;	//!< Trace breakpoints
   static const unsigned int TRACE_VCD    = 0x00000008;	//!< Generate VCD
   static const unsigned int TRACE_SILENT = 0x00000010;  //!< Reduce messages
-  static const unsigned int TRACE_DISAS  = 0x00000020;  //!< Reduce messages
+  static const unsigned int TRACE_DISAS  = 0x00000020;  //!< Trace instructions
+  static const unsigned int TRACE_SPEED  = 0x00000040;  //!< Model speed
+  static const unsigned int TRACE_VCDGZ  = 0x00000080;  //!< Compressed VCD
 
   static const unsigned int TRACE_NONE   = 0x00000000;	//!< Trace nothing
   static const unsigned int TRACE_BAD    = 0xffffffff;	//!< Invalid flag bit